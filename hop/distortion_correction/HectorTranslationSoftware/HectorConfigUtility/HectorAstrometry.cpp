@@ -0,0 +1,161 @@
+//
+//                    H e c t o r  A s t r o m e t r y . c p p
+//
+//  Function:
+//     A small utility class that does mean <-> apparent conversions for Hector
+//
+//  Description:
+//     This is the implementation of the HectorAstrometry class. See the
+//     comments in HectorAstrometry.h for details.
+//
+//  Author(s): Hector Observations Pipeline team, (HOP)
+//
+//  History:
+//     16th Oct 2026.  Original version. HOP.
+//
+
+#include "HectorAstrometry.h"
+
+#include "slalib.h"
+
+// ----------------------------------------------------------------------------------
+
+//                          C o n s t r u c t o r
+//
+//  The constructor sets the epoch to J2000, simply so that the object is always
+//  in a usable state. Normally, SetEpoch() will be called before it is used.
+
+HectorAstrometry::HectorAstrometry (void)
+{
+   SetEpoch (51544.5);
+}
+
+// ----------------------------------------------------------------------------------
+
+//                            S e t  E p o c h
+//
+//  Sets the observing time for which apparent positions are to be calculated,
+//  and the equinox of the mean positions, and works out the parameters needed
+//  for the conversions between the two. These parameters are then used for all
+//  conversions until SetEpoch() is called again.
+//
+//  Mjd      UTC observing date and time as modified julian date. (Strictly,
+//           slaMappa() wants TDB, but the difference is negligible here.)
+//  Equinox  Epoch of the mean equinox (Julian). Defaults to 2000.0.
+
+void HectorAstrometry::SetEpoch (double Mjd, double Equinox)
+{
+   I_Mjd = Mjd;
+   I_Equinox = Equinox;
+   slaMappa (Equinox,Mjd,I_Amprms);
+}
+
+// ----------------------------------------------------------------------------------
+
+//                            G e t  E p o c h
+//
+//  Returns the observing time, as a modified julian date, last set by
+//  SetEpoch().
+
+double HectorAstrometry::GetEpoch (void) const
+{
+   return I_Mjd;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                        M e a n  2  A p p a r e n t
+//
+//  Converts a mean position, with its proper motions, to an apparent position
+//  for the observing time set by SetEpoch(). This gives exactly the same result
+//  as the equivalent call to slaMap().
+//
+//  MeanRa   Mean Ra in radians.
+//  MeanDec  Mean Dec in radians.
+//  PmRa     Proper motion in Ra, as passed to slaMap().
+//  PmDec    Proper motion in Dec, as passed to slaMap().
+//  AppRa    Returned with the apparent Ra in radians.
+//  AppDec   Returned with the apparent Dec in radians.
+
+void HectorAstrometry::Mean2Apparent (
+   double MeanRa, double MeanDec, double PmRa, double PmDec,
+   double* AppRa, double* AppDec) const
+{
+   //  slaMapqk() doesn't modify its parameter array, but doesn't declare it
+   //  const either.
+
+   slaMapqk (MeanRa,MeanDec,PmRa,PmDec,0.0,0.0,
+                          const_cast<double*>(I_Amprms),AppRa,AppDec);
+}
+
+// ----------------------------------------------------------------------------------
+
+//                        A p p a r e n t  2  M e a n
+//
+//  Converts an apparent position for the observing time set by SetEpoch() to
+//  a mean position. This gives exactly the same result as the equivalent call
+//  to slaAmp().
+//
+//  AppRa    Apparent Ra in radians.
+//  AppDec   Apparent Dec in radians.
+//  MeanRa   Returned with the mean Ra in radians.
+//  MeanDec  Returned with the mean Dec in radians.
+
+void HectorAstrometry::Apparent2Mean (
+   double AppRa, double AppDec, double* MeanRa, double* MeanDec) const
+{
+   slaAmpqk (AppRa,AppDec,const_cast<double*>(I_Amprms),MeanRa,MeanDec);
+}
+
+// ----------------------------------------------------------------------------------
+
+//                   M e a n  2  A p p a r e n t  B a t c h
+//
+//  Converts an array of mean positions, with their proper motions, to apparent
+//  positions, exactly as Mean2Apparent() would convert each of them.
+//
+//  MeanRa   Array of mean Ra values in radians.
+//  MeanDec  Array of mean Dec values in radians.
+//  PmRa     Array of proper motions in Ra, as passed to slaMap(). If this
+//           is passed as NULL, the proper motions are taken as zero.
+//  PmDec    Array of proper motions in Dec, as passed to slaMap(). If this
+//           is passed as NULL, the proper motions are taken as zero.
+//  NPosns   Number of positions to convert.
+//  AppRa    Array to receive the apparent Ra values in radians.
+//  AppDec   Array to receive the apparent Dec values in radians.
+
+void HectorAstrometry::Mean2ApparentBatch (
+   const double MeanRa[], const double MeanDec[],
+   const double PmRa[], const double PmDec[], int NPosns,
+   double AppRa[], double AppDec[]) const
+{
+   for (int IPosn = 0; IPosn < NPosns; IPosn++) {
+      Mean2Apparent (MeanRa[IPosn],MeanDec[IPosn],
+            PmRa ? PmRa[IPosn] : 0.0,PmDec ? PmDec[IPosn] : 0.0,
+                                         &AppRa[IPosn],&AppDec[IPosn]);
+   }
+}
+
+// ----------------------------------------------------------------------------------
+
+//                   A p p a r e n t  2  M e a n  B a t c h
+//
+//  Converts an array of apparent positions to mean positions, exactly as
+//  Apparent2Mean() would convert each of them.
+//
+//  AppRa    Array of apparent Ra values in radians.
+//  AppDec   Array of apparent Dec values in radians.
+//  NPosns   Number of positions to convert.
+//  MeanRa   Array to receive the mean Ra values in radians.
+//  MeanDec  Array to receive the mean Dec values in radians.
+
+void HectorAstrometry::Apparent2MeanBatch (
+   const double AppRa[], const double AppDec[], int NPosns,
+   double MeanRa[], double MeanDec[]) const
+{
+   for (int IPosn = 0; IPosn < NPosns; IPosn++) {
+      Apparent2Mean (AppRa[IPosn],AppDec[IPosn],&MeanRa[IPosn],&MeanDec[IPosn]);
+   }
+}
+
+// ----------------------------------------------------------------------------------
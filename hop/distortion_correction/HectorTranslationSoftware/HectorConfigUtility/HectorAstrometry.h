@@ -0,0 +1,77 @@
+//
+//                    H e c t o r  A s t r o m e t r y . h
+//
+//  Function:
+//     A small utility class that does mean <-> apparent conversions for Hector
+//
+//  Description:
+//     This defines a C++ class, HectorAstrometry, that converts sky positions
+//     between mean J2000 Ra,Dec coordinates, as used in the target files, and
+//     apparent Ra,Dec coordinates for the observing time, as needed by the
+//     HectorRaDecXY coordinate converter. This is the same conversion that
+//     slaMap() and slaAmp() perform, but those work out all the precession,
+//     nutation and aberration parameters for the observing time each time
+//     they are called. A HectorAstrometry object works these out just once,
+//     when its epoch is set using SetEpoch(), and then uses slaMapqk() and
+//     slaAmpqk() for each position, which gives exactly the same results.
+//
+//     There are methods to convert single positions, and batch methods that
+//     convert arrays of positions. Once the epoch has been set, all the
+//     conversion methods are const and do not modify the object, so a single
+//     HectorAstrometry object can be shared by any number of threads, so long
+//     as none of them calls SetEpoch() while the others are using it.
+//
+//  Author(s): Hector Observations Pipeline team, (HOP)
+//
+//  History:
+//     16th Oct 2026.  Original version. HOP.
+//
+// ----------------------------------------------------------------------------------
+
+#ifndef __HectorAstrometry__
+#define __HectorAstrometry__
+
+class HectorAstrometry {
+public:
+   //  Constructor
+   HectorAstrometry (void);
+   //  Set the observing time, working out the mean to apparent parameters.
+   void SetEpoch (double Mjd, double Equinox = 2000.0);
+   //  Get the observing time as set by SetEpoch().
+   double GetEpoch (void) const;
+   //  Convert a mean position, with proper motions, to apparent
+   void Mean2Apparent (double MeanRa, double MeanDec, double PmRa,
+                  double PmDec, double* AppRa, double* AppDec) const;
+   //  Convert an apparent position to mean
+   void Apparent2Mean (double AppRa, double AppDec,
+                  double* MeanRa, double* MeanDec) const;
+   //  Convert an array of mean positions, with proper motions, to apparent
+   void Mean2ApparentBatch (const double MeanRa[], const double MeanDec[],
+                  const double PmRa[], const double PmDec[], int NPosns,
+                  double AppRa[], double AppDec[]) const;
+   //  Convert an array of apparent positions to mean
+   void Apparent2MeanBatch (const double AppRa[], const double AppDec[],
+                  int NPosns, double MeanRa[], double MeanDec[]) const;
+private:
+   //  UTC observing date and time as modified julian date.
+   double I_Mjd;
+   //  Epoch of the mean equinox used for mean positions (Julian).
+   double I_Equinox;
+   //  Mean to apparent parameters, as calculated by slaMappa().
+   double I_Amprms[21];
+};
+
+#endif
+
+// ----------------------------------------------------------------------------------
+
+/*                        P r o g r a m m i n g  N o t e s
+
+   o  slaMapqk() and slaAmpqk() only read the parameter array they are passed,
+      and have no internal state, which is what makes it safe to share a
+      HectorAstrometry object between threads.
+
+   o  This doesn't apply the radial velocity and parallax corrections supported
+      by slaMapqk(), as the target files don't provide them. They are passed
+      as zero, just as Mean2Apparent() in HectorConfigUtil always did.
+*/
@@ -0,0 +1,459 @@
+//
+//                   H e c t o r  C o n f i g  C  A p i . c p p
+//
+//  Function:
+//     A C interface to the HectorConfigSession class.
+//
+//  Description:
+//     This is the implementation of the C interface to the HectorConfigSession
+//     class. See the comments in HectorConfigCApi.h for details. Each routine
+//     is a thin wrapper around the corresponding HectorConfigSession method,
+//     passing the caller's arrays straight through wherever the method can
+//     use them as they are.
+//
+//  Author(s): Hector Observations Pipeline team, (HOP)
+//
+//  History:
+//     16th Oct 2026.  Original version. HOP.
+//     17th Oct 2026.  HectorConfigCheckSky() no longer passes positions that
+//                     aren't finite numbers on to the sky checker. HOP.
+//     17th Oct 2026.  Added HectorConfigClearRadius(), which shares
+//                     SkyPositions() and SkyResults() with HectorConfigCheckSky().
+//                     HOP.
+//     17th Oct 2026.  The observing time picked for a field given no time is
+//                     reported as a warning, rather than printed. HOP.
+//
+
+#include "HectorConfigCApi.h"
+
+#include "HectorConfigSession.h"
+#include "HectorConfigRoutines.h"
+
+#include "TcsUtil.h"
+
+#include <math.h>
+
+#include <functional>
+
+#include "slalib.h"
+#include "slamac.h"
+
+using std::vector;
+using std::string;
+
+//  The structure behind a handle, which holds the session along with copies of
+//  its latest error and warnings, so that the C strings returned for these
+//  remain valid after the call that generated them.
+
+struct HectorConfigHandle {
+   HectorConfigSession Session;          // The session itself
+   string ErrorText = "";                // Description of latest error
+   vector<string> Warnings;              // Warnings from the latest call
+   double SkyRadiusAsec = 0.0;           // Default sky clearance in arcsec
+};
+
+// ----------------------------------------------------------------------------------
+
+//                          F i l e  N a m e  S t r i n g
+//
+//  Returns a C file name passed in the settings as a string, with any
+//  environment variables expanded, as the command handler does for the file
+//  names given on the command line. NULL is taken as a blank name.
+
+static string FileNameString (const char* Name)
+{
+   if (Name == NULL) return "";
+   string FileName = Name;
+   string Expanded;
+   if (TcsUtil::ExpandFileName(FileName,Expanded)) FileName = Expanded;
+   return FileName;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                          S e t  O u t c o m e
+//
+//  Copies the error and warnings from a handle's session after a call, so that
+//  they can be returned as C strings. If the call partly failed - only some of
+//  the positions could be handled - the error is also added to the warnings,
+//  just as the HectorConfigUtil service reports it.
+
+static void SetOutcome (HectorConfigHandle* Handle, bool Partial,
+                                                     const string& Prefix)
+{
+   Handle->ErrorText = Handle->Session.GetError();
+   Handle->Warnings = Handle->Session.GetWarnings();
+   if (Partial && Handle->ErrorText != "") {
+      Handle->Warnings.push_back(Prefix + Handle->ErrorText);
+   }
+}
+
+// ----------------------------------------------------------------------------------
+
+//                          C h e c k  F i e l d
+//
+//  Returns true if a field has been set up for a handle's session, and otherwise
+//  sets the handle's error text and clears its warnings.
+
+static bool CheckField (HectorConfigHandle* Handle)
+{
+   Handle->Warnings.clear();
+   if (Handle->Session.GetFieldKey() == "") {
+      Handle->ErrorText = "No field has been set up for the session";
+      return false;
+   }
+   return true;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                         H e c t o r  C o n f i g  D e f a u l t s
+//
+//  Sets a settings structure to the defaults HectorConfigUtil uses for anything
+//  not given on its command line. There are no defaults for the file names,
+//  which the program takes from the environment; these are set to
+//  "$TDF_DISTORTION", "$TDF_LINEARITY" and "$PROFIT_DIR", which are expanded
+//  when the session is created.
+
+void HectorConfigDefaults (HectorConfigSettings* Settings)
+{
+   Settings->DistFileName = "$TDF_DISTORTION";
+   Settings->LinFileName = "$TDF_LINEARITY";
+   Settings->ProfitDirectory = "$PROFIT_DIR";
+   Settings->ProfitCacheDirectory = "";
+   Settings->DebugLevels = "";
+   Settings->SkyRadiusAsec = 3.0;
+   Settings->Threads = 0;
+   Settings->MechCorrection = 1;
+   Settings->TeleCorrection = 1;
+   Settings->LinCorrection = 1;
+   Settings->PmCorrection = 1;
+   Settings->CheckSky = 1;
+   Settings->UseClearMaps = 0;
+   Settings->UseCountTables = 0;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                         H e c t o r  C o n f i g  C r e a t e
+//
+//  Creates a session, setting it up with the program details HectorConfigUtil
+//  would set up for the same settings given on its command line - including
+//  the field radius and expected numbers of sky fibres it always uses. Nothing
+//  is read at this stage; the models are read when the first field is set,
+//  and the Profit mask files when they are first needed.
+
+HectorConfigHandle* HectorConfigCreate (const HectorConfigSettings* Settings)
+{
+   HectorConfigHandle* Handle = new HectorConfigHandle;
+   
+   HectorUtilProgDetails ProgDetails;
+   ProgDetails.DistFileName = FileNameString(Settings->DistFileName);
+   ProgDetails.LinFileName = FileNameString(Settings->LinFileName);
+   ProgDetails.ProfitDirectory = FileNameString(Settings->ProfitDirectory);
+   ProgDetails.ProfitCacheDirectory =
+                             FileNameString(Settings->ProfitCacheDirectory);
+   if (Settings->DebugLevels) ProgDetails.DebugLevels = Settings->DebugLevels;
+   ProgDetails.SkyRadiusAsec = Settings->SkyRadiusAsec;
+   ProgDetails.Threads = Settings->Threads;
+   ProgDetails.MechCorrection = Settings->MechCorrection;
+   ProgDetails.TeleCorrection = Settings->TeleCorrection;
+   ProgDetails.LinCorrection = Settings->LinCorrection;
+   ProgDetails.PmCorrection = Settings->PmCorrection;
+   ProgDetails.CheckSky = Settings->CheckSky;
+   ProgDetails.UseClearMaps = Settings->UseClearMaps;
+   ProgDetails.UseCountTables = Settings->UseCountTables;
+   ProgDetails.PrintMeridianTime = false;
+   ProgDetails.ExpectedHFibres = 56;
+   ProgDetails.ExpectedAFibres = 35;
+   ProgDetails.FieldRadius = 1.1 * DD2R;
+   Handle->Session.SetProgDetails(ProgDetails);
+   Handle->SkyRadiusAsec = Settings->SkyRadiusAsec;
+   return Handle;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                        H e c t o r  C o n f i g  D e s t r o y
+//
+//  Deletes a session created by HectorConfigCreate(). Passing NULL is harmless.
+
+void HectorConfigDestroy (HectorConfigHandle* Handle)
+{
+   delete Handle;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                       H e c t o r  C o n f i g  S e t  F i e l d
+//
+//  Sets the field for the session, as HectorConfigSession::SetField() does,
+//  returning 1 if this worked and 0 if not. NULL strings are taken as blank -
+//  a blank time being the time the field is on the meridian tonight, and a
+//  blank rotation matrix the identity.
+
+int HectorConfigSetField (
+   HectorConfigHandle* Handle, double CentreRaDeg, double CentreDecDeg,
+   const char* DateAndTime, double RobotTempC, double ObsTempC,
+   const char* RotMatString)
+{
+   bool Ok = Handle->Session.SetField(CentreRaDeg,CentreDecDeg,
+               DateAndTime ? DateAndTime : "",RobotTempC,ObsTempC,
+                                           RotMatString ? RotMatString : "");
+   SetOutcome (Handle,false,"");
+   return Ok ? 1 : 0;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                        H e c t o r  C o n f i g  G e t  M j d
+//
+//  Returns the observing time for the field, as Mjd, or zero if none is set.
+
+double HectorConfigGetMjd (const HectorConfigHandle* Handle)
+{
+   return Handle->Session.GetMjd();
+}
+
+// ----------------------------------------------------------------------------------
+
+//                   H e c t o r  C o n f i g  R a  D e c  T o  X Y
+//
+//  Converts mean J2000 Ra,Dec positions in degrees to plate X,Y in microns, as
+//  HectorConfigSession::RaDecToXY() does. The proper motion arrays may be NULL.
+//  Positions that can't be converted are returned as NaN, with a warning.
+//  Returns the number of positions converted, or -1 if no field has been set.
+
+int HectorConfigRaDecToXY (
+   HectorConfigHandle* Handle, int NPosns, const double RaDeg[],
+   const double DecDeg[], const double PmRa[], const double PmDec[],
+   double X[], double Y[])
+{
+   if (!CheckField(Handle)) return -1;
+   
+   //  A vector<bool> can't be passed as an array, hence the unique_ptr.
+   
+   std::unique_ptr<bool[]> Converted(new bool[NPosns]);
+   bool Ok = Handle->Session.RaDecToXY(NPosns,RaDeg,DecDeg,PmRa,PmDec,X,Y,
+                                                            Converted.get());
+   SetOutcome (Handle,!Ok,"Error converting Ra,Dec to X,Y: ");
+   int NConverted = 0;
+   for (int IPosn = 0; IPosn < NPosns; IPosn++) {
+      if (Converted[IPosn]) {
+         NConverted++;
+      } else {
+         X[IPosn] = Y[IPosn] = NAN;
+      }
+   }
+   return NConverted;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                   H e c t o r  C o n f i g  X Y  T o  R a  D e c
+//
+//  Converts plate X,Y positions in microns to mean J2000 Ra,Dec in degrees, as
+//  HectorConfigSession::XYToRaDec() does. If Sky is non-zero, the positions are
+//  converted as sky fibre positions are. Positions that can't be converted are
+//  returned as NaN, with a warning. Returns the number of positions converted,
+//  or -1 if no field has been set.
+
+int HectorConfigXYToRaDec (
+   HectorConfigHandle* Handle, int NPosns, const double X[], const double Y[],
+   int Sky, double RaDeg[], double DecDeg[])
+{
+   if (!CheckField(Handle)) return -1;
+   
+   std::unique_ptr<bool[]> Converted(new bool[NPosns]);
+   bool Ok = Handle->Session.XYToRaDec(NPosns,X,Y,Sky != 0,RaDeg,DecDeg,
+                                                            Converted.get());
+   SetOutcome (Handle,!Ok,"Error converting X,Y to Ra,Dec: ");
+   int NConverted = 0;
+   for (int IPosn = 0; IPosn < NPosns; IPosn++) {
+      if (Converted[IPosn]) {
+         NConverted++;
+      } else {
+         RaDeg[IPosn] = DecDeg[IPosn] = NAN;
+      }
+   }
+   return NConverted;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                          S k y  P o s i t i o n s
+//
+//  Sets up the ProfitSkyPosn structures for positions that are to be passed to
+//  the session's sky checker, each needing RadiusDeg clear round it. Only the
+//  positions that are actual numbers go to the sky checker, and Index is set to
+//  the entry in SkyPosns for each position, or -1 if there is none.
+
+static void SkyPositions (int NPosns, const double RaDeg[],
+   const double DecDeg[], double RadiusDeg, vector<ProfitSkyPosn>* SkyPosns,
+                                                          vector<int>* Index)
+{
+   SkyPosns->clear();
+   Index->assign(NPosns,-1);
+   for (int IPosn = 0; IPosn < NPosns; IPosn++) {
+      if (!isfinite(RaDeg[IPosn]) || !isfinite(DecDeg[IPosn])) continue;
+      (*Index)[IPosn] = SkyPosns->size();
+      ProfitSkyPosn SkyPosn;
+      SkyPosn.RaDeg = RaDeg[IPosn];
+      SkyPosn.DecDeg = DecDeg[IPosn];
+      SkyPosn.RadiusDeg = RadiusDeg;
+      SkyPosns->push_back(SkyPosn);
+   }
+}
+
+// ----------------------------------------------------------------------------------
+
+//                            S k y  R e s u l t s
+//
+//  Sets the result for each of a number of positions once those that were passed
+//  to the sky checker by SkyPositions() have been dealt with. Value is called to
+//  get the result for each position that was checked, and any other is set to
+//  NaN, with a warning giving the reason. Returns the number checked.
+
+static int SkyResults (HectorConfigHandle* Handle, int NPosns,
+   const vector<ProfitSkyPosn>& SkyPosns, const vector<int>& Index,
+                   std::function<double(int)> Value, double Results[])
+{
+   int NChecked = 0;
+   for (int IPosn = 0; IPosn < NPosns; IPosn++) {
+      if (Index[IPosn] < 0) {
+         Results[IPosn] = NAN;
+         Handle->Warnings.push_back("Position " + std::to_string(IPosn) +
+                                    " not checked: Ra,Dec is not a number");
+         continue;
+      }
+      const ProfitSkyPosn& SkyPosn = SkyPosns[Index[IPosn]];
+      if (SkyPosn.Status == SKY_UNCHECKED) {
+         Results[IPosn] = NAN;
+         Handle->Warnings.push_back("Position " + std::to_string(IPosn) +
+                                          " not checked: " + SkyPosn.Reason);
+      } else {
+         Results[IPosn] = Value(Index[IPosn]);
+         NChecked++;
+      }
+   }
+   return NChecked;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                      H e c t o r  C o n f i g  C h e c k  S k y
+//
+//  Checks whether mean J2000 Ra,Dec positions in degrees are clear of any
+//  objects in the Profit mask files, to within the given clearance in arcsec -
+//  if this is negative, the clearance given in the settings is used. Clear is
+//  set to 1.0 for each position that is clear, 0.0 for one that isn't, and NaN
+//  for one that couldn't be checked, in which case there is a warning giving
+//  the reason. A position whose Ra or Dec is NaN or infinite isn't checked.
+//  Returns the number of positions checked, or -1 if the checks couldn't be
+//  made at all.
+
+int HectorConfigCheckSky (
+   HectorConfigHandle* Handle, int NPosns, const double RaDeg[],
+   const double DecDeg[], double ClearanceAsec, double Clear[])
+{
+   if (!CheckField(Handle)) return -1;
+   
+   if (ClearanceAsec < 0.0) ClearanceAsec = Handle->SkyRadiusAsec;
+   
+   vector<ProfitSkyPosn> SkyPosns;
+   vector<int> Index;
+   SkyPositions (NPosns,RaDeg,DecDeg,ClearanceAsec / 3600.0,&SkyPosns,&Index);
+   bool Ok = Handle->Session.CheckSky(&SkyPosns);
+   SetOutcome (Handle,false,"");
+   if (!Ok) return -1;
+   
+   return SkyResults (Handle,NPosns,SkyPosns,Index,[&](int ISkyPosn) {
+      return (SkyPosns[ISkyPosn].Status == SKY_CLEAR) ? 1.0 : 0.0;
+   },Clear);
+}
+
+// ----------------------------------------------------------------------------------
+
+//                   H e c t o r  C o n f i g  C l e a r  R a d i u s
+//
+//  Sets ClearAsec to the radius in arcsec round each of a number of mean J2000
+//  Ra,Dec positions in degrees that is clear of any objects in the Profit mask
+//  files, as given by the clearance maps - which are only built if the session
+//  was created with UseClearMaps set. A radius that couldn't be found is set to
+//  NaN, with a warning giving the reason, just as for HectorConfigCheckSky().
+//  Returns the number of radii found, or -1 if none could be looked up at all.
+
+int HectorConfigClearRadius (
+   HectorConfigHandle* Handle, int NPosns, const double RaDeg[],
+   const double DecDeg[], double ClearAsec[])
+{
+   if (!CheckField(Handle)) return -1;
+   
+   vector<ProfitSkyPosn> SkyPosns;
+   vector<int> Index;
+   SkyPositions (NPosns,RaDeg,DecDeg,0.0,&SkyPosns,&Index);
+   vector<double> Radii;
+   bool Ok = Handle->Session.GetClearRadii(&SkyPosns,&Radii);
+   SetOutcome (Handle,false,"");
+   if (!Ok) return -1;
+   
+   return SkyResults (Handle,NPosns,SkyPosns,Index,[&](int ISkyPosn) {
+      return Radii[ISkyPosn];
+   },ClearAsec);
+}
+
+// ----------------------------------------------------------------------------------
+
+//                      H e c t o r  C o n f i g  G e t  E r r o r
+//
+//  Returns a description of the error that caused the latest call to fail.
+
+const char* HectorConfigGetError (const HectorConfigHandle* Handle)
+{
+   return Handle->ErrorText.c_str();
+}
+
+// ----------------------------------------------------------------------------------
+
+//                   H e c t o r  C o n f i g  W a r n i n g  C o u n t
+//
+//  Returns the number of warnings generated by the latest call.
+
+int HectorConfigWarningCount (const HectorConfigHandle* Handle)
+{
+   return int(Handle->Warnings.size());
+}
+
+// ----------------------------------------------------------------------------------
+
+//                    H e c t o r  C o n f i g  G e t  W a r n i n g
+//
+//  Returns one of the warnings generated by the latest call, numbered from
+//  zero, or a blank string if there is no such warning.
+
+const char* HectorConfigGetWarning (const HectorConfigHandle* Handle, int Index)
+{
+   if (Index < 0 || Index >= int(Handle->Warnings.size())) return "";
+   return Handle->Warnings[Index].c_str();
+}
+
+// ----------------------------------------------------------------------------------
+
+/*                        P r o g r a m m i n g  N o t e s
+
+   o  The conversion routines pass the caller's arrays straight to the session,
+      which writes its results directly into the output arrays. The only
+      copying is what the session does internally anyway - the conversion to
+      radians, for example, and the ProfitSkyPosn structures the sky checker
+      works with.
+
+   o  A blank field key is how a session shows it has no field set up. The
+      routines check this themselves, rather than leaving it to the session,
+      so that they can tell a call that couldn't be made at all - which is an
+      error - from one where only some positions failed, which gives warnings
+      and NaN values, as the HectorConfigUtil service gives nulls.
+
+   o  Nothing here throws an exception on purpose, and none of the code it calls
+      does either, short of running out of memory, so there is no attempt to
+      stop exceptions reaching the C caller.
+*/
@@ -0,0 +1,138 @@
+//
+//                     H e c t o r  C o n f i g  C  A p i . h
+//
+//  Function:
+//     A C interface to the HectorConfigSession class.
+//
+//  Description:
+//     HectorConfigSession (see HectorConfigSession.h) is a C++ class, and can't
+//     be used directly from C, or from anything - like a Python extension
+//     module - that expects a plain C interface. This is a small set of C
+//     functions that let such code create a session, set its field, convert
+//     arrays of positions between mean Ra,Dec and plate X,Y, and check arrays
+//     of positions for contamination, with all the values passed in plain
+//     arrays of doubles. The arrays are used as they are, so a caller holding
+//     its positions in contiguous arrays of doubles (NumPy float64 arrays, for
+//     example) can pass them without having to copy them first.
+//
+//     A session is created by HectorConfigCreate(), passing it a settings
+//     structure that should first be set to its default values by calling
+//     HectorConfigDefaults(). The settings are those that would otherwise be
+//     given on the HectorConfigUtil command line. Functions that can fail
+//     return a negative value (or zero, for those returning a success flag),
+//     and HectorConfigGetError() then describes the problem. Any warnings from
+//     the latest call can be obtained using HectorConfigWarningCount() and
+//     HectorConfigGetWarning().
+//
+//     Positions that can't be converted or checked are returned as NaN, so a
+//     caller doesn't need a separate array of flags to see which they were.
+//
+//  Author(s): Hector Observations Pipeline team, (HOP)
+//
+//  History:
+//     16th Oct 2026.  Original version. HOP.
+//     17th Oct 2026.  Added HectorConfigClearRadius(). HOP.
+//
+// ----------------------------------------------------------------------------------
+
+#ifndef __HectorConfigCApi__
+#define __HectorConfigCApi__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//  A session, as seen from C. The structure itself is only defined in
+//  HectorConfigCApi.cpp.
+
+typedef struct HectorConfigHandle HectorConfigHandle;
+
+//  The settings for a session, as would be given on the command line. The
+//  strings are copied when the session is created, and any environment
+//  variables in the file names are expanded. The flags are 0 (false) or
+//  1 (true).
+
+typedef struct HectorConfigSettings {
+   const char* DistFileName;          // Name of 2dF distortion file
+   const char* LinFileName;           // Name of 2dF linearity file
+   const char* ProfitDirectory;       // Directory holding Profit mask files
+   const char* ProfitCacheDirectory;  // Directory for cached mask data, or ""
+   const char* DebugLevels;           // Used to control debugging
+   double SkyRadiusAsec;              // Default sky clearance radius in arcsec
+   int Threads;                       // Threads for conversions, 0 => 1 per core
+   int MechCorrection;                // Apply mechanical offset corrections
+   int TeleCorrection;                // Apply telecentricity corrections
+   int LinCorrection;                 // Apply linearity corrections
+   int PmCorrection;                  // Apply proper motion corrections
+   int CheckSky;                      // Allow sky contamination checks
+   int UseClearMaps;                  // Check sky using clearance maps
+   int UseCountTables;                // Speed sky checks with count tables
+} HectorConfigSettings;
+
+//  Set a settings structure to the defaults used by HectorConfigUtil.
+void HectorConfigDefaults (HectorConfigSettings* Settings);
+
+//  Create a session with the given settings. Returns NULL if this fails.
+HectorConfigHandle* HectorConfigCreate (const HectorConfigSettings* Settings);
+
+//  Delete a session created by HectorConfigCreate().
+void HectorConfigDestroy (HectorConfigHandle* Handle);
+
+//  Set the field centre (deg), observing time and conditions. Returns 1 if Ok.
+int HectorConfigSetField (HectorConfigHandle* Handle, double CentreRaDeg,
+             double CentreDecDeg, const char* DateAndTime, double RobotTempC,
+             double ObsTempC, const char* RotMatString);
+
+//  Return the observing time for the field, as Mjd, or zero if none is set.
+double HectorConfigGetMjd (const HectorConfigHandle* Handle);
+
+//  Convert mean Ra,Dec (deg) to plate X,Y (microns). Returns # converted.
+int HectorConfigRaDecToXY (HectorConfigHandle* Handle, int NPosns,
+             const double RaDeg[], const double DecDeg[], const double PmRa[],
+             const double PmDec[], double X[], double Y[]);
+
+//  Convert plate X,Y (microns) to mean Ra,Dec (deg). Returns # converted.
+int HectorConfigXYToRaDec (HectorConfigHandle* Handle, int NPosns,
+             const double X[], const double Y[], int Sky, double RaDeg[],
+             double DecDeg[]);
+
+//  Check positions for contamination, setting Clear. Returns # checked.
+int HectorConfigCheckSky (HectorConfigHandle* Handle, int NPosns,
+             const double RaDeg[], const double DecDeg[], double ClearanceAsec,
+             double Clear[]);
+
+//  Get the clear radius (arcsec) round positions. Returns # found.
+int HectorConfigClearRadius (HectorConfigHandle* Handle, int NPosns,
+             const double RaDeg[], const double DecDeg[], double ClearAsec[]);
+
+//  Get description of latest error.
+const char* HectorConfigGetError (const HectorConfigHandle* Handle);
+
+//  Get the number of warnings from the latest call.
+int HectorConfigWarningCount (const HectorConfigHandle* Handle);
+
+//  Get one of the warnings from the latest call, numbered from zero.
+const char* HectorConfigGetWarning (const HectorConfigHandle* Handle, int Index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+// ----------------------------------------------------------------------------------
+
+/*                        P r o g r a m m i n g  N o t e s
+
+   o  This is deliberately a plain C header - no bool, no std::string - so that
+      it can be included by C code, such as HectorConfigModule.c, the Python
+      extension module that is its main user.
+
+   o  As for HectorConfigSession itself, a session isn't thread-safe, but
+      different sessions can be used at once in different threads. The Python
+      module releases the Python global interpreter lock while these routines
+      run, so it keeps a lock of its own for each session.
+
+   o  The strings returned by HectorConfigGetError() and HectorConfigGetWarning()
+      remain valid until the next call made for the same session.
+*/
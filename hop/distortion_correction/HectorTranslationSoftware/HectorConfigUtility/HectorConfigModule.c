@@ -0,0 +1,546 @@
+//
+//                  H e c t o r  C o n f i g  M o d u l e . c
+//
+//  Function:
+//     A Python extension module giving access to HectorConfigSession.
+//
+//  Description:
+//     The Python code that uses the Hector configuration utility has always
+//     run HectorConfigUtil as a separate program, writing its targets to
+//     files and reading the results back. This extension module, hectorconfig,
+//     lets Python code use the same code in-process, through the C interface
+//     in HectorConfigCApi.h. It provides a Session type:
+//
+//        import hectorconfig
+//        Session = hectorconfig.Session(distortion="HectorDistortion.sds",
+//                       linearity="HectorLinear.sds",profitdir="/data/masks")
+//        Mjd = Session.set_field(180.0,10.0,"2022 02 28 14 00 00",15.0,15.0)
+//        NConverted = Session.radec_to_xy(Ra,Dec,X,Y)
+//        NConverted = Session.xy_to_radec(X,Y,Ra,Dec,sky=True)
+//        NChecked = Session.check_sky(Ra,Dec,Clear,clearance=3.0)
+//        NFound = Session.clear_radius(Ra,Dec,ClearAsec)
+//
+//     The keyword arguments to Session() are: distortion, linearity, profitdir,
+//     profitcache and debug (strings, as on the command line); clearance
+//     (arcsec); threads; and mech, tele, lin, pm, sky, clearmap and counttable
+//     (true or false, as for the -mech/-nomech etc. command line flags).
+//     set_field() takes the field centre Ra and Dec in degrees, and optionally
+//     the observing time, robot and observing temperatures in deg C, and
+//     the XY rotation matrix, and returns the observing time as Mjd.
+//
+//     The position arguments - both the values passed and the arrays that
+//     receive the results - can be anything that supports the Python buffer
+//     protocol as a contiguous array of doubles, such as a NumPy float64 array
+//     or an array.array('d'). The routines work directly on the memory of
+//     these arrays: nothing is copied, and the results go straight into the
+//     arrays passed for them, which must already be the right size. The
+//     proper motions for radec_to_xy() - keyword arguments pmra and pmdec,
+//     in milli-arcsec/year as in the target files - are optional. Positions
+//     that can't be converted or checked are set to NaN, each check_sky()
+//     result being 1.0 (clear), 0.0 (contaminated) or NaN (not checked).
+//     clear_radius() gives the radius in arcsec round each position that is
+//     clear, from the clearance maps, so needs a session with clearmap=True.
+//     Each routine returns the number of positions it converted or checked.
+//
+//     The Python global interpreter lock is released while the work is being
+//     done, so other Python threads can run at the same time - including ones
+//     using other sessions. Any warnings from a call are issued as Python
+//     warnings, and errors raise a RuntimeError.
+//
+//     This is built by the 'python' target in the Makefile.
+//
+//  Author(s): Hector Observations Pipeline team, (HOP)
+//
+//  History:
+//     16th Oct 2026.  Original version. HOP.
+//     17th Oct 2026.  Added clear_radius(). The format for the Session()
+//                     keyword arguments had one flag too many, so giving the
+//                     counttable argument failed. HOP.
+//
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <pythread.h>
+
+#include <limits.h>
+#include <string.h>
+
+#include "HectorConfigCApi.h"
+
+//  The Python object for a session. The lock makes sure only one thread at
+//  a time uses the session, since a thread can't rely on the Python global
+//  interpreter lock for this once it has released it.
+
+typedef struct {
+   PyObject_HEAD
+   HectorConfigHandle* Handle;        // The session, through the C interface
+   PyThread_type_lock Lock;           // Held while the session is in use
+} HectorSessionObject;
+
+// ----------------------------------------------------------------------------------
+
+//                          G e t  D o u b l e s
+//
+//  Gets a buffer for a Python object that should be a contiguous array of
+//  doubles, checking that it has the expected number of items - unless
+//  NItems is passed as a negative value, in which case it is set to the
+//  number of items. If Writable is true, the buffer has to be writable. If
+//  anything is wrong, this sets a Python exception and returns 0, otherwise
+//  it returns 1 and the buffer must be released using PyBuffer_Release().
+
+static int GetDoubles (
+   PyObject* Object, const char* Name, int Writable, Py_buffer* View,
+   Py_ssize_t* NItems)
+{
+   int Flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT;
+   if (Writable) Flags |= PyBUF_WRITABLE;
+   if (PyObject_GetBuffer(Object,View,Flags) != 0) {
+      PyErr_Format (PyExc_TypeError,
+          "'%s' should be a contiguous%s array of doubles",Name,
+                                              Writable ? ", writable" : "");
+      return 0;
+   }
+   const char* Format = View->format ? View->format : "B";
+   if (Format[0] == '@' || Format[0] == '=' || Format[0] == '<') Format++;
+   if (strcmp(Format,"d") != 0 || View->itemsize != sizeof(double)) {
+      PyErr_Format (PyExc_TypeError,
+          "'%s' should be an array of doubles (float64), not format '%s'",
+                                                            Name,View->format);
+      PyBuffer_Release (View);
+      return 0;
+   }
+   Py_ssize_t NValues = View->len / View->itemsize;
+   if (*NItems < 0) {
+      if (NValues > INT_MAX) {
+         PyErr_Format (PyExc_ValueError,"'%s' has too many values",Name);
+         PyBuffer_Release (View);
+         return 0;
+      }
+      *NItems = NValues;
+   } else if (NValues != *NItems) {
+      PyErr_Format (PyExc_ValueError,"'%s' has %zd values, should have %zd",
+                                                        Name,NValues,*NItems);
+      PyBuffer_Release (View);
+      return 0;
+   }
+   return 1;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                          R e l e a s e  V i e w s
+//
+//  Releases the buffers obtained by GetDoubles(), for those that were obtained.
+
+static void ReleaseViews (Py_buffer Views[], int NViews)
+{
+   for (int IView = 0; IView < NViews; IView++) {
+      if (Views[IView].obj) PyBuffer_Release (&Views[IView]);
+   }
+}
+
+// ----------------------------------------------------------------------------------
+
+//                            O u t c o m e
+//
+//  Called, with the interpreter lock held, once a call to the C interface has
+//  been made, while the session is still locked. Picks up any warnings from
+//  the call and, if Status is negative (or zero for a success flag, if Flag
+//  is true), the session's error, then unlocks the session. The warnings are
+//  then issued as Python warnings, and the error raised as a RuntimeError.
+//  Returns 0 if an exception has been raised, 1 otherwise.
+
+static int Outcome (HectorSessionObject* Self, int Status, int Flag)
+{
+   //  The messages have to be picked up before the session is unlocked, since
+   //  another thread could then use it, but the warnings can't be issued until
+   //  afterwards, since a warning filter could try to use the session too.
+   
+   int Failed = (Status < 0 || (Flag && Status == 0));
+   int NWarnings = HectorConfigWarningCount(Self->Handle);
+   PyObject* Warnings = PyList_New(NWarnings);
+   for (int IWarn = 0; Warnings && IWarn < NWarnings; IWarn++) {
+      const char* Text = HectorConfigGetWarning(Self->Handle,IWarn);
+      PyObject* Warning = PyUnicode_DecodeUTF8(Text,strlen(Text),"replace");
+      if (Warning == NULL) Py_CLEAR (Warnings);
+      else PyList_SET_ITEM (Warnings,IWarn,Warning);
+   }
+   PyObject* Error = NULL;
+   if (Failed) {
+      const char* Text = HectorConfigGetError(Self->Handle);
+      Error = PyUnicode_DecodeUTF8(Text,strlen(Text),"replace");
+   }
+   PyThread_release_lock (Self->Lock);
+   
+   if (Warnings == NULL || (Failed && Error == NULL)) {
+      Py_XDECREF (Warnings);
+      Py_XDECREF (Error);
+      return 0;
+   }
+   int Ok = 1;
+   for (int IWarn = 0; Ok && IWarn < NWarnings; IWarn++) {
+      const char* Text = PyUnicode_AsUTF8(PyList_GET_ITEM(Warnings,IWarn));
+      if (Text == NULL || PyErr_WarnEx(PyExc_UserWarning,Text,1) != 0) Ok = 0;
+   }
+   Py_DECREF (Warnings);
+   if (Ok && Failed) {
+      PyErr_SetObject (PyExc_RuntimeError,Error);
+      Ok = 0;
+   }
+   Py_XDECREF (Error);
+   return Ok;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                          S e s s i o n  N e w
+//
+//  Creates a new Session object, with the settings given as keyword arguments.
+
+static PyObject* SessionNew (
+   PyTypeObject* Type, PyObject* Args, PyObject* Kwds)
+{
+   static char* Keywords[] = {"distortion","linearity","profitdir",
+            "profitcache","debug","clearance","threads","mech","tele","lin",
+                                "pm","sky","clearmap","counttable",NULL};
+   
+   HectorConfigSettings Settings;
+   HectorConfigDefaults (&Settings);
+   if (!PyArg_ParseTupleAndKeywords(Args,Kwds,"|sssssdippppppp",Keywords,
+         &Settings.DistFileName,&Settings.LinFileName,&Settings.ProfitDirectory,
+         &Settings.ProfitCacheDirectory,&Settings.DebugLevels,
+         &Settings.SkyRadiusAsec,&Settings.Threads,&Settings.MechCorrection,
+         &Settings.TeleCorrection,&Settings.LinCorrection,&Settings.PmCorrection,
+         &Settings.CheckSky,&Settings.UseClearMaps,&Settings.UseCountTables)) {
+      return NULL;
+   }
+   HectorSessionObject* Self = (HectorSessionObject*) Type->tp_alloc(Type,0);
+   if (Self == NULL) return NULL;
+   Self->Lock = PyThread_allocate_lock();
+   if (Self->Lock == NULL) {
+      Py_DECREF (Self);
+      return PyErr_NoMemory();
+   }
+   Self->Handle = HectorConfigCreate(&Settings);
+   return (PyObject*) Self;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                          S e s s i o n  D e a l l o c
+//
+//  Deletes a Session object, and the session behind it.
+
+static void SessionDealloc (HectorSessionObject* Self)
+{
+   HectorConfigDestroy (Self->Handle);
+   if (Self->Lock) PyThread_free_lock (Self->Lock);
+   Py_TYPE(Self)->tp_free ((PyObject*) Self);
+}
+
+// ----------------------------------------------------------------------------------
+
+//                          S e s s i o n  S e t  F i e l d
+//
+//  Session.set_field(ra, dec, time="", robot_temp=15.0, obs_temp=15.0,
+//  xymatrix="") sets the field, returning its observing time as Mjd.
+
+static PyObject* SessionSetField (
+   HectorSessionObject* Self, PyObject* Args, PyObject* Kwds)
+{
+   static char* Keywords[] = {"ra","dec","time","robot_temp","obs_temp",
+                                                            "xymatrix",NULL};
+   double CentreRaDeg = 0.0;
+   double CentreDecDeg = 0.0;
+   const char* DateAndTime = "";
+   double RobotTempC = 15.0;
+   double ObsTempC = 15.0;
+   const char* RotMatString = "";
+   if (!PyArg_ParseTupleAndKeywords(Args,Kwds,"dd|sdds",Keywords,
+            &CentreRaDeg,&CentreDecDeg,&DateAndTime,&RobotTempC,&ObsTempC,
+                                                             &RotMatString)) {
+      return NULL;
+   }
+   int Status = 0;
+   double Mjd = 0.0;
+   Py_BEGIN_ALLOW_THREADS
+   PyThread_acquire_lock (Self->Lock,WAIT_LOCK);
+   Status = HectorConfigSetField(Self->Handle,CentreRaDeg,CentreDecDeg,
+                             DateAndTime,RobotTempC,ObsTempC,RotMatString);
+   Mjd = HectorConfigGetMjd(Self->Handle);
+   Py_END_ALLOW_THREADS
+   if (!Outcome(Self,Status,1)) return NULL;
+   return PyFloat_FromDouble(Mjd);
+}
+
+// ----------------------------------------------------------------------------------
+
+//                          S e s s i o n  R a  D e c  T o  X Y
+//
+//  Session.radec_to_xy(ra, dec, x, y, pmra=None, pmdec=None) converts mean
+//  Ra,Dec (deg) to plate X,Y (microns), returning the number converted.
+
+static PyObject* SessionRaDecToXY (
+   HectorSessionObject* Self, PyObject* Args, PyObject* Kwds)
+{
+   static char* Keywords[] = {"ra","dec","x","y","pmra","pmdec",NULL};
+   PyObject* Objects[6] = {NULL,NULL,NULL,NULL,Py_None,Py_None};
+   if (!PyArg_ParseTupleAndKeywords(Args,Kwds,"OOOO|OO",Keywords,&Objects[0],
+              &Objects[1],&Objects[2],&Objects[3],&Objects[4],&Objects[5])) {
+      return NULL;
+   }
+   static const int Writable[6] = {0,0,1,1,0,0};
+   Py_buffer Views[6];
+   memset (Views,0,sizeof(Views));
+   Py_ssize_t NPosns = -1;
+   for (int IArg = 0; IArg < 6; IArg++) {
+      if (Objects[IArg] == Py_None) continue;
+      if (!GetDoubles(Objects[IArg],Keywords[IArg],Writable[IArg],
+                                                   &Views[IArg],&NPosns)) {
+         ReleaseViews (Views,6);
+         return NULL;
+      }
+   }
+   int Status = 0;
+   Py_BEGIN_ALLOW_THREADS
+   PyThread_acquire_lock (Self->Lock,WAIT_LOCK);
+   Status = HectorConfigRaDecToXY(Self->Handle,(int)NPosns,
+                (const double*) Views[0].buf,(const double*) Views[1].buf,
+                (const double*) Views[4].buf,(const double*) Views[5].buf,
+                                    (double*) Views[2].buf,(double*) Views[3].buf);
+   Py_END_ALLOW_THREADS
+   int Ok = Outcome(Self,Status,0);
+   ReleaseViews (Views,6);
+   if (!Ok) return NULL;
+   return PyLong_FromLong(Status);
+}
+
+// ----------------------------------------------------------------------------------
+
+//                          S e s s i o n  X Y  T o  R a  D e c
+//
+//  Session.xy_to_radec(x, y, ra, dec, sky=False) converts plate X,Y (microns)
+//  to mean Ra,Dec (deg), returning the number converted.
+
+static PyObject* SessionXYToRaDec (
+   HectorSessionObject* Self, PyObject* Args, PyObject* Kwds)
+{
+   static char* Keywords[] = {"x","y","ra","dec","sky",NULL};
+   PyObject* Objects[4] = {NULL,NULL,NULL,NULL};
+   int Sky = 0;
+   if (!PyArg_ParseTupleAndKeywords(Args,Kwds,"OOOO|p",Keywords,&Objects[0],
+                             &Objects[1],&Objects[2],&Objects[3],&Sky)) {
+      return NULL;
+   }
+   static const int Writable[4] = {0,0,1,1};
+   Py_buffer Views[4];
+   memset (Views,0,sizeof(Views));
+   Py_ssize_t NPosns = -1;
+   for (int IArg = 0; IArg < 4; IArg++) {
+      if (!GetDoubles(Objects[IArg],Keywords[IArg],Writable[IArg],
+                                                   &Views[IArg],&NPosns)) {
+         ReleaseViews (Views,4);
+         return NULL;
+      }
+   }
+   int Status = 0;
+   Py_BEGIN_ALLOW_THREADS
+   PyThread_acquire_lock (Self->Lock,WAIT_LOCK);
+   Status = HectorConfigXYToRaDec(Self->Handle,(int)NPosns,
+                (const double*) Views[0].buf,(const double*) Views[1].buf,Sky,
+                                    (double*) Views[2].buf,(double*) Views[3].buf);
+   Py_END_ALLOW_THREADS
+   int Ok = Outcome(Self,Status,0);
+   ReleaseViews (Views,4);
+   if (!Ok) return NULL;
+   return PyLong_FromLong(Status);
+}
+
+// ----------------------------------------------------------------------------------
+
+//                          S e s s i o n  C h e c k  S k y
+//
+//  Session.check_sky(ra, dec, clear, clearance=None) checks mean Ra,Dec
+//  positions (deg) for contamination, returning the number checked. The
+//  clearance is in arcsec, and defaults to that given for the session.
+
+static PyObject* SessionCheckSky (
+   HectorSessionObject* Self, PyObject* Args, PyObject* Kwds)
+{
+   static char* Keywords[] = {"ra","dec","clear","clearance",NULL};
+   PyObject* Objects[3] = {NULL,NULL,NULL};
+   PyObject* ClearanceObject = Py_None;
+   if (!PyArg_ParseTupleAndKeywords(Args,Kwds,"OOO|O",Keywords,&Objects[0],
+                             &Objects[1],&Objects[2],&ClearanceObject)) {
+      return NULL;
+   }
+   double ClearanceAsec = -1.0;
+   if (ClearanceObject != Py_None) {
+      ClearanceAsec = PyFloat_AsDouble(ClearanceObject);
+      if (ClearanceAsec == -1.0 && PyErr_Occurred()) return NULL;
+      if (ClearanceAsec < 0.0) {
+         PyErr_SetString (PyExc_ValueError,"'clearance' can't be negative");
+         return NULL;
+      }
+   }
+   static const int Writable[3] = {0,0,1};
+   Py_buffer Views[3];
+   memset (Views,0,sizeof(Views));
+   Py_ssize_t NPosns = -1;
+   for (int IArg = 0; IArg < 3; IArg++) {
+      if (!GetDoubles(Objects[IArg],Keywords[IArg],Writable[IArg],
+                                                   &Views[IArg],&NPosns)) {
+         ReleaseViews (Views,3);
+         return NULL;
+      }
+   }
+   int Status = 0;
+   Py_BEGIN_ALLOW_THREADS
+   PyThread_acquire_lock (Self->Lock,WAIT_LOCK);
+   Status = HectorConfigCheckSky(Self->Handle,(int)NPosns,
+                (const double*) Views[0].buf,(const double*) Views[1].buf,
+                                           ClearanceAsec,(double*) Views[2].buf);
+   Py_END_ALLOW_THREADS
+   int Ok = Outcome(Self,Status,0);
+   ReleaseViews (Views,3);
+   if (!Ok) return NULL;
+   return PyLong_FromLong(Status);
+}
+
+// ----------------------------------------------------------------------------------
+
+//                        S e s s i o n  C l e a r  R a d i u s
+//
+//  Session.clear_radius(ra, dec, clear) sets clear to the radius (arcsec) clear
+//  of contamination round each mean Ra,Dec position (deg), as given by the
+//  clearance maps, returning the number of radii found.
+
+static PyObject* SessionClearRadius (
+   HectorSessionObject* Self, PyObject* Args, PyObject* Kwds)
+{
+   static char* Keywords[] = {"ra","dec","clear",NULL};
+   PyObject* Objects[3] = {NULL,NULL,NULL};
+   if (!PyArg_ParseTupleAndKeywords(Args,Kwds,"OOO",Keywords,&Objects[0],
+                                                 &Objects[1],&Objects[2])) {
+      return NULL;
+   }
+   static const int Writable[3] = {0,0,1};
+   Py_buffer Views[3];
+   memset (Views,0,sizeof(Views));
+   Py_ssize_t NPosns = -1;
+   for (int IArg = 0; IArg < 3; IArg++) {
+      if (!GetDoubles(Objects[IArg],Keywords[IArg],Writable[IArg],
+                                                   &Views[IArg],&NPosns)) {
+         ReleaseViews (Views,3);
+         return NULL;
+      }
+   }
+   int Status = 0;
+   Py_BEGIN_ALLOW_THREADS
+   PyThread_acquire_lock (Self->Lock,WAIT_LOCK);
+   Status = HectorConfigClearRadius(Self->Handle,(int)NPosns,
+                (const double*) Views[0].buf,(const double*) Views[1].buf,
+                                                      (double*) Views[2].buf);
+   Py_END_ALLOW_THREADS
+   int Ok = Outcome(Self,Status,0);
+   ReleaseViews (Views,3);
+   if (!Ok) return NULL;
+   return PyLong_FromLong(Status);
+}
+
+// ----------------------------------------------------------------------------------
+
+//  The methods of the Session type, and the type itself.
+
+static PyMethodDef SessionMethods[] = {
+   {"set_field",(PyCFunction)(void(*)(void)) SessionSetField,
+         METH_VARARGS | METH_KEYWORDS,
+         "set_field(ra, dec, time='', robot_temp=15.0, obs_temp=15.0, "
+         "xymatrix='')\n\nSet the field centre (deg), observing time and "
+         "conditions. Returns the observing time as Mjd."},
+   {"radec_to_xy",(PyCFunction)(void(*)(void)) SessionRaDecToXY,
+         METH_VARARGS | METH_KEYWORDS,
+         "radec_to_xy(ra, dec, x, y, pmra=None, pmdec=None)\n\nConvert mean "
+         "Ra,Dec (deg) to plate X,Y (microns), in place. Returns the number "
+         "converted."},
+   {"xy_to_radec",(PyCFunction)(void(*)(void)) SessionXYToRaDec,
+         METH_VARARGS | METH_KEYWORDS,
+         "xy_to_radec(x, y, ra, dec, sky=False)\n\nConvert plate X,Y (microns) "
+         "to mean Ra,Dec (deg), in place. Returns the number converted."},
+   {"check_sky",(PyCFunction)(void(*)(void)) SessionCheckSky,
+         METH_VARARGS | METH_KEYWORDS,
+         "check_sky(ra, dec, clear, clearance=None)\n\nCheck Ra,Dec (deg) "
+         "positions for contamination, setting clear to 1.0, 0.0 or NaN. "
+         "Returns the number checked."},
+   {"clear_radius",(PyCFunction)(void(*)(void)) SessionClearRadius,
+         METH_VARARGS | METH_KEYWORDS,
+         "clear_radius(ra, dec, clear)\n\nSet clear to the radius (arcsec) "
+         "clear of contamination round Ra,Dec (deg) positions, from the "
+         "clearance maps, or NaN. Returns the number found."},
+   {NULL,NULL,0,NULL}
+};
+
+static PyTypeObject HectorSessionType = {
+   PyVarObject_HEAD_INIT(NULL,0)
+   .tp_name = "hectorconfig.Session",
+   .tp_basicsize = sizeof(HectorSessionObject),
+   .tp_itemsize = 0,
+   .tp_dealloc = (destructor) SessionDealloc,
+   .tp_flags = Py_TPFLAGS_DEFAULT,
+   .tp_doc = "A Hector configuration session - see HectorConfigModule.c",
+   .tp_methods = SessionMethods,
+   .tp_new = SessionNew,
+};
+
+static struct PyModuleDef HectorConfigModule = {
+   PyModuleDef_HEAD_INIT,
+   .m_name = "hectorconfig",
+   .m_doc = "In-process access to the Hector configuration utility code.",
+   .m_size = -1,
+};
+
+// ----------------------------------------------------------------------------------
+
+//                          P y  I n i t  h e c t o r c o n f i g
+//
+//  The module initialisation routine called by Python on import.
+
+PyMODINIT_FUNC PyInit_hectorconfig (void)
+{
+   if (PyType_Ready(&HectorSessionType) < 0) return NULL;
+   PyObject* Module = PyModule_Create(&HectorConfigModule);
+   if (Module == NULL) return NULL;
+   Py_INCREF (&HectorSessionType);
+   if (PyModule_AddObject(Module,"Session",
+                                   (PyObject*) &HectorSessionType) < 0) {
+      Py_DECREF (&HectorSessionType);
+      Py_DECREF (Module);
+      return NULL;
+   }
+   return Module;
+}
+
+// ----------------------------------------------------------------------------------
+
+/*                        P r o g r a m m i n g  N o t e s
+
+   o  This is C rather than C++, so that it only depends on the plain C header
+      HectorConfigCApi.h, but it is linked using g++, along with the rest of
+      the code, which is all C++.
+
+   o  Holding the buffers from the time they are obtained until the call is
+      complete is what makes it safe to release the interpreter lock while
+      the session works on them - Python won't let an object whose buffer is
+      held be resized or freed, even by another thread.
+
+   o  The session lock is only ever waited for after the interpreter lock has
+      been released, so a thread waiting for a session never holds up other
+      Python threads. It is held until the call's warnings and error have been
+      picked up, which is done with the interpreter lock re-acquired, but
+      nothing that might wait for a session lock - or run any Python code -
+      is done while both are held, so the two can't deadlock.
+
+   o  The library code, and all the packages it uses, have to be compiled as
+      position-independent code to be linked into the shared object Python
+      loads for this module - hence the use of -fPIC throughout the Makefile.
+*/
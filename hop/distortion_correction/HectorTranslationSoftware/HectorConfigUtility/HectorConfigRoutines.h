@@ -0,0 +1,115 @@
+//
+//                 H e c t o r  C o n f i g  R o u t i n e s . h
+//
+//  Function:
+//     Declares the processing routines used to configure a Hector tile.
+//
+//  Description:
+//     These are the routines that do the real work of the Hector configuration
+//     utility, originally all part of HectorConfigUtil.cpp. They are now part of
+//     the libhectorconfig library, used both by the HectorConfigSession class
+//     and by the HectorConfigUtil main program. See the comments in
+//     HectorConfigRoutines.cpp for details.
+//
+//  Author(s): Keith Shortridge, K&V  (Keith@KnaveAndVarlet.com.au)
+//             Hector Observations Pipeline team, (HOP)
+//
+//  History:
+//     16th Oct 2026.  Original version, for the routines moved out of
+//                     HectorConfigUtil.cpp. HOP.
+//
+// ----------------------------------------------------------------------------------
+
+#ifndef __HectorConfigRoutines__
+#define __HectorConfigRoutines__
+
+#include "HectorStructures.h"
+
+#include <string>
+#include <vector>
+
+//  Only the sky checking routines need the details of this class.
+
+class ProfitSkyCheck;
+
+//  Zero degrees C in degrees K.
+
+const double ZeroDegCinDegK = 273.15;
+
+//  Set the debug levels for the routines in HectorConfigRoutines.cpp.
+void SetMainDebugLevels (const std::string& Levels);
+//  List the program details, for diagnostic purposes.
+void ListProgDetails (const HectorUtilProgDetails& ProgDetails);
+//  Check a string is a valid integer, returning its value.
+bool ValidInteger (const std::string& String, long* Value);
+//  Check a string is a valid real number, returning its value.
+bool ValidReal (const std::string& String, double* Value);
+//  Get the XY rotation matrix values from a string, eg "1 0 0 1".
+void ParseRotMatString (std::string& RotMatString, double XYRotMatrix[],
+                                              bool& Ok, std::string& Error);
+//  Read a galaxy or guide star target file.
+void ReadInputFile (HectorTargetType FileType, HectorFileHeader* FileHeader,
+         std::vector<HectorTarget> *TargetList, HectorUtilProgDetails* ProgDetails);
+//  Convert a mean position, with proper motions, to apparent.
+void Mean2Apparent (HectorUtilProgDetails* ProgDetails, double MeanRa,
+         double MeanDec, double PmRa, double PmDec, double* AppRa, double* AppDec);
+//  Convert an apparent position to mean.
+void Apparent2Mean (HectorUtilProgDetails* ProgDetails, double AppRa,
+                        double AppDec, double* MeanRa, double* MeanDec);
+//  Parse a UT date and time string, returning the Mjd.
+bool ParseUTString (const std::string& UTString, double* Mjd,
+                                                         std::string* Error);
+//  Set the observing time, and the astrometry for it, in the program details.
+void ParseObsTime (const std::string& ObsTime,HectorUtilProgDetails* ProgDetails);
+//  Set up the observation details, and initialise the coordinate converter.
+void GetObsDetails (HectorObsDetails *ObsDetails,
+                                         HectorUtilProgDetails* ProgDetails);
+//  Convert mean positions to X,Y on the plate, using several threads.
+bool MeanToPlateXY (const HectorAstrometry& Astrometry, HectorRaDecXY& Converter,
+         int NPosns, const double MeanRa[], const double MeanDec[],
+         const double PmRa[], const double PmDec[], double AppRa[],
+         double AppDec[], double X[], double Y[], bool Converted[],
+         const HectorUtilProgDetails& ProgDetails, std::string* Error);
+//  Work out the X,Y positions of all the targets.
+void ConvertTargetCoordinates (const HectorObsDetails &ObsDetails,
+         std::vector<HectorTarget>* TargetList, HectorUtilProgDetails* ProgDetails);
+//  Read the sky fibre file.
+void GetSkyFibreDetails (std::vector<HectorSkyFibre> *SkyFibreList,
+                                         HectorUtilProgDetails* ProgDetails);
+//  Work out the Ra,Dec positions of all the sky fibre positions.
+void ConvertSkyFibreCoordinates (const HectorObsDetails &ObsDetails,
+         std::vector<HectorSkyFibre> *SkyFibreList,
+                                         HectorUtilProgDetails* ProgDetails);
+//  Set up a sky checker for the field.
+void SetUpSkyChecker (ProfitSkyCheck* SkyChecker,
+                                         HectorUtilProgDetails* ProgDetails);
+//  Check the sky fibre positions for contamination, choosing one for each.
+void CheckSkyFibresAreClear (std::vector<HectorSkyFibre> *SkyFibreList,
+         HectorUtilProgDetails* ProgDetails, ProfitSkyCheck* SkyChecker = NULL);
+//  Apply the sky shuffling needed for the Hector spectrograph (not needed).
+void ShuffleSkyFibres (std::vector<HectorSkyFibre>* SkyFibreList,
+                                         HectorUtilProgDetails* ProgDetails);
+//  Parse the epochs given with the -sweep option.
+void GetSweepEpochs (HectorUtilProgDetails* ProgDetails);
+//  Work out, and write out, the target positions at each sweep epoch.
+void SweepTargetCoordinates (const HectorObsDetails &ObsDetails,
+         const std::vector<HectorTarget> &TargetList,
+                                         HectorUtilProgDetails* ProgDetails);
+//  Write the output file.
+void WriteOutputFile (const HectorFileHeader &FileHeader,
+         const HectorObsDetails &ObsDetails,
+         const std::vector<HectorTarget> &TargetList,
+         const std::vector<HectorSkyFibre> &SkyFibreList,
+                                         HectorUtilProgDetails* ProgDetails);
+//  Copy sky fibre details already read, in place of GetSkyFibreDetails().
+void CopySkyFibreDetails (const HectorSharedDetails& Shared,
+         std::vector<HectorSkyFibre> *SkyFibreList,
+                                         HectorUtilProgDetails* ProgDetails);
+//  Read the models and sky fibre details once, for use by many tiles.
+void ReadSharedDetails (HectorSharedDetails* Shared,
+                                   const HectorUtilProgDetails& ProgDetails);
+//  Read just the sky fibre details, for use by many tiles.
+void ReadSharedSkyFibres (HectorSharedDetails* Shared,
+                                   const HectorUtilProgDetails& ProgDetails);
+
+#endif
@@ -0,0 +1,819 @@
+//
+//                 H e c t o r  C o n f i g  S e s s i o n . c p p
+//
+//  Function:
+//     A class that does the work of the Hector configuration utility in-process.
+//
+//  Description:
+//     This is the implementation of the HectorConfigSession class. See the
+//     comments in HectorConfigSession.h for details.
+//
+//  Author(s): Hector Observations Pipeline team, (HOP)
+//
+//  History:
+//     16th Oct 2026.  Original version. HOP.
+//     16th Oct 2026.  Added GetClearRadii(). SetUpField() now reports the
+//                     observing time it picked as a warning if the program
+//                     details say not to print it. HOP.
+//     16th Oct 2026.  Added StartSkyChecker(), DropSkyChecker() and
+//                     MakeSkyChecker(), so that ConfigureTile() can set up the
+//                     sky checker while the positions are being converted. HOP.
+//
+
+#include "HectorConfigSession.h"
+
+#include "HectorConfigRoutines.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include "slalib.h"
+#include "slamac.h"
+
+using std::vector;
+using std::string;
+
+// ----------------------------------------------------------------------------------
+
+//                            C o n s t r u c t o r
+//
+//  The constructor just initialises the instance variables. Nothing can be
+//  done until SetProgDetails() has been called.
+
+HectorConfigSession::HectorConfigSession (void)
+{
+   I_FieldSet = false;
+   I_FieldKey = "";
+   I_Shared = NULL;
+   I_ErrorText = "";
+}
+
+// ----------------------------------------------------------------------------------
+
+//                             D e s t r u c t o r
+//
+//  The destructor only has to make sure any sky checker set-up started by
+//  StartSkyChecker() has finished - the sky checker itself, if one was set up,
+//  goes with the unique_ptr that holds it.
+
+HectorConfigSession::~HectorConfigSession ()
+{
+   DropSkyChecker();
+}
+
+// ----------------------------------------------------------------------------------
+
+//                        S e t  P r o g  D e t a i l s
+//
+//  Sets the details that would otherwise come from the command line, as set
+//  up by SetUpProgDetails() in HectorConfigUtil.cpp. Any field already set up
+//  is forgotten, as are any sky fibre details read by the session, since
+//  these may depend on the details that have changed. The coordinate models,
+//  once read, are kept - the converter reads them again if the files change.
+
+void HectorConfigSession::SetProgDetails (
+   const HectorUtilProgDetails& ProgDetails)
+{
+   I_Settings = ProgDetails;
+   I_Settings.Ok = true;
+   I_Settings.Error = "";
+   I_Settings.Warnings.clear();
+   I_Settings.ConverterInitialised = false;
+   I_Settings.CoordConverter.SetDebugLevels(I_Settings.DebugLevels);
+   I_FieldSet = false;
+   I_FieldKey = "";
+   DropSkyChecker();
+   I_OwnShared = HectorSharedDetails();
+}
+
+// ----------------------------------------------------------------------------------
+
+//                      U s e  S h a r e d  D e t a i l s
+//
+//  Has the session use the models and sky fibre details in a structure that
+//  has been set up by ReadSharedDetails(), rather than reading them itself.
+//  This is what lets a number of sessions - one for each thread working through
+//  the tiles in a manifest, for example - read these just once between them.
+//  The structure must stay in existence, unchanged, for as long as the session
+//  uses it. Passing NULL has the session read these for itself again.
+
+void HectorConfigSession::UseSharedDetails (const HectorSharedDetails* Shared)
+{
+   I_Shared = Shared;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                        S e t  D e b u g  L e v e l s
+//
+//  Sets the debug levels for the routines in HectorConfigRoutines.cpp that do
+//  most of the work. These are shared by all sessions, so this is a static
+//  method, and should be called before any sessions are being used in other
+//  threads. (The levels for each session's coordinate converter and sky checker
+//  are taken from the DebugLevels given in its program details.)
+
+void HectorConfigSession::SetDebugLevels (const string& Levels)
+{
+   SetMainDebugLevels (Levels);
+}
+
+// ----------------------------------------------------------------------------------
+
+//                            S e t  F i e l d
+//
+//  Sets the field used by the conversion and checking methods. The centre is
+//  given as mean J2000 Ra,Dec in degrees, the temperatures in deg C, and the
+//  observing time and XY rotation matrix as strings, as on the command line.
+//  If these are the same as for the field already set up, that is used as it
+//  is, and Reused, if passed, is set true. Otherwise, the coordinate converter
+//  and astrometry are set up for the new field, as GetObsDetails() sets them up
+//  for a tile, and any sky checker set up for the previous field is dropped.
+
+bool HectorConfigSession::SetField (
+   double CentreRaDeg, double CentreDecDeg, const string& DateAndTime,
+   double RobotTempC, double ObsTempC, const string& RotMatString,
+   bool* Reused)
+{
+   I_ErrorText = "";
+   I_Warnings.clear();
+   string MatString = RotMatString;
+   double XYRotMatrix[4];
+   bool Ok = true;
+   ParseRotMatString (MatString,XYRotMatrix,Ok,I_ErrorText);
+   if (!Ok) return false;
+   return SetUpField (CentreRaDeg * DD2R,CentreDecDeg * DD2R,DateAndTime,
+         RobotTempC + ZeroDegCinDegK,ObsTempC + ZeroDegCinDegK,RotMatString,
+                                              XYRotMatrix,Reused,&I_Warnings);
+}
+
+// ----------------------------------------------------------------------------------
+
+//                          S e t  U p  F i e l d
+//
+//  Does the work for SetField() and ProcessTile(), taking the centre in radians,
+//  the temperatures in deg K and the XY rotation matrix already parsed, as in
+//  the program details. Any warnings setting up the field are added to those
+//  in Warnings - and are added again each time the field is reused, so that
+//  each tile configured for the field reports them, just as it would if the
+//  field had been set up for it alone.
+
+bool HectorConfigSession::SetUpField (
+   double CentreRa, double CentreDec, const string& DateAndTime,
+   float RobotTemp, float ObsTemp, const string& RotMatString,
+   const double XYRotMatrix[], bool* Reused, vector<string>* Warnings)
+{
+   string Key = MakeFieldKey(CentreRa,CentreDec,DateAndTime,RobotTemp,
+                                                        ObsTemp,XYRotMatrix);
+   if (Reused) *Reused = false;
+   if (I_FieldSet && Key == I_FieldKey) {
+      if (Reused) *Reused = true;
+      Warnings->insert(Warnings->end(),I_Field.Warnings.begin(),
+                                                      I_Field.Warnings.end());
+      return true;
+   }
+   I_FieldSet = false;
+   I_FieldKey = "";
+   DropSkyChecker();
+   
+   //  The models only need to be read once, either for all sessions sharing
+   //  them or, if not shared, by the first field this session sets up. In
+   //  that case they're in the previous field's converter, which is about
+   //  to be replaced, so they're kept in Models until the new one has them.
+   
+   HectorRaDecXY Models;
+   if (!(I_Shared && I_Shared->ModelsRead)) {
+      Models.CopyModels(I_Field.CoordConverter);
+   }
+   I_Field = I_Settings;
+   I_Field.CentreRa = CentreRa;
+   I_Field.CentreDec = CentreDec;
+   I_Field.DateAndTime = DateAndTime;
+   I_Field.RobotTemp = RobotTemp;
+   I_Field.ObsTemp = ObsTemp;
+   I_Field.RotMatString = RotMatString;
+   for (int I = 0; I < 4; I++) I_Field.XYRotMatrix[I] = XYRotMatrix[I];
+   if (I_Shared && I_Shared->ModelsRead) {
+      I_Field.CoordConverter.CopyModels(I_Shared->Models);
+   } else {
+      I_Field.CoordConverter.CopyModels(Models);
+   }
+   I_ObsDetails = HectorObsDetails();
+   GetObsDetails (&I_ObsDetails,&I_Field);
+   
+   //  If the observing time was picked to put the field on the meridian, and
+   //  the program details say not to print this, it's reported as a warning.
+   
+   if (!I_Field.PrintMeridianTime && I_Field.MeridianTimeMessage != "") {
+      I_Field.Warnings.push_back(I_Field.MeridianTimeMessage);
+   }
+   Warnings->insert(Warnings->end(),I_Field.Warnings.begin(),
+                                                     I_Field.Warnings.end());
+   if (!I_Field.Ok) {
+      I_ErrorText = I_Field.Error;
+      return false;
+   }
+   I_FieldKey = Key;
+   I_FieldSet = true;
+   return true;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                          M a k e  F i e l d  K e y
+//
+//  Returns a string that describes everything that determines how positions
+//  in a field are converted, given the values in the units held in the program
+//  details. Two fields with the same key are the same field.
+
+string HectorConfigSession::MakeFieldKey (
+   double CentreRa, double CentreDec, const string& DateAndTime,
+   float RobotTemp, float ObsTemp, const double XYRotMatrix[])
+{
+   char Values[256];
+   snprintf (Values,sizeof(Values),"%.17g %.17g|%.9g %.9g|%.17g %.17g %.17g %.17g",
+        CentreRa,CentreDec,RobotTemp,ObsTemp,
+              XYRotMatrix[0],XYRotMatrix[1],XYRotMatrix[2],XYRotMatrix[3]);
+   return string(Values) + "|" + DateAndTime;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                             F i e l d  K e y
+//
+//  Returns the key that SetField() would give a field, given the same values
+//  it is passed, without setting anything up. This lets a program that keeps
+//  a number of sessions, such as the HectorConfigUtil service, see if one is
+//  already set up for a given field. If the rotation matrix string isn't
+//  valid, this returns a blank string, which never matches a field's key.
+
+string HectorConfigSession::FieldKey (
+   double CentreRaDeg, double CentreDecDeg, const string& DateAndTime,
+   double RobotTempC, double ObsTempC, const string& RotMatString)
+{
+   string MatString = RotMatString;
+   double XYRotMatrix[4];
+   bool Ok = true;
+   string Error = "";
+   ParseRotMatString (MatString,XYRotMatrix,Ok,Error);
+   if (!Ok) return "";
+   return MakeFieldKey(CentreRaDeg * DD2R,CentreDecDeg * DD2R,DateAndTime,
+        RobotTempC + ZeroDegCinDegK,ObsTempC + ZeroDegCinDegK,XYRotMatrix);
+}
+
+// ----------------------------------------------------------------------------------
+
+//                          G e t  F i e l d  K e y
+//
+//  Returns the key for the field currently set up, or a blank string if none is.
+
+string HectorConfigSession::GetFieldKey (void) const
+{
+   return I_FieldKey;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                              G e t  M j d
+//
+//  Returns the observing time for the field currently set up, as Mjd, which
+//  is useful if this was left to default. Returns zero if no field is set up.
+
+double HectorConfigSession::GetMjd (void) const
+{
+   return I_FieldSet ? I_Field.Mjd : 0.0;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                          R a  D e c  T o  X Y
+//
+//  Converts a number of mean J2000 Ra,Dec positions, in degrees, to X,Y positions
+//  on the plate, in microns, for the field, exactly as the target positions are
+//  converted by ConvertTargetCoordinates(). The proper motions are in milli-
+//  arcsec/year, the Ra proper motion including the cos(Dec) factor, as in the
+//  target files, and either or both may be passed as NULL if there are none.
+//  They are ignored if proper motion corrections have been disabled. Converted
+//  is set to show which positions were converted, and if any could not be,
+//  this returns false (see HectorConfigSession.h for the error reported).
+
+bool HectorConfigSession::RaDecToXY (
+   int NPosns, const double RaDeg[], const double DecDeg[],
+   const double PmRa[], const double PmDec[], double X[], double Y[],
+   bool Converted[])
+{
+   I_ErrorText = "";
+   I_Warnings.clear();
+   for (int IPosn = 0; IPosn < NPosns; IPosn++) Converted[IPosn] = false;
+   if (!CheckFieldSet()) return false;
+   
+   //  Convert the units as ReadInputFile() does.
+   
+   const double MilliArcsecToRadians = DD2R / (1000.0 * 3600.0);
+   vector<double> MeanRa(NPosns),MeanDec(NPosns);
+   vector<double> PmRaRad(NPosns,0.0),PmDecRad(NPosns,0.0);
+   for (int IPosn = 0; IPosn < NPosns; IPosn++) {
+      MeanRa[IPosn] = RaDeg[IPosn] * DD2R;
+      MeanDec[IPosn] = DecDeg[IPosn] * DD2R;
+      if (I_Field.PmCorrection) {
+         double CosDec = cos(MeanDec[IPosn]);
+         if (PmRa && CosDec != 0.0) {
+            PmRaRad[IPosn] = (PmRa[IPosn] / CosDec) * MilliArcsecToRadians;
+         }
+         if (PmDec) PmDecRad[IPosn] = PmDec[IPosn] * MilliArcsecToRadians;
+      }
+   }
+   vector<double> AppRa(NPosns),AppDec(NPosns);
+   return MeanToPlateXY(I_Field.Astrometry,I_Field.CoordConverter,NPosns,
+            MeanRa.data(),MeanDec.data(),PmRaRad.data(),PmDecRad.data(),
+            AppRa.data(),AppDec.data(),X,Y,Converted,I_Field,&I_ErrorText);
+}
+
+// ----------------------------------------------------------------------------------
+
+//                          X Y  T o  R a  D e c
+//
+//  Converts a number of X,Y positions on the plate, in microns, to mean J2000
+//  Ra,Dec positions in degrees, for the field. If Sky is true, the positions
+//  are converted as ConvertSkyFibreCoordinates() converts the sky fibre
+//  positions, without the telecentricity and mech offset corrections. Converted
+//  is set to show which positions were converted, and if any could not be,
+//  this returns false (see HectorConfigSession.h for the error reported).
+
+bool HectorConfigSession::XYToRaDec (
+   int NPosns, const double X[], const double Y[], bool Sky,
+   double RaDeg[], double DecDeg[], bool Converted[])
+{
+   I_ErrorText = "";
+   I_Warnings.clear();
+   for (int IPosn = 0; IPosn < NPosns; IPosn++) Converted[IPosn] = false;
+   if (!CheckFieldSet()) return false;
+   
+   HectorRaDecXY& Converter = I_Field.CoordConverter;
+   bool PrevTele = false;
+   bool PrevMech = false;
+   if (Sky) {
+      PrevTele = Converter.DisableTelecentricity(true);
+      PrevMech = Converter.DisableMechOffset(true);
+   }
+   vector<double> AppRa(NPosns),AppDec(NPosns);
+   bool Ok = Converter.XY2RaDecBatch(X,Y,NPosns,AppRa.data(),AppDec.data(),
+                                                                   Converted);
+   if (!Ok) I_ErrorText = Converter.GetError();
+   if (Sky) {
+      Converter.DisableTelecentricity(PrevTele);
+      Converter.DisableMechOffset(PrevMech);
+   }
+   for (int IPosn = 0; IPosn < NPosns; IPosn++) {
+      if (Converted[IPosn]) {
+         double MeanRa,MeanDec;
+         Apparent2Mean (&I_Field,AppRa[IPosn],AppDec[IPosn],&MeanRa,&MeanDec);
+         RaDeg[IPosn] = MeanRa * DR2D;
+         DecDeg[IPosn] = MeanDec * DR2D;
+      }
+   }
+   return Ok;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                             C h e c k  S k y
+//
+//  Checks a number of positions in the field for contamination by objects in
+//  the Profit mask files, using the session's sky checker, which is set up the
+//  first time it is needed for a field and then kept, with any masks it has
+//  loaded, until the field changes. The positions, and the clearance needed
+//  around each, are passed in the ProfitSkyPosn structures, and the results
+//  are returned in them, exactly as for ProfitSkyCheck::CheckPositionsForSky().
+
+bool HectorConfigSession::CheckSky (vector<ProfitSkyPosn>* SkyPosns)
+{
+   I_ErrorText = "";
+   I_Warnings.clear();
+   if (!CheckFieldSet()) return false;
+   if (!I_Settings.CheckSky) {
+      I_ErrorText = "Sky position checks have been disabled";
+      return false;
+   }
+   ProfitSkyCheck* SkyChecker = GetSkyChecker();
+   if (SkyChecker == NULL) return false;
+   if (!SkyChecker->CheckPositionsForSky(*SkyPosns)) {
+      I_ErrorText = SkyChecker->GetError();
+      return false;
+   }
+   return true;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                         G e t  C l e a r  R a d i i
+//
+//  Looks up the radius (arcsec) that is clear of contamination round a number
+//  of positions in the field, using the clearance maps the session's sky checker
+//  builds if the program details ask for them (UseClearMaps). The positions are
+//  passed in ProfitSkyPosn structures, as for CheckSky(), and ClearAsec is set to
+//  the clear radius for each. Status is set to SKY_CLEAR if this is at least
+//  RadiusDeg, as it is when HectorConfigUtil is run with -clearmap, or to
+//  SKY_OBSCURED if not. A position that can't be looked up is left as
+//  SKY_UNCHECKED, with a zero radius, and Reason says why.
+
+bool HectorConfigSession::GetClearRadii (
+   vector<ProfitSkyPosn>* SkyPosns, vector<double>* ClearAsec)
+{
+   I_ErrorText = "";
+   I_Warnings.clear();
+   ClearAsec->assign(SkyPosns->size(),0.0);
+   if (!CheckFieldSet()) return false;
+   if (!I_Settings.CheckSky) {
+      I_ErrorText = "Sky position checks have been disabled";
+      return false;
+   }
+   if (!I_Settings.UseClearMaps) {
+      I_ErrorText = "Clearance maps have not been enabled for the session";
+      return false;
+   }
+   ProfitSkyCheck* SkyChecker = GetSkyChecker();
+   if (SkyChecker == NULL) return false;
+   for (size_t IPosn = 0; IPosn < SkyPosns->size(); IPosn++) {
+      ProfitSkyPosn& SkyPosn = (*SkyPosns)[IPosn];
+      double* Clear = &(*ClearAsec)[IPosn];
+      SkyPosn.Status = SKY_UNCHECKED;
+      SkyPosn.Reason = "";
+      if (SkyChecker->GetClearRadius(SkyPosn.RaDeg,SkyPosn.DecDeg,Clear)) {
+         SkyPosn.Status = (*Clear >= SkyPosn.RadiusDeg * 3600.0) ?
+                                                  SKY_CLEAR : SKY_OBSCURED;
+      } else {
+         SkyPosn.Reason = SkyChecker->GetError();
+      }
+   }
+   return true;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                       C o n f i g u r e  T a r g e t s
+//
+//  Does what ProcessTile() does for the field set by SetField(), but with the
+//  targets held in memory rather than read from files, and the results returned
+//  in memory rather than written to an output file. The mean Ra,Dec and proper
+//  motions of each target must be set, in radians (and radians/year) as in
+//  the HectorTarget structure, and their X,Y positions are set. SkyFibreList
+//  is set to the sky fibre details, including their Ra,Dec positions and the
+//  positions chosen for them by the sky checks.
+
+bool HectorConfigSession::ConfigureTargets (
+   vector<HectorTarget>* TargetList, vector<HectorSkyFibre>* SkyFibreList)
+{
+   I_ErrorText = "";
+   I_Warnings.clear();
+   SkyFibreList->clear();
+   if (!CheckFieldSet()) return false;
+   
+   HectorUtilProgDetails Details = I_Field;
+   Details.Warnings.clear();
+   ConvertTargetCoordinates (I_ObsDetails,TargetList,&Details);
+   ConfigureSkyFibres (SkyFibreList,&Details);
+   return SetOutcome(Details);
+}
+
+// ----------------------------------------------------------------------------------
+
+//                           P r o c e s s  T i l e
+//
+//  Configures the tile described by the program details passed to
+//  SetProgDetails(), from reading the input files to writing the output file,
+//  exactly as HectorConfigUtil does when run for a single tile.
+
+bool HectorConfigSession::ProcessTile (void)
+{
+   HectorUtilProgDetails TileDetails = I_Settings;
+   return ConfigureTile (&TileDetails);
+}
+
+// ----------------------------------------------------------------------------------
+
+//                           P r o c e s s  T i l e
+//
+//  Configures a tile, such as one listed in a manifest file, using the values
+//  given for it in place of those passed to SetProgDetails().
+
+bool HectorConfigSession::ProcessTile (const HectorManifestTile& Tile)
+{
+   HectorUtilProgDetails TileDetails = I_Settings;
+   TileDetails.MainTargetFileName = Tile.MainTargetFileName;
+   TileDetails.GuideTargetFileName = Tile.GuideTargetFileName;
+   TileDetails.OutputFileName = Tile.OutputFileName;
+   TileDetails.Label = Tile.Label;
+   TileDetails.PlateID = Tile.PlateID;
+   TileDetails.DateAndTime = Tile.DateAndTime;
+   TileDetails.RobotTemp = Tile.RobotTemp;
+   TileDetails.ObsTemp = Tile.ObsTemp;
+   TileDetails.RotMatString = Tile.RotMatString;
+   for (int I = 0; I < 4; I++) {
+      TileDetails.XYRotMatrix[I] = Tile.XYRotMatrix[I];
+   }
+   return ConfigureTile (&TileDetails);
+}
+
+// ----------------------------------------------------------------------------------
+
+//                         C o n f i g u r e  T i l e
+//
+//  Does all the work for one tile, as described by the program details passed.
+//  This follows what the HectorConfigUtil main program originally did, as a
+//  simple linear progression. If anything goes wrong, one stage will flag this
+//  in the program details, and subsequent stages will just fall through to the
+//  end. The only differences are that the field is set up by SetUpField() once
+//  the input files have given its centre, so if the previous tile was for the
+//  same field, its converter, astrometry and sky checker are used again, and
+//  that if a sky checker has to be set up for the field, this is started in a
+//  separate thread at that point, while the positions are being converted.
+
+bool HectorConfigSession::ConfigureTile (HectorUtilProgDetails* TileDetails)
+{
+   I_ErrorText = "";
+   I_Warnings.clear();
+   
+   //  a) Structures containing anything we need from the input files that will
+   //     need to be included in the output file. We have two, one for the main
+   //     target file and one for the guide star target file.
+   
+   HectorFileHeader MainFileHeader;
+   HectorFileHeader GuideFileHeader;
+   
+   //  b) A set of structures each containing the details of a target object.
+   
+   vector<HectorTarget> TargetList;
+   
+   //  c) A set of structures each containing the details of a sky fibre.
+   
+   vector<HectorSkyFibre> SkyFibreList;
+   
+   //  Read the input files, getting any header information that has to be
+   //  included in the output file, and the set of target galaxies and guide
+   //  stars, adding all the targets to the target list.
+   
+   ReadInputFile (GALAXY,&MainFileHeader,&TargetList,TileDetails);
+   ReadInputFile (GUIDE,&GuideFileHeader,&TargetList,TileDetails);
+   
+   //  Having read the input files gives us the field centre, so we can now set
+   //  up the field. The tile works with its own copy of the converter, so
+   //  nothing it does to it affects the field as set up.
+   
+   if (TileDetails->Ok) {
+      if (!SetUpField(TileDetails->CentreRa,TileDetails->CentreDec,
+              TileDetails->DateAndTime,TileDetails->RobotTemp,
+                 TileDetails->ObsTemp,TileDetails->RotMatString,
+                    TileDetails->XYRotMatrix,NULL,&TileDetails->Warnings)) {
+         TileDetails->Error = I_ErrorText;
+         TileDetails->Ok = false;
+      } else {
+         TileDetails->DateAndTime = I_Field.DateAndTime;
+         TileDetails->Mjd = I_Field.Mjd;
+         TileDetails->Astrometry = I_Field.Astrometry;
+         TileDetails->CoordConverter = I_Field.CoordConverter;
+         TileDetails->ConverterInitialised = I_Field.ConverterInitialised;
+         for (int I = 0; I < C_MODEL_PARMS; I++) {
+            TileDetails->ModelPars[I] = I_Field.ModelPars[I];
+         }
+         TileDetails->NumberPars = I_Field.NumberPars;
+      }
+   }
+   
+   //  In sweep mode, all we do is calculate the target positions for each
+   //  of the specified epochs and write them out. Everything else is for the
+   //  normal mode.
+   
+   if (TileDetails->SweepSpec != "") {
+      GetSweepEpochs (TileDetails);
+      SweepTargetCoordinates (I_ObsDetails,TargetList,TileDetails);
+   } else {
+      
+      //  Add the X,Y plate positions to the structures that describe the
+      //  targets, then work out the Ra,Dec positions of the sky fibres and
+      //  pick the clear ones, and write out the new target file. Reading the
+      //  masks for the sky checks doesn't depend on any of the positions, so
+      //  that can be getting on in the meantime.
+      
+      if (TileDetails->Ok && TileDetails->CheckSky &&
+                                           TileDetails->Threads != 1) {
+         StartSkyChecker();
+      }
+      ConvertTargetCoordinates (I_ObsDetails,&TargetList,TileDetails);
+      ConfigureSkyFibres (&SkyFibreList,TileDetails);
+      WriteOutputFile (MainFileHeader,I_ObsDetails,TargetList,SkyFibreList,
+                                                                 TileDetails);
+   }
+   return SetOutcome(*TileDetails);
+}
+
+// ----------------------------------------------------------------------------------
+
+//                     C o n f i g u r e  S k y  F i b r e s
+//
+//  Gets the details of the sky fibre positions, works out their Ra,Dec positions
+//  for the field, and sees which are contaminated by known objects, choosing a
+//  position for each. The sky checker is the session's, set up for the field
+//  the first time it is needed.
+
+void HectorConfigSession::ConfigureSkyFibres (
+   vector<HectorSkyFibre>* SkyFibreList, HectorUtilProgDetails* ProgDetails)
+{
+   GetSkyFibres (SkyFibreList,ProgDetails);
+   ConvertSkyFibreCoordinates (I_ObsDetails,SkyFibreList,ProgDetails);
+   ProfitSkyCheck* SkyChecker = NULL;
+   if (ProgDetails->Ok && ProgDetails->CheckSky) {
+      SkyChecker = GetSkyChecker();
+      if (SkyChecker == NULL) {
+         ProgDetails->Error = I_ErrorText;
+         ProgDetails->Ok = false;
+      }
+   }
+   CheckSkyFibresAreClear (SkyFibreList,ProgDetails,SkyChecker);
+   ShuffleSkyFibres (SkyFibreList,ProgDetails);
+}
+
+// ----------------------------------------------------------------------------------
+
+//                          G e t  S k y  F i b r e s
+//
+//  Gets the details of the sky fibres, from the shared details if these
+//  include them, or otherwise from the copy this session keeps, reading the
+//  sky fibre file the first time they are needed. Any warnings or error from
+//  reading the file are reported for every call, as they would be if the
+//  file were read each time.
+
+void HectorConfigSession::GetSkyFibres (
+   vector<HectorSkyFibre>* SkyFibreList, HectorUtilProgDetails* ProgDetails)
+{
+   if (!ProgDetails->Ok) return;
+   
+   const HectorSharedDetails* Shared = I_Shared;
+   if (Shared == NULL || !Shared->SkyFibresRead) {
+      if (!I_OwnShared.SkyFibresRead) {
+         ReadSharedSkyFibres (&I_OwnShared,*ProgDetails);
+      }
+      Shared = &I_OwnShared;
+   }
+   CopySkyFibreDetails (*Shared,SkyFibreList,ProgDetails);
+}
+
+// ----------------------------------------------------------------------------------
+
+//                          G e t  S k y  C h e c k e r
+//
+//  Returns the sky checker for the field. If StartSkyChecker() has started
+//  setting one up, this waits for it to finish, and otherwise sets one up now.
+//  If the set-up fails, this returns NULL, with I_ErrorText set to describe
+//  the problem, and the set-up will be tried again next time.
+
+ProfitSkyCheck* HectorConfigSession::GetSkyChecker (void)
+{
+   if (I_SkyCheckerSetUp.valid()) {
+      I_SkyCheckerSetUp.get();
+      if (!I_StartedSkyChecker) {
+         I_ErrorText = I_StartedSkyCheckerError;
+         return NULL;
+      }
+      I_SkyChecker = std::move(I_StartedSkyChecker);
+   }
+   if (!I_SkyChecker) {
+      string Error = "";
+      I_SkyChecker.reset(MakeSkyChecker(I_Field,&Error));
+      if (!I_SkyChecker) {
+         I_ErrorText = Error;
+         return NULL;
+      }
+   }
+   return I_SkyChecker.get();
+}
+
+// ----------------------------------------------------------------------------------
+
+//                        S t a r t  S k y  C h e c k e r
+//
+//  Starts setting up a sky checker for the field in a separate thread, unless
+//  one has already been set up, or is being set up. GetSkyChecker() waits for
+//  this to finish and picks up the result.
+
+void HectorConfigSession::StartSkyChecker (void)
+{
+   if (I_SkyChecker || I_SkyCheckerSetUp.valid()) return;
+   
+   I_StartedSkyChecker.reset();
+   I_StartedSkyCheckerError = "";
+   HectorUtilProgDetails CheckDetails = I_Field;
+   I_SkyCheckerSetUp = std::async(std::launch::async,[this,CheckDetails]() {
+      I_StartedSkyChecker.reset(
+                   MakeSkyChecker(CheckDetails,&I_StartedSkyCheckerError));
+   });
+}
+
+// ----------------------------------------------------------------------------------
+
+//                         D r o p  S k y  C h e c k e r
+//
+//  Drops the sky checker for the field, if one has been set up, first waiting
+//  for any set-up started by StartSkyChecker() to finish.
+
+void HectorConfigSession::DropSkyChecker (void)
+{
+   if (I_SkyCheckerSetUp.valid()) I_SkyCheckerSetUp.get();
+   I_StartedSkyChecker.reset();
+   I_SkyChecker.reset();
+}
+
+// ----------------------------------------------------------------------------------
+
+//                         M a k e  S k y  C h e c k e r
+//
+//  Creates a sky checker and sets it up with SetUpSkyChecker() for the field
+//  described by a copy of the field's program details, returning it - for the
+//  caller to delete - or returning NULL, with Error set, if the set-up fails.
+//  This only uses its arguments, so can be run in a separate thread.
+
+ProfitSkyCheck* HectorConfigSession::MakeSkyChecker (
+   HectorUtilProgDetails CheckDetails, string* Error)
+{
+   std::unique_ptr<ProfitSkyCheck> SkyChecker(new ProfitSkyCheck);
+   CheckDetails.Ok = true;
+   SetUpSkyChecker (SkyChecker.get(),&CheckDetails);
+   if (!CheckDetails.Ok) {
+      *Error = CheckDetails.Error;
+      return NULL;
+   }
+   return SkyChecker.release();
+}
+
+// ----------------------------------------------------------------------------------
+
+//                            S e t  O u t c o m e
+//
+//  Sets the error and warnings returned by GetError() and GetWarnings() from
+//  the program details used by a call, and returns its Ok flag.
+
+bool HectorConfigSession::SetOutcome (const HectorUtilProgDetails& ProgDetails)
+{
+   I_ErrorText = ProgDetails.Ok ? "" : ProgDetails.Error;
+   I_Warnings = ProgDetails.Warnings;
+   return ProgDetails.Ok;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                         C h e c k  F i e l d  S e t
+//
+//  Returns true if a field has been set up, and otherwise sets I_ErrorText.
+
+bool HectorConfigSession::CheckFieldSet (void)
+{
+   if (!I_FieldSet) {
+      I_ErrorText = "No field has been set up for the session";
+      return false;
+   }
+   return true;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                             G e t  E r r o r
+//
+//  Returns a description of the error that caused the latest call to fail.
+
+string HectorConfigSession::GetError (void) const
+{
+   return I_ErrorText;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                           G e t  W a r n i n g s
+//
+//  Returns any warnings generated by the latest call.
+
+vector<string> HectorConfigSession::GetWarnings (void) const
+{
+   return I_Warnings;
+}
+
+// ----------------------------------------------------------------------------------
+
+/*                        P r o g r a m m i n g  N o t e s
+
+   o  SetUpField() sets up the converter in place in I_Field, rather than in
+      a copy that then replaces I_Field. A field that can't be set up (one
+      too close to the horizon at the given time, say) leaves I_FieldSet
+      false, but the models have already been copied into I_Field's
+      converter, so they're still available to be copied for the next.
+
+   o  MakeSkyChecker() works on a copy of the field's program details, just so
+      a failure setting up the checker doesn't leave I_Field flagged as bad.
+      The copy is only made when a checker is set up, once for each field.
+      StartSkyChecker() makes its copy before starting the thread, since
+      I_Field can change once the thread has started.
+
+   o  A tile that fails before its sky fibres are checked leaves any set-up
+      started for it running. That's harmless - the checker is for the field,
+      and is picked up by the next tile or check in the same field, and if
+      the field changes, DropSkyChecker() waits for the set-up to finish
+      before throwing it away.
+*/
@@ -0,0 +1,214 @@
+//
+//                 H e c t o r  C o n f i g  S e s s i o n . h
+//
+//  Function:
+//     A class that does the work of the Hector configuration utility in-process.
+//
+//  Description:
+//     The Hector configuration utility, HectorConfigUtil, was written to be run
+//     once for each tile (field), reading its targets from files and writing
+//     the results to another file. A HectorConfigSession object does the same
+//     work, using the same routines (see HectorConfigRoutines.h), but can be
+//     used for any number of tiles, and keeps as much as it can from one to the
+//     next: the 2dF distortion and linearity models and the sky fibre details
+//     once they have been read, and the coordinate converter, astrometry and
+//     Profit mask sky checker set up for the most recent field and epoch. As
+//     well as configuring a tile from files, just as the program does, it can
+//     convert arrays of positions between Ra,Dec and plate X,Y, check arrays
+//     of positions for contamination, and configure a set of targets held in
+//     memory, returning the results in memory. HectorConfigUtil itself now
+//     uses this class, and it is built into the libhectorconfig library so
+//     that other programs can use it too.
+//
+//     A session is set up with SetProgDetails(), passing it a program details
+//     structure with the values that would otherwise come from the command
+//     line (file names, flags, clearance, number of threads, etc.), including
+//     those HectorConfigUtil sets itself, such as the field radius and the
+//     expected numbers of sky fibres. For the conversion and checking
+//     methods, SetField() then gives the field centre, observing time,
+//     temperatures and XY rotation matrix, and these remain in force until
+//     SetField() is called again. ProcessTile() sets the field itself, from
+//     the input files, just as the program does.
+//
+//     Like the other classes in this program, methods return false if they
+//     fail, and GetError() then describes the problem. GetWarnings() returns
+//     any warnings generated by the most recent call. RaDecToXY() and
+//     XYToRaDec() convert every position they can, and if any can't be
+//     converted, GetError() describes the problem with the first (lowest
+//     numbered) of those, however many threads were used.
+//
+//  Author(s): Hector Observations Pipeline team, (HOP)
+//
+//  History:
+//     16th Oct 2026.  Original version. HOP.
+//     16th Oct 2026.  Added GetClearRadii(). HOP.
+//     16th Oct 2026.  ProcessTile() now sets up the sky checker in a separate
+//                     thread while the target and sky fibre positions are being
+//                     converted. Added StartSkyChecker(), DropSkyChecker(),
+//                     MakeSkyChecker() and the associated instance variables. HOP.
+//
+// ----------------------------------------------------------------------------------
+
+#ifndef __HectorConfigSession__
+#define __HectorConfigSession__
+
+#include "HectorStructures.h"
+#include "ProfitSkyCheck.h"
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+class HectorConfigSession {
+public:
+   //  Constructor
+   HectorConfigSession (void);
+   //  Destructor
+   ~HectorConfigSession ();
+   //  Set the details that would otherwise be given on the command line.
+   void SetProgDetails (const HectorUtilProgDetails& ProgDetails);
+   //  Use models and sky fibre details already read, shared with other sessions.
+   void UseSharedDetails (const HectorSharedDetails* Shared);
+   //  Set the field centre (deg), observing time and conditions.
+   bool SetField (double CentreRaDeg, double CentreDecDeg,
+                  const std::string& DateAndTime, double RobotTempC,
+                  double ObsTempC, const std::string& RotMatString,
+                  bool* Reused = NULL);
+   //  Return a string that describes the field set by SetField().
+   std::string GetFieldKey (void) const;
+   //  Return the field description SetField() would give for a set of values.
+   static std::string FieldKey (double CentreRaDeg, double CentreDecDeg,
+                  const std::string& DateAndTime, double RobotTempC,
+                  double ObsTempC, const std::string& RotMatString);
+   //  Return the observing time for the field, as Mjd.
+   double GetMjd (void) const;
+   //  Convert mean Ra,Dec positions (deg) to X,Y on the plate (microns).
+   bool RaDecToXY (int NPosns, const double RaDeg[], const double DecDeg[],
+                  const double PmRa[], const double PmDec[], double X[],
+                  double Y[], bool Converted[]);
+   //  Convert X,Y positions on the plate (microns) to mean Ra,Dec (deg).
+   bool XYToRaDec (int NPosns, const double X[], const double Y[], bool Sky,
+                  double RaDeg[], double DecDeg[], bool Converted[]);
+   //  Check a set of positions in the field for contamination.
+   bool CheckSky (std::vector<ProfitSkyPosn>* SkyPosns);
+   //  Get the clear radius round a set of positions from the clearance maps.
+   bool GetClearRadii (std::vector<ProfitSkyPosn>* SkyPosns,
+                  std::vector<double>* ClearAsec);
+   //  Convert targets in memory, and pick and check the sky fibre positions.
+   bool ConfigureTargets (std::vector<HectorTarget>* TargetList,
+                  std::vector<HectorSkyFibre>* SkyFibreList);
+   //  Configure the tile described by the program details, as the program does.
+   bool ProcessTile (void);
+   //  Configure a tile, such as one listed in a manifest file.
+   bool ProcessTile (const HectorManifestTile& Tile);
+   //  Get description of latest error.
+   std::string GetError (void) const;
+   //  Get any warnings from the latest call.
+   std::vector<std::string> GetWarnings (void) const;
+   //  Set the debug levels for the routines used by all sessions.
+   static void SetDebugLevels (const std::string& Levels);
+private:
+   //  Set up the field, given the values in the units the routines use.
+   bool SetUpField (double CentreRa, double CentreDec,
+                  const std::string& DateAndTime, float RobotTemp,
+                  float ObsTemp, const std::string& RotMatString,
+                  const double XYRotMatrix[], bool* Reused,
+                  std::vector<std::string>* Warnings);
+   //  Return the field description for values in the units the routines use.
+   static std::string MakeFieldKey (double CentreRa, double CentreDec,
+                  const std::string& DateAndTime, float RobotTemp,
+                  float ObsTemp, const double XYRotMatrix[]);
+   //  Configure a tile, given program details set up for it.
+   bool ConfigureTile (HectorUtilProgDetails* TileDetails);
+   //  Get, convert and check the sky fibre positions for the field.
+   void ConfigureSkyFibres (std::vector<HectorSkyFibre>* SkyFibreList,
+                  HectorUtilProgDetails* ProgDetails);
+   //  Get the sky fibre details, reading them if necessary.
+   void GetSkyFibres (std::vector<HectorSkyFibre>* SkyFibreList,
+                  HectorUtilProgDetails* ProgDetails);
+   //  Get the sky checker for the field, setting it up if necessary.
+   ProfitSkyCheck* GetSkyChecker (void);
+   //  Start setting up the sky checker for the field in a separate thread.
+   void StartSkyChecker (void);
+   //  Drop the sky checker, waiting for any set-up in progress to finish.
+   void DropSkyChecker (void);
+   //  Create and set up a sky checker, given program details for the field.
+   static ProfitSkyCheck* MakeSkyChecker (HectorUtilProgDetails CheckDetails,
+                  std::string* Error);
+   //  Copy the outcome of a call from a program details structure.
+   bool SetOutcome (const HectorUtilProgDetails& ProgDetails);
+   //  Check the field has been set, setting an error if not.
+   bool CheckFieldSet (void);
+   //  The program details as passed to SetProgDetails().
+   HectorUtilProgDetails I_Settings;
+   //  Program details set up for the field, with the converter initialised.
+   HectorUtilProgDetails I_Field;
+   //  Observation details for the field.
+   HectorObsDetails I_ObsDetails;
+   //  True once a field has been set up.
+   bool I_FieldSet;
+   //  Describes the field that has been set up.
+   std::string I_FieldKey;
+   //  Sky checker for the field, set up when first needed.
+   std::unique_ptr<ProfitSkyCheck> I_SkyChecker;
+   //  Sky checker set up by StartSkyChecker(), once its set-up has finished.
+   std::unique_ptr<ProfitSkyCheck> I_StartedSkyChecker;
+   //  Error from the set-up started by StartSkyChecker(), if it failed.
+   std::string I_StartedSkyCheckerError;
+   //  Completes when the set-up started by StartSkyChecker() has finished.
+   std::future<void> I_SkyCheckerSetUp;
+   //  Models and sky fibre details shared with other sessions, if any.
+   const HectorSharedDetails* I_Shared;
+   //  Models and sky fibre details read by this session, if not shared.
+   HectorSharedDetails I_OwnShared;
+   //  Description of latest error.
+   std::string I_ErrorText;
+   //  Warnings from the latest call.
+   std::vector<std::string> I_Warnings;
+};
+
+#endif
+
+// ----------------------------------------------------------------------------------
+
+/*                        P r o g r a m m i n g  N o t e s
+
+   o  A HectorConfigSession object isn't thread-safe, but different sessions
+      can be used at once in different threads, as HectorConfigUtil does for
+      the tiles in a manifest. The one proviso is that the debug levels set
+      by SetDebugLevels() are shared by all sessions, so should be set before
+      any threads start.
+
+   o  Each tile processed by ProcessTile() works with a copy of the coordinate
+      converter set up for its field, so nothing a tile does - in sweep mode,
+      for example, the converter is set up again for each epoch - affects the
+      next one. The models are only read once, and passed on to the converter
+      for each new field using HectorRaDecXY::CopyModels().
+
+   o  The units used by the public methods are those a user of the class is
+      most likely to have to hand - degrees for positions, deg C for the
+      temperatures, and milli-arcsec/year (including the cos(Dec) factor, as
+      in the target files) for proper motions. The HectorTarget and
+      HectorSkyFibre structures used by ConfigureTargets() are in radians, as
+      they are throughout the program.
+
+   o  Setting up the sky checker means finding and reading the Profit mask files
+      that cover the field, which can take as long as everything else a tile
+      needs. So once ProcessTile() knows the field, it has StartSkyChecker()
+      do this in a separate thread while the positions of the targets and sky
+      fibres are worked out, and GetSkyChecker() then waits for it to finish.
+      This isn't done if the program details ask for just the one thread, nor
+      for a sweep, which doesn't check the sky. The set-up thread works on its
+      own copy of the field details and its own ProfitSkyCheck object, and
+      only its own three instance variables are shared with it - these are
+      only touched by the session after waiting for the thread to finish. The
+      results are the same as setting up the checker when it is first needed.
+
+   o  If SetField() is given a blank observing time, a time putting the field
+      on the meridian tonight is used, as for the program. That time is worked
+      out when the field is first set up, and kept for as long as the field
+      is used. The program prints the time it picks; a session whose program
+      details have PrintMeridianTime cleared, as the C API and the service
+      do, reports it as a warning instead, each time the field is set.
+*/
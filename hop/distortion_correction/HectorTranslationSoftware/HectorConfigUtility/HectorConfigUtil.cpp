@@ -80,6 +80,164 @@
 //                      "subsystem.level". These can contain wildcard characters,
 //                      so -debug "*.*" turns on all diagnostics.
 //
+//  Fast conversion:
+//     -surrogate <microns>  Converts target positions using a fast approximation
+//                      to the 2dF distortion and linearity models, fitted over
+//                      the field, instead of the models themselves. This is
+//                      only used if checking it against the exact conversion
+//                      over the whole field shows it to be accurate to within
+//                      the given number of microns; if not, the exact
+//                      conversion is used as usual. The default, 0, never uses
+//                      the approximation. Most useful with -sweep.
+//     -threads <n>     The number of threads to use when converting target
+//                      positions, and when reading Profit mask files. The
+//                      default, 0, uses one per processor core. The results
+//                      are the same however many are used. If any -debug
+//                      levels are set, only one thread is used for the
+//                      conversions. With more than one thread, the gzipped
+//                      mask files covering the field are all read at once
+//                      before the sky fibre positions are checked.
+//     -clearmap        Checks the sky fibre positions using clearance maps,
+//                      which give the clear radius around each mask pixel in
+//                      the field. These take a little while to build, but then
+//                      each check is a single lookup whatever the clearance.
+//                      Positions within about a pixel of contamination can
+//                      give a different result to the usual check.
+//     -counttable      Builds a table of the number of contaminated mask pixels
+//                      in the field before checking the sky fibre positions.
+//                      This gives the same results as the usual check, but
+//                      makes it quicker, particularly for a large <clearance>,
+//                      at the cost of four bytes of memory per mask pixel.
+//     -profitcache <dir>  Keeps a copy of the data from each Profit mask file
+//                      used, in a compact form that can be read very quickly,
+//                      in the given directory, and uses that in place of the
+//                      mask file when it is run again. This saves a lot of
+//                      time with gzipped mask files. The default is the
+//                      directory given by the environment variable
+//                      PROFIT_CACHE, if that is set, and if neither is
+//                      given no cache is used.
+//     -tempcache       With -manifest or -serve, and no -profitcache, caches
+//                      the Profit mask file data in a new directory in $TMPDIR
+//                      (or /tmp) for the run, so that each mask file is only
+//                      read once, and deletes it at the end. This can need a
+//                      lot of space if the tiles cover many mask files.
+//
+//  Sweep mode:
+//     -sweep "epochs"  Instead of the usual output file, writes a file giving
+//                      the X,Y positions of all the targets at each of a set
+//                      of observing times (epochs). This is much faster than
+//                      running the program once for each time, as the input
+//                      files are only read once and only the time-dependent
+//                      parts of the conversion are recalculated for each epoch.
+//                      "epochs" is a list of items separated by semicolons.
+//                      Each is either a UT date and time, in the same format as
+//                      <date_and_time>, or a range given as
+//                         <date_and_time> to <date_and_time> step <minutes>
+//                      and either form can be followed by
+//                         at <robot_temp> <obs_temp>
+//                      to give the temperatures (deg C) for those epochs,
+//                      which otherwise default to <robot_temp> and <obs_temp>.
+//                      eg -sweep "2022 05 12 10 00 to 2022 05 12 14 00 step 30;
+//                                 2022 05 13 11 30 at 14 12"
+//                      Sky fibre positions are not calculated in this mode.
+//                      The output file has the usual header lines, followed by
+//                      one line for each target at each epoch, giving the epoch
+//                      number (from 1), its UT date and time, the temperatures
+//                      used, the target number (from 1, in the order used in
+//                      the usual output file) and the MagnetX,MagnetY values.
+//
+//  Batch mode:
+//     -manifest <file> Instead of configuring one tile (field), configures all
+//                      the tiles listed in the given manifest file, in the one
+//                      run of the program. The distortion and linearity files
+//                      and the sky fibre file are only read once, and with
+//                      more than one worker the tiles are processed at once.
+//                      Each line of the manifest describes a tile, giving
+//                      <galaxy_file_path>,<guide_file_path>,<output_file_path>,
+//                      <label>,<plateId>,<date_and_time>,<robot_temp>,
+//                      <obs_temp>,<xymatrix>
+//                      separated by commas, with the same meanings as the
+//                      command line arguments (and -xymatrix). Items can be
+//                      enclosed in double quotes. The first five are needed,
+//                      and any of the rest that are omitted or empty take the
+//                      values given on the command line, or their defaults.
+//                      Blank lines and lines starting with '#' are ignored.
+//                      The other arguments, which are the same for all tiles,
+//                      should be given by name, eg 2dFDistortion=<file>, if
+//                      they aren't to default to the environment variables.
+//                      Each output file is exactly as it would be if the
+//                      program were run for that tile alone. The result for
+//                      each tile - "All OK", or its errors and warnings - is
+//                      reported after a line giving its output file name, in
+//                      the order of the manifest, and the program returns a
+//                      completion code of zero only if all the tiles were
+//                      configured. Each mask file is only read once for all
+//                      the tiles if -profitcache or -tempcache is used.
+//     -workers <n>     The number of tiles processed at once with -manifest.
+//                      The default, 0, uses one per processor core, but only
+//                      one is used if any -debug levels are set. With
+//                      more than one, unless -threads is given each tile uses
+//                      its share of the processor cores for its conversions.
+//
+//  Service mode:
+//     -serve <socket>  Runs the program as a service that handles requests for
+//                      coordinate conversions, sky position checks and tiles
+//                      until told to quit, keeping the models, the sky fibre
+//                      details, and the set up for each field and epoch, and
+//                      the mask files it uses, ready for the next request.
+//                      Clients connect, one at a time, to the Unix domain
+//                      socket with the given path name, or if this is "-",
+//                      the requests are read from standard input and the
+//                      responses written to standard output (with anything
+//                      else that would have gone there sent to standard error).
+//                      Each request is a JSON object on a line of its own, and
+//                      the response to it is another. Requests can include an
+//                      "id" member, which is copied into the response. Each
+//                      response has "ok":true, with the results, or "ok":false
+//                      with an "error" string, and a "warnings" array if there
+//                      were any. The "cmd" member of a request is one of:
+//                      "open"     opens a session for a field and epoch,
+//                                 given by "session" (an ID chosen by the
+//                                 client), "centre" ([ra,dec] in degrees) and
+//                                 optionally "time", "robot_temp", "obs_temp"
+//                                 and "xymatrix", which are as for the command
+//                                 line, and default to the values given there.
+//                                 Opening the same session ID again is only
+//                                 allowed with exactly the same values (the
+//                                 response says it was "reused") unless it is
+//                                 closed first. The response gives the "mjd".
+//                      "radec2xy" converts the mean J2000 positions given by
+//                                 "ra" and "dec" (in degrees), with optional
+//                                 "pmra" and "pmdec" as in the target files,
+//                                 to "x" and "y" in microns, for the field and
+//                                 epoch of the given "session", as for targets.
+//                      "xy2radec" converts "x" and "y" to "ra" and "dec". If
+//                                 "sky" is true, this is done as for the sky
+//                                 fibres, without the telecentricity and mech
+//                                 offset corrections.
+//                      "checksky" checks the positions given by "ra" and "dec"
+//                                 for contamination, giving "clear" as true,
+//                                 false or null (not checked), and "reasons"
+//                                 for any not checked. "clearance" (arcsec)
+//                                 defaults to <clearance>.
+//                      "tile"     configures a tile, given by "gal", "guide",
+//                                 "output", "label", "plateid" and optionally
+//                                 "time", "robot_temp", "obs_temp" and
+//                                 "xymatrix", exactly as if the program had been
+//                                 run for it alone.
+//                      "close"    closes the given "session".
+//                      "quit"     stops the service.
+//                      Positions can be given as single numbers, or as arrays,
+//                      and the results match. Positions that can't be converted
+//                      are given as null. For example:
+//                        {"id":1,"cmd":"open","session":"A","centre":[180,-1]}
+//                        {"id":2,"cmd":"radec2xy","session":"A","ra":[180.1],
+//                                                                "dec":[-1.2]}
+//                      The other arguments, which are the same for all requests,
+//                      should be given by name, as for -manifest, and as for
+//                      -manifest, -profitcache or -tempcache can be used to
+//                      cache the mask file data.
+//
 //  Return codes:
 //     If the program completes successfully, it will return a completion code
 //     of zero. If it hits a problem and fails to complete properly, it returns
@@ -174,29 +332,102 @@
 //                     the pmRA and pmDec columns. (Which it seems have been
 //                     there for a while - something I'd mossed). Also added
 //                     the -nopm option for test purposes. KS.
+//      16th Oct 2026. ConvertTargetCoordinates() now converts all the targets
+//                     in one call to RaDec2XYBatch(), which does the field
+//                     centre calculations once instead of once per target. HOP.
+//      16th Oct 2026. ConvertSkyFibreCoordinates() now reports on the accuracy
+//                     of the inversions of the distortion model, using the
+//                     new "Inverse" debug level, and adds a warning if any
+//                     failed to reach the required accuracy. HOP.
+//      16th Oct 2026. Added the -sweep option, with GetSweepEpochs() and
+//                     SweepTargetCoordinates(). The parsing of a date and time
+//                     string has been moved out of ParseObsTime() into
+//                     ParseUTString() so it can be used for the sweep epochs
+//                     as well. HOP.
+//      16th Oct 2026. Added the -surrogate option. HOP.
+//      16th Oct 2026. Mean2Apparent() and Apparent2Mean() now use the
+//                     HectorAstrometry object in ProgDetails, set up for the
+//                     observing time by ParseObsTime(), instead of slaMap()
+//                     and slaAmp(), which recalculated all the mean to apparent
+//                     parameters for every position. ConvertTargetCoordinates()
+//                     and SweepTargetCoordinates() convert all their targets
+//                     with one call to Mean2ApparentBatch(). HOP.
+//      16th Oct 2026. Added MeanToPlateXY(), used by ConvertTargetCoordinates()
+//                     and SweepTargetCoordinates(), which shares the target
+//                     conversions between a number of threads, and the
+//                     -threads option to control this. HOP.
+//      16th Oct 2026. Added the -clearmap option, which has
+//                     CheckSkyFibresAreClear() use the clear radius from the
+//                     ProfitSkyCheck clearance maps. HOP.
+//      16th Oct 2026. Added the -counttable option. HOP.
+//      16th Oct 2026. Added the -profitcache option. HOP.
+//      16th Oct 2026. -threads now also sets the number of threads ProfitSkyCheck
+//                     uses to read mask files, and CheckSkyFibresAreClear() has
+//                     it preload the gzipped ones if more than one is used. HOP.
+//      16th Oct 2026. CheckSkyFibresAreClear() now checks all the positions for
+//                     all the sky fibres with one call to the new ProfitSkyCheck
+//                     CheckPositionsForSky(), unless the clearance maps are
+//                     being used. HOP.
+//      16th Oct 2026. Added the -manifest, -workers and -tempcache options. The
+//                     work done for one tile has moved from main() into
+//                     ProcessTile(), and ProcessManifest() calls this for each
+//                     tile listed in the manifest, read by ReadManifest(),
+//                     sharing the model files and sky fibre details read once
+//                     for all of them. ParseObsTime() now uses gmtime_r(). HOP.
+//      16th Oct 2026. Added the -serve option, with Serve() and the routines
+//                     it uses to handle the requests made to the service.
+//                     ReadSharedDetails() has been split out of
+//                     ProcessManifest() so the service can use it too. HOP.
+//      16th Oct 2026. The processing routines have moved to HectorConfigRoutines.cpp,
+//                     and ProcessTile() has become the new HectorConfigSession
+//                     class, both now in the libhectorconfig library so other
+//                     programs can use them. The main program, the manifest
+//                     and the service all now use HectorConfigSession. HOP.
+//      16th Oct 2026. The service reports the time picked for a field given no
+//                     observing time as a warning, rather than printing it. HOP.
 //
 //  Note:
-//     The structure of this code has a main program that simply calls a set of
-//     processing subroutines in a fixed order. The code layout has the subroutines
-//     first, to avoid the need for forward definitions of them to allow the main
-//     routine to compile, followed by the main routine. When looking at this code
-//     for the first time, it would be as well to skip straight to the main routine
-//     to see the big picture and then look back to the subroutines for more detail.
+//     The processing routines that do the real work are in HectorConfigRoutines.cpp,
+//     and the HectorConfigSession class (in HectorConfigSession.cpp) calls them in
+//     a fixed order to configure a tile. This file has the main program, and the
+//     routines that handle the command line, the manifest and the service. The
+//     code layout has these routines first, to avoid the need for forward
+//     definitions of them to allow the main routine to compile, followed by the
+//     main routine. When looking at this code for the first time, it would be as
+//     well to skip straight to the main routine to see the big picture and then
+//     look back to HectorConfigSession::ConfigureTile() for more detail.
 //
 // ----------------------------------------------------------------------------------
 
 #include "HectorStructures.h"
+#include "HectorConfigRoutines.h"
+#include "HectorConfigSession.h"
 
-#include <ctime>
+#include <atomic>
 #include <iostream>
+#include <memory>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <thread>
+#include <dirent.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 
 #include "slalib.h"
 #include "slamac.h"
 
 #include "ProfitSkyCheck.h"
 
+//  The requests made to the program when it runs as a service are in JSON.
+
+#include "HectorJson.h"
+
 //  This code uses a few utility routines (mostly string-handling) originally
 //  developed for the AAT TCS system, and included in a small TcsUtil library.
 
@@ -211,181 +442,11 @@
 using std::vector;
 using std::string;
 
-extern "C" {
-   float gen_qfmed_(float* Data,int* Nelm);
-}
-
 //  Constants:
-//  Zero degrees C in degrees K.
-
-const double ZeroDegCinDegK = 273.15;
-
-//  A global DebugHandler is used for the code in this file. (The RaDec
-//  conversion and SkyCheck subsystems have their own DebugHandlers.) The
-//  levels this responds to are set at the start of the code for main().
-
-#include "DebugHandler.h"
-
-static DebugHandler G_Debug("Main");
-
-// ----------------------------------------------------------------------------------
-
-//                      L i s t  P r o g  D e t a i l s
-//
-//  This is a diagnostic routine that lists the contents of the overall program
-//  details structure.
-
-void ListProgDetails (const HectorUtilProgDetails& ProgDetails)
-{
-   printf ("\n");
-   printf ("Contents of program details structure\n");
-   printf ("\n");
-
-   printf ("Ok flag: %s\n",ProgDetails.Ok ? "true" : "false");
-   
-   //  Listing the command line arguments may be useful, but note that most
-   //  are just copied into the other items in the ProgDetails structure, so
-   //  they'll end up dimply duplicated. At least this will show if any
-   //  of these were mishandled. Note the order needs to be changed if the
-   //  command arguments change - the awkward use of I and N allows these
-   //  lines to be moved around easily, even if it looks odd.
-   
-   printf ("Number of command line arguments: %d\n",ProgDetails.Argc);
-   int I = 0;
-   int N = ProgDetails.Argc;
-   if (I < N) printf ("   Program name: '%s'\n",ProgDetails.Argv[I++]);
-   if (I < N) printf ("   Galaxy target file: '%s'\n",ProgDetails.Argv[I++]);
-   if (I < N) printf ("   Guide target file: '%s'\n",ProgDetails.Argv[I++]);
-   if (I < N) printf ("   Output file: '%s'\n",ProgDetails.Argv[I++]);
-   if (I < N) printf ("   Label: '%s'\n",ProgDetails.Argv[I++]);
-   if (I < N) printf ("   PlateID: '%s'\n",ProgDetails.Argv[I++]);
-   if (I < N) printf ("   Date and time: '%s'\n",ProgDetails.Argv[I++]);
-   if (I < N) printf ("   Robot temp: '%s' C\n",ProgDetails.Argv[I++]);
-   if (I < N) printf ("   Observing temp: '%s' C\n",ProgDetails.Argv[I++]);
-   
-   //  Now the same values as they ended up in the individual fields of the
-   //  structure.
-   
-   printf ("Main target file name: '%s'\n",ProgDetails.MainTargetFileName.c_str());
-   printf ("Guide target file name: '%s'\n",ProgDetails.GuideTargetFileName.c_str());
-   printf ("Output file name: '%s'\n",ProgDetails.OutputFileName.c_str());
-   printf ("Label: '%s'\n",ProgDetails.Label.c_str());
-   printf ("PlateID: '%s'\n",ProgDetails.PlateID.c_str());
-   printf ("Date and time: '%s'\n",ProgDetails.DateAndTime.c_str());
-   printf ("Mechanical corrections: %s\n",ProgDetails.MechCorrection ?
-                                                  "enabled" : "disabled");
-   printf ("Telecentricity corrections: %s\n",ProgDetails.TeleCorrection ?
-                                                     "enabled" : "disabled");
-   int Year,Month,Day,Ihmsf[4],Jstat;
-   double Frac,Mjd;
-   char Sign[1];
-   Mjd = ProgDetails.Mjd;
-   slaDd2tf(0, Mjd - floor(Mjd), Sign, Ihmsf);
-   slaDjcl(Mjd, &Year, &Month, &Day, &Frac, &Jstat);
-   printf("Mjd: %f (UT %.4d/%.2d/%.2d  %.2d:%.2d:%.2d)\n",
-               Mjd, Year, Month, Day, Ihmsf[0], Ihmsf[1], Ihmsf[2]);
-   printf ("Robot temp: '%.2f' K (%.2f C)\n",ProgDetails.RobotTemp,
-                                       ProgDetails.RobotTemp - ZeroDegCinDegK);
-   printf ("Observing temp: '%.2f' K (%.2f C)\n",ProgDetails.ObsTemp,
-                                         ProgDetails.ObsTemp - ZeroDegCinDegK);
-
-   //  And the rest.
-   
-   printf ("Converter initialised: %s\n",
-                      ProgDetails.ConverterInitialised ? "true" : "false");
-   printf ("CenterRa : %f deg\n",ProgDetails.CentreRa * DR2D);
-   printf ("CenterDec : %f deg\n",ProgDetails.CentreDec * DR2D);
-   printf ("Distortion file name: '%s'\n",ProgDetails.DistFileName.c_str());
-   printf ("Error string: '%s'\n",ProgDetails.Error.c_str());
-   int NWarnings = ProgDetails.Warnings.size();
-   printf ("Warning strings: %d\n",NWarnings);
-   for (int I = 0; I < NWarnings; I++) {
-      printf ("   '%s'\n",ProgDetails.Warnings[I].c_str());
-   }
-
-   printf ("\n");
-}
-
-// ----------------------------------------------------------------------------------
-
-//                      V a l i d  I n t e g e r
-//
-//  Simple utility to check if a string represents a valid integer, and
-//  to return the value of that integer if so.
-
-bool ValidInteger (const string& String, long* Value)
-{
-   bool Valid = true;
-   size_t Idx;
-   try {
-      *Value = stol(String,&Idx);
-   } catch (...) {
-      *Value = 0;
-      Valid = false;
-   }
-   if (Valid) {
-      if ((Idx != string::npos) && (Idx != String.size())) Valid = false;
-   }
-   return Valid;
-}
-
-// ----------------------------------------------------------------------------------
-
-//                        V a l i d  R e a l
-//
-//  Simple utility to check if a string represents a valid floating point
-//  number, and to return the value of that number if so.
+//  The longest request line accepted from a client when running as a service.
+//  (This allows for many thousands of positions in one request.)
 
-bool ValidReal (const string& String, double* Value)
-{
-   bool Valid = true;
-   size_t Idx;
-   try {
-      *Value = stod(String,&Idx);
-   } catch (...) {
-      *Value = 0.0;
-      Valid = false;
-   }
-   if (Valid) {
-      if ((Idx != string::npos) && (Idx != String.size())) Valid = false;
-   }
-   return Valid;
-}
-
-// ----------------------------------------------------------------------------------
-
-//                      P a r s e  R o t  M a t  S t r i n g
-//
-//  This routine extracts the double precision values for the X Y rotation matrix
-//  from the string supplied on the command line.
-
-void ParseRotMatString (std::string& RotMatString, double XYRotMatrix[],
-                                              bool& Ok, std::string& Error)
-{
-   //  Do nothing is Ok is passed already set false.
-   
-   if (Ok) {
-   
-      //  If the string is null, use the default identity matrix.
-      
-      if (RotMatString == "") {
-         XYRotMatrix[0] = 1.0;
-         XYRotMatrix[1] = 0.0;
-         XYRotMatrix[2] = 0.0;
-         XYRotMatrix[3] = 1.0;
-      } else {
-      
-         //  This parsing is pretty crude, but will do for the moment.
-         
-         int Nvals = sscanf(RotMatString.c_str(),"%lf %lf %lf %lf",
-            &XYRotMatrix[0],&XYRotMatrix[1],&XYRotMatrix[2],&XYRotMatrix[3]);
-         if (Nvals != 4) {
-            Ok = false;
-            Error = "Invalid floating point values given for rotation matrix";
-         }
-      }
-   }
-}
+const size_t MaxServiceRequestBytes = 64 * 1024 * 1024;
 
 // ----------------------------------------------------------------------------------
 
@@ -468,6 +529,26 @@ void SetUpProgDetails (int Argc,char** Argv,HectorUtilProgDetails* ProgDetails)
    StringArg DebugArg(TheHandler,"Debug",0,"NoSave","","Debug levels");
    StringArg RotMatArg(TheHandler,"XYMatrix",0,"NoSave","",
                                  "XY Rotation matrix, ie \"1 0 0 1\"");
+   StringArg SweepArg(TheHandler,"Sweep",0,"NoSave","",
+                     "Observing times (epochs) for a sweep of target positions");
+   RealArg SurrogateArg(TheHandler,"Surrogate",0,"NoSave",0.0,0.0,1000.0,
+                     "Max error (microns) allowed for fast conversion, 0 => none");
+   IntArg ThreadsArg(TheHandler,"Threads",0,"NoSave",0,0,1024,
+                     "Number of threads used for conversions, 0 => one per core");
+   BoolArg ClearMapArg(TheHandler,"ClearMap",0,"NoSave",false,
+                     "Use clearance maps to check sky fibre positions");
+   BoolArg CountTableArg(TheHandler,"CountTable",0,"NoSave",false,
+                     "Use count tables to speed up sky fibre checks");
+   FileArg ProfitCacheArg(TheHandler,"ProfitCache",0,"NoSave,NullOk",
+                "$PROFIT_CACHE","Directory for cached Profit mask file data");
+   BoolArg TempCacheArg(TheHandler,"TempCache",0,"NoSave",false,
+                     "Cache Profit mask file data in a temporary directory");
+   FileArg ManifestArg(TheHandler,"Manifest",0,"NoSave,NullOk","",
+                     "File listing the tiles to configure, one per line");
+   IntArg WorkersArg(TheHandler,"Workers",0,"NoSave",0,0,1024,
+                     "Number of tiles processed at once, 0 => one per core");
+   StringArg ServeArg(TheHandler,"Serve",0,"NoSave","",
+                     "Socket to serve requests on, or '-' for standard input");
 
    if (TheHandler.IsInteractive()) TheHandler.ReadPrevious();
 
@@ -487,11 +568,22 @@ void SetUpProgDetails (int Argc,char** Argv,HectorUtilProgDetails* ProgDetails)
    }
 
    string Error = "";
-   ProgDetails->MainTargetFileName = GalaxyFileArg.GetValue(&Ok,&Error);
-   ProgDetails->GuideTargetFileName = GuideFileArg.GetValue(&Ok,&Error);
-   ProgDetails->OutputFileName = OutputFileArg.GetValue(&Ok,&Error);
-   ProgDetails->Label = LabelArg.GetValue(&Ok,&Error);
-   ProgDetails->PlateID = PlateIdArg.GetValue(&Ok,&Error);
+   ProgDetails->ManifestFileName = ManifestArg.GetValue(&Ok,&Error);
+   ProgDetails->Workers = WorkersArg.GetValue(&Ok,&Error);
+   ProgDetails->ServeSpec = ServeArg.GetValue(&Ok,&Error);
+   
+   //  With a manifest, the required details of each tile come from that, so
+   //  they aren't asked for here. Any other values are used as defaults for
+   //  items the manifest leaves out. The same goes for the requests made to
+   //  a service.
+   
+   if (ProgDetails->ManifestFileName == "" && ProgDetails->ServeSpec == "") {
+      ProgDetails->MainTargetFileName = GalaxyFileArg.GetValue(&Ok,&Error);
+      ProgDetails->GuideTargetFileName = GuideFileArg.GetValue(&Ok,&Error);
+      ProgDetails->OutputFileName = OutputFileArg.GetValue(&Ok,&Error);
+      ProgDetails->Label = LabelArg.GetValue(&Ok,&Error);
+      ProgDetails->PlateID = PlateIdArg.GetValue(&Ok,&Error);
+   }
    ProgDetails->DateAndTime = DateTimeArg.GetValue(&Ok,&Error);
    ProgDetails->RobotTemp = RobotTempArg.GetValue(&Ok,&Error) + ZeroDegCinDegK;
    ProgDetails->ObsTemp = ObsTempArg.GetValue(&Ok,&Error) + ZeroDegCinDegK;
@@ -507,6 +599,21 @@ void SetUpProgDetails (int Argc,char** Argv,HectorUtilProgDetails* ProgDetails)
    ProgDetails->PmCorrection = PmArg.GetValue(&Ok,&Error);
    ProgDetails->DebugLevels = DebugArg.GetValue(&Ok,&Error);
    ProgDetails->RotMatString = RotMatArg.GetValue(&Ok,&Error);
+   ProgDetails->SweepSpec = SweepArg.GetValue(&Ok,&Error);
+   ProgDetails->SurrogateTolerance = SurrogateArg.GetValue(&Ok,&Error);
+   ProgDetails->Threads = ThreadsArg.GetValue(&Ok,&Error);
+   ProgDetails->UseClearMaps = ClearMapArg.GetValue(&Ok,&Error);
+   ProgDetails->UseCountTables = CountTableArg.GetValue(&Ok,&Error);
+   ProgDetails->ProfitCacheDirectory = ProfitCacheArg.GetValue(&Ok,&Error);
+   ProgDetails->UseTempCache = TempCacheArg.GetValue(&Ok,&Error);
+   
+   //  If PROFIT_CACHE isn't defined, the cache directory is left as the
+   //  unexpanded default, and that means no cache is to be used.
+   
+   string Expanded;
+   if (!TcsUtil::ExpandFileName(ProgDetails->ProfitCacheDirectory,Expanded)) {
+      ProgDetails->ProfitCacheDirectory = "";
+   }
    if (!Ok) ProgDetails->Error = Error;
    
    //  Work out the XY rotation values from the supplied string.
@@ -525,12 +632,11 @@ void SetUpProgDetails (int Argc,char** Argv,HectorUtilProgDetails* ProgDetails)
    
    ProgDetails->FieldRadius = 1.1 * DD2R;
   
-   //  Set debugging levels for the global coordinate converter and the
-   //  global handler used for this main program. The ProfitSkyChecker levels
-   //  are set in CheckSkyFibresAreClear(), which is the only routine that
-   //  uses it.
+   //  Set debugging levels for the coordinate converter and the global handler
+   //  used by the processing routines. The ProfitSkyChecker levels are set in
+   //  SetUpSkyChecker(), which is the only routine that sets one up.
    
-   G_Debug.SetLevels (ProgDetails->DebugLevels);
+   HectorConfigSession::SetDebugLevels (ProgDetails->DebugLevels);
    ProgDetails->CoordConverter.SetDebugLevels(ProgDetails->DebugLevels);
    
    if (TheHandler.IsInteractive()) TheHandler.SaveCurrent();
@@ -540,1567 +646,1102 @@ void SetUpProgDetails (int Argc,char** Argv,HectorUtilProgDetails* ProgDetails)
 
 // ----------------------------------------------------------------------------------
 
-//                      R e a d  I n p u t  F i l e
+//                      R e p o r t  R e s u l t
+//
+//  This routine tidies up at the end of the program, reporting any errors and
+//  anything else that might be needed.
+
+void ReportResult(
+   const HectorUtilProgDetails& ProgDetails)
+{
+   int NWarnings = ProgDetails.Warnings.size();
+   if (ProgDetails.Ok && NWarnings == 0) {
+      printf ("All OK\n");
+   } else {
+      if (ProgDetails.Error != "") {
+         fprintf (stderr,"** Error ** %s\n",ProgDetails.Error.c_str());
+      }
+      for (int I = 0; I < NWarnings; I++) {
+         fprintf (stderr,"* Warning * %s\n",ProgDetails.Warnings[I].c_str());
+      }
+   }
+}
+
+// ----------------------------------------------------------------------------------
+
+//                      R e a d  M a n i f e s t
 //
-//  This routine reads the specified input file and fills the File header structure
-//  with the details of the header lines adds the details of the targets specified
-//  in the input fileto to the target list vector. The FileType should be either
-//  GALAXY or GUIDE, and the name of the target file will be taken from the
-//  relevant entry in the ProgDetails structure.
-
-void ReadInputFile (
-   HectorTargetType FileType,
-   HectorFileHeader* FileHeader,
-   vector<HectorTarget> *TargetList,
+//  With the -manifest option, this routine reads the manifest file, which lists
+//  the tiles to be configured, one per line. Each line gives the first eight
+//  command line arguments for a tile, and optionally the XY rotation matrix,
+//  separated by commas. See the description of -manifest at the start of this
+//  file. Anything left out defaults to the value in ProgDetails. The tiles are
+//  added to the Tiles vector in the order they are listed.
+
+void ReadManifest (
+   vector<HectorManifestTile>* Tiles,
    HectorUtilProgDetails* ProgDetails)
 {
    if (!ProgDetails->Ok) return;
    
-   const double MilliArcsecToRadians = DD2R / (1000.0 * 3600.0);
-   
-   //  I do have a pretty good idea of the format of the input file, although a
-   //  few details are still TBD. Actually, I think a better description is that
-   //  not all the details are completely clear to me. Still, all the files I've
-   //  seen so far seem to follow the pattern shown by the first few lines of
-   //  one sample file:
-   //
-   //  # Target and Standard Star file from Sam's tiling code
-   //  # 336.5224915 -31.106872600000003
-   //  # Proximity Value: 217.616
-   //  ID RA DEC mag type
-   //  999388004253 337.1053162 -31.6497154 14.0115051 2
-   //  999388006577 336.2006226 -31.7324677 14.036174800000001 2
-   //  etc..
-   //
-   //  As far as I can see:
-   //  The first line is pretty much the same in all cases.
-   //  The second, although it looks like a comment, actually gives the Ra,Dec
-   //  of the field centre, in decimal degrees.
-   //  The third line gives a 'proximity value', and I don't know what that is.
-   //  The fourth line, which doesn't have a '#' at the start, gives the fields
-   //  to expect in the rest of the lines in the file. Some files just have the
-   //  five fields shown here. Other files have a great many other items.
-   //
-   //  There is then one line for each object, which gives the values for the
-   //  various fields for each object. These are blank-separated in some cases,
-   //  comma-separated in others. However, all seem to have in common that the
-   //  first field is a numeric ID or 'name' and the second and third fields are
-   //  the Ra and Dec position for the object in decimal degrees.
-   //
-   //  That doesn't exactly constitute a full understanding of the format, but
-   //  really this program only needs to be able to work with the Ra and Dec
-   //  values and to pass on the rest of the field values unchanged to the
-   //  output file.
-   //
-   //  The code that follows assumes the format described above.
-   
-   //  Open the input target file. I'm assuming we get this from the command line
-   //  arguments.
-   
-   char Error[1024];
-   string TargetFileName;
-   if (FileType == GALAXY) {
-      TargetFileName = ProgDetails->MainTargetFileName;
-   } else {
-      TargetFileName = ProgDetails->GuideTargetFileName;
+   string ManifestFileName = ProgDetails->ManifestFileName;
+   FILE* ManifestFile = fopen(ManifestFileName.c_str(),"r");
+   if (ManifestFile == NULL) {
+      ProgDetails->Error = "Error opening manifest file: " + ManifestFileName;
+      ProgDetails->Ok = false;
+      return;
    }
    
-   //  We quietly ignore any file with a null name - the idea is that it might
-   //  sometimes be convenient to have the guide file null so we can test with
-   //  just one file.
-   
-   if (TargetFileName != "") {
-      FileHeader->FileName = TargetFileName;
-      FILE* TargetFile = fopen(TargetFileName.c_str(),"r");
-      if (TargetFile == NULL) {
-         ProgDetails->Error = "Error opening target file: " + TargetFileName;
+   int LineNumber = 0;
+   char Line[4096];
+   while (ProgDetails->Ok && fgets(Line,sizeof(Line),ManifestFile)) {
+      LineNumber++;
+      
+      //  Split the line into items at the commas, allowing for items in double
+      //  quotes, and ignoring blank lines and comment lines. Items lose any
+      //  trailing blanks (Tokenize() has already dropped any leading ones).
+      
+      vector<string> Tokens;
+      TcsUtil::Tokenize(Line,Tokens,",","\"","#"," \t\r\n");
+      int NItems = Tokens.size();
+      if (NItems == 0) continue;
+      for (string& Token : Tokens) {
+         size_t LastNonBlank = Token.find_last_not_of(" \t\r\n");
+         Token.erase(LastNonBlank == string::npos ? 0 : LastNonBlank + 1);
+      }
+      string Where = "line " + TcsUtil::FormatInt(LineNumber) +
+                                     " of manifest file " + ManifestFileName;
+      if (NItems < 5 || NItems > 9) {
+         ProgDetails->Error = "Expected between 5 and 9 items on " + Where;
          ProgDetails->Ok = false;
-      } else {
-         int TargetCount = 0;
-         int GuideCount = 0;
-         int LineNumber = 0;
-         int ObjectItems = 0;
-         int RaItem = -1;
-         int DecItem = -1;
-         int PmRaItem = -1;
-         int PmDecItem = -1;
-         for (;;) {
-            char Line[1024];
-            if (fgets (Line,sizeof(Line),TargetFile)) {
-            
-               //  Read a line. Parse it, after removing any newline or return
-               //  characters and truncating after the last non-blank character.
-               
-               LineNumber++;
-               Line[sizeof(Line) - 1] = '\0';
-               int LastNonBlank = -1;
-               for (unsigned int I = 0; I < sizeof(Line); I++) {
-                  if (Line[I] == '\0') break;
-                  if (Line[I] == '\n' || Line[I] == '\r') {
-                     Line[I] = '\0';
-                     break;
-                  }
-                  if (Line[I] != ' ') LastNonBlank = I;
-               }
-               Line[LastNonBlank + 1] = '\0';
-               string LineString = Line;
-               
-               //  Tokenize the line. We'll need to do this for most lines, so
-               //  do this here for all of them.
-               
-               vector<string> Tokens;
-               TcsUtil::Tokenize(LineString,Tokens," ,");
-               bool IsComment = false;
-               int ItemCount = Tokens.size();
-               if (ItemCount > 0 && Tokens[0] == "#") IsComment = true;
-               if (LineNumber <= 3 && !IsComment) {
-                  snprintf (Error,sizeof(Error),
-                           "Line %d: Expected line to start with #: '%s'",
-                                                                LineNumber,Line);
-                  ProgDetails->Ok = false;
-                  ProgDetails->Error = Error;
-                  break;
-               }
-
-               if (LineNumber == 1) {
-               
-                  //  The first line should just be that first comment line,
-                  //  something like "# Target and Standard Star file ..."
-                  //  All we need do with that is remember it.
-                  
-                  FileHeader->HeaderLines.push_back(LineString);
-                  
-               } else if (LineNumber == 2) {
-               
-                  //  The second line should be a pseudo-comment that gives the
-                  //  field centre Ra,Dec, eg
-                  //  "# 336.5224915 -31.106872600000003"
-                  //  This always seems to be space-separated. We extract the
-                  //  Ra,Dec values, and remember the header line. This we can
-                  //  check, because this should be the same for both files, so
-                  //  if a field centre has already been set - ie if we're reading
-                  //  the second (or any subsequent) file, we see if it matches.
-
-                  FileHeader->HeaderLines.push_back(LineString);
-                  if (ItemCount != 3) {
-                     snprintf (Error,sizeof(Error),
-                         "Line %d: Unexpected number of tokens in: '%s'",
-                                                                LineNumber,Line);
-                     ProgDetails->Ok = false;
-                     ProgDetails->Error = Error;
-                     break;
-                  }
-                  
-                  //  The exact comparison of a floating point number should be
-                  //  dodgy, but I'm assuming both have been generated from the
-                  //  same program, so really should be identical. I doubt if
-                  //  this is something to exit the program for, but we should
-                  //  at least log it.
-                  
-                  double CentreRa = atof(Tokens[1].c_str()) * DD2R;
-                  if (ProgDetails->CentreRa == 0.0) {
-                     ProgDetails->CentreRa = CentreRa;
-                  } else {
-                     if (ProgDetails->CentreRa != CentreRa) {
-                        snprintf (Error,sizeof(Error),
-                           "Line %d: Mismatch in centre RA value: %f, %f",
-                                       LineNumber,ProgDetails->CentreRa,CentreRa);
-                        ProgDetails->Warnings.push_back(string(Error));
-                     }
-                  }
-                  double CentreDec = atof(Tokens[2].c_str()) * DD2R;
-                  if (ProgDetails->CentreDec == 0.0) {
-                     ProgDetails->CentreDec = CentreDec;
-                  } else {
-                     if (ProgDetails->CentreDec != CentreDec) {
-                        snprintf (Error,sizeof(Error),
-                           "Line %d: Mismatch in centre Dec value: %f, %f",
-                                     LineNumber,ProgDetails->CentreDec,CentreDec);
-                        ProgDetails->Warnings.push_back(string(Error));
-                     }
-                  }
-
-               } else if (LineNumber == 3) {
-               
-                  //  The third line should just be that third comment line,
-                  //  something like "# Proximity Value: 217.616"
-                  //  All we need do with that is remember it.
-                  
-                  FileHeader->HeaderLines.push_back(LineString);
-
-               } else if (LineNumber == 4) {
-               
-                  //  The fourth line is the most informative of the header lines,
-                  //  in terms of telling us what to expect in the lines describing
-                  //  the objects. It gives the number of fields in each object line,
-                  //  and should even tell us which give the Ra and Dec values -
-                  //  I'm trying to play safe here and not assume they're always the
-                  //  2nd and 3rd fields. The first field should be the ID field
-                  //  that gives the name of the object, but we don't need that for
-                  //  this program, so don't treat it in any sort of special way.
-                  //  We are also hoping to find proper motion information, in
-                  //  columns called "pmRA" and "pmDec".
-                  
-                  ObjectItems = ItemCount;
-                  for (int I = 0; I < ObjectItems; I++) {
-                     if (TcsUtil::MatchCaseBlind(Tokens[I],"RA")) {
-                        RaItem = I;
-                     }  else if (TcsUtil::MatchCaseBlind(Tokens[I],"Dec")) {
-                        DecItem = I;
-                     } else if (TcsUtil::MatchCaseBlind(Tokens[I],"pmRA")) {
-                        PmRaItem = I;
-                     }  else if (TcsUtil::MatchCaseBlind(Tokens[I],"pmDec")) {
-                        PmDecItem = I;
-                     }
-                  }
-                  
-                  //  See if we found these expected columns.
-                  
-                  if (RaItem < 0) {
-                     snprintf (Error,sizeof(Error),
-                        "Line %d: Could not find RA in: '%s'",LineNumber,Line);
-                     ProgDetails->Warnings.push_back(string(Error));
-                  }
-                  if (DecItem < 0) {
-                     snprintf (Error,sizeof(Error),
-                        "Line %d: Could not find Dec in: '%s'",LineNumber,Line);
-                     ProgDetails->Warnings.push_back(string(Error));
-                  }
-                  
-                  //  Only warn about missing proper motion columns if we're
-                  //  planning to use them.
-                  
-                  if (ProgDetails->PmCorrection) {
-                     if (PmRaItem < 0) {
-                        snprintf (Error,sizeof(Error),
-                           "Line %d: Could not find pmRA in: '%s'",LineNumber,Line);
-                        ProgDetails->Warnings.push_back(string(Error));
-                     }
-                     if (PmDecItem < 0) {
-                        snprintf (Error,sizeof(Error),
-                           "Line %d: Could not find pmDEC in: '%s'",LineNumber,Line);
-                        ProgDetails->Warnings.push_back(string(Error));
-                     }
-                  } else {
-                     G_Debug.Log ("Pm","Proper motion corrections are disabled");
-                  }
-
-                  //  We can live without most of the other fields, but we do need
-                  //  Ra,Dec positions for each object. And we need to remember
-                  //  which fields are Ra and Dec for when we write out the
-                  //  sky fibre details. We can live with letting proper motion
-                  //  values default to zero.
-                  
-                  if (RaItem < 0 || DecItem < 0) {
-                     ProgDetails->Ok = false;
-                     break;
-                  }
-                  ProgDetails->RaItem = RaItem;
-                  ProgDetails->DecItem = DecItem;
-                  ProgDetails->PmRaItem = PmRaItem;
-                  ProgDetails->PmDecItem = PmDecItem;
-
-                  //  Now, things are different for the galaxy and the guide files,
-                  //  because they may have different sets of items. We make no
-                  //  assumptions about most of the fields, but we do assume that:
-                  //  a) Both guide and galaxy files have Ra and Dec fields.
-                  //  b) The galaxy files will list more items than the guide files,
-                  //  but all the items in the guide files will also be in the
-                  //  galaxy files. (This means we can treat the galaxy list as
-                  //  the superset of both lists, which simplifies things a lot.
-                  //  When we output the items, we have to mess with the guide lines
-                  //  to make the fields match the galaxy lines, with lots of null
-                  //  fields inserted.)
-                  
-                  if (FileType == GALAXY) {
-
-                     //  For the galaxy file, we just record the list of fields,
-                     //  which we assume is the superset list. We keep the simple
-                     //  string, which makes things easy, and we also save the
-                     //  parsed set of fields, which we'll need when this routine
-                     //  is called again to read the guide file.
-                  
-                     ProgDetails->ListOfFields = LineString;
-                     ProgDetails->FieldNames = Tokens;
-                     
-                  } else {
-                  
-                     //  For the guide file, we need to see how the list of fields
-                     //  we have now compares to the list we got from the galaxy
-                     //  file. We check that all the guide fields are present in the
-                     //  galaxy list (ie that it really is a superset), and we note
-                     //  which fields in that superset list are supplied in the guide
-                     //  details, and which guide fields they correspond to.
-                     
-                     int NFields = ProgDetails->FieldNames.size();
-                     ProgDetails->GuideFieldIndices.resize(NFields);
-                     for (int IList = 0; IList < NFields; IList++) {
-                        ProgDetails->GuideFieldIndices[IList] = -1;
-                     }
-                     
-                     //  Go through each of the guide field items and see if it
-                     //  is in the superset list of items.
-                     
-                     for (unsigned int IGuideItem = 0; IGuideItem < Tokens.size();
-                                                                 IGuideItem++) {
-                        int ListMatchItem = -1;
-                        for (int IList = 0; IList < NFields; IList++) {
-                           if (TcsUtil::MatchCaseBlind(Tokens[IGuideItem],
-                                          ProgDetails->FieldNames[IList])) {
-                              ListMatchItem = IList;
-                              break;
-                           }
-                        }
-                        
-                        //  If we found it (at field entry ListMatchItem) then set
-                        //  the guide field index for the list item to indicate
-                        //  this entry in the guide field items. If not, issue a
-                        //  warning - perhaps this should be an error?
-                        
-                        if (ListMatchItem < 0) {
-                           snprintf (Error,sizeof(Error),
-                              "Line %d: Could not find guide field '%s' in '%s'",
-                                        LineNumber,Tokens[IGuideItem].c_str(),
-                                          ProgDetails->ListOfFields.c_str());
-                           ProgDetails->Warnings.push_back(string(Error));
-                        } else {
-                           ProgDetails->GuideFieldIndices[ListMatchItem] =
-                                                                     IGuideItem;
-                        }
-                     }
-                  }
-
-               } else if (ItemCount == 0) {
-               
-                  //  This is a blank line. I don't expect to see them, but
-                  //  it should be safe to ignore them.
-
-                  FileHeader->HeaderLines.push_back(LineString);
-
-               } else if (IsComment) {
-               
-                  //  This is a line starting with '#', but not part of the
-                  //  'standard' header. I'm not sure if these might be expected,
-                  //  or what to do with them if we find them. For the moment,
-                  //  I'm adding them to the set of header lines.
-                  
-                  FileHeader->HeaderLines.push_back(LineString);
-
-               } else {
-               
-                  //  This is one of the lines giving the details for an
-                  //  object. We want to check that we have the expected number
-                  //  of fields, and we want to extract the Ra and Dec values
-                  //  because that's what this program is mostly about. We need to
-                  //  keep all the details for when we write the output file,
-                  //  however. We also need the object name, and - if they were
-                  //  specified, the magnitude and Re values. (Actually, it seems
-                  //  the real intent is that the output file contain all the values
-                  //  from the input file, so all we really need to do is record
-                  //  the whole original input line.
-                  
-                  if (ItemCount != ObjectItems) {
-                     snprintf (Error,sizeof(Error),
-                                 "Line %d: Expected %d values, read %d: '%s'",
-                                        LineNumber,ObjectItems,ItemCount,Line);
-                     ProgDetails->Ok = false;
-                     ProgDetails->Error = Error;
-                     break;
-                  }
-                  TargetCount++;
-                  HectorTarget ThisTarget;
-                  
-                  //  We will have bailed out if RaItem and DecItem were
-                  //  not set in parsing the header. The others can be allowed to
-                  //  default to the values defined by the structure. Note that
-                  //  the Ra,Dec values in the file are in degrees, and we want
-                  //  them in radians.
-                  
-                  ThisTarget.OriginalLine = LineString;
-                  double Ra = atof(Tokens[RaItem].c_str());
-                  double Dec = atof(Tokens[DecItem].c_str());
-                  ThisTarget.MeanRa = Ra * DD2R;
-                  ThisTarget.MeanDec = Dec * DD2R;
-                  ThisTarget.Type = FileType;
-                  
-                  //  Proper motions. We assume the units are milli-arcsec/year,
-                  //  which we convert to radians/year so they can be passed
-                  //  directly to slaMap(). AND we do assume the files have the
-                  //  cos(dec) correction applied to the RA value, and we undo
-                  //  this, because Slalib assumes this correction hasn't been
-                  //  done.
-                  
-                  double PmRa = 0.0;
-                  double PmDec = 0.0;
-                  
-                  if (ProgDetails->PmCorrection) {
-                     double CosDec = cos(ThisTarget.MeanDec);
-                     if (PmRaItem >= 0) {
-                        PmRa = atof(Tokens[PmRaItem].c_str());
-                        if (CosDec != 0.0) PmRa = PmRa / CosDec;
-                     }
-                     if (PmDecItem >= 0) {
-                        PmDec = atof(Tokens[PmDecItem].c_str());
-                     }
-                     G_Debug.Logf(
-                        "Pm","%s, CosDec %f, PmRa %f, PmDec %f (masec/y)",
-                                      Tokens[0].c_str(),CosDec,PmRa,PmDec);
-                  }
-
-                  //  Convert from milli-arcsec/year to radians/year
-                  
-                  ThisTarget.PMRa = PmRa * MilliArcsecToRadians;
-                  ThisTarget.PMDec = PmDec * MilliArcsecToRadians;
-
-                  //  Add this to the list of targets.
-                  
-                  (*TargetList).push_back(ThisTarget);
-                  if (FileType == GUIDE) GuideCount++;
-               }
-               
-            } else {
-            
-               //  Error or Eof. Check which. On EOF, we've read the whole file.
-               //  Otherwise, it's an error. Either way, break out of the loop.
-               
-               if (!feof(TargetFile)) {
-                  snprintf (Error,sizeof(Error),
-                              "Error reading from, target file: '%s'",
-                                                 TargetFileName.c_str());
-                  ProgDetails->Ok = false;
-                  ProgDetails->Error = Error;
-               }
-               break;
-            }
+         break;
+      }
+      Tokens.resize(9,"");
+      if (Tokens[0] == "" || Tokens[2] == "") {
+         ProgDetails->Error = "No galaxy file or output file given on " + Where;
+         ProgDetails->Ok = false;
+         break;
+      }
+      
+      //  File names can include environment variables, as on the command line.
+      
+      for (int I = 0; I < 3; I++) {
+         string Expanded;
+         if (TcsUtil::ExpandFileName(Tokens[I],Expanded)) Tokens[I] = Expanded;
+      }
+      
+      HectorManifestTile Tile;
+      Tile.LineNumber = LineNumber;
+      Tile.MainTargetFileName = Tokens[0];
+      Tile.GuideTargetFileName = Tokens[1];
+      Tile.OutputFileName = Tokens[2];
+      Tile.Label = Tokens[3];
+      Tile.PlateID = Tokens[4];
+      Tile.DateAndTime = (Tokens[5] != "") ? Tokens[5] : ProgDetails->DateAndTime;
+      
+      //  The temperatures are given in deg C, so need to be converted to deg K,
+      //  and are limited to the same range as on the command line.
+      
+      Tile.RobotTemp = ProgDetails->RobotTemp;
+      Tile.ObsTemp = ProgDetails->ObsTemp;
+      for (int I = 6; I < 8; I++) {
+         if (Tokens[I] == "") continue;
+         double Temp = 0.0;
+         if (!ValidReal(Tokens[I],&Temp) || Temp < -10.0 || Temp > 60.0) {
+            ProgDetails->Error = "Invalid temperature '" + Tokens[I] +
+                                 "' (deg C, -10 to 60) on " + Where;
+            ProgDetails->Ok = false;
+            break;
          }
-         
-         //  Originally, I had no way of getting the field centre -
-         //  it wasn't clear that it was to be found in the file
-         //  headers - so instead I fell back on calculating the median
-         //  position of the various targets, assuming this will be
-         //  a reasonable value to work with until the proper mechansim
-         //  for telling this program the field centre emerges.
-   
-         //  This code can be removed, of course, but for now I'm leaving
-         //  it in, disabled, because it seems interesting to compare its
-         //  values with the centre Ra,Dec read from the header (which are
-         //  the values now used by the rest of the code).
-         
-         const bool CheckFieldCentre = false;         // Set true to re-enable
-         if (CheckFieldCentre && ProgDetails->Ok) {
-            if (TargetCount > 0) {
-
-               float* RaValues = (float*) malloc(TargetCount * sizeof(float));
-               float* DecValues = (float*) malloc(TargetCount * sizeof(float));
-               if (RaValues && DecValues) {
-                  for (int I = 0; I < TargetCount; I++) {
-                     RaValues[I] = (*TargetList)[I].MeanRa;
-                     DecValues[I] = (*TargetList)[I].MeanDec;
-                  }
-                  float MedianRa = gen_qfmed_(RaValues,&TargetCount);
-                  float MedianDec = gen_qfmed_(DecValues,&TargetCount);
-                  printf ("Centre RA, %f, median %f\n",
-                                   ProgDetails->CentreRa * DR2D, MedianRa * DR2D);
-                  printf ("Centre Dec, %f, median %f\n",
-                                   ProgDetails->CentreDec * DR2D, MedianDec * DR2D);
-                  free (RaValues);
-                  free (DecValues);
-               }
-            }
+         if (I == 6) Tile.RobotTemp = Temp + ZeroDegCinDegK;
+         else Tile.ObsTemp = Temp + ZeroDegCinDegK;
+      }
+      if (!ProgDetails->Ok) break;
+      
+      //  And the XY rotation values, if given, are parsed just as they are
+      //  for the command line.
+      
+      Tile.RotMatString = ProgDetails->RotMatString;
+      for (int I = 0; I < 4; I++) Tile.XYRotMatrix[I] = ProgDetails->XYRotMatrix[I];
+      if (Tokens[8] != "") {
+         Tile.RotMatString = Tokens[8];
+         bool Ok = true;
+         string Error = "";
+         ParseRotMatString (Tile.RotMatString,Tile.XYRotMatrix,Ok,Error);
+         if (!Ok) {
+            ProgDetails->Error = Error + " on " + Where;
+            ProgDetails->Ok = false;
+            break;
          }
-         fclose(TargetFile);
       }
+      Tiles->push_back(Tile);
    }
+   fclose (ManifestFile);
    
+   if (ProgDetails->Ok && Tiles->size() == 0) {
+      ProgDetails->Error = "No tiles listed in manifest file: " + ManifestFileName;
+      ProgDetails->Ok = false;
+   }
 }
 
 // ----------------------------------------------------------------------------------
 
-//                        M e a n  2  A p p a r e n t
+//                 M a k e  T e m p  C a c h e  D i r e c t o r y
 //
-//  Packages up a call to slaMap() to convert a position from mean to apparent
-//  coordinates. The position is passed in MeanRa,MeanDec as a mean J2000
-//  position in radians, and is returned in AppRa,AppDec as an apparent position
-//  in radians for the Mjd value held in ProgDetails->Mjd. This routine also
-//  applies the proper motion values for Ra and Dec passed in PmRa and PmDec
-//  in degrees per Julian year. (This routine does not apply the radial and
-//  parallax corrections supported by SlaMap(), but coud easily be extended
-//  to do so.)
-
-void Mean2Apparent (
-   HectorUtilProgDetails* ProgDetails, double MeanRa, double MeanDec,
-   double PmRa, double PmDec, double* AppRa, double* AppDec)
+//  Creates a new, empty, directory to be used to cache the Profit mask file data
+//  for the duration of the program, in the directory given by the environment
+//  variable TMPDIR, or /tmp if that isn't set, and returns its name. If the
+//  directory can't be created, this returns a null string.
+
+string MakeTempCacheDirectory (void)
 {
-   //  SlaMap() documentation often mentions that slaMapqk() can be more
-   //  efficient when a lot of conversions are being performed. On a modern
-   //  machine this probably makes little difference, and in any case isn't
-   //  needed for this program,
-   
-   slaMap (MeanRa,MeanDec,PmRa,PmDec,0.0,0.0,2000.0,ProgDetails->Mjd,
-                                                           AppRa,AppDec);
-   
-/*  This is diagnostic code to look at the difference the conversion makes
-    (assuming the first call is for the field centre, which it will be), and
-    to check that the slalib calls at least produce reversible results.
- 
-   double DR2A = DR2D * 3600.0;
-   static bool First = true;
-   static double FirstRaDiff,FirstDecDiff;
-   double RaDiff = fabs(*AppRa - MeanRa);
-   double DecDiff = fabs(*AppDec - MeanDec);
-   if (First) {
-      FirstRaDiff = RaDiff;
-      FirstDecDiff = DecDiff;
-      First = false;
-   }
-   printf ("DEBUG: Mean2App: date %f, diff (asec) %f %f\n",ProgDetails->Mjd,
-                RaDiff * DR2A,DecDiff * DR2A);
-   printf ("DEBUG: diff from first (asec) %f %f\n",
-         fabs(FirstRaDiff - RaDiff) * DR2A,fabs(FirstDecDiff - DecDiff) * DR2A);
-
-   double NewRa,NewDec;
-   slaAmp (*AppRa,*AppDec,ProgDetails->Mjd,2000.0,&NewRa,&NewDec);
-   printf ("DEBUG: Reverse back to mean: diff (asec) %f %f\n",
-                fabs(NewRa - MeanRa) * DR2A,fabs(NewDec - MeanDec) * DR2A);
-*/
+   const char* TmpDir = getenv("TMPDIR");
+   string Template = string((TmpDir && TmpDir[0]) ? TmpDir : "/tmp") +
+                                                   "/HectorConfigUtil.XXXXXX";
+   vector<char> Name(Template.begin(),Template.end());
+   Name.push_back('\0');
+   if (mkdtemp(Name.data()) == NULL) return "";
+   return string(Name.data());
 }
 
 // ----------------------------------------------------------------------------------
 
-//                        A p p a r e n t  2  M e a n
+//               R e m o v e  T e m p  C a c h e  D i r e c t o r y
 //
-//  Packages up a call to slaAmp() to convert a position from apparent to mean
-//  coordinates. The position is passed in AppRa,AppDec as an apparent position
-//  in radians for the Mjd value held in ProgDetails->Mjd, and is returned in
-//  AppRa,AppDec as a mean J2000 position in radians.
-
-void Apparent2Mean (
-   HectorUtilProgDetails* ProgDetails, double AppRa, double AppDec,
-   double* MeanRa, double* MeanDec)
+//  Deletes a directory created by MakeTempCacheDirectory(), and the cache files
+//  that have been written into it.
+
+void RemoveTempCacheDirectory (const string& Directory)
 {
-   slaAmp (AppRa,AppDec,ProgDetails->Mjd,2000.0,MeanRa,MeanDec);
+   DIR* Dir = opendir(Directory.c_str());
+   if (Dir) {
+      struct dirent* Entry;
+      while ((Entry = readdir(Dir)) != NULL) {
+         string Name = Entry->d_name;
+         if (Name != "." && Name != "..") unlink((Directory + '/' + Name).c_str());
+      }
+      closedir(Dir);
+   }
+   rmdir(Directory.c_str());
 }
 
 // ----------------------------------------------------------------------------------
 
-//                        P a r s e  O b s  T i m e
+//                     P r o c e s s  M a n i f e s t
 //
-//  The parsing of the observation time string is sufficiently complex that it
-//  is best left to a separate routine, namely this. This routine is passed the
-//  string supplied as part of the command line arguments that specifies the
-//  observing time, and uses it to set the Mjd field in the ProgDetails structure.
-//  If no string is specified, a null string can be passed to this routine, in
-//  which case it will calculate a default Mjd that can be used for testing.
-
-void ParseObsTime (const string& ObsTime,HectorUtilProgDetails* ProgDetails)
+//  With the -manifest option, this routine configures all the tiles listed in
+//  the manifest file, using HectorConfigSession::ProcessTile() for each, with
+//  the program details set up from ProgDetails as they would be from the
+//  command line for that tile alone. The 2dF distortion and linearity models
+//  and the sky fibre file are read just once, here, and if -tempcache was given
+//  and no cache directory has been specified for the Profit mask file data, a
+//  temporary one is used, so each mask file is only read once for all the
+//  tiles. Several tiles are processed at once, each in its own thread, as set
+//  by ProgDetails->Workers. The results are reported, in the order the tiles
+//  are listed, once they have all been processed. This returns true if all the
+//  tiles were configured.
+
+bool ProcessManifest (HectorUtilProgDetails* ProgDetails)
 {
-   //  The observing time is specified as a UT date and time, in the form
-   //  "2020 01 28 15 30 0.00", ie UT date year, month, day followed by UT time
-   //  hour, minute, second. If no observing time argument is specified, a default
-   //  will be calulated in SetObsDetails(). If an argument is specified, the
-   //  parsing is slightly complex. The date must be specified, but a time can
-   //  be allowed to default, essentially to midnight. If a time is specified,
-   //  it can be done in one of two ways, either using the hour minute sec
-   //  fields, with minute and second fields defaulting to zero, or the UT
-   //  can be specified with a fraactional day, eg "2020 01 28.6".
-
-   if (ObsTime != "") {
-   
-      //  The general structure of this block of code comes from the 2dF
-      //  configure code in tdFparse.c, although that does not support the
-      //  use of explicit hours, minutes and seconds to specify a fractional
-      //  day. Here, we have been given an observation time string, and need
-      //  to split it up into its component parts.
-      
-      ProgDetails->DateAndTime = ObsTime;
-      string Error = "";
-      vector<string> Tokens;
-      TcsUtil::Tokenize(ObsTime,Tokens);
-      int Items = Tokens.size();
-      if (Items < 3) {
-         Error = "Need at least year, month, day for observing time";
-      } else {
-      
-         //  Get the Year, month and day fields. Check to see if the day is
-         //  fractional, because we need to know if a fraction was specified
-         //  explicitly.
-         
-         //  Note, this code catches some errors, but error reporting could be
-         //  better. In particular, there isn't a check that the various numeric
-         //  strings are actually valid numbers, since the atoi() and atod()
-         //  routines fail silently.
-         
-         int Uty = 0,Utm = 0,Utd = 0;
-         double FracDay = 0.0;
-         Uty = atoi(Tokens[0].c_str());
-         Utm = atoi(Tokens[1].c_str());
-         if (Tokens[2].find_first_of('.') == string::npos) {
-            Utd = atoi(Tokens[2].c_str());
-         } else {
-            double Day = atof(Tokens[2].c_str());
-            Utd = int(Day);
-            FracDay = Day - double(Utd);
-         }
-         
-         //  Similarly, get any time of day fields - we don't need them all,
-         //  so any missing ones can default to zero.
-         
-         int Hour = 0;
-         int Min = 0;
-         double Sec = 0;
-         if (Items > 3) Hour = atoi(Tokens[3].c_str());
-         if (Items > 4) Min = atoi(Tokens[4].c_str());
-         if (Items > 5) {
-            if (Tokens[5].find_first_of('.') == string::npos) {
-               Sec = double(atoi(Tokens[5].c_str()));
-            } else {
-               Sec = atof(Tokens[5].c_str());
-            }
-         }
-         
-         //  If a time of daya was specified, calculate the fractional day
-         //  value on that basis.
-         
-         if (Items > 3) {
-            if (FracDay != 0.0) {
-               Error = "Cannot specify both a time of day and a fractional day";
-            } else {
-               FracDay = double(Hour)/24.0 + double(Min)/(24.0 * 60.) +
-                                                 Sec/(24.0 * 60.0 * 60.0);
-            }
-         } else {
-         
-            //  If no fractional day was specified at all, assume .5, which
-            //  allows for the half day difference (roughly) between Australia
-            //  and Greenwich.
-            
-            if (FracDay == 0.0) FracDay = 0.5;
-         }
-      
-         //  Allow for years specified using two digits. (SlaCldj() itself
-         //  allows for 2 digit years, but the 2dF code chose to insert these
-         //  tests, and I've left them in for the moment.
-         
-         if ((Uty > 0) && (Uty < 100)) {
-            if (Uty <= 50) {
-               Uty += 2000;
-            } else if (Uty >= 70) {
-               Uty += 1900;
-            }
-         }
-         if (Uty < 1970) {
-            Error = "Illegal UT year, 2dF does not support dates before 1970";
-         }
-
-         //  Finally, we can calculate the Mjd value.
-      
-         if (Error == "") {
-            double Mjd = 0.0;
-            int Jstat = 0;
-            slaCldj(Uty,Utm,Utd,&Mjd,&Jstat);
-            if (Jstat != 0) {
-               Error = "Invalid UT date";
-            }
-            ProgDetails->Mjd = Mjd + FracDay;
-         }
+   vector<HectorManifestTile> Tiles;
+   ReadManifest (&Tiles,ProgDetails);
+   if (!ProgDetails->Ok) {
+      ReportResult(*ProgDetails);
+      return false;
+   }
+   int NTiles = Tiles.size();
+   
+   //  Read the models and sky fibre file just the once.
+   
+   HectorSharedDetails Shared;
+   ReadSharedDetails (&Shared,*ProgDetails);
+   
+   //  Without a cache directory, each tile would read all the mask files that
+   //  cover it, and neighbouring tiles share most of those. But the cache holds
+   //  a copy of every mask file used, so a temporary one is only used if asked.
+   
+   string TempCacheDirectory = "";
+   if (ProgDetails->CheckSky && ProgDetails->SweepSpec == "" &&
+         ProgDetails->UseTempCache && ProgDetails->ProfitCacheDirectory == "") {
+      TempCacheDirectory = MakeTempCacheDirectory();
+      ProgDetails->ProfitCacheDirectory = TempCacheDirectory;
+   }
+   
+   //  Work out how many tiles to process at once. Debug output from tiles being
+   //  processed at the same time would be hopelessly mixed up, and the mask
+   //  files can only be read in more than one thread at once if cfitsio was
+   //  built to allow it. Unless the number of threads each tile uses has been
+   //  specified, the processor cores are shared out between the workers.
+   
+   int Cores = std::thread::hardware_concurrency();
+   if (Cores < 1) Cores = 1;
+   int Workers = ProgDetails->Workers;
+   if (Workers <= 0) Workers = Cores;
+   if (ProgDetails->DebugLevels != "") Workers = 1;
+   if (ProgDetails->CheckSky && !fits_is_reentrant()) Workers = 1;
+   if (Workers > NTiles) Workers = NTiles;
+   int Threads = ProgDetails->Threads;
+   if (Threads == 0 && Workers > 1) {
+      Threads = Cores / Workers;
+      if (Threads < 1) Threads = 1;
+   }
+   
+   //  Each worker has its own session, and takes the next tile still to be
+   //  done, processes it, and keeps the outcome. A session only reuses the
+   //  field it set up for its previous tile if the new tile is for exactly the
+   //  same field, so the results don't depend on which worker gets which tile.
+   //  This thread is one of the workers.
+   
+   HectorUtilProgDetails TileBase = *ProgDetails;
+   TileBase.Threads = Threads;
+   vector<char> TileOk(NTiles,0);
+   vector<string> TileErrors(NTiles);
+   vector<vector<string> > TileWarnings(NTiles);
+   std::atomic<int> NextTile(0);
+   auto Worker = [&]() {
+      HectorConfigSession Session;
+      Session.UseSharedDetails (&Shared);
+      Session.SetProgDetails (TileBase);
+      for (;;) {
+         int ITile = NextTile++;
+         if (ITile >= NTiles) break;
+         TileOk[ITile] = Session.ProcessTile(Tiles[ITile]);
+         TileErrors[ITile] = Session.GetError();
+         TileWarnings[ITile] = Session.GetWarnings();
       }
+   };
+   vector<std::thread> WorkerThreads;
+   for (int IWorker = 1; IWorker < Workers; IWorker++) {
+      WorkerThreads.push_back(std::thread(Worker));
+   }
+   Worker();
+   for (std::thread& Thread : WorkerThreads) Thread.join();
+   
+   if (TempCacheDirectory != "") RemoveTempCacheDirectory (TempCacheDirectory);
+   
+   //  Report on each tile in turn, as ReportResult() would for that tile alone.
+   
+   bool AllOk = true;
+   for (int ITile = 0; ITile < NTiles; ITile++) {
+      printf ("Tile %d (line %d): %s\n",ITile + 1,Tiles[ITile].LineNumber,
+                                         Tiles[ITile].OutputFileName.c_str());
+      fflush (stdout);
+      HectorUtilProgDetails Outcome;
+      Outcome.Ok = TileOk[ITile];
+      Outcome.Error = TileErrors[ITile];
+      Outcome.Warnings = TileWarnings[ITile];
+      ReportResult(Outcome);
+      fflush (stdout);
+      if (!Outcome.Ok) AllOk = false;
+   }
+   return AllOk;
+}
 
-      if (Error != "") {
-         ProgDetails->Ok = false;
-         ProgDetails->Error = Error + ": " + ObsTime;
-      }
+// ----------------------------------------------------------------------------------
 
-   } else {
-   
-      //  This is the case where no observation time was specified. In this
-      //  case, let's just use halfway through the current UT day, which will be
-      //  sometime in the middle of tonight in Oz. First, get today's date. Then
-      //  we use the code from ConfSetUTMeridian() in configure.c to set the centre
-      //  of the field on the meridian, given the centre of the field and the
-      //  longitude of the AAT.
-      
-      std::time_t TimeNow = std::time(0);
-      std::tm* UT = std::gmtime(&TimeNow);
-      int Year = (UT->tm_year + 1900);
-      int Month = (UT->tm_mon + 1);
-      int Day = UT->tm_mday;
-      double Mjd = 0.0;
-      int Jstat = 0;
-      slaCaldj (Year,Month,Day,&Mjd,&Jstat);
-      Mjd += 0.5;
-      
-      double Longit = 149.0673 * DD2R;
-      double Lst = slaGmst(Mjd) - Longit + slaEqeqx(Mjd);
-      Mjd = Mjd + (slaDrange(ProgDetails->CentreRa - Lst)) / D2PI / 1.0027379;
-      char Sign[1];
-      int Ihmsf[4];
-      double Frac;
-      slaDd2tf(0, Mjd - floor(Mjd), Sign, Ihmsf);
-      slaDjcl(Mjd, &Year, &Month, &Day, &Frac, &Jstat);
-      printf("UT set to %.4d/%.2d/%.2d  %.2d:%.2d:%.2d to put field on meridian\n",
-               Year, Month, Day, Ihmsf[0], Ihmsf[1], Ihmsf[2]);
-      ProgDetails->Mjd = Mjd;
+//                      S e r v i c e  S t r i n g
+//
+//  The routines that handle the requests made to a service use this to get the
+//  value of a string member of a request. If the member is missing, Value is
+//  set to Default, unless it is required, in which case this returns false
+//  with Error describing the problem, as it does if the member isn't a string.
+
+bool ServiceString (
+   const HectorJsonValue& Request, const string& Name, bool Required,
+   const string& Default, string* Value, string* Error)
+{
+   const HectorJsonValue* Member = HectorJson::Member(Request,Name);
+   if (Member == NULL) {
+      if (Required) {
+         *Error = "No \"" + Name + "\" given in request";
+         return false;
+      }
+      *Value = Default;
+      return true;
+   }
+   if (Member->Type != JSON_STRING) {
+      *Error = "\"" + Name + "\" should be a string, not a " +
+                                            HectorJson::TypeName(Member->Type);
+      return false;
    }
+   *Value = Member->String;
+   return true;
 }
 
-
 // ----------------------------------------------------------------------------------
 
-//                      G e t  O b s  D e t a i l s
+//                      S e r v i c e  N u m b e r s
 //
-//  This routine fills up the structure containing details of the observation -
-//  date, time, met conditions etc.
-
-void GetObsDetails (
-   HectorObsDetails *ObsDetails,
-   HectorUtilProgDetails* ProgDetails)
+//  Gets the value of a member of a service request that gives either a single
+//  number or an array of numbers, returning these in Values and setting IsArray
+//  to show which it was, so that the response can match. If the member is
+//  missing, Values is left empty, unless it is required, in which case this
+//  returns false with Error describing the problem.
+
+bool ServiceNumbers (
+   const HectorJsonValue& Request, const string& Name, bool Required,
+   vector<double>* Values, bool* IsArray, string* Error)
 {
-   if (!ProgDetails->Ok) return;
-   
-   //  We don't ask how, but we assume the name of the 2dF distortion file is
-   //  in ProgDetails. Ditto the linearity file.
-   
-   ObsDetails->DistFilePath = ProgDetails->DistFileName;
-   ObsDetails->LinFilePath = ProgDetails->LinFileName;
-
-   //  We need to add the actual initialisation of the observation details. Normally,
-   //  we expect anything that isn't going to be allowed to default to have been
-   //  supplied on the command line, so it will now be in ProgDetails.
-   
-   //  These met values are those used for 2dF in the testharness program, which
-   //  is probably as good a set of defaults as any. They'll do for the moment
-   //  as a set of default values, although we now assume that the atmospheric
-   //  temperature and the observing temperature for the plate are the same.
-   //  (Previously, a standard default value of 285K was being used.)
-   
-   ObsDetails->Temp = ProgDetails->ObsTemp; // Temperature in degrees Kelvin.
-   ObsDetails->Press = 900;       // Pressure in mm Hg.
-   ObsDetails->Humid = 0.5;       // Humidity - as a fraction, ie 0 - 1.
-   ObsDetails->ObsWave = 0.60;    // Wavelength in microns.
-   ObsDetails->CenWave = 0.60;    // Wavelength in microns.
-
-   //  Now, do we have any values in ProgDetails that will replace these defaults?
-   //  At the moment, we only have a specified command line parameter for the
-   //  observation temperature, but that's for the plate temperature during
-   //  observation. Is this likely to be the same as the atmospheric temperature
-   //  during observing? For the moment, let's assume not.
-   
-   //  The field centre should be in ProgDetails, having been set in there when
-   //  the input files were read.
-   
-   ObsDetails->CenRa = ProgDetails->CentreRa;
-   ObsDetails->CenDec = ProgDetails->CentreDec;
-   
-   //  The observing time may have been specified - usually will be specified -
-   //  in the command line parameters, as a string giving date and time. If it
-   //  wasn't this string will be blank. ParseObsTime parses this string (the
-   //  DateAndTime field in ProgDetails, and sets the Mjd field in the same
-   //  structure. If the time string is blank, it picks a suitable default time.
-   
-   ParseObsTime(ProgDetails->DateAndTime,ProgDetails);
-   ObsDetails->Mjd = ProgDetails->Mjd;
-
-   //  Once we have the observation details, we can initialise the coordinate
-   //  converter included in the ProgDetails structure.
-   
-   double CenRaMean = ObsDetails->CenRa;
-   double CenDecMean = ObsDetails->CenDec;
-   double CenRaApp,CenDecApp;
-   Mean2Apparent (ProgDetails,CenRaMean,CenDecMean,0.0,0.0,&CenRaApp,&CenDecApp);
-   if (!ProgDetails->CoordConverter.Initialise(CenRaApp,CenDecApp,
-      ObsDetails->Mjd,ObsDetails->Dut,ObsDetails->Temp,ObsDetails->Press,
-         ObsDetails->Humid,ObsDetails->CenWave,ObsDetails->ObsWave,
-            ProgDetails->RobotTemp,ProgDetails->ObsTemp,ProgDetails->XYRotMatrix,
-               ObsDetails->DistFilePath,ObsDetails->LinFilePath)) {
-      string Error = "Error initialising coordinate converter: " +
-                                     ProgDetails->CoordConverter.GetError();
-      ProgDetails->Ok = false;
-      ProgDetails->Error = Error;
-   } else {
-      if (!ProgDetails->CoordConverter.GetModel(ProgDetails->ModelPars,
-                               C_MODEL_PARMS,&(ProgDetails->NumberPars))) {
-         string Error = "Error coordinate converter parameters: " +
-                                    ProgDetails->CoordConverter.GetError();
-         ProgDetails->Ok = false;
-         ProgDetails->Error = Error;
-      } else {
-         ProgDetails->ConverterInitialised = true;
+   Values->clear();
+   *IsArray = false;
+   const HectorJsonValue* Member = HectorJson::Member(Request,Name);
+   if (Member == NULL) {
+      if (Required) {
+         *Error = "No \"" + Name + "\" given in request";
+         return false;
       }
+      return true;
    }
-   
-   //  If we are supposed to disable the telecentricity or mechanical offset
-   //  calculations, do so. Should we log this in some way?
-   
-   if (!(ProgDetails->MechCorrection)) {
-      ProgDetails->CoordConverter.DisableMechOffset(true);
-   }
-   if (!(ProgDetails->TeleCorrection)) {
-      ProgDetails->CoordConverter.DisableTelecentricity(true);
+   if (Member->Type == JSON_NUMBER) {
+      Values->push_back(Member->Number);
+      return true;
    }
-
-   //  Ditto the linearity correction
-   
-   if (!(ProgDetails->LinCorrection)) {
-      ProgDetails->CoordConverter.DisableLin(true);
+   if (Member->Type == JSON_ARRAY) {
+      *IsArray = true;
+      for (const HectorJsonValue& Item : Member->Items) {
+         if (Item.Type != JSON_NUMBER) {
+            *Error = "\"" + Name + "\" should only contain numbers";
+            return false;
+         }
+         Values->push_back(Item.Number);
+      }
+      return true;
    }
-   
+   *Error = "\"" + Name + "\" should be a number or an array of numbers, not a "
+                                          + HectorJson::TypeName(Member->Type);
+   return false;
 }
 
 // ----------------------------------------------------------------------------------
 
-//                  C o n v e r t  T a r g e t  C o o r d i n a t e s
+//                      S e r v i c e  T e m p
 //
-//  This routine takes the list of targets and, using the observation details,
-//  calculates the Ra,Dec positions for each target and sets those in the list of
-//  targets.
+//  Gets a temperature, given in deg C, from a member of a service request,
+//  checking it is in the same range as allowed on the command line, and
+//  converting it to deg K. If the member is missing, Temp is left unchanged.
 
-void ConvertTargetCoordinates (
-   const HectorObsDetails &ObsDetails,
-   vector<HectorTarget>* TargetList,
-   HectorUtilProgDetails* ProgDetails)
+bool ServiceTemp (
+   const HectorJsonValue& Request, const string& Name, float* Temp,
+   string* Error)
 {
-   if (!ProgDetails->Ok) return;
-   
-   //  It would be an internal error in this code if we got to this point with
-   //  the coordinate converter not initialised properly, but we check anyway.
-   
-   if (!ProgDetails->ConverterInitialised) {
-      ProgDetails->Error =
-        "Coordinate converter not initialised: cannot convert target coordinates";
-      ProgDetails->Ok = false;
-   } else {
-   
-      //  Work through all the targets in the list we've been passed, converting
-      //  the Ra,Dec positions to X,Y on the plate, setting the X,Y values in the
-      //  structure describing each target.
-      
-      double MinX = 0.0;
-      double MaxX = 0.0;
-      double MaxY = 0.0;
-      double MinY = 0.0;
-      int NumberTargets = TargetList->size();
-      for (int ITarget = 0; ITarget < NumberTargets; ITarget++) {
-         double MeanRa = (*TargetList)[ITarget].MeanRa;
-         double MeanDec = (*TargetList)[ITarget].MeanDec;
-         double PmRa = (*TargetList)[ITarget].PMRa;
-         double PmDec = (*TargetList)[ITarget].PMDec;
-         double AppRa,AppDec;
-         Mean2Apparent (ProgDetails,MeanRa,MeanDec,PmRa,PmDec,&AppRa,&AppDec);
-         double X,Y;
-         if (!ProgDetails->CoordConverter.RaDec2XY(AppRa,AppDec,&X,&Y)) {
-            char Error[1024];
-            snprintf (Error,sizeof(Error),
-               "Error converting Ra %f Dec %f to X,Y: %s\n",
-                  MeanRa,MeanDec,ProgDetails->CoordConverter.GetError().c_str());
-            ProgDetails->Ok = false;
-            ProgDetails->Error = Error;
-            break;
-         }
-         (*TargetList)[ITarget].X = X;
-         (*TargetList)[ITarget].Y = Y;
-         if (X > MaxX) MaxX = X;
-         if (X < MinX) MinX = X;
-         if (Y > MaxY) MaxY = Y;
-         if (Y < MinY) MinY = Y;
-      }
-      
-      //  It may be a useful check to list the range of calculated positions.
-      
-      G_Debug.Logf ("Range","X range %f to %f, Y range %f to %f",
-                                                      MinX,MaxX,MinY,MaxY);
+   vector<double> Values;
+   bool IsArray = false;
+   if (!ServiceNumbers(Request,Name,false,&Values,&IsArray,Error)) return false;
+   if (Values.size() == 0) return true;
+   if (IsArray || Values[0] < -10.0 || Values[0] > 60.0) {
+      *Error = "\"" + Name + "\" should be a temperature in deg C, -10 to 60";
+      return false;
    }
+   *Temp = Values[0] + ZeroDegCinDegK;
+   return true;
 }
 
 // ----------------------------------------------------------------------------------
 
-//                  G e t  S k y  F i b r e  D e t a i l s
+//                      S e r v i c e  L i s t
 //
-//  This routine fills the vector used for the list of sky fibres with details of
-//  each of the sky fibres, particularly their X,Y positions on the plate.
+//  Formats a set of values, each already formatted as JSON text, for a service
+//  response. If the request gave an array, so does the response. Otherwise,
+//  there will only be the one value, and that is returned as it is.
 
-void GetSkyFibreDetails (
-   vector<HectorSkyFibre> *SkyFibreList,
-   HectorUtilProgDetails* ProgDetails)
+string ServiceList (const vector<string>& Items, bool IsArray)
 {
-   static const double Mm2microns = 1000.0;
-   
-   if (!ProgDetails->Ok) return;
+   if (!IsArray && Items.size() == 1) return Items[0];
+   string List = "[";
+   for (size_t Index = 0; Index < Items.size(); Index++) {
+      if (Index > 0) List += ",";
+      List += Items[Index];
+   }
+   return List + "]";
+}
 
-   char Error[1024];
-   string SkyFibreFileName = ProgDetails->SkyFibreFileName;
-   
-   FILE* SkyFibreFile = fopen(SkyFibreFileName.c_str(),"r");
-   if (SkyFibreFile == NULL) {
-      ProgDetails->Error = "Error opening sky fibre file: " + SkyFibreFileName;
-      ProgDetails->Ok = false;
-   } else {
-      int AFibres = 0;
-      int HFibres = 0;
-      int LineNumber = 0;
-      for (;;) {
-         char Line[1024];
-         if (fgets (Line,sizeof(Line),SkyFibreFile)) {
-         
-            //  Read a line. Parse it, after removing any newline or return
-            //  characters and truncating after the last non-blank character.
-            
-            LineNumber++;
-            Line[sizeof(Line) - 1] = '\0';
-            int LastNonBlank = -1;
-            for (unsigned int I = 0; I < sizeof(Line); I++) {
-               if (Line[I] == '\0') break;
-               if (Line[I] == '\n' || Line[I] == '\r') {
-                  Line[I] = '\0';
-                  break;
-               }
-               if (Line[I] != ' ') LastNonBlank = I;
-            }
-            Line[LastNonBlank + 1] = '\0';
-            string LineString = Line;
-            
-            //  Tokenize the line. This is a .csv file, so the only separator
-            //  we care about is a comma.
-            
-            vector<string> Tokens;
-            TcsUtil::Tokenize(LineString,Tokens,",");
-            int ItemCount = Tokens.size();
-            
-            //  The only lines we care about are the fibre position lines,
-            //  so we ignore any line that doesn't start with 'A' and a
-            //  number or 'H' and a number. Look carefully at that first
-            //  item, and if it looks OK, see if the second item is an
-            //  integer fibre number.
-            
-            bool FibreLine = false;
-            char Type = ' ';
-            long TypeNo = 0;
-            long FibreNo = 0;
-            if (ItemCount > 2) {
-               string Item = Tokens[0];
-               if (Item.size() >= 2) {
-                  Type = toupper(Item[0]);
-                  if (Type == 'H' || Type == 'A') {
-                     if (ValidInteger(Item.substr(1),&TypeNo)) {
-                        Item = Tokens[1];
-                        if (ValidInteger(Tokens[1],&FibreNo)) {
-                           FibreLine = true;
-                        }
-                     }
-                  }
-               }
-            }
+// ----------------------------------------------------------------------------------
 
-            if (FibreLine) {
-            
-               if (Type == 'H') HFibres++;
-               else AFibres++;
-            
-               HectorSkyFibre FibreDetails;
-               FibreDetails.SubplateType = Type;
-               FibreDetails.SubplateNo = TypeNo;
-               FibreDetails.FibreNumber = FibreNo;
-
-               //  This line starts properly, so we expect the rest of the
-               //  fields to be three blanks, followed by 12 real numbers
-               //  giving the fibre position data.
-               
-               if (ItemCount < 17) {
-                  snprintf (Error,sizeof(Error),
-                         "Line %d: Not enough position values in: '%s'",
-                                                            LineNumber,Line);
-                  ProgDetails->Error = Error;
-                  ProgDetails->Ok = false;
-                  break;
-               }
-               for (int Posn = 0; Posn < 4; Posn++) {
-                  int Index = (Posn * 3) + 4;
-                  double Values[3] = {0.0,0.0,0.0};
-                  for (int I = 0; I < 3; I++) {
-                     if (!ValidReal(Tokens[Index + I],&Values[I])) {
-                        snprintf(Error,sizeof(Error),
-                           "Line %d: '%s' is not a valid position value"
-                               " in '%s'",LineNumber,Tokens[Index + I].c_str(),
-                                                                         Line);
-                        ProgDetails->Error = Error;
-                        ProgDetails->Ok = false;
-                        break;
-                     }
-                  }
-                  if (!ProgDetails->Ok) break;
-                  
-                  //  The original documentation for the sky fibre file said
-                  //  the positions were in microns, but they seem to be in mm.
-                  
-                  FibreDetails.X[Posn] = Values[0] * Mm2microns;
-                  FibreDetails.Y[Posn] = Values[1] * Mm2microns;
-                  FibreDetails.Radius[Posn] = Values[2] * Mm2microns;
-               }
-               if (!ProgDetails->Ok) break;
-               SkyFibreList->push_back(FibreDetails);
-            }
-         
-         } else {
-         
-            //  Error or Eof. Check which. On EOF, we've read the whole file.
-            //  Otherwise, it's an error. Either way, break out of the loop.
-         
-            if (!feof(SkyFibreFile)) {
-               snprintf (Error,sizeof(Error),
-                           "Error reading from sky fibre file: '%s'",
-                                              SkyFibreFileName.c_str());
-               ProgDetails->Ok = false;
-               ProgDetails->Error = Error;
-            }
-            break;
-         }
-      }
-      fclose (SkyFibreFile);
-      
-      //  Check on expected fibre numbers. Allow for the possibility that
-      //  no sky fibres were expected for one of the spectrographs. If fibres
-      //  were expected and none were defined, that's an error. If an
-      //  unexpected number were found, treat that as a warning. If we
-      //  didn't expect fibres of a given type but some were defined, that's
-      //  OK - we expect the fibre file to have both.
-      
-      if (ProgDetails->ExpectedHFibres > 0) {
-         if (HFibres == 0) {
-            snprintf(Error,sizeof(Error),
-               "No Hector fibre positions defined. Expected %d",
-                                                 ProgDetails->ExpectedHFibres);
-            ProgDetails->Error = Error;
-            ProgDetails->Ok = false;
-         } else {
-            if (HFibres != ProgDetails->ExpectedHFibres) {
-               snprintf (Error,sizeof(Error),
-                  "Expected positions for %d Hector fibres, got %d",
-                               ProgDetails->ExpectedHFibres,HFibres);
-               ProgDetails->Warnings.push_back(string(Error));
-            }
-         }
-      }
-      if (ProgDetails->ExpectedAFibres > 0) {
-         if (AFibres == 0) {
-            snprintf(Error,sizeof(Error),
-               "No AAOmega fibre positions defined. Expected %d",
-                                                 ProgDetails->ExpectedAFibres);
-            ProgDetails->Error = Error;
-            ProgDetails->Ok = false;
-         } else {
-            if (AFibres != ProgDetails->ExpectedAFibres) {
-               snprintf (Error,sizeof(Error),
-                  "Expected positions for %d AAOmega fibres, got %d",
-                               ProgDetails->ExpectedAFibres,AFibres);
-               ProgDetails->Warnings.push_back(string(Error));
-            }
-         }
-      }
-      G_Debug.Logf ("Fibres", "H fibres = %d, A fibres = %d, total = %d",
-                                            HFibres,AFibres,HFibres + AFibres);
+//                      F i n d  S e r v i c e  S e s s i o n
+//
+//  Returns the session named by the "session" member of a service request,
+//  or NULL, with Error describing the problem, if there is no such session.
+
+HectorConfigSession* FindServiceSession (
+   const HectorJsonValue& Request, HectorServiceState* State, string* Error)
+{
+   string SessionId = "";
+   if (!ServiceString(Request,"session",true,"",&SessionId,Error)) return NULL;
+   auto Iter = State->Sessions.find(SessionId);
+   if (Iter == State->Sessions.end()) {
+      *Error = "No session \"" + SessionId + "\" is open";
+      return NULL;
    }
+   return Iter->second.get();
 }
 
 // ----------------------------------------------------------------------------------
 
-//             C o n v e r t  S k y  F i b r e  C o o r d i n a t e s
+//                      S e r v i c e  O p e n
 //
-//  This routine takes the list of sky fibres and, using the observation details,
-//  calculates the X,Y positions for each fibre and sets those in the list of
-//  fibres.
-
-void ConvertSkyFibreCoordinates (
-   const HectorObsDetails &ObsDetails,
-   vector<HectorSkyFibre> *SkyFibreList,
-   HectorUtilProgDetails* ProgDetails)
+//  Handles an "open" request made to a service. This opens a session, with the
+//  ID given by the client, for a field centre, observing time, temperatures
+//  and XY rotation matrix given in the request, any of which other than the
+//  centre default to the values given on the command line. Each session is a
+//  HectorConfigSession, whose coordinate converter and astrometry are set up
+//  for the field just as they are for a tile, using the models read when the
+//  service started, and are then used for all the requests made for that
+//  session. A session ID can be opened again, with exactly the same values, in
+//  which case the existing session is reused, but using the same ID for
+//  different values is an error until the session has been closed. This is
+//  what makes it safe for clients to rely on a session ID to mean one field
+//  and epoch.
+
+bool ServiceOpen (
+   const HectorJsonValue& Request, HectorServiceState* State,
+   const HectorUtilProgDetails& Base, string* Members,
+   vector<string>* Warnings, string* Error)
 {
-   if (!ProgDetails->Ok) return;
-   
-   //  It would be an internal error in this code if we got to this point with
-   //  the coordinate converter not initialised properly, but we check anyway.
-   
-   if (!ProgDetails->ConverterInitialised) {
-      ProgDetails->Error =
-        "Coordinate converter not initialised: cannot convert sky coordinates";
-      ProgDetails->Ok = false;
+   string SessionId = "";
+   if (!ServiceString(Request,"session",true,"",&SessionId,Error)) return false;
+   if (SessionId == "") {
+      *Error = "The session ID cannot be blank";
+      return false;
+   }
+   vector<double> Centre;
+   bool IsArray = false;
+   if (!ServiceNumbers(Request,"centre",true,&Centre,&IsArray,Error)) return false;
+   if (!IsArray || Centre.size() != 2 || Centre[1] < -90.0 || Centre[1] > 90.0) {
+      *Error = "\"centre\" should be [ra,dec] in degrees";
+      return false;
+   }
+   string DateAndTime = "";
+   string RotMatString = "";
+   float RobotTemp = Base.RobotTemp;
+   float ObsTemp = Base.ObsTemp;
+   if (!ServiceString(Request,"time",false,Base.DateAndTime,&DateAndTime,Error) ||
+       !ServiceTemp(Request,"robot_temp",&RobotTemp,Error) ||
+       !ServiceTemp(Request,"obs_temp",&ObsTemp,Error) ||
+       !ServiceString(Request,"xymatrix",false,Base.RotMatString,
+                                               &RotMatString,Error)) {
+      return false;
+   }
+   //  A bad rotation matrix string is reported as such, rather than as a
+   //  different field to that of an existing session.
+   
+   double XYRotMatrix[4];
+   bool Ok = true;
+   ParseRotMatString (RotMatString,XYRotMatrix,Ok,*Error);
+   if (!Ok) return false;
+   
+   //  The sessions take the temperatures in deg C, as given in the request.
+   
+   double RobotTempC = RobotTemp - ZeroDegCinDegK;
+   double ObsTempC = ObsTemp - ZeroDegCinDegK;
+   
+   auto Iter = State->Sessions.find(SessionId);
+   bool Reused = (Iter != State->Sessions.end());
+   if (Reused) {
+      if (Iter->second->GetFieldKey() != HectorConfigSession::FieldKey(
+             Centre[0],Centre[1],DateAndTime,RobotTempC,ObsTempC,RotMatString)) {
+         *Error = "Session \"" + SessionId +
+               "\" is already open for a different field or epoch, and must be "
+                                                     "closed before it is reused";
+         return false;
+      }
    } else {
    
-      //  Sky fibres should not have the telecentricity and mech offset
-      //  calculation applied, as any such offset is already incorporated in
-      //  the positions given in the sky fibre definition file. We do the
-      //  right thing and restore the previous settings once we've finished
-      //  with the sky fibres.
+      //  Set up the new session, using the models read when the service
+      //  started. The "checksky" requests always check positions with
+      //  CheckPositionsForSky(), so there's no point building clearance maps.
       
-      bool PrevTele = ProgDetails->CoordConverter.DisableTelecentricity(true);
-      bool PrevMech = ProgDetails->CoordConverter.DisableMechOffset(true);
-
-      //  Work through all the sky fibres in the list we've been passed, converting
-      //  the X,Y positions on the plate to Ra,Dec coordinates, and setting the
-      //  Ra,Dec values in the structure describing each sky fibre.
-      
-      int NumberSkies = SkyFibreList->size();
-      for (int ISky = 0; ISky < NumberSkies; ISky++) {
-         for (int IPosn = 0; IPosn < 4; IPosn++) {
-            double X = (*SkyFibreList)[ISky].X[IPosn];
-            double Y = (*SkyFibreList)[ISky].Y[IPosn];
-            double AppRa,AppDec;
-            if (!ProgDetails->CoordConverter.XY2RaDec(X,Y,&AppRa,&AppDec)) {
-               char Error[1024];
-               snprintf (Error,sizeof(Error),
-                  "Error converting X %f Y %f to Ra,Dec: %s",
-                  AppRa,AppDec,ProgDetails->CoordConverter.GetError().c_str());
-               ProgDetails->Ok = false;
-               ProgDetails->Error = Error;
-               break;
-            }
-            double MeanRa,MeanDec;
-            Apparent2Mean (ProgDetails,AppRa,AppDec,&MeanRa,&MeanDec);
-            (*SkyFibreList)[ISky].MeanRa[IPosn] = MeanRa;
-            (*SkyFibreList)[ISky].MeanDec[IPosn] = MeanDec;
-         }
-         if (!ProgDetails->Ok) break;
+      std::shared_ptr<HectorConfigSession> Session(new HectorConfigSession);
+      HectorUtilProgDetails SessionDetails = Base;
+      SessionDetails.UseClearMaps = false;
+      Session->UseSharedDetails (&State->Shared);
+      Session->SetProgDetails (SessionDetails);
+      bool FieldSet = Session->SetField (Centre[0],Centre[1],DateAndTime,
+                                    RobotTempC,ObsTempC,RotMatString);
+      *Warnings = Session->GetWarnings();
+      if (!FieldSet) {
+         *Error = Session->GetError();
+         return false;
       }
-      
-      //  Restore the offset calculations to their previous state.
-      
-      ProgDetails->CoordConverter.DisableTelecentricity(PrevTele);
-      ProgDetails->CoordConverter.DisableMechOffset(PrevMech);
+      Iter = State->Sessions.insert(std::make_pair(SessionId,Session)).first;
    }
+   *Members = ",\"session\":" + HectorJson::Quote(SessionId) + ",\"reused\":" +
+       (Reused ? "true" : "false") + ",\"mjd\":" +
+                         HectorJson::FormatNumber(Iter->second->GetMjd());
+   return true;
 }
 
 // ----------------------------------------------------------------------------------
 
-//             C h e c k  S k y  F i b r e s  A r e  C l e a r
-//
-//  This routine takes the list of sky fibres and checks that none of them are
-//  contaminated by being too close to any known object. This tries the various
-//  possible positions for each sky fibre, and picks the best position to use,
-//  picking position 1 if this is clear, then falling back on position 2 and
-//  finally on position 3. If all positions are contaminated, it picks position
-//  0, which essentially means that fibre is unused. This version of the
-//  routine uses Profit mask files to check for contamination. This assumes
-//  that the Sky fibre details have already been read into the elements of
-//  the SkyFibreList, and that any necessary parameters have been set in the
-//  ProgDetails structure.
+//                      S e r v i c e  R a  D e c  2  X Y
 //
+//  Handles a "radec2xy" request made to a service. This converts one or more
+//  mean J2000 Ra,Dec positions, given in degrees, with optional proper motions
+//  in milli-arcsec/year given as in the target files, to X,Y positions in
+//  microns on the plate, for the session's field and epoch, exactly as the
+//  target positions are converted by ConvertTargetCoordinates(). Positions
+//  that can't be converted are given as null, with a warning.
+
+bool ServiceRaDec2XY (
+   const HectorJsonValue& Request, HectorConfigSession* Session,
+   string* Members, vector<string>* Warnings, string* Error)
+{
+   vector<double> Ra,Dec,PmRa,PmDec;
+   bool IsArray = false;
+   bool Unused = false;
+   if (!ServiceNumbers(Request,"ra",true,&Ra,&IsArray,Error) ||
+       !ServiceNumbers(Request,"dec",true,&Dec,&Unused,Error) ||
+       !ServiceNumbers(Request,"pmra",false,&PmRa,&Unused,Error) ||
+       !ServiceNumbers(Request,"pmdec",false,&PmDec,&Unused,Error)) {
+      return false;
+   }
+   int NPosns = Ra.size();
+   if (int(Dec.size()) != NPosns || (PmRa.size() > 0 && int(PmRa.size()) != NPosns)
+                       || (PmDec.size() > 0 && int(PmDec.size()) != NPosns)) {
+      *Error = "\"ra\", \"dec\", \"pmra\" and \"pmdec\" should all have the "
+                                                       "same number of values";
+      return false;
+   }
+   vector<double> X(NPosns),Y(NPosns);
+   std::unique_ptr<bool[]> Converted(new bool[NPosns]);
+   if (!Session->RaDecToXY(NPosns,Ra.data(),Dec.data(),
+            PmRa.size() > 0 ? PmRa.data() : NULL,
+               PmDec.size() > 0 ? PmDec.data() : NULL,X.data(),Y.data(),
+                                                           Converted.get())) {
+      Warnings->push_back("Error converting Ra,Dec to X,Y: " +
+                                                          Session->GetError());
+   }
+   vector<string> XItems,YItems;
+   for (int IPosn = 0; IPosn < NPosns; IPosn++) {
+      XItems.push_back(Converted[IPosn] ? HectorJson::FormatNumber(X[IPosn]) : "null");
+      YItems.push_back(Converted[IPosn] ? HectorJson::FormatNumber(Y[IPosn]) : "null");
+   }
+   *Members = ",\"x\":" + ServiceList(XItems,IsArray) + ",\"y\":" +
+                                                    ServiceList(YItems,IsArray);
+   return true;
+}
 
-void CheckSkyFibresAreClear (
-   vector<HectorSkyFibre> *SkyFibreList,
-   HectorUtilProgDetails* ProgDetails)
+// ----------------------------------------------------------------------------------
+
+//                      S e r v i c e  X Y  2  R a  D e c
+//
+//  Handles an "xy2radec" request made to a service. This converts one or more
+//  X,Y positions in microns on the plate to mean J2000 Ra,Dec positions in
+//  degrees, for the session's field and epoch. If "sky" is true, the positions
+//  are converted as ConvertSkyFibreCoordinates() converts the sky fibre
+//  positions, without the telecentricity and mech offset corrections.
+//  Positions that can't be converted are given as null, with a warning.
+
+bool ServiceXY2RaDec (
+   const HectorJsonValue& Request, HectorConfigSession* Session,
+   string* Members, vector<string>* Warnings, string* Error)
 {
-   if (!ProgDetails->Ok) return;
-   
-   if (ProgDetails->CheckSky) {
-   
-      int FailedChecks = 0;
-   
-      //  The contamination checks are performed using a ProfitSkyCheck object,
-      //  which needs to be initialised with the name of the directory containing
-      //  the Profit mask files (FITS files), and the centre and radius of the
-      //  field to be checked. This lets it load the various mask files that
-      //  cover the fiels in question.
-   
-      ProfitSkyCheck SkyChecker;
-   
-      SkyChecker.SetDebugLevels (ProgDetails->DebugLevels);
-         
-      if (!SkyChecker.Initialise (ProgDetails->ProfitDirectory,
-         ProgDetails->CentreRa * DR2D,ProgDetails->CentreDec * DR2D,
-                                             ProgDetails->FieldRadius * DR2D)) {
-         ProgDetails->Error = SkyChecker.GetError();
-         ProgDetails->Ok = false;
-         
-      } else {
-      
-         //  Go through each fibre in the list of sky fibres. Get the Ra and
-         //  Dec of each of the four positions defined for it, and - in the
-         //  preferred order, ie starting at 1, then 2, then 3, see if the
-         //  checker thinks that position is clear. If so, use it. If none
-         //  are clear, fall back on position 0 - which doesn't need to be
-         //  checked for contamination. As of Jan 2022, a failure to check an
-         //  individual sky position (possibly because of a missing mask file)
-         //  now only generates a warning, and no longer stops the program
-         //  from running.
-         
-        double RadiusDeg = ProgDetails->SkyRadiusAsec / 3600.0;
-        int NFibres = (*SkyFibreList).size();
-        for (int IFibre = 0; IFibre < NFibres; IFibre++) {
-            HectorSkyFibre* FibreDetails = &(*SkyFibreList)[IFibre];
-            FibreDetails->ChosenPosn = 0;
-            for (int Posn = 1; Posn < 4; Posn++) {
-               double RaDeg = FibreDetails->MeanRa[Posn] * DR2D;
-               double DecDeg = FibreDetails->MeanDec[Posn] * DR2D;
-               bool Clear = false;
-               
-               if (G_Debug.Active("Fibres")) {
-                  G_Debug.Logf ("Fibres","Checking sky fibre %c%d %d",
-                       FibreDetails->SubplateType,
-                       FibreDetails->SubplateNo,FibreDetails->FibreNumber);
-                  double DelRa = RaDeg - (ProgDetails->CentreRa * DR2D);
-                  double DelDec = DecDeg - (ProgDetails->CentreDec * DR2D);
-                  double Dist = sqrt(DelRa * DelRa + DelDec * DelDec);
-                  G_Debug.Logf ("Fibres","RaDeg %f DecDeg %f dist from centre = %f",
-                      RaDeg,DecDeg,Dist);
-               }
-               
-               if (!SkyChecker.CheckUseForSky(RaDeg,DecDeg,RadiusDeg,&Clear)) {
-                  char FibreId[32];
-                  snprintf (FibreId,sizeof(FibreId),"%c%d %d (%d)",
-                       FibreDetails->SubplateType,FibreDetails->SubplateNo,
-                                       FibreDetails->FibreNumber,Posn);
-                  ProgDetails->Warnings.push_back(SkyChecker.GetError() +
-                                    " (Sky fibre " + string(FibreId) + ")");
-                  FailedChecks++;
-                  continue;
-               }
-               if (Clear) {
-                  FibreDetails->ChosenPosn = Posn;
-                  break;
-               }
-            }
-            if (!ProgDetails->Ok) break;
-            G_Debug.Logf ("Fibres","Sky fibre %c%d %d position %d",
-                FibreDetails->SubplateType,FibreDetails->SubplateNo,
-                FibreDetails->FibreNumber,FibreDetails->ChosenPosn);
-         }
-      }
-      
-      if (FailedChecks > 0) {
-         ProgDetails->Warnings.push_back(
-            "Total number of sky fibre positions that could not be checked = " +
-                                              TcsUtil::FormatInt(FailedChecks));
+   vector<double> X,Y;
+   bool IsArray = false;
+   bool Unused = false;
+   if (!ServiceNumbers(Request,"x",true,&X,&IsArray,Error) ||
+       !ServiceNumbers(Request,"y",true,&Y,&Unused,Error)) {
+      return false;
+   }
+   bool Sky = false;
+   const HectorJsonValue* SkyMember = HectorJson::Member(Request,"sky");
+   if (SkyMember) {
+      if (SkyMember->Type != JSON_BOOL) {
+         *Error = "\"sky\" should be true or false";
+         return false;
       }
-      
-   } else {
-   
-      //  If we've disabled checking the sky fibre positions for contamination,
-      //  indicate this by setting the chosen position for each to -99.
-      
-      int NFibres = (*SkyFibreList).size();
-      for (int IFibre = 0; IFibre < NFibres; IFibre++) {
-         HectorSkyFibre* FibreDetails = &(*SkyFibreList)[IFibre];
-         FibreDetails->ChosenPosn = -99;
+      Sky = SkyMember->Bool;
+   }
+   int NPosns = X.size();
+   if (int(Y.size()) != NPosns) {
+      *Error = "\"x\" and \"y\" should have the same number of values";
+      return false;
+   }
+   vector<double> Ra(NPosns),Dec(NPosns);
+   std::unique_ptr<bool[]> Converted(new bool[NPosns]);
+   if (!Session->XYToRaDec(NPosns,X.data(),Y.data(),Sky,Ra.data(),Dec.data(),
+                                                           Converted.get())) {
+      Warnings->push_back("Error converting X,Y to Ra,Dec: " +
+                                                          Session->GetError());
+   }
+   vector<string> RaItems,DecItems;
+   for (int IPosn = 0; IPosn < NPosns; IPosn++) {
+      if (Converted[IPosn]) {
+         RaItems.push_back(HectorJson::FormatNumber(Ra[IPosn]));
+         DecItems.push_back(HectorJson::FormatNumber(Dec[IPosn]));
+      } else {
+         RaItems.push_back("null");
+         DecItems.push_back("null");
       }
-
    }
-   
+   *Members = ",\"ra\":" + ServiceList(RaItems,IsArray) + ",\"dec\":" +
+                                                 ServiceList(DecItems,IsArray);
+   return true;
 }
 
 // ----------------------------------------------------------------------------------
 
-//                 S h u f f l e  S k y  F i b r e s
+//                      S e r v i c e  C h e c k  S k y
 //
-//  This routine takes the list of sky fibres and applies the sky shuffling that
-//  is required for the Hector spectrograph. This will probably result in some
-//  previously uncapped fibres being flagged as capped in order to achieve the
-//  spacing required. Actually, what it really does is nothing at all, as this
-//  requirement has been dropped.
-
-void ShuffleSkyFibres (
-   vector<HectorSkyFibre>* /*SkyFibreList*/,
-   HectorUtilProgDetails* ProgDetails)
+//  Handles a "checksky" request made to a service. This checks whether one or
+//  more mean J2000 Ra,Dec positions, given in degrees, are clear of any objects
+//  in the Profit mask files, to within the clearance given in arcsec (which
+//  defaults to that given on the command line), just as CheckSkyFibresAreClear()
+//  checks the sky fibre positions. Each session has its own ProfitSkyCheck
+//  object, set up for its field the first time it is needed, and kept, with
+//  the masks it has loaded, for any further requests. (If that set-up fails,
+//  it is tried again for the next request.) The result for each
+//  position is true (clear), false, or null if it couldn't be checked, in
+//  which case the reason is given.
+
+bool ServiceCheckSky (
+   const HectorJsonValue& Request, HectorConfigSession* Session,
+   const HectorUtilProgDetails& Base, string* Members, string* Error)
 {
-   if (!ProgDetails->Ok) return;
+   if (!Base.CheckSky) {
+      *Error = "Sky position checks have been disabled (-nosky)";
+      return false;
+   }
+   vector<double> Ra,Dec,Clearance;
+   bool IsArray = false;
+   bool Unused = false;
+   if (!ServiceNumbers(Request,"ra",true,&Ra,&IsArray,Error) ||
+       !ServiceNumbers(Request,"dec",true,&Dec,&Unused,Error) ||
+       !ServiceNumbers(Request,"clearance",false,&Clearance,&Unused,Error)) {
+      return false;
+   }
+   int NPosns = Ra.size();
+   if (int(Dec.size()) != NPosns) {
+      *Error = "\"ra\" and \"dec\" should have the same number of values";
+      return false;
+   }
+   double ClearanceAsec = Base.SkyRadiusAsec;
+   if (Clearance.size() > 0) {
+      ClearanceAsec = Clearance[0];
+      if (Unused || ClearanceAsec < 0.0 || ClearanceAsec > 10.0) {
+         *Error = "\"clearance\" should be a number of arcsec, 0 to 10";
+         return false;
+      }
+   }
+   
+   vector<ProfitSkyPosn> SkyPosns(NPosns);
+   for (int IPosn = 0; IPosn < NPosns; IPosn++) {
+      SkyPosns[IPosn].RaDeg = Ra[IPosn];
+      SkyPosns[IPosn].DecDeg = Dec[IPosn];
+      SkyPosns[IPosn].RadiusDeg = ClearanceAsec / 3600.0;
+   }
+   if (!Session->CheckSky(&SkyPosns)) {
+      *Error = Session->GetError();
+      return false;
+   }
+   vector<string> ClearItems,ReasonItems;
+   for (const ProfitSkyPosn& SkyPosn : SkyPosns) {
+      if (SkyPosn.Status == SKY_UNCHECKED) ClearItems.push_back("null");
+      else ClearItems.push_back(SkyPosn.Status == SKY_CLEAR ? "true" : "false");
+      ReasonItems.push_back(HectorJson::Quote(SkyPosn.Reason));
+   }
+   *Members = ",\"clear\":" + ServiceList(ClearItems,IsArray) + ",\"reasons\":" +
+                                            ServiceList(ReasonItems,IsArray);
+   return true;
 }
 
 // ----------------------------------------------------------------------------------
 
-//                 W r i t e  O u t p u t  F i l e
+//                      S e r v i c e  T i l e
 //
-//  This routine takes all the details collected and calculated by the program
-//  and writes the output file in the required format.
-
-void WriteOutputFile (
-   const HectorFileHeader &FileHeader,
-   const HectorObsDetails &ObsDetails,
-   const vector<HectorTarget> &TargetList,
-   const vector<HectorSkyFibre> &SkyFibreList,
-   HectorUtilProgDetails* ProgDetails)
+//  Handles a "tile" request made to a service. This configures a tile exactly
+//  as it is configured when the program is run for that tile alone, using the
+//  values given in the request in place of the first eight command line
+//  arguments (and -xymatrix), with the models and sky fibre details read when
+//  the service started. All the tiles are configured by the one session, so
+//  a tile for the same field as the one before uses the field as already set
+//  up. The tile's warnings are returned, and if it could not be configured,
+//  its error.
+
+bool ServiceTile (
+   const HectorJsonValue& Request, HectorServiceState* State,
+   const HectorUtilProgDetails& Base, string* Members,
+   vector<string>* Warnings, string* Error)
 {
-   if (!ProgDetails->Ok) return;
+   HectorManifestTile Tile;
+   Tile.RobotTemp = Base.RobotTemp;
+   Tile.ObsTemp = Base.ObsTemp;
+   for (int I = 0; I < 4; I++) Tile.XYRotMatrix[I] = Base.XYRotMatrix[I];
+   if (!ServiceString(Request,"gal",true,"",&Tile.MainTargetFileName,Error) ||
+       !ServiceString(Request,"guide",false,"",&Tile.GuideTargetFileName,Error) ||
+       !ServiceString(Request,"output",true,"",&Tile.OutputFileName,Error) ||
+       !ServiceString(Request,"label",false,"",&Tile.Label,Error) ||
+       !ServiceString(Request,"plateid",false,"",&Tile.PlateID,Error) ||
+       !ServiceString(Request,"time",false,Base.DateAndTime,
+                                                     &Tile.DateAndTime,Error) ||
+       !ServiceTemp(Request,"robot_temp",&Tile.RobotTemp,Error) ||
+       !ServiceTemp(Request,"obs_temp",&Tile.ObsTemp,Error) ||
+       !ServiceString(Request,"xymatrix",false,Base.RotMatString,
+                                                    &Tile.RotMatString,Error)) {
+      return false;
+   }
+   if (Tile.RotMatString != Base.RotMatString) {
+      bool Ok = true;
+      ParseRotMatString (Tile.RotMatString,Tile.XYRotMatrix,Ok,*Error);
+      if (!Ok) return false;
+   }
    
-   //  Open the output file specified in ProgDetails.
+   //  File names can include environment variables, as on the command line.
    
-   FILE* OutputFile = fopen(ProgDetails->OutputFileName.c_str(),"w");
-   if (OutputFile == NULL) {
-      ProgDetails->Error = "Unable to create output file: '" +
-                                             ProgDetails->OutputFileName;
-      ProgDetails->Ok = false;
-   } else {
+   string* FileNames[] = {&Tile.MainTargetFileName,&Tile.GuideTargetFileName,
+                                                         &Tile.OutputFileName};
+   for (string* FileName : FileNames) {
+      string Expanded;
+      if (TcsUtil::ExpandFileName(*FileName,Expanded)) *FileName = Expanded;
+   }
    
-      //  Now, write out what we have, in a format that should match that defined
-      //  in the Hector software document, ASD 143. (As modified through subsequent
-      //  discussions with Sam Vaughan, which emphasised that all the input fields
-      //  for each object needed to be included.
-      
-      //  Basic header
-      
-      fprintf(OutputFile,"#LABEL,%s\n",ProgDetails->Label.c_str());
-      fprintf(OutputFile,"#PLATEID,%s\n",ProgDetails->PlateID.c_str());
- 
-      //  Observing details
-      
-      char Sign[1];
-      int Ihmsf[4],Idmsf[4];
-      double Frac;
-      int Year,Month,Day,Jstat;
-      double Mjd = ObsDetails.Mjd;
-      slaDd2tf(2, Mjd - floor(Mjd), Sign, Ihmsf);
-      slaDjcl(Mjd, &Year, &Month, &Day, &Frac, &Jstat);
-      fprintf(OutputFile,"#UTDATE,%04d %02d %02d #Target observing date\n",
-                                                           Year,Month,Day);
-      fprintf(OutputFile,"#UTTIME,%02d %02d %02d.%02d #Target observing time\n",
-                                   Ihmsf[0],Ihmsf[1],Ihmsf[2],Ihmsf[3]);
-      slaCr2tf(2,ObsDetails.CenRa,Sign,Ihmsf);
-      slaDr2af(1,ObsDetails.CenDec,Sign,Idmsf);
-      fprintf(OutputFile,
-         "#CENTRE,%02d %02d %02d.%02d,%c%02d %02d %02d.%01d #Field centre\n",
-         Ihmsf[0],Ihmsf[1],Ihmsf[2],Ihmsf[3],
-         Sign[0],Idmsf[0],Idmsf[1],Idmsf[2],Idmsf[3]);
-      fputs("#EQUINOX,J2000.0\n",OutputFile);
-      
-      //  These additional details were requested by Tony Farrell. They provide
-      //  diagnostic information about the coordinate conversion parameters.
-      
-      fputs("#MDLPARS",OutputFile);
-      for (int I = 0; I < ProgDetails->NumberPars; I++) {
-         fprintf(OutputFile,",%.10g",ProgDetails->ModelPars[I]);
-      }
-      fputs("\n",OutputFile);
-      fprintf(OutputFile,"#ROBOT_TEMP,%f\n",ProgDetails->RobotTemp);
-      fprintf(OutputFile,"#OBS_TEMP,%f\n",ProgDetails->ObsTemp);
-
-      //  Now the target details. The field labels come from the ListOfFields
-      //  item, which is the list exactly as read from the galaxy input file,
-      //  plus the two values calculated by the program, MagnetX and MagnetY
-      //  and the position used by the sky fibres.
-      
-      std::string FieldList = ProgDetails->ListOfFields +
-                                          ",MagnetX,MagnetY,SkyPosition\n";
-      fputs(FieldList.c_str(),OutputFile);
-      int TargetCount = TargetList.size();
-      for (int ITarget = 0; ITarget < TargetCount; ITarget++) {
-         double X = TargetList[ITarget].X;
-         double Y = TargetList[ITarget].Y;
-         
-         if (TargetList[ITarget].Type == GALAXY) {
-
-            //  For a galaxy, this is easy. We just put out the whole of the original
-            //  input line, and append the values we've calculated - ie X and Y,
-            //  which are the magnet X and Y positions.
-         
-            fprintf(OutputFile,"%s,%.2f,%.2f\n",
-                       TargetList[ITarget].OriginalLine.c_str(),X,Y);
+   bool Ok = State->TileSession->ProcessTile(Tile);
+   *Warnings = State->TileSession->GetWarnings();
+   if (!Ok) {
+      *Error = State->TileSession->GetError();
+      return false;
+   }
+   *Members = ",\"output\":" + HectorJson::Quote(Tile.OutputFileName);
+   return true;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                      H a n d l e  S e r v i c e  R e q u e s t
+//
+//  Handles one request made to a service, given as a line of JSON text, and
+//  returns the response, as a line of JSON text (without the terminating
+//  newline). The request is an object whose "cmd" member says what is wanted.
+//  The response is an object with an "ok" member, true if the request was
+//  handled, together with the results of the request or, if "ok" is false,
+//  an "error" member describing the problem. Any warnings are included as
+//  an array of strings in a "warnings" member. If the request has an "id"
+//  member, this is included, unchanged, in the response.
+
+string HandleServiceRequest (
+   const string& Line, HectorServiceState* State,
+   const HectorUtilProgDetails& Base)
+{
+   HectorJsonValue Request;
+   string Error = "";
+   vector<string> Warnings;
+   string Members = "";
+   bool Ok = HectorJson::Parse(Line,&Request,&Error);
+   if (Ok && Request.Type != JSON_OBJECT) {
+      Error = "Request should be a JSON object";
+      Ok = false;
+   }
+   string Cmd = "";
+   if (Ok) Ok = ServiceString(Request,"cmd",true,"",&Cmd,&Error);
+   if (Ok) {
+      if (Cmd == "open") {
+         Ok = ServiceOpen(Request,State,Base,&Members,&Warnings,&Error);
+      } else if (Cmd == "close") {
+         string SessionId = "";
+         Ok = ServiceString(Request,"session",true,"",&SessionId,&Error);
+         if (Ok) {
+            bool Closed = (State->Sessions.erase(SessionId) > 0);
+            Members = string(",\"closed\":") + (Closed ? "true" : "false");
+         }
+      } else if (Cmd == "radec2xy" || Cmd == "xy2radec" || Cmd == "checksky") {
+         HectorConfigSession* Session = FindServiceSession(Request,State,&Error);
+         if (Session == NULL) {
+            Ok = false;
+         } else if (Cmd == "radec2xy") {
+            Ok = ServiceRaDec2XY(Request,Session,&Members,&Warnings,&Error);
+         } else if (Cmd == "xy2radec") {
+            Ok = ServiceXY2RaDec(Request,Session,&Members,&Warnings,&Error);
          } else {
-         
-            //  For a guide star, we have to extract the values of its fields and
-            //  generate an output line that has all the fields in the superset
-            //  used by the galaxy, with nulls where the star data has no value
-            //  and the guide star's data where available. We make use of the array
-            //  of GuideFieldIndices built up when the guide file header was read and
-            //  compared with that of the galaxy file header.
-            
-            //  First, split up the line read from the guide file for this object
-            //  into its tokens (this was done already, when it was read in, and
-            //  maybe what should have been saved is the list of tokens - it
-            //  doesn't really matter).
- 
-            vector<string> Tokens;
-            TcsUtil::Tokenize(TargetList[ITarget].OriginalLine,Tokens);
-            int OutputItems = ProgDetails->GuideFieldIndices.size();
-            int GuideItems = Tokens.size();
-            
-            //  Now build up the output line. This has to have something for each
-            //  field included in the galaxy input file. If the GuideFileIndices
-            //  array entry for this field is -1, it wasn't one of the fields
-            //  supplied in the guide file, and we put in a null string. Otherwise,
-            //  the GuideFileIndices value is the index into the list of tokens
-            //  read from the guilde file for this object, and we use that. Fields
-            //  are comma separated.
-            
-            string OutputLine = "";
-            for (int Item = 0; Item < OutputItems; Item++) {
-               int GuideItem = ProgDetails->GuideFieldIndices[Item];
-               if (GuideItem >= 0) {
-                  if (GuideItem < GuideItems) {
-                     OutputLine = OutputLine + Tokens[GuideItem];
-                  }
-               }
-               OutputLine = OutputLine + ',';
-            }
-            
-            //  Note we don't need a comma at the end of OutputLine as it already
-            //  ends in one.
-            
-            fprintf(OutputFile,"%s%.2f,%.2f\n",OutputLine.c_str(),X,Y);
+            Ok = ServiceCheckSky(Request,Session,Base,&Members,&Error);
          }
+      } else if (Cmd == "tile") {
+         Ok = ServiceTile(Request,State,Base,&Members,&Warnings,&Error);
+      } else if (Cmd == "quit") {
+         State->QuitRequested = true;
+      } else {
+         Error = "Unknown request \"" + Cmd + "\"";
+         Ok = false;
       }
-      
-      //  Now the sky fibres. For each, we generate the name in the form
-      //  Sky-<T>-<N> where <T> is A or H depending on the spectrograph for
-      //  the fibre, and <N> is the fibre number, eg Sky-H-23.
-      
-      int SkyFibreCount = SkyFibreList.size();
-      for (int ISky = 0; ISky < SkyFibreCount; ISky++) {
-         string Spect{SkyFibreList[ISky].SubplateType};
-         int SubplateNo = SkyFibreList[ISky].SubplateNo;
-         int FibreNo = SkyFibreList[ISky].FibreNumber;
-         string Name = "Sky-" + Spect + TcsUtil::FormatInt(SubplateNo) +
-                                            "-" + TcsUtil::FormatInt(FibreNo);
-         
-         //  Name is the first field for a sky fibre. Most of the rest are
-         //  null, except for the Ra,Dec fields and the final X,Y and
-         //  Position fields. (If sky checking has been disabled, all the
-         //  chosen positions will be flagged as -99, and we should fall
-         //  back on position 0 for the Ra,Dec and X,Y numbers).
-         
-         int Posn = SkyFibreList[ISky].ChosenPosn;
-         int UsePosn = Posn;
-         if (Posn < 0 || Posn > 3) UsePosn = 0;
-         double Ra = SkyFibreList[ISky].MeanRa[UsePosn];
-         double Dec = SkyFibreList[ISky].MeanDec[UsePosn];
-         double X = SkyFibreList[ISky].X[UsePosn];
-         double Y = SkyFibreList[ISky].Y[UsePosn];
-         string OutputLine = Name;
-         int NFields = ProgDetails->FieldNames.size();
-         char Number[64];
-         for (int IField = 1; IField < NFields; IField++) {
-            if (IField == ProgDetails->RaItem) {
-               snprintf(Number,sizeof(Number),"%.7f",Ra * DR2D);
-               OutputLine = OutputLine + "," + string(Number);
-            } else if (IField == ProgDetails->DecItem) {
-               snprintf(Number,sizeof(Number),"%.9f",Dec * DR2D);
-               OutputLine = OutputLine + "," + string(Number);
-            } else {
-               OutputLine = OutputLine + ",";
-            }
-         }
-         fprintf(OutputFile,"%s,%.2f,%.2f,%d\n",OutputLine.c_str(),X,Y,Posn);
+   }
+   
+   string Response = "{";
+   const HectorJsonValue* Id = HectorJson::Member(Request,"id");
+   if (Id) Response += "\"id\":" + HectorJson::Format(*Id) + ",";
+   if (Ok) {
+      Response += "\"ok\":true" + Members;
+   } else {
+      Response += "\"ok\":false,\"error\":" + HectorJson::Quote(Error);
+   }
+   if (Warnings.size() > 0) {
+      Response += ",\"warnings\":[";
+      for (size_t Index = 0; Index < Warnings.size(); Index++) {
+         if (Index > 0) Response += ",";
+         Response += HectorJson::Quote(Warnings[Index]);
       }
-
-      fclose(OutputFile);
+      Response += "]";
    }
+   return Response + "}";
 }
 
 // ----------------------------------------------------------------------------------
 
-//                      R e p o r t  R e s u l t
+//                      R e a d  S e r v i c e  L i n e
 //
-//  This routine tidies up at the end of the program, reporting any errors and
-//  anything else that might be needed.
-
-void ReportResult(
-   const HectorUtilProgDetails& ProgDetails)
+//  Reads the next line of text from a file descriptor open on the service
+//  socket or standard input. Pending holds anything already read that follows
+//  the last line returned, and should be empty to start with. This waits for
+//  the first byte using ReadSocketData(), and then reads whatever else is
+//  already available in the one call, so a whole request is usually read at
+//  once without reading past the end of what the client has sent. This returns
+//  false at the end of the input, or if there is a problem, when Error will
+//  describe it.
+
+bool ReadServiceLine (int Fd, string* Pending, string* Line, string* Error)
 {
-   int NWarnings = ProgDetails.Warnings.size();
-   if (ProgDetails.Ok && NWarnings == 0) {
-      printf ("All OK\n");
-   } else {
-      if (ProgDetails.Error != "") {
-         fprintf (stderr,"** Error ** %s\n",ProgDetails.Error.c_str());
+   for (;;) {
+      size_t Newline = Pending->find('\n');
+      if (Newline != string::npos) {
+         *Line = Pending->substr(0,Newline);
+         Pending->erase(0,Newline + 1);
+         if (Line->size() > 0 && (*Line)[Line->size() - 1] == '\r') {
+            Line->erase(Line->size() - 1);
+         }
+         return true;
       }
-      for (int I = 0; I < NWarnings; I++) {
-         fprintf (stderr,"* Warning * %s\n",ProgDetails.Warnings[I].c_str());
+      if (Pending->size() > MaxServiceRequestBytes) {
+         *Error = "Service request is too long";
+         return false;
+      }
+      char Buffer[65536];
+      if (TcsUtil::ReadSocketData(Fd,Buffer,1,0,*Error) < 0) return false;
+      Pending->push_back(Buffer[0]);
+      int Available = 0;
+      if (ioctl(Fd,FIONREAD,&Available) == 0 && Available > 0) {
+         if (Available > int(sizeof(Buffer))) Available = sizeof(Buffer);
+         if (TcsUtil::ReadSocketData(Fd,Buffer,Available,0,*Error) < 0) {
+            return false;
+         }
+         Pending->append(Buffer,Available);
       }
    }
 }
 
 // ----------------------------------------------------------------------------------
 
-//                          M a i n  P r o g r a m
+//                      S e r v e  C o n n e c t i o n
+//
+//  Handles all the requests from one client of a service, reading them as lines
+//  from InFd and writing each response as a line to OutFd, until the client
+//  closes the connection or asks the service to quit. Blank lines are ignored.
 
-int main (int Argc, char* Argv[]) {
+void ServeConnection (
+   int InFd, int OutFd, HectorServiceState* State,
+   const HectorUtilProgDetails& Base)
+{
+   string Pending = "";
+   string Line = "";
+   string Error = "";
+   while (!State->QuitRequested && ReadServiceLine(InFd,&Pending,&Line,&Error)) {
+      if (Line.find_first_not_of(" \t") == string::npos) continue;
+      string Response = HandleServiceRequest(Line,State,Base) + "\n";
+      if (TcsUtil::WriteSocketData(OutFd,Response.data(),Response.size(),
+                                                                  Error) < 0) {
+         break;
+      }
+   }
+}
 
-   //  Create the structures we work with.
-   
-   //  a) Structures containing anything we need from the input files that will
-   //     need to be included in the output file. We have two, one for the main
-   //     target file and one for the guide star target file. The information in
-   //     the two should be the same, except for the details about the fields
-   //     describing each object.
-   
-   HectorFileHeader MainFileHeader;
-   HectorFileHeader GuideFileHeader;
+// ----------------------------------------------------------------------------------
 
-   //  b) A structure with the observation details - time, met conditions, etc.
+//                      O p e n  S e r v i c e  S o c k e t
+//
+//  Creates a Unix domain socket with the given path name, on which the service
+//  listens for clients, and returns its file descriptor, or -1 with Error
+//  describing the problem. A socket left behind by a previous service that
+//  has since exited is replaced, but if another service is still listening
+//  on it, or the path name is already used by something that isn't a socket,
+//  it is left alone and this fails.
+
+int OpenServiceSocket (const string& Path, string* Error)
+{
+   struct sockaddr_un Address;
+   memset (&Address,0,sizeof(Address));
+   Address.sun_family = AF_UNIX;
+   if (Path.size() >= sizeof(Address.sun_path)) {
+      *Error = "Socket path name is too long: " + Path;
+      return -1;
+   }
+   memcpy (Address.sun_path,Path.c_str(),Path.size());
    
-   HectorObsDetails ObsDetails;
+   int SocketFd = socket(AF_UNIX,SOCK_STREAM,0);
+   if (SocketFd < 0) {
+      *Error = "Unable to create socket: " + string(strerror(errno));
+      return -1;
+   }
+   struct stat Status;
+   if (lstat(Path.c_str(),&Status) == 0) {
+      if (!S_ISSOCK(Status.st_mode)) {
+         *Error = "Not replacing existing file that isn't a socket: " + Path;
+         close (SocketFd);
+         return -1;
+      }
+      if (connect(SocketFd,(struct sockaddr*)&Address,sizeof(Address)) == 0) {
+         *Error = "Another service is already listening on socket: " + Path;
+         close (SocketFd);
+         return -1;
+      }
+      unlink (Path.c_str());
+   }
+   if (bind(SocketFd,(struct sockaddr*)&Address,sizeof(Address)) < 0 ||
+                                                     listen(SocketFd,8) < 0) {
+      *Error = "Unable to listen on socket " + Path + ": " +
+                                                       string(strerror(errno));
+      close (SocketFd);
+      return -1;
+   }
+   return SocketFd;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                             S e r v e
+//
+//  With the -serve option, the program runs as a service, handling requests
+//  from clients until one asks it to quit, rather than configuring a tile and
+//  exiting. See the description of -serve at the start of this file. The
+//  requests are read either from standard input or from clients connecting to
+//  a Unix domain socket, one client at a time. The models and sky fibre details
+//  are read just once, and as for a manifest, if -tempcache was given and no
+//  cache directory has been specified for the Profit mask file data, a
+//  temporary one is used. This returns false if the service could not be
+//  started.
+
+bool Serve (HectorUtilProgDetails* ProgDetails)
+{
+   //  The time picked for a field if a request gives none is reported to the
+   //  client as a warning, rather than printed.
+   
+   ProgDetails->PrintMeridianTime = false;
+   HectorServiceState State;
+   ReadSharedDetails (&State.Shared,*ProgDetails);
+   
+   string TempCacheDirectory = "";
+   if (ProgDetails->CheckSky && ProgDetails->UseTempCache &&
+                                    ProgDetails->ProfitCacheDirectory == "") {
+      TempCacheDirectory = MakeTempCacheDirectory();
+      ProgDetails->ProfitCacheDirectory = TempCacheDirectory;
+   }
    
-   //  c) A set of structures each containing the details of a target object.
+   State.TileSession.reset(new HectorConfigSession);
+   State.TileSession->UseSharedDetails (&State.Shared);
+   State.TileSession->SetProgDetails (*ProgDetails);
    
-   vector<HectorTarget> TargetList;
+   //  A client that goes away without reading its response shouldn't kill
+   //  the service.
    
-   //  d) A set of structures each containing the details of a sky fibre.
+   signal (SIGPIPE,SIG_IGN);
    
-   vector<HectorSkyFibre> SkyFibreList;
+   if (ProgDetails->ServeSpec == "-") {
    
-   //  e) A structure containing internal details the program needs. In particular,
-   //     including an 'OK' flag that each routine tests on entry (and exits
-   //     immediately if something has already gone wrong). This keeps the
-   //     program structure simple, without needing to use exceptions.
+      //  The responses go to standard output, so anything else that would
+      //  be written there, such as warnings from ProfitSkyCheck, is sent to
+      //  standard error instead.
+      
+      fflush (stdout);
+      int OutFd = dup(1);
+      dup2 (2,1);
+      ServeConnection (0,OutFd,&State,*ProgDetails);
+      close (OutFd);
+      
+   } else {
    
-   HectorUtilProgDetails ProgDetails;
+      string Error = "";
+      string Path = ProgDetails->ServeSpec;
+      int SocketFd = OpenServiceSocket(Path,&Error);
+      if (SocketFd < 0) {
+         ProgDetails->Error = Error;
+         ProgDetails->Ok = false;
+      } else {
+         printf ("Listening for requests on socket %s\n",Path.c_str());
+         fflush (stdout);
+         while (!State.QuitRequested) {
+            int ClientFd = accept(SocketFd,NULL,NULL);
+            if (ClientFd < 0) {
+               if (errno == EINTR) continue;
+               ProgDetails->Error = "Error accepting connection on socket " +
+                                          Path + ": " + string(strerror(errno));
+               ProgDetails->Ok = false;
+               break;
+            }
+            ServeConnection (ClientFd,ClientFd,&State,*ProgDetails);
+            close (ClientFd);
+         }
+         close (SocketFd);
+         unlink (Path.c_str());
+      }
+   }
    
-   //  Set the debug levels supported by the global debugger used by this
-   //  code file.
+   //  The sessions' sky checkers may be using files in the cache directory,
+   //  so they go before it does.
    
-   G_Debug.LevelsList ("Range,Fibres,Pm");
+   State.Sessions.clear();
+   State.TileSession.reset();
+   if (TempCacheDirectory != "") RemoveTempCacheDirectory (TempCacheDirectory);
    
-   //  This is where the program starts. Set up the program details - these
-   //  may depend on the command line arguments. This main routine is as simple
-   //  as possible, showing the processes as a simple linear progression, which
-   //  is all that's needed - this is a simple utility program. If anything goes
-   //  wrong, one stage will flag this in the program details, and subsequent
-   //  stages will just fall through to the end.
+   return ProgDetails->Ok;
+}
 
-   SetUpProgDetails (Argc,Argv,&ProgDetails);
-   
-   //  Read the input files, getting any header information that has to be
-   //  included in the output file, and the set of target galaxies and guide
-   //  stars. We do this for the main target file, and again for the guide star
-   //  file, adding all the targets to the target list.
-   
-   ReadInputFile (GALAXY,&MainFileHeader,&TargetList,&ProgDetails);
-   ReadInputFile (GUIDE,&GuideFileHeader,&TargetList,&ProgDetails);
+// ----------------------------------------------------------------------------------
 
-   //  Get the observation details. Note - we do this after we read the input
-   //  file, because having read the input files allows us to set things like
-   //  sensible defaults for the observing time based on the field centre.
-   
-   GetObsDetails (&ObsDetails,&ProgDetails);
-   
-   //  Optionally, list the program details for diagnostic purposes.
-   
-   if (false) ListProgDetails(ProgDetails);
+//                          M a i n  P r o g r a m
 
-   //  Work through the targets, both galaxies and guide stars (we don't need to
-   //  distinguish between them in this program, as all we are here to do is
-   //  the coordinate conversion). Add the X,Y plate positions to the structures
-   //  that describe them.
-   
-   ConvertTargetCoordinates (ObsDetails,&TargetList,&ProgDetails);
-   
-   //  Get the details of the sky fibre positions.
-   
-   GetSkyFibreDetails (&SkyFibreList,&ProgDetails);
-   
-   //  Work out the Ra,Dec coordinates for each of the sky fibres.
+int main (int Argc, char* Argv[]) {
+
+   //  The structure we work with contains the internal details the program
+   //  needs. In particular, including an 'OK' flag that each routine tests on
+   //  entry (and exits immediately if something has already gone wrong). This
+   //  keeps the program structure simple, without needing to use exceptions.
+   //  The other structures - for the input file headers, the observation
+   //  details, the targets and the sky fibres - are created when the tile
+   //  is processed.
    
-   ConvertSkyFibreCoordinates (ObsDetails,&SkyFibreList,&ProgDetails);
+   HectorUtilProgDetails ProgDetails;
    
-   //  See which of the sky fibres are contaminated by known objects in the
-   //  catalogue we use. Flag those accordingly, both as contaiminated and capped.
+   //  This is where the program starts. Set up the program details - these
+   //  may depend on the command line arguments.
+
+   SetUpProgDetails (Argc,Argv,&ProgDetails);
    
-   CheckSkyFibresAreClear (&SkyFibreList,&ProgDetails);
+   //  With a manifest, all the tiles it lists are configured, and the results
+   //  for each reported, by ProcessManifest().
    
-   //  Perform the sky shuffling process required for the Hector spectrograph.
-   //  This may result in a number of additional sky fibres being flagged as capped.
+   if (ProgDetails.Ok && ProgDetails.ManifestFileName != "") {
+      bool AllOk = ProcessManifest (&ProgDetails);
+      exit (AllOk ? 0 : 1);
+   }
    
-   ShuffleSkyFibres (&SkyFibreList,&ProgDetails);
+   //  Running as a service, Serve() handles requests until told to quit.
    
-   //  Write out the new target file, including the converted coordinate positions
-   //  for all the target objects, and the list of sky fibres and their capped flags.
+   if (ProgDetails.Ok && ProgDetails.ServeSpec != "") {
+      Serve (&ProgDetails);
+      ReportResult(ProgDetails);
+      exit (ProgDetails.Ok ? 0 : 1);
+   }
    
-   WriteOutputFile (MainFileHeader,ObsDetails,TargetList,SkyFibreList,&ProgDetails);
+   //  Otherwise, there's just the one tile, described by the command line
+   //  arguments. A HectorConfigSession does everything from reading the input
+   //  files to writing the output file. (The session is closed down before
+   //  the result is reported, so any warnings its sky checker outputs as it
+   //  closes come first, as they always have.)
+   
+   if (ProgDetails.Ok) {
+      HectorConfigSession Session;
+      Session.SetProgDetails (ProgDetails);
+      ProgDetails.Ok = Session.ProcessTile();
+      ProgDetails.Error = Session.GetError();
+      for (const string& Warning : Session.GetWarnings()) {
+         ProgDetails.Warnings.push_back(Warning);
+      }
+   }
    
    //  And that's it. Report any final problems, as will be shown in the program
    //  details structure.
@@ -2174,6 +1815,26 @@ int main (int Argc, char* Argv[]) {
  
    o The sky shuffling is no longer going to be needed, at least in this
      program, and could be removed entirely.
+
+   o With -manifest, tiles are configured for several tiles at once in
+     different threads, each with its own HectorConfigSession. This relies on
+     each tile having its own copy of the program details, including its own
+     coordinate converter, and on everything the routines it calls share being
+     read-only - the global debug handler, and the models and sky fibre
+     details in the HectorSharedDetails structure. The SDS routines used to
+     read the model files are not thread-safe, which is one reason the models
+     are read once, before the threads start. Each session has its own
+     ProfitSkyCheck object, and those can be used at once. ParseObsTime() uses
+     gmtime_r() rather than gmtime() for the same reason. Any new code called
+     from HectorConfigSession::ProcessTile() needs to be safe in this way.
+ 
+   o With -serve, the requests are handled one at a time, in the one thread,
+     and a single slow request (a large tile, say) holds up any others. Each
+     session is a HectorConfigSession, so the time-dependent parts of
+     the conversion are fixed for the session; a client wanting another
+     epoch for the same field opens another session for it. The -clearmap
+     option isn't used by "checksky" requests, which always check positions
+     with CheckPositionsForSky(), although it is used by "tile" requests.
  
    o The telecentricity correction is now implemented - in HectorRaDecXY.cpp,
      but I am slightly concerned it depends on the height of the magnets used
@@ -0,0 +1,499 @@
+//
+//                        H e c t o r  J s o n . c p p
+//
+//  Function:
+//     A minimal JSON parser and formatter used by the HectorConfigUtil service.
+//
+//  Description:
+//     This is the implementation of the HectorJson class. See the comments in
+//     HectorJson.h for details.
+//
+//  Author(s): Hector Observations Pipeline team, (HOP)
+//
+//  History:
+//     16th Oct 2026.  Original version. HOP.
+//
+
+#include "HectorJson.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+//  The maximum nesting depth for arrays and objects accepted by Parse().
+
+static const int MaxJsonDepth = 64;
+
+//  Internal routines used by Parse(). These all work through the text
+//  starting at the character index given by *Posn, and update *Posn to
+//  the index of the first character following what they have parsed.
+
+static void SkipBlanks (const std::string& Text, size_t* Posn);
+static bool ParseValue (const std::string& Text, size_t* Posn, int Depth,
+                              HectorJsonValue* Value, std::string* ErrorText);
+static bool ParseString (const std::string& Text, size_t* Posn,
+                              std::string* String, std::string* ErrorText);
+static bool ParseNumber (const std::string& Text, size_t* Posn,
+                              double* Number, std::string* ErrorText);
+static bool ParseHex4 (const std::string& Text, size_t Posn, unsigned* Code);
+static void AppendUtf8 (unsigned Code, std::string* String);
+static std::string Where (size_t Posn);
+
+// ----------------------------------------------------------------------------------
+
+//                                P a r s e
+//
+//  Parses a complete JSON text, returning the value it represents. The text
+//  must contain exactly one JSON value, optionally surrounded by white space.
+//  If the text is not valid JSON, this returns false and sets *ErrorText to
+//  a description of the problem, including the character position at which
+//  it was detected.
+
+bool HectorJson::Parse (
+   const std::string& Text,
+   HectorJsonValue* Value,
+   std::string* ErrorText)
+{
+   *Value = HectorJsonValue();
+   size_t Posn = 0;
+   if (!ParseValue(Text,&Posn,0,Value,ErrorText)) return false;
+   SkipBlanks(Text,&Posn);
+   if (Posn < Text.size()) {
+      *ErrorText = "Unexpected text following JSON value" + Where(Posn);
+      return false;
+   }
+   return true;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                               M e m b e r
+//
+//  Returns a pointer to the value of the named member of a JSON object, or
+//  NULL if the value is not an object or has no such member. If a name is
+//  repeated in the object, the last value given is returned, which is what
+//  most JSON parsers do.
+
+const HectorJsonValue* HectorJson::Member (
+   const HectorJsonValue& Object,
+   const std::string& Name)
+{
+   const HectorJsonValue* Value = NULL;
+   if (Object.Type == JSON_OBJECT) {
+      for (size_t Index = 0; Index < Object.Names.size(); Index++) {
+         if (Object.Names[Index] == Name) Value = &(Object.Items[Index]);
+      }
+   }
+   return Value;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                                F o r m a t
+//
+//  Returns a JSON value formatted as compact JSON text, with no white space
+//  between items. Parsing the result gives the same value back.
+
+std::string HectorJson::Format (const HectorJsonValue& Value)
+{
+   std::string Text = "";
+   switch (Value.Type) {
+      case JSON_NULL: Text = "null"; break;
+      case JSON_BOOL: Text = Value.Bool ? "true" : "false"; break;
+      case JSON_NUMBER: Text = FormatNumber(Value.Number); break;
+      case JSON_STRING: Text = Quote(Value.String); break;
+      case JSON_ARRAY:
+      case JSON_OBJECT: {
+         bool IsObject = (Value.Type == JSON_OBJECT);
+         Text = IsObject ? "{" : "[";
+         for (size_t Index = 0; Index < Value.Items.size(); Index++) {
+            if (Index > 0) Text += ",";
+            if (IsObject) Text += Quote(Value.Names[Index]) + ":";
+            Text += Format(Value.Items[Index]);
+         }
+         Text += IsObject ? "}" : "]";
+         break;
+      }
+   }
+   return Text;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                                 Q u o t e
+//
+//  Returns the given string enclosed in double quotes, with any characters
+//  that need to be escaped in a JSON string escaped.
+
+std::string HectorJson::Quote (const std::string& String)
+{
+   std::string Quoted = "\"";
+   for (char Char : String) {
+      switch (Char) {
+         case '"': Quoted += "\\\""; break;
+         case '\\': Quoted += "\\\\"; break;
+         case '\n': Quoted += "\\n"; break;
+         case '\r': Quoted += "\\r"; break;
+         case '\t': Quoted += "\\t"; break;
+         case '\b': Quoted += "\\b"; break;
+         case '\f': Quoted += "\\f"; break;
+         default:
+            if ((unsigned char)Char < 0x20) {
+               char Escape[8];
+               snprintf (Escape,sizeof(Escape),"\\u%04x",(unsigned char)Char);
+               Quoted += Escape;
+            } else {
+               Quoted += Char;
+            }
+      }
+   }
+   Quoted += "\"";
+   return Quoted;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                          F o r m a t  N u m b e r
+//
+//  Returns a number formatted for inclusion in JSON text. This uses enough
+//  significant figures for the value to be reproduced exactly when read back.
+//  JSON has no representation for infinities or NaNs, so these are returned
+//  as null.
+
+std::string HectorJson::FormatNumber (double Number)
+{
+   if (!isfinite(Number)) return "null";
+   char Buffer[32];
+   snprintf (Buffer,sizeof(Buffer),"%.17g",Number);
+   return Buffer;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                              T y p e  N a m e
+//
+//  Returns a description of a JSON value type, for use in error messages.
+
+std::string HectorJson::TypeName (HectorJsonType Type)
+{
+   std::string Name = "unknown";
+   switch (Type) {
+      case JSON_NULL: Name = "null"; break;
+      case JSON_BOOL: Name = "boolean"; break;
+      case JSON_NUMBER: Name = "number"; break;
+      case JSON_STRING: Name = "string"; break;
+      case JSON_ARRAY: Name = "array"; break;
+      case JSON_OBJECT: Name = "object"; break;
+   }
+   return Name;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                           S k i p  B l a n k s
+//
+//  Moves *Posn past any JSON white space.
+
+static void SkipBlanks (const std::string& Text, size_t* Posn)
+{
+   while (*Posn < Text.size()) {
+      char Char = Text[*Posn];
+      if (Char != ' ' && Char != '\t' && Char != '\n' && Char != '\r') break;
+      (*Posn)++;
+   }
+}
+
+// ----------------------------------------------------------------------------------
+
+//                           P a r s e  V a l u e
+//
+//  Parses a single JSON value of any type. Depth is the nesting depth of the
+//  value, used to limit the recursion for arrays and objects.
+
+static bool ParseValue (
+   const std::string& Text,
+   size_t* Posn,
+   int Depth,
+   HectorJsonValue* Value,
+   std::string* ErrorText)
+{
+   SkipBlanks(Text,Posn);
+   if (*Posn >= Text.size()) {
+      *ErrorText = "Unexpected end of JSON text";
+      return false;
+   }
+   char Char = Text[*Posn];
+   
+   if (Char == '{' || Char == '[') {
+   
+      //  Objects and arrays are handled together, the only difference being
+      //  that each object member is preceded by a name and a colon.
+      
+      bool IsObject = (Char == '{');
+      char Closing = IsObject ? '}' : ']';
+      if (Depth >= MaxJsonDepth) {
+         *ErrorText = "JSON nested too deeply" + Where(*Posn);
+         return false;
+      }
+      Value->Type = IsObject ? JSON_OBJECT : JSON_ARRAY;
+      (*Posn)++;
+      SkipBlanks(Text,Posn);
+      if (*Posn < Text.size() && Text[*Posn] == Closing) {
+         (*Posn)++;
+         return true;
+      }
+      for (;;) {
+         if (IsObject) {
+            SkipBlanks(Text,Posn);
+            if (*Posn >= Text.size() || Text[*Posn] != '"') {
+               *ErrorText = "Expected a member name" + Where(*Posn);
+               return false;
+            }
+            std::string Name;
+            if (!ParseString(Text,Posn,&Name,ErrorText)) return false;
+            SkipBlanks(Text,Posn);
+            if (*Posn >= Text.size() || Text[*Posn] != ':') {
+               *ErrorText = "Expected ':' after member name" + Where(*Posn);
+               return false;
+            }
+            (*Posn)++;
+            Value->Names.push_back(Name);
+         }
+         Value->Items.push_back(HectorJsonValue());
+         if (!ParseValue(Text,Posn,Depth + 1,&(Value->Items.back()),
+                                                    ErrorText)) return false;
+         SkipBlanks(Text,Posn);
+         if (*Posn < Text.size() && Text[*Posn] == ',') {
+            (*Posn)++;
+         } else if (*Posn < Text.size() && Text[*Posn] == Closing) {
+            (*Posn)++;
+            break;
+         } else {
+            *ErrorText = std::string("Expected ',' or '") + Closing + "'"
+                                                               + Where(*Posn);
+            return false;
+         }
+      }
+      return true;
+   }
+   
+   if (Char == '"') {
+      Value->Type = JSON_STRING;
+      return ParseString(Text,Posn,&(Value->String),ErrorText);
+   }
+   
+   if (Char == '-' || (Char >= '0' && Char <= '9')) {
+      Value->Type = JSON_NUMBER;
+      return ParseNumber(Text,Posn,&(Value->Number),ErrorText);
+   }
+   
+   //  All that's left are the literals true, false and null.
+   
+   if (Text.compare(*Posn,4,"true") == 0) {
+      Value->Type = JSON_BOOL;
+      Value->Bool = true;
+      *Posn += 4;
+   } else if (Text.compare(*Posn,5,"false") == 0) {
+      Value->Type = JSON_BOOL;
+      Value->Bool = false;
+      *Posn += 5;
+   } else if (Text.compare(*Posn,4,"null") == 0) {
+      Value->Type = JSON_NULL;
+      *Posn += 4;
+   } else {
+      *ErrorText = "Invalid JSON value" + Where(*Posn);
+      return false;
+   }
+   return true;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                           P a r s e  S t r i n g
+//
+//  Parses a JSON string, which must start at *Posn with a double quote. The
+//  string is returned unquoted and with any escape sequences converted.
+
+static bool ParseString (
+   const std::string& Text,
+   size_t* Posn,
+   std::string* String,
+   std::string* ErrorText)
+{
+   size_t Start = *Posn;
+   String->clear();
+   (*Posn)++;
+   while (*Posn < Text.size()) {
+      unsigned char Char = Text[*Posn];
+      if (Char == '"') {
+         (*Posn)++;
+         return true;
+      }
+      if (Char < 0x20) {
+         *ErrorText = "Control character in JSON string" + Where(*Posn);
+         return false;
+      }
+      if (Char != '\\') {
+         *String += Char;
+         (*Posn)++;
+         continue;
+      }
+      if (*Posn + 1 >= Text.size()) break;
+      char Escape = Text[*Posn + 1];
+      *Posn += 2;
+      switch (Escape) {
+         case '"': *String += '"'; break;
+         case '\\': *String += '\\'; break;
+         case '/': *String += '/'; break;
+         case 'b': *String += '\b'; break;
+         case 'f': *String += '\f'; break;
+         case 'n': *String += '\n'; break;
+         case 'r': *String += '\r'; break;
+         case 't': *String += '\t'; break;
+         case 'u': {
+         
+            //  A \u escape gives a UTF-16 code unit. Characters outside the
+            //  basic plane come as a surrogate pair of two such escapes.
+            
+            unsigned Code;
+            if (!ParseHex4(Text,*Posn,&Code)) {
+               *ErrorText = "Invalid \\u escape in JSON string" + Where(*Posn);
+               return false;
+            }
+            *Posn += 4;
+            if (Code >= 0xD800 && Code <= 0xDBFF) {
+               unsigned Low;
+               if (Text.compare(*Posn,2,"\\u") != 0 ||
+                      !ParseHex4(Text,*Posn + 2,&Low) ||
+                                            Low < 0xDC00 || Low > 0xDFFF) {
+                  *ErrorText = "Invalid surrogate pair in JSON string"
+                                                               + Where(*Posn);
+                  return false;
+               }
+               *Posn += 6;
+               Code = 0x10000 + ((Code - 0xD800) << 10) + (Low - 0xDC00);
+            } else if (Code >= 0xDC00 && Code <= 0xDFFF) {
+               *ErrorText = "Invalid surrogate pair in JSON string"
+                                                               + Where(*Posn);
+               return false;
+            }
+            AppendUtf8(Code,String);
+            break;
+         }
+         default:
+            *ErrorText = "Invalid escape in JSON string" + Where(*Posn - 2);
+            return false;
+      }
+   }
+   *ErrorText = "Unterminated JSON string" + Where(Start);
+   return false;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                           P a r s e  N u m b e r
+//
+//  Parses a JSON number. This checks the number against the JSON syntax,
+//  which is stricter than that accepted by strtod() (no leading '+', no
+//  leading zeros, no hex, no 'inf' or 'nan'), and then uses strtod() to
+//  convert it.
+
+static bool ParseNumber (
+   const std::string& Text,
+   size_t* Posn,
+   double* Number,
+   std::string* ErrorText)
+{
+   size_t Start = *Posn;
+   size_t Index = Start;
+   size_t Size = Text.size();
+   bool Valid = true;
+   if (Index < Size && Text[Index] == '-') Index++;
+   if (Index < Size && Text[Index] == '0') {
+      Index++;
+   } else if (Index < Size && Text[Index] >= '1' && Text[Index] <= '9') {
+      while (Index < Size && Text[Index] >= '0' && Text[Index] <= '9') Index++;
+   } else {
+      Valid = false;
+   }
+   if (Valid && Index < Size && Text[Index] == '.') {
+      Index++;
+      if (Index >= Size || Text[Index] < '0' || Text[Index] > '9') Valid = false;
+      while (Index < Size && Text[Index] >= '0' && Text[Index] <= '9') Index++;
+   }
+   if (Valid && Index < Size && (Text[Index] == 'e' || Text[Index] == 'E')) {
+      Index++;
+      if (Index < Size && (Text[Index] == '+' || Text[Index] == '-')) Index++;
+      if (Index >= Size || Text[Index] < '0' || Text[Index] > '9') Valid = false;
+      while (Index < Size && Text[Index] >= '0' && Text[Index] <= '9') Index++;
+   }
+   if (!Valid) {
+      *ErrorText = "Invalid JSON number" + Where(Start);
+      return false;
+   }
+   std::string NumberText = Text.substr(Start,Index - Start);
+   *Number = strtod(NumberText.c_str(),NULL);
+   *Posn = Index;
+   return true;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                            P a r s e  H e x  4
+//
+//  Parses the four hex digits of a \u escape starting at Posn.
+
+static bool ParseHex4 (const std::string& Text, size_t Posn, unsigned* Code)
+{
+   if (Posn + 4 > Text.size()) return false;
+   *Code = 0;
+   for (size_t Index = Posn; Index < Posn + 4; Index++) {
+      char Char = Text[Index];
+      unsigned Digit;
+      if (Char >= '0' && Char <= '9') Digit = Char - '0';
+      else if (Char >= 'a' && Char <= 'f') Digit = Char - 'a' + 10;
+      else if (Char >= 'A' && Char <= 'F') Digit = Char - 'A' + 10;
+      else return false;
+      *Code = (*Code << 4) | Digit;
+   }
+   return true;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                           A p p e n d  U t f  8
+//
+//  Appends a Unicode code point to a string, encoded as UTF-8.
+
+static void AppendUtf8 (unsigned Code, std::string* String)
+{
+   if (Code < 0x80) {
+      *String += char(Code);
+   } else if (Code < 0x800) {
+      *String += char(0xC0 | (Code >> 6));
+      *String += char(0x80 | (Code & 0x3F));
+   } else if (Code < 0x10000) {
+      *String += char(0xE0 | (Code >> 12));
+      *String += char(0x80 | ((Code >> 6) & 0x3F));
+      *String += char(0x80 | (Code & 0x3F));
+   } else {
+      *String += char(0xF0 | (Code >> 18));
+      *String += char(0x80 | ((Code >> 12) & 0x3F));
+      *String += char(0x80 | ((Code >> 6) & 0x3F));
+      *String += char(0x80 | (Code & 0x3F));
+   }
+}
+
+// ----------------------------------------------------------------------------------
+
+//                                 W h e r e
+//
+//  Returns a string giving a character position in the text being parsed,
+//  for use in error messages. Positions are reported counting from 1.
+
+static std::string Where (size_t Posn)
+{
+   char Buffer[64];
+   snprintf (Buffer,sizeof(Buffer)," at character %lu",(unsigned long)(Posn + 1));
+   return Buffer;
+}
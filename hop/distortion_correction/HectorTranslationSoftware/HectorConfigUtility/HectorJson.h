@@ -0,0 +1,87 @@
+//
+//                        H e c t o r  J s o n . h
+//
+//  Function:
+//     A minimal JSON parser and formatter used by the HectorConfigUtil service.
+//
+//  Description:
+//     When HectorConfigUtil runs as a service (see the -serve option), each
+//     request it reads is a single line of JSON text, and each response it
+//     writes is another. The requests are small and simple - a single object
+//     with a handful of string, number and boolean members - and it seemed
+//     excessive to bring in a complete JSON package just to handle these.
+//     This file defines a small HectorJsonValue structure that can hold any
+//     JSON value, and a HectorJson class with static routines that parse a
+//     JSON text into one of these, look up object members by name, and format
+//     values, strings and numbers as JSON text for the responses.
+//
+//     A HectorJsonValue holds the elements of an array in its Items vector.
+//     An object is held the same way, with its member values in Items and
+//     the corresponding member names in the parallel Names vector, in the
+//     order in which they appeared in the text.
+//
+//  Author(s): Hector Observations Pipeline team, (HOP)
+//
+//  History:
+//     16th Oct 2026.  Original version. HOP.
+//
+// ----------------------------------------------------------------------------------
+
+#ifndef __HectorJson__
+#define __HectorJson__
+
+#include <string>
+#include <vector>
+
+//  The different types of JSON value.
+
+enum HectorJsonType {JSON_NULL,JSON_BOOL,JSON_NUMBER,JSON_STRING,
+                                                     JSON_ARRAY,JSON_OBJECT};
+
+//  A single JSON value, of any type.
+
+struct HectorJsonValue {
+   HectorJsonType Type = JSON_NULL;
+   bool Bool = false;
+   double Number = 0.0;
+   std::string String = "";
+   std::vector<HectorJsonValue> Items;
+   std::vector<std::string> Names;
+};
+
+class HectorJson {
+public:
+   //  Parse a JSON text, returning false and an error description if invalid.
+   static bool Parse (const std::string& Text, HectorJsonValue* Value,
+                                                      std::string* ErrorText);
+   //  Return a named member of an object, or NULL if there is no such member.
+   static const HectorJsonValue* Member (const HectorJsonValue& Object,
+                                                   const std::string& Name);
+   //  Return a JSON value formatted as JSON text.
+   static std::string Format (const HectorJsonValue& Value);
+   //  Return a string formatted as a quoted and escaped JSON string.
+   static std::string Quote (const std::string& String);
+   //  Return a number formatted for JSON. (Non-finite values become null.)
+   static std::string FormatNumber (double Number);
+   //  Return a description of a JSON value type, for use in error messages.
+   static std::string TypeName (HectorJsonType Type);
+};
+
+#endif
+
+// ----------------------------------------------------------------------------------
+
+/*                        P r o g r a m m i n g  N o t e s
+
+   o  This is deliberately minimal. It accepts any valid JSON text, but makes
+      no attempt to preserve the distinction between integers and reals, and
+      all numbers are held as doubles.
+
+   o  Parse() limits the nesting of arrays and objects to a depth of 64, which
+      is far more than any request needs, so that a malicious or corrupt input
+      line can't exhaust the stack through the recursion.
+
+   o  Strings are held as UTF-8. \u escapes (including surrogate pairs) are
+      converted to UTF-8 when parsed, but Quote() only escapes the characters
+      JSON requires to be escaped, leaving any other UTF-8 text as it is.
+*/
@@ -84,16 +84,138 @@
 //     23rd Nov 2021.  Following some confusion abput the precise orientation
 //                     of the XY coordinate system, introduced I_RotXyMatrix to
 //                     allow experimentation with rotating the coordinates. KS.
+//     16th Oct 2026.  Added RaDec2XYBatch() and XY2RaDecBatch(). Converting a
+//                     single position through TdfRd2xy() or TdfXy2rd() repeats
+//                     all the field centre calculations (slaAoppat(), the ZD
+//                     check and the field centre mount position) for every
+//                     position, and XY2RaDec() does this three times. The batch
+//                     routines use the new TdfFieldInit() to do this once per
+//                     call, and the body of the single position routines has
+//                     moved into ConvertRaDec2XY() and ConvertXY2RaDec() so
+//                     both sets of routines share the same code. HOP.
+//     16th Oct 2026.  Introduced the field transform plan, I_Plan. This is
+//                     built by BuildPlan() whenever Initialise() or
+//                     SetObsWavelength() changes the conversion parameters, and
+//                     holds everything that can be worked out in advance - the
+//                     field centre details and distortion model at the
+//                     observing wavelength, the normalized and inverted linear
+//                     model, the thermal expansion factors and the rotation
+//                     matrices. The conversion routines now take everything
+//                     from the plan, which replaces the TdfFieldType argument
+//                     added earlier today, and InitField() has gone. Split
+//                     ThermalOffset() into ThermalExpansion() and
+//                     ApplyThermalExpansion(). HOP.
+//     16th Oct 2026.  RaDec2XYBatch() now converts its positions in stages,
+//                     so that the distortion model can be applied to all of
+//                     them at once using TdfDistXyBatch(). The Hector specific
+//                     corrections have moved from ConvertRaDec2XY() into the
+//                     new CorrectPlateXY() so the two can share them. HOP.
+//     16th Oct 2026.  Pos2RaDec() now inverts the distortion model using
+//                     TdfDistXyInvNewton(), which iterates to a specified
+//                     tolerance instead of doing a fixed five iterations, and
+//                     keeps statistics on the iterations needed and the
+//                     residuals. Added SetInverseTolerance(), GetInverseStats()
+//                     and ResetInverseStats(), and the "Inverse" debug level. HOP.
+//     16th Oct 2026.  XY2RaDec() no longer converts each position to Ra,Dec
+//                     three times. TeleCorrFromXY() now works out the Hector
+//                     zone from the radius in the tangent plane, which needs
+//                     only the inversion of the distortion model, and returns
+//                     the tangent plane position of the corrected X,Y so that
+//                     ConvertXY2RaDec() only needs to convert that to Ra,Dec.
+//                     Pos2RaDec() is split into Pos2Tangent() and
+//                     Tangent2RaDec(), and TangentOffset() added. The zone
+//                     limits and offsets it shares with TelecentricityOffsetS()
+//                     are held in ZoneTable. XY2RaDecBatch() now converts its
+//                     positions in stages, as RaDec2XYBatch() does, so that the
+//                     distortion model can be inverted for all of them at once
+//                     by the new Pos2TangentBatch(), which uses
+//                     TdfDistXyInvBatch(). HOP.
+//     16th Oct 2026.  Added SetObservation(), which allows the converter to
+//                     be used for a different observing time without reading
+//                     the model files again or recalculating the apparent to
+//                     observed parameters. HOP.
+//     16th Oct 2026.  Added an optional fast approximation to the conversion
+//                     from Ra,Dec to 2dF field plate X,Y, a Chebyshev series
+//                     fitted over the field by BuildPlan() and only used if
+//                     checking it against the exact conversion shows it to be
+//                     accurate enough. Added SetSurrogate(), GetSurrogateError(),
+//                     FitSurrogate() and SurrogateRaDec2Pos(). HOP.
+//     16th Oct 2026.  The Ra,Dec to X,Y conversion routines are now const, and
+//                     report problems through a HectorConvStatus rather than
+//                     I_ErrorText, so that the new const RaDec2XYBatch() can
+//                     be used by several threads at once. The diagnostic check
+//                     that a position converts back correctly, which updates
+//                     the inversion statistics, has moved out of
+//                     CorrectPlateXY() into CheckRoundTrip(), called by the
+//                     non-const routines, and its running maximum is now kept
+//                     in I_MaxDiff rather than in a static variable. HOP.
+//     16th Oct 2026.  The Ra,Dec to X,Y conversions now give the 2dF routines
+//                     a thread local error context (see TdfErrSetContext())
+//                     so problems are recorded rather than reported through
+//                     Ers, and only formatted, by ConvErrorText(), if they
+//                     are going to be used. HOP.
+//     16th Oct 2026.  Added ReadModels() and CopyModels(). Initialise() no
+//                     longer reads the model files if the same ones have
+//                     already been read. HOP.
 //
 
 #include "HectorRaDecXY.h"
 
+#include <vector>
+
 //  Slalib is needed because the telecentricity code does some of its own
 //  calculations using SLA calls.
 
 #include "slalib.h"
 #include "slamac.h"
 
+//  The Hector zones, working outwards from the field centre. For each, this
+//  gives the field angle in degrees at its outer limit, the telecentricity
+//  (prism angle) offset in microns at its inner and outer limits, between
+//  which it varies linearly, and the mechanical offset in microns. (See
+//  TelecentricityOffsetS() for where these come from.) TelecentricityOffsetS()
+//  uses this to work out the zone and the offsets for a position, and
+//  TangentOffset() uses the limits to tell if a position is close enough to a
+//  zone boundary that the zone has to be determined using its Ra,Dec.
+
+struct HectorZoneDetails {
+   double OuterDeg;        // Field angle at the outer limit of the zone
+   double InnerOffset;     // Telecentricity offset at the inner limit
+   double OuterOffset;     // Telecentricity offset at the outer limit
+   double MechOffset;      // Mechanical offset throughout the zone
+};
+
+static const HectorZoneDetails ZoneTable[] = {
+   { 0.396,  31.0,  31.0, 117.3 },
+   { 0.627,  64.0,  64.0, 238.2 },
+   { 0.823,  94.0,  95.0, 346.8 },
+   { 1.0,   118.0, 116.0, 452.9 }
+};
+
+static const int NumZones = sizeof(ZoneTable) / sizeof(ZoneTable[0]);
+
+//  How close (in arc seconds) a position has to be to a zone boundary for
+//  TangentOffset() to use its Ra,Dec to determine the zone. The angle from
+//  the field centre as measured in the tangent plane differs from that
+//  between the apparent Ra,Dec positions because of differential refraction,
+//  but by no more than about 6 arc seconds even at a zenith distance of 70
+//  degrees, so this leaves a good margin.
+
+static const double ZoneGuardAsec = 20.0;
+
+//  The half-width, in degrees, of the square in the tangent plane covered by
+//  the surrogate conversion fitted by FitSurrogate(). This goes a little beyond
+//  the edge of the field (the outer zone limit). Positions outside it are
+//  always converted exactly.
+
+static const double SurrRadiusDeg = 1.05;
+
+//  The number of points along each side of the grid used by FitSurrogate() to
+//  check the surrogate conversion against the exact conversion. This is chosen
+//  so that none of the points coincide with the points used for the fit.
+
+static const int SurrCheckPoints = 64;
+
 // ----------------------------------------------------------------------------------
 
 //                          C o n s t r u c t o r
@@ -105,6 +227,7 @@
 HectorRaDecXY::HectorRaDecXY (void) : I_Debug("RaDec")
 {
    I_Initialised = false;
+   I_XYParsSet = false;
    I_Mjd = 0.0;
    I_Dut = 0.0;
    I_AtmosTemp = 0.0;
@@ -115,10 +238,19 @@ HectorRaDecXY::HectorRaDecXY (void) : I_Debug("RaDec")
    I_RobotTemp = 0.0;
    I_ObsTemp = 0.0;
    I_DistFilePath = "";
+   I_ModelsRead = false;
+   I_ModelDistPath = "";
+   I_ModelLinPath = "";
    I_ErrorText = "";
    I_EnableTelecentricity = true;
    I_EnableMechOffset = true;
    I_EnableLin = true;
+   I_InvTolerance = TDFXY_INV_TOL;
+   I_InvMaxIter = TDFXY_INV_MAXITER;
+   ResetInverseStats();
+   I_SurrTolerance = 0.0;
+   I_SurrOrder = HECTOR_SURR_ORDER;
+   I_MaxDiff = 0.0;
    
    //  The default rotation matrix is the identity matrix (as is its inverse,
    //  of course).
@@ -141,7 +273,8 @@ HectorRaDecXY::HectorRaDecXY (void) : I_Debug("RaDec")
    //  If new calls to I_Debug.Log() or I_Debug.Logf() are added, the levels
    //  they use need to be included in this list.
    
-   I_Debug.LevelsList("Diff,Offsets,Temp,DiffMax,Trace,TraceOne");
+   I_Debug.LevelsList(
+                "Diff,Offsets,Temp,DiffMax,Trace,TraceOne,Inverse,Surrogate");
    
 }
 
@@ -213,6 +346,7 @@ bool HectorRaDecXY::Initialise (
    StatusType Status = STATUS__OK;
    
    I_Initialised = false;
+   I_XYParsSet = false;
    
    I_CenRa = CenRa;
    I_CenDec = CenDec;
@@ -228,16 +362,12 @@ bool HectorRaDecXY::Initialise (
    I_DistFilePath = DistFilePath;
    I_LinFilePath = LinFilePath;
    
-   //  Try to read the distortion file and the linearity file.
+   //  Try to read the distortion file and the linearity file, unless they
+   //  have already been read, by ReadModels() or by CopyModels().
    
-   TdfGetDist(const_cast<char*>(DistFilePath.c_str()),&I_Dist,&Status);
-   if (Status != STATUS__OK) {
-      I_ErrorText = "Unable to open 2dF distortion file " + DistFilePath;
-   } else {
-      TdfGetLin(const_cast<char*>(LinFilePath.c_str()),&I_Lin,&Status);
-      if (Status != STATUS__OK) {
-         I_ErrorText = "Unable to open 2dF distortion file " + LinFilePath;
-      }
+   if (!I_ModelsRead || DistFilePath != I_ModelDistPath ||
+                                            LinFilePath != I_ModelLinPath) {
+      if (!ReadModels(DistFilePath,LinFilePath)) return false;
    }
    if (Status == STATUS__OK) {
    
@@ -278,8 +408,15 @@ bool HectorRaDecXY::Initialise (
             "Failed to initialise XT conversion routines - " + StatusText;
       }
    } else {
-      I_Initialised = true;
-      ReturnOK = true;
+   
+      //  Work out everything the conversion routines need that doesn't depend
+      //  on the position being converted.
+      
+      I_XYParsSet = true;
+      if (BuildPlan()) {
+         I_Initialised = true;
+         ReturnOK = true;
+      }
    }
    
    return ReturnOK;
@@ -287,6 +424,128 @@ bool HectorRaDecXY::Initialise (
 
 // ----------------------------------------------------------------------------------
 
+//                            R e a d  M o d e l s
+//
+//  Reads the 2dF distortion and linearity models from the specified SDS files.
+//  Initialise() calls this itself if it hasn't already been called for the
+//  same files, so this only needs to be called explicitly if the models are
+//  to be read before Initialise() can be called, for example so they can be
+//  passed on to other converters using CopyModels().
+//
+//  DisFilePath The path for the 2dF distortion file to use.
+//  LinFilePath The path for the 2dF linearity file to use.
+
+bool HectorRaDecXY::ReadModels (
+   const std::string& DistFilePath, const std::string& LinFilePath)
+{
+   StatusType Status = STATUS__OK;
+   
+   I_ModelsRead = false;
+   TdfGetDist(const_cast<char*>(DistFilePath.c_str()),&I_Dist,&Status);
+   if (Status != STATUS__OK) {
+      I_ErrorText = "Unable to open 2dF distortion file " + DistFilePath;
+   } else {
+      TdfGetLin(const_cast<char*>(LinFilePath.c_str()),&I_Lin,&Status);
+      if (Status != STATUS__OK) {
+         I_ErrorText = "Unable to open 2dF distortion file " + LinFilePath;
+      }
+   }
+   if (Status == STATUS__OK) {
+      I_ModelDistPath = DistFilePath;
+      I_ModelLinPath = LinFilePath;
+      I_ModelsRead = true;
+   }
+   return I_ModelsRead;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                            C o p y  M o d e l s
+//
+//  Copies the 2dF distortion and linearity models already read by another
+//  converter (using ReadModels() or Initialise()), so that a subsequent
+//  call to Initialise() for the same model files doesn't need to read them.
+//  If the source converter hasn't read any models, this does nothing.
+
+void HectorRaDecXY::CopyModels (const HectorRaDecXY& Source)
+{
+   if (Source.I_ModelsRead) {
+      I_Dist = Source.I_Dist;
+      I_Lin = Source.I_Lin;
+      I_ModelDistPath = Source.I_ModelDistPath;
+      I_ModelLinPath = Source.I_ModelLinPath;
+      I_ModelsRead = true;
+   }
+}
+
+// ----------------------------------------------------------------------------------
+
+//                         S e t  O b s e r v a t i o n
+//
+//  Changes the time of the observation, and the temperatures that depend on it,
+//  so the same converter can be used to calculate positions for a number of
+//  possible observing times (eg when trying to find the best time at which to
+//  observe a field). The distortion and linearity models are not read again.
+//  If only the time changes, only the time-dependent part of the apparent to
+//  observed parameters - the local sidereal time and the equation of the
+//  equinoxes - needs to be updated, using TdfXyNewTime(). A change to the
+//  atmospheric temperature changes the refraction, and then the parameters
+//  are recalculated in full using TdfXyInit(). The plate temperatures only
+//  affect the thermal expansion factors held in the plan. If the new details
+//  cannot be used - for example, if the field is too close to the horizon at
+//  the new time - this returns false and the converter cannot be used until
+//  a later call to SetObservation() succeeds.
+//
+//  CenRa       Apparent Ra of the field centre at the new time, in radians.
+//  CenDec      Apparent Dec of the field centre at the new time, in radians.
+//  Mjd         UTC observing date and time as modified julian date.
+//  AtmosTemp   Atmospheric temperature (K) for observation.
+//  RobotTemp   Temperature of plate when configured by robot (K).
+//  ObsTemp     Temperature of plate during observation (K).
+
+bool HectorRaDecXY::SetObservation (
+   double CenRa, double CenDec, double Mjd,
+   double AtmosTemp, double RobotTemp, double ObsTemp)
+{
+   bool ReturnOK = false;
+   
+   if (!I_XYParsSet) {
+      I_ErrorText =
+         "Cannot modify observation details - Conversion routines not initialised";
+   } else {
+   
+      StatusType Status = STATUS__OK;
+      I_Initialised = false;
+      double OldMjd = I_Mjd;
+      I_CenRa = CenRa;
+      I_CenDec = CenDec;
+      I_Mjd = Mjd;
+      I_RobotTemp = RobotTemp;
+      I_ObsTemp = ObsTemp;
+      if (AtmosTemp == I_AtmosTemp) {
+         if (Mjd != OldMjd) TdfXyNewTime (&I_XYPars,OldMjd,Mjd);
+      } else {
+         I_AtmosTemp = AtmosTemp;
+         TdfXyInit (I_Mjd,I_Dut,I_AtmosTemp,I_Press,I_Humid,I_CenWave,I_ObsWave,
+                 0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,
+                 I_Dist,&I_XYPars,&Status);
+      }
+      if (Status != STATUS__OK) {
+         std::string StatusText = StatusToText(Status);
+         if (StatusText == "") StatusText = "Unexpected error";
+         I_ErrorText =
+            "Failed to initialise XT conversion routines - " + StatusText;
+         I_XYParsSet = false;
+      } else if (BuildPlan()) {
+         I_Initialised = true;
+         ReturnOK = true;
+      }
+   }
+   return ReturnOK;
+}
+
+// ----------------------------------------------------------------------------------
+
 //                       S e t  O b s  W a v e l e n g t h
 
 //  Changes the observing wavelength being used. This needs to be called before
@@ -316,6 +575,8 @@ bool HectorRaDecXY::SetObsWavelength (double ObsWave)
             I_ErrorText =
                "Failed to initialise XT conversion routines - " + StatusText;
             I_Initialised = false;
+         } else if (!BuildPlan()) {
+            I_Initialised = false;
          } else {
             ReturnOK = true;
          }
@@ -400,57 +661,80 @@ bool HectorRaDecXY::XY2RaDec (
       I_ErrorText =
          "Cannot convert X,Y to Ra,Dec - Conversion routines not initialised";
    } else {
+      ReturnOK = ConvertXY2RaDec (X,Y,Ra,Dec,I_Plan);
+   }
+   return ReturnOK;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                     C o n v e r t  X Y  2  R a  D e c
+//
+//  Does the actual work for XY2RaDec() and XY2RaDecBatch(), using the
+//  transformation details in the plan set up by BuildPlan(). The caller is
+//  expected to have checked that the conversion routines have been initialised.
+//
+//  X       Field plate X coordinate in microns.
+//  Y       Field plate Y coordinate in microns.
+//  Ra      Calculated apparent RA in radians.
+//  Dec     Calculated apparent Dec in radians.
+//  Plan    The field transform plan, normally I_Plan.
+
+bool HectorRaDecXY::ConvertXY2RaDec (
+   double X, double Y, double* Ra, double* Dec, const HectorXYPlan& Plan)
+{
+   bool ReturnOK = false;
    
-      //  Apply the rotation matrix introduced to allow for experimentation
-      //  with the plate coordinate axes.
-      
-      I_Debug.Logf ("Trace","In XY2RaDec, X Y %f %f",X,Y);
-      double XRot,YRot;
-      XRot = (X * I_RotXyMat[0]) + (Y * I_RotXyMat[1]);
-      YRot = (X * I_RotXyMat[2]) + (Y * I_RotXyMat[3]);
-      I_Debug.Logf ("Trace","In XY2RaDec, axis rotation gives X, Y %f %f\n",
-                                                                  XRot,YRot);
-   
-      //  The X,Y positions will be those set by the robot during configuration,
-      //  but these will need to be modified to allow for thermal expansion.
-      
-      double CorrX,CorrY;
-      ThermalOffset (XRot,YRot,I_ObsTemp,I_RobotTemp,I_CTE,&CorrX,&CorrY,&I_Debug);
-      double LocalX = CorrX;
-      double LocalY = CorrY;
-      I_Debug.Logf ("Trace","In XY2RaDec, Thermal offset: %f %f X Y now %f %f",
-                                    CorrX - XRot,CorrY - YRot,CorrX,CorrY);
-
-      //  Now apply the telecentricity correction.
-
-      //  The sequence performed by TeleCorrFromXY() is actually quite
-      //  messy. It's being passed X and Y and an initial estimate at Ra,Dec.
-      //  It's going to use that initial Ra,Dec position to work out the
-      //  Hector magnet zone and hence the offset in X & Y. It will then
-      //  apply that offset to the X,Y value it's passed and call TdfXy2rd()
-      //  again to get a new Ra,Dec that has taken the magnet offset into
-      //  account. Not only that, it will then use that new Ra,Dec value to
-      //  redetermine the zone, to see if applying the offset has moved the
-      //  resulting Ra,Dec position into a different zone (which happens very
-      //  rarely, for positions right on the zone boundaries). If so, it will
-      //  recalculate the offset on the basis of that changed zone - and that
-      //  will involve yet another call to TdfXy2rd().
-      
-      if (TeleCorrFromXY (LocalX,LocalY,&CorrX,&CorrY)) {
+   //  Apply the rotation matrix introduced to allow for experimentation
+   //  with the plate coordinate axes.
+   
+   I_Debug.Logf ("Trace","In XY2RaDec, X Y %f %f",X,Y);
+   double XRot,YRot;
+   XRot = (X * Plan.RotXyMat[0]) + (Y * Plan.RotXyMat[1]);
+   YRot = (X * Plan.RotXyMat[2]) + (Y * Plan.RotXyMat[3]);
+   I_Debug.Logf ("Trace","In XY2RaDec, axis rotation gives X, Y %f %f\n",
+                                                               XRot,YRot);
+
+   //  The X,Y positions will be those set by the robot during configuration,
+   //  but these will need to be modified to allow for thermal expansion.
+   
+   double CorrX,CorrY;
+   PlanThermalOffset (XRot,YRot,false,Plan,&CorrX,&CorrY);
+   double LocalX = CorrX;
+   double LocalY = CorrY;
+   I_Debug.Logf ("Trace","In XY2RaDec, Thermal offset: %f %f X Y now %f %f",
+                                 CorrX - XRot,CorrY - YRot,CorrX,CorrY);
+
+   //  Now apply the telecentricity correction.
+
+   //  TeleCorrFromXY() uses the position to work out the Hector magnet
+   //  zone and hence the offset in X & Y. It then applies that offset to
+   //  the X,Y value it's passed and inverts the distortion model again
+   //  to get the tangent plane position that has taken the magnet offset
+   //  into account. It then checks to see if applying the offset has moved
+   //  the position into a different zone (which happens very rarely, for
+   //  positions right on the zone boundaries). If so, it will recalculate
+   //  the offset on the basis of that changed zone. The zones are worked out
+   //  from the tangent plane positions, so all this can be done without
+   //  any conversions to Ra,Dec, and only the final tangent plane position
+   //  has to be converted.
+   
+   double Xi,Eta;
+   if (TeleCorrFromXY (LocalX,LocalY,&CorrX,&CorrY,&Xi,&Eta,Plan)) {
+      I_Debug.Logf ("Trace",
+               "In XY2RaDec, TeleCorrfromXY %f %f X Y now %f %f",
+                        CorrX - LocalX,CorrY - LocalY,CorrX,CorrY);
+      LocalX = CorrX;
+      LocalY = CorrY;
+
+      //  Convert the tangent plane position of this X,Y position (as
+      //  corrected) to the equivalent Ra,Dec.
+   
+      if (Tangent2RaDec (Xi,Eta,Ra,Dec,Plan)) {
          I_Debug.Logf ("Trace",
-                  "In XY2RaDec, TeleCorrfromXY %f %f X Y now %f %f",
-                           CorrX - LocalX,CorrY - LocalY,CorrX,CorrY);
-         LocalX = CorrX;
-         LocalY = CorrY;
-
-         //  Convert this X,Y position (as corrected) to the equivalent Ra,Dec.
-      
-         if (Pos2RaDec (LocalX,LocalY,Ra,Dec)) {
-            I_Debug.Logf ("Trace",
-               "In XY2RaDec, Finally, X Y %f %f gives Ra,Dec %f %f",
-                                                  LocalX,LocalY,*Ra,*Dec);
-            ReturnOK = true;
-         }
+            "In XY2RaDec, Finally, X Y %f %f gives Ra,Dec %f %f",
+                                               LocalX,LocalY,*Ra,*Dec);
+         ReturnOK = true;
       }
    }
    return ReturnOK;
@@ -481,87 +765,677 @@ bool HectorRaDecXY::RaDec2XY (
       I_ErrorText =
          "Cannot convert Ra,Dec to X,Y - Conversion routines not initialised";
    } else {
+      HectorConvStatus Status;
+      ReturnOK = ConvertRaDec2XY (Ra,Dec,X,Y,I_Plan,&Status);
+      if (ReturnOK) {
+         CheckRoundTrip (Ra,Dec,*X,*Y);
+      } else {
+         I_ErrorText = Status.Error;
+      }
+   }
+   if (I_Debug.Active("TraceOne")) I_Debug.UnsetLevels("Trace");
+
+   return ReturnOK;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                     C o n v e r t  R a  D e c  2  X Y
+//
+//  Does the actual work for RaDec2XY() and RaDec2XYBatch(), using the
+//  transformation details in the plan set up by BuildPlan(). The caller is
+//  expected to have checked that the conversion routines have been initialised.
+//  This is const, and if there is a problem it is described in the status
+//  structure passed, so this can be used by several threads at once.
+//
+//  Ra      Apparent RA in radians.
+//  Dec     Apparent Dec in radians.
+//  X       Calculated field plate X coordinate in microns.
+//  Y       Calculated field plate Y coordinate in microns.
+//  Plan    The field transform plan, normally I_Plan.
+//  Status  Set to describe the problem if the conversion fails (and it
+//          doesn't already describe an earlier one).
+
+bool HectorRaDecXY::ConvertRaDec2XY (
+   double Ra, double Dec, double* X, double* Y, const HectorXYPlan& Plan,
+   HectorConvStatus* Status) const
+{
+   bool ReturnOK = false;
    
-      //  Apply the standard 2dF coordinate conversions, including the
-      //  linearity correction (if enabled, which it usually will be).
+   //  Apply the standard 2dF coordinate conversions, including the
+   //  linearity correction (if enabled, which it usually will be). If there
+   //  is an accurate enough approximation to these, that is used instead.
+   
+   bool PosOK = SurrogateRaDec2Pos (Ra,Dec,X,Y,Plan);
+   if (!PosOK) PosOK = RaDec2Pos (Ra,Dec,X,Y,Plan,Status);
+   if (PosOK) {
+      CorrectPlateXY (Ra,Dec,X,Y,Plan);
+      ReturnOK = true;
+   }
+
+   return ReturnOK;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                      C o r r e c t  P l a t e  X Y
+//
+//  Takes the X,Y position on the field plate produced by the standard 2dF
+//  coordinate conversions (RaDec2Pos()) for a given Ra,Dec and applies the
+//  Hector-specific corrections - telecentricity and magnet offset, thermal
+//  expansion and the axis rotation - to give the X,Y position the robot needs
+//  to use. This is the second half of ConvertRaDec2XY(), split out so that
+//  RaDec2XYBatch() can do the 2dF conversions for all its positions first.
+//
+//  Ra      Apparent RA in radians.
+//  Dec     Apparent Dec in radians.
+//  X       Field plate X coordinate in microns, as from RaDec2Pos(). Returned
+//          with all the corrections applied.
+//  Y       Field plate Y coordinate in microns, as from RaDec2Pos(). Returned
+//          with all the corrections applied.
+//  Plan    The field transform plan, normally I_Plan.
+
+void HectorRaDecXY::CorrectPlateXY (
+   double Ra, double Dec, double* X, double* Y, const HectorXYPlan& Plan) const
+{
+   I_Debug.Logf ("Trace",
+           "In RaDec2XY, RaDec2Pos: Ra, Dec %f %f, X Y %f %f",
+                                                     Ra,Dec,*X,*Y);
+
+   //  Apply the telecentricity and magnet offset correction. Note that
+   //  this uses the Ra,Dec position of the target to determine the zone
+   //  and hence the mechanical characteristics of the Hector magnet.
+   //  There may be issues near a zone boundary, where a magnet for
+   //  either zone might be used, but where each would need a different
+   //  X,Y position, as their offsets would be different. However, this
+   //  code always picks the zone strictly on the basis of the Ra,Dec
+   //  position.
+   
+   double CorrX,CorrY;
+   TeleCorrFromRaDec (Ra,Dec,*X,*Y,&CorrX,&CorrY);
+   I_Debug.Logf ("Trace",
+         "In RaDec2XY, TelleCorrFromRaDec: %f %f X Y now %f %f",
+                                 CorrX - *X,CorrY - *Y,CorrX,CorrY);
+   *X = CorrX;
+   *Y = CorrY;
+
+   //  The X,Y position will be that at observing time and at observing
+   //  temp. We need the position the robot will use at configuration
+   //  time.
+   
+   PlanThermalOffset (*X,*Y,true,Plan,&CorrX,&CorrY);
+   I_Debug.Logf ("Trace",
+          "In RaDec2XY, Thermal offset: %f %f X Y now %f %f",
+                                 CorrX - *X,CorrY - *Y,CorrX,CorrY);
+   *X = CorrX;
+   *Y = CorrY;
+   
+   //  Apply the inverse rotation matrix so this X,Y result is in the
+   //  same coordinate orientation as is used for the sky fibre positions.
+   
+   double XRot = *X;
+   double YRot = *Y;
+   *X = (XRot * Plan.RotXyInv[0]) + (YRot * Plan.RotXyInv[1]);
+   *Y = (XRot * Plan.RotXyInv[2]) + (YRot * Plan.RotXyInv[3]);
+   I_Debug.Logf ("Trace",
+      "In RaDec2XY, axis rotation %f %f X Y now %f %f",XRot,YRot,*X,*Y);
+}
+
+// ----------------------------------------------------------------------------------
+
+//                       C h e c k  R o u n d  T r i p
+//
+//  Just for fun, converts the X,Y position calculated for an Ra,Dec position
+//  back to Ra,Dec and compares the two. This at least checks if the coordinate
+//  conversion code can be reversed accurately enough. This only does anything
+//  if the "Diff" or "DiffMax" debug levels are active. It keeps track of the
+//  largest difference seen in I_MaxDiff, and the conversion back to Ra,Dec
+//  updates the inversion statistics, so unlike the conversion routines this
+//  is not const. It is called by the non-const RaDec2XY() and RaDec2XYBatch().
+//
+//  Ra      Apparent RA in radians.
+//  Dec     Apparent Dec in radians.
+//  X       Field plate X coordinate in microns calculated from Ra,Dec.
+//  Y       Field plate Y coordinate in microns calculated from Ra,Dec.
+
+void HectorRaDecXY::CheckRoundTrip (double Ra, double Dec, double X, double Y)
+{
+   if (I_Debug.Active("Diff") || I_Debug.Active("DiffMax")) {
+      double Ra2,Dec2;
+      double MdiffWas = I_MaxDiff;
+      ConvertXY2RaDec (X,Y,&Ra2,&Dec2,I_Plan);
+      if (fabs(Ra2-Ra) > I_MaxDiff) I_MaxDiff = fabs(Ra2-Ra);
+      if (fabs(Dec2-Dec) > I_MaxDiff) I_MaxDiff = fabs(Dec2-Dec);
+      char Text[1024];
+      snprintf (Text,sizeof(Text),
+            "Ra,Dec [%f,%f] -> [%f,%f] -> Ra2,Dec2 [%f,%f]"
+            " differences: [%f,%f] max diff %f (asec)",
+            Ra,Dec,X,Y,Ra2,Dec2,fabs(Ra2-Ra) * DR2D * 3600.0,
+                   fabs(Dec2-Dec) * DR2D * 3600.0, I_MaxDiff * DR2D * 3600.0);
+      I_Debug.Log("Diff",std::string(Text));
+      if (I_MaxDiff > MdiffWas) {
+         I_Debug.Logf("DiffMax","Maximum difference now %f (asec)",
+                                              I_MaxDiff * DR2D * 3600.0);
+      }
+   }
+}
+
+// ----------------------------------------------------------------------------------
+
+//                       R a  D e c  2  X Y  B a t c h
+//
+//  Converts an array of apparent RA,Dec positions on the sky to X,Y coordinates
+//  on the field plate. Each position is converted exactly as it would be by
+//  RaDec2XY(), but the conversion is done in stages, each stage being applied
+//  to all the positions before moving on to the next. This allows the 2dF
+//  distortion model to be applied to all the positions at once, using
+//  TdfDistXyBatch(), which can use vector instructions. Each element of
+//  Converted is set true if that position was converted successfully. If any
+//  position could not be converted, this routine returns false, and GetError()
+//  will describe the problem with the first such position. Positions after a
+//  failed position are still converted.
+//
+//  Ra        Array of apparent RA values in radians.
+//  Dec       Array of apparent Dec values in radians.
+//  NPosns    Number of positions to convert.
+//  X         Array to receive the field plate X coordinates in microns.
+//  Y         Array to receive the field plate Y coordinates in microns.
+//  Converted Array set to show which positions were converted successfully.
+
+bool HectorRaDecXY::RaDec2XYBatch (
+   const double Ra[], const double Dec[], int NPosns,
+   double X[], double Y[], bool Converted[])
+{
+   //  The const version does all the work. TraceOne means only the first
+   //  conversion should be traced, so if it is set the first position is
+   //  converted on its own, and tracing turned off for the rest.
+   
+   HectorConvStatus Status;
+   int First = 0;
+   if (I_Debug.Active("TraceOne") && NPosns > 1) {
+      RaDec2XYBatch (Ra,Dec,1,X,Y,Converted,&Status);
+      I_Debug.UnsetLevels("Trace");
+      First = 1;
+   }
+   RaDec2XYBatch (Ra + First,Dec + First,NPosns - First,X + First,Y + First,
+                                                   Converted + First,&Status);
+   if (I_Debug.Active("TraceOne")) I_Debug.UnsetLevels("Trace");
+   if (!Status.Ok) I_ErrorText = Status.Error;
+   for (int IPosn = 0; IPosn < NPosns; IPosn++) {
+      if (Converted[IPosn]) CheckRoundTrip (Ra[IPosn],Dec[IPosn],X[IPosn],Y[IPosn]);
+   }
+   return Status.Ok;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                       R a  D e c  2  X Y  B a t c h
+//
+//  A const version of RaDec2XYBatch(), which converts the positions in exactly
+//  the same way, but instead of setting I_ErrorText if there is a problem, it
+//  describes the first problem in a HectorConvStatus structure passed by the
+//  caller. This doesn't modify the object in any way, so once the object has
+//  been initialised, any number of threads can use this at the same time, so
+//  long as each passes its own status structure and output arrays and nothing
+//  calls any of the non-const routines (including Initialise(), SetObservation()
+//  etc.) while they are doing so. The diagnostic round trip check performed
+//  by the non-const version for the "Diff" debug level is not performed.
+//
+//  Ra        Array of apparent RA values in radians.
+//  Dec       Array of apparent Dec values in radians.
+//  NPosns    Number of positions to convert.
+//  X         Array to receive the field plate X coordinates in microns.
+//  Y         Array to receive the field plate Y coordinates in microns.
+//  Converted Array set to show which positions were converted successfully.
+//  Status    Set to describe the problem with the first position that could
+//            not be converted, unless it already describes an earlier problem.
+
+bool HectorRaDecXY::RaDec2XYBatch (
+   const double Ra[], const double Dec[], int NPosns,
+   double X[], double Y[], bool Converted[], HectorConvStatus* Status) const
+{
+   bool ReturnOK = false;
+   
+   for (int IPosn = 0; IPosn < NPosns; IPosn++) Converted[IPosn] = false;
+   
+   if (!I_Initialised) {
+      if (Status->Ok) {
+         Status->Ok = false;
+         Status->Error =
+            "Cannot convert Ra,Dec to X,Y - Conversion routines not initialised";
+      }
+   } else if (I_Plan.Surrogate.Usable) {
+   
+      //  If the fast approximation to the 2dF conversions is being used, there
+      //  is nothing to gain from doing them in stages, and each position is
+      //  just converted in turn.
       
-      if (RaDec2Pos (Ra,Dec,X,Y)) {
-         I_Debug.Logf ("Trace",
-                 "In RaDec2XY, RaDec2Pos: Ra, Dec %f %f, X Y %f %f",
-                                                           Ra,Dec,*X,*Y);
+      ReturnOK = true;
+      for (int IPosn = 0; IPosn < NPosns; IPosn++) {
+         Converted[IPosn] = ConvertRaDec2XY (Ra[IPosn],Dec[IPosn],
+                                        &X[IPosn],&Y[IPosn],I_Plan,Status);
+         if (!Converted[IPosn]) ReturnOK = false;
+      }
+   } else {
+   
+      //  First, the tangent plane positions. This is the same as the first
+      //  part of TdfRd2xyQk(), and is the only stage that can fail. The 2dF
+      //  routines don't declare the parameters they only read as const.
       
-         //  Apply the telecentricity and magnet offset correction. Note that
-         //  this uses the Ra,Dec position of the target to determine the zone
-         //  and hence the mechanical characteristics of the Hector magnet.
-         //  There may be issues near a zone boundary, where a magnet for
-         //  either zone might be used, but where each would need a different
-         //  X,Y position, as their offsets would be different. However, this
-         //  code always picks the zone strictly on the basis of the Ra,Dec
-         //  position.
-         
-         double CorrX,CorrY;
-         TeleCorrFromRaDec (Ra,Dec,*X,*Y,&CorrX,&CorrY);
-         I_Debug.Logf ("Trace",
-               "In RaDec2XY, TelleCorrFromRaDec: %f %f X Y now %f %f",
-                                       CorrX - *X,CorrY - *Y,CorrX,CorrY);
-         *X = CorrX;
-         *Y = CorrY;
-
-         //  The X,Y position will be that at observing time and at observing
-         //  temp. We need the position the robot will use at configuration
-         //  time.
-         
-         ThermalOffset (*X,*Y,I_RobotTemp,I_ObsTemp,I_CTE,&CorrX,&CorrY, &I_Debug);
-         I_Debug.Logf ("Trace",
-                "In RaDec2XY, Thermal offset: %f %f X Y now %f %f",
-                                       CorrX - *X,CorrY - *Y,CorrX,CorrY);
-         *X = CorrX;
-         *Y = CorrY;
-         
-         //  Apply the inverse rotation matrix so this X,Y result is in the
-         //  same coordinate orientation as is used for the sky fibre positions.
-         
-         double XRot = *X;
-         double YRot = *Y;
-         *X = (XRot * I_RotXyInv[0]) + (YRot * I_RotXyInv[1]);
-         *Y = (XRot * I_RotXyInv[2]) + (YRot * I_RotXyInv[3]);
-         I_Debug.Logf ("Trace",
-            "In RaDec2XY, axis rotation %f %f X Y now %f %f",XRot,YRot,*X,*Y);
-
-         //  Just for fun, convert that back to Ra Dec and compare. This at
-         //  least checks if the coordinate conversion code can be reversed
-         //  accurately enough.
-         
-         if (I_Debug.Active("Diff") || I_Debug.Active("DiffMax")) {
-            double Ra2,Dec2;
-            static double Mdiff = 0.0;
-            double MdiffWas = Mdiff;
-            XY2RaDec (*X,*Y,&Ra2,&Dec2);
-            if (fabs(Ra2-Ra) > Mdiff) Mdiff = fabs(Ra2-Ra);
-            if (fabs(Dec2-Dec) > Mdiff) Mdiff = fabs(Dec2-Dec);
-            char Text[1024];
-            snprintf (Text,sizeof(Text),
-                  "Ra,Dec [%f,%f] -> [%f,%f] -> Ra2,Dec2 [%f,%f]"
-                  " differences: [%f,%f] max diff %f (asec)",
-                  Ra,Dec,*X,*Y,Ra2,Dec2,fabs(Ra2-Ra) * DR2D * 3600.0,
-                         fabs(Dec2-Dec) * DR2D * 3600.0, Mdiff * DR2D * 3600.0);
-            I_Debug.Log("Diff",std::string(Text));
-            if (Mdiff > MdiffWas) {
-               I_Debug.Logf("DiffMax","Maximum difference now %f (asec)",
-                                                    Mdiff * DR2D * 3600.0);
+      ReturnOK = true;
+      TdfXyType* XYPars = const_cast<TdfXyType*>(&I_XYPars);
+      std::vector<double> Xi(NPosns,0.0);
+      std::vector<double> Eta(NPosns,0.0);
+      TdfErrType Report;
+      TdfErrType* PrevReport = TdfErrSetContext (&Report);
+      for (int IPosn = 0; IPosn < NPosns; IPosn++) {
+         StatusType TdfStatus = STATUS__OK;
+         TdfRd2tanQk (XYPars,&I_Plan.Field,Ra[IPosn],Dec[IPosn],
+                                           &Xi[IPosn],&Eta[IPosn],&TdfStatus);
+         if (TdfStatus == STATUS__OK) {
+            Converted[IPosn] = true;
+         } else {
+            ReturnOK = false;
+            if (Status->Ok) {
+               Status->Ok = false;
+               Status->Error = ConvErrorText(TdfStatus,Report);
             }
          }
-         
-         ReturnOK = true;
+      }
+      TdfErrSetContext (PrevReport);
+      
+      //  Then the distortion model, for all the positions at once. Any that
+      //  failed just have a tangent plane position of 0,0, which does no harm.
+      
+      TdfDistXyBatch (&I_Plan.Field,NPosns,Xi.data(),Eta.data(),X,Y);
+      
+      //  And then the linearity correction (which completes what RaDec2Pos()
+      //  does) and the Hector corrections for each position in turn.
+      
+      for (int IPosn = 0; IPosn < NPosns; IPosn++) {
+         if (Converted[IPosn]) {
+            if (I_EnableLin) {
+               double LinCorrX = X[IPosn];
+               double LinCorrY = Y[IPosn];
+               TdfXy2posQk (&I_Plan.Lin,LinCorrX,LinCorrY,&X[IPosn],&Y[IPosn]);
+            }
+            CorrectPlateXY (Ra[IPosn],Dec[IPosn],&X[IPosn],&Y[IPosn],I_Plan);
+         }
       }
    }
-   if (I_Debug.Active("TraceOne")) I_Debug.UnsetLevels("Trace");
+   return ReturnOK;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                       X Y  2  R a  D e c  B a t c h
+//
+//  Converts an array of X,Y coordinates on the field plate to apparent RA,Dec
+//  positions on the sky. This is the batch equivalent of XY2RaDec(), in the
+//  same way that RaDec2XYBatch() is the batch equivalent of RaDec2XY(), and
+//  the same notes apply. The stages are those of ConvertXY2RaDec() and
+//  TeleCorrFromXY(), and the distortion model is inverted for all the
+//  positions at once, twice - before and after the telecentricity offset is
+//  applied - by Pos2TangentBatch(), which can use vector instructions. If
+//  the "Trace" debug level is set, the positions are converted one at a time,
+//  so that each can be followed through. Note that, as for XY2RaDec(), the
+//  telecentricity and mechanical offsets should be disabled before this is
+//  used for sky fibres.
+//
+//  X         Array of field plate X coordinates in microns.
+//  Y         Array of field plate Y coordinates in microns.
+//  NPosns    Number of positions to convert.
+//  Ra        Array to receive the apparent RA values in radians.
+//  Dec       Array to receive the apparent Dec values in radians.
+//  Converted Array set to show which positions were converted successfully.
+
+bool HectorRaDecXY::XY2RaDecBatch (
+   const double X[], const double Y[], int NPosns,
+   double Ra[], double Dec[], bool Converted[])
+{
+   bool ReturnOK = false;
+   
+   for (int IPosn = 0; IPosn < NPosns; IPosn++) Converted[IPosn] = false;
+   
+   if (!I_Initialised) {
+      I_ErrorText =
+         "Cannot convert X,Y to Ra,Dec - Conversion routines not initialised";
+   } else if (I_Debug.Active("Trace")) {
+      ReturnOK = true;
+      std::string FirstError = "";
+      for (int IPosn = 0; IPosn < NPosns; IPosn++) {
+         Converted[IPosn] = ConvertXY2RaDec (X[IPosn],Y[IPosn],
+                                       &Ra[IPosn],&Dec[IPosn],I_Plan);
+         if (!Converted[IPosn] && ReturnOK) {
+            FirstError = I_ErrorText;
+            ReturnOK = false;
+         }
+      }
+      if (!ReturnOK) I_ErrorText = FirstError;
+   } else {
+   
+      //  The problems are found in different stages, so this keeps the
+      //  description of the one with the first position that failed.
+      
+      int FirstFailed = NPosns;
+      std::string FirstError = "";
+      auto Failed = [&](int IPosn) {
+         if (IPosn < FirstFailed) {
+            FirstFailed = IPosn;
+            FirstError = I_ErrorText;
+         }
+      };
+      
+      //  First, the axis rotation and the thermal expansion, as in
+      //  ConvertXY2RaDec(), and then the tangent plane position of each of
+      //  the resulting X,Y positions, which TeleCorrFromXY() uses to find
+      //  the Hector zone.
+      
+      std::vector<double> LocalX(NPosns),LocalY(NPosns);
+      for (int IPosn = 0; IPosn < NPosns; IPosn++) {
+         double XRot = (X[IPosn] * I_Plan.RotXyMat[0]) +
+                                              (Y[IPosn] * I_Plan.RotXyMat[1]);
+         double YRot = (X[IPosn] * I_Plan.RotXyMat[2]) +
+                                              (Y[IPosn] * I_Plan.RotXyMat[3]);
+         PlanThermalOffset (XRot,YRot,false,I_Plan,&LocalX[IPosn],&LocalY[IPosn]);
+      }
+      std::vector<double> PosXi(NPosns),PosEta(NPosns);
+      Pos2TangentBatch (NPosns,LocalX.data(),LocalY.data(),PosXi.data(),
+                                                        PosEta.data(),I_Plan);
+      
+      //  Then the telecentricity offset for each of those, and the X,Y without
+      //  it. Only the positions where this works go on to the next stages, and
+      //  Index gives the position each of those started as.
+      
+      std::vector<int> Index,Zone;
+      std::vector<double> NewX,NewY;
+      for (int IPosn = 0; IPosn < NPosns; IPosn++) {
+         int PosZone = 0;
+         double Offset = 0.0;
+         if (TangentOffset (PosXi[IPosn],PosEta[IPosn],I_Plan,&Offset,&PosZone)) {
+            double XPos = LocalX[IPosn];
+            double YPos = LocalY[IPosn];
+            double R = sqrt (XPos * XPos + YPos * YPos);
+            Index.push_back(IPosn);
+            Zone.push_back(PosZone);
+            NewX.push_back(XPos * (R - Offset) / R);
+            NewY.push_back(YPos * (R - Offset) / R);
+         } else {
+            Failed(IPosn);
+         }
+      }
+      
+      //  The tangent plane positions of the offset X,Y positions.
+      
+      int NOffset = Index.size();
+      std::vector<double> Xi(NOffset),Eta(NOffset);
+      Pos2TangentBatch (NOffset,NewX.data(),NewY.data(),Xi.data(),Eta.data(),
+                                                                        I_Plan);
+      
+      //  And finally, for each, the check TeleCorrFromXY() makes that the
+      //  offset hasn't moved it into another zone, and the conversion of the
+      //  tangent plane position to Ra,Dec.
+      
+      for (int I = 0; I < NOffset; I++) {
+         int IPosn = Index[I];
+         int NewZone = 0;
+         double NewOffset = 0.0;
+         if (!TangentOffset (Xi[I],Eta[I],I_Plan,&NewOffset,&NewZone)) {
+            Failed(IPosn);
+            continue;
+         }
+         if (NewZone != Zone[I]) {
+            I_Debug.Logf ("Offsets",
+               "Telecentricity offset crosses boundary of Zones %d and %d",
+                                                            NewZone,Zone[I]);
+            double XPos = LocalX[IPosn];
+            double YPos = LocalY[IPosn];
+            double R = sqrt (XPos * XPos + YPos * YPos);
+            Pos2Tangent (XPos * (R - NewOffset) / R,YPos * (R - NewOffset) / R,
+                                                         &Xi[I],&Eta[I],I_Plan);
+         }
+         Converted[IPosn] =
+                 Tangent2RaDec (Xi[I],Eta[I],&Ra[IPosn],&Dec[IPosn],I_Plan);
+         if (!Converted[IPosn]) Failed(IPosn);
+      }
+      ReturnOK = (FirstFailed == NPosns);
+      if (!ReturnOK) I_ErrorText = FirstError;
+   }
+   return ReturnOK;
+}
+
+// ----------------------------------------------------------------------------------
 
+//                            B u i l d  P l a n
+//
+//  Sets up the field transform plan in I_Plan. This holds everything used by
+//  the conversion routines that depends only on the parameters passed to
+//  Initialise() and SetObsWavelength(), and not on the position being
+//  converted. Building it updates the apparent to observed parameters for the
+//  observing time, checks that the field centre is observable at that time,
+//  works out the mount position of the field centre and the distortion model
+//  at the observing wavelength (all using TdfFieldInit()), normalizes and
+//  inverts the linear model (TdfLinInit()), and works out the thermal expansion
+//  factors for the plate. If a fast approximation to the conversion has been
+//  requested (see SetSurrogate()), this fits it for the new plan. The
+//  conversion routines only ever read the plan, so once built it can be shared
+//  by any number of conversions. If this fails, it returns false and sets an
+//  error description into I_ErrorText.
+
+bool HectorRaDecXY::BuildPlan (void)
+{
+   bool ReturnOK = true;
+   StatusType Status = STATUS__OK;
+   HectorXYPlan Plan;
+   TdfFieldInit (&I_XYPars,I_CenRa,I_CenDec,I_Mjd,&Plan.Field,&Status);
+   TdfLinInit (&I_Lin,&Plan.Lin,&Status);
+   if (Status != STATUS__OK) {
+      ReturnOK = false;
+      std::string StatusText = StatusToText(Status);
+      if (StatusText == "") StatusText = "Unexpected error";
+      I_ErrorText = "Cannot set up field for conversion - " + StatusText;
+   } else {
+      Plan.ThermalToObs = ThermalExpansion (I_ObsTemp,I_RobotTemp,I_CTE);
+      Plan.ThermalToRobot = ThermalExpansion (I_RobotTemp,I_ObsTemp,I_CTE);
+      for (int I = 0; I < 4; I++) {
+         Plan.RotXyMat[I] = I_RotXyMat[I];
+         Plan.RotXyInv[I] = I_RotXyInv[I];
+      }
+      FitSurrogate (&Plan);
+      I_Plan = Plan;
+   }
    return ReturnOK;
 }
 
 // ----------------------------------------------------------------------------------
 
+//                          F i t  S u r r o g a t e
+//
+//  Fits the fast approximation to the conversion performed by RaDec2Pos() for
+//  the plan being built by BuildPlan(). Each of X and Y is approximated by a
+//  two-dimensional Chebyshev series in the tangent plane coordinates xi,eta of
+//  the apparent Ra,Dec relative to the field centre, covering a square of half
+//  width SurrRadiusDeg. The coefficients come from the exact conversion at the
+//  Chebyshev nodes, which makes the series interpolate the exact values there.
+//  The series is then checked against the exact conversion on a finer grid
+//  covering the whole square, and the largest difference found is recorded
+//  in the plan. The surrogate is only marked usable if that is within the
+//  tolerance passed to SetSurrogate(); otherwise the conversion routines
+//  carry on using the exact conversion. Nothing is fitted if no tolerance
+//  has been set.
+//
+//  Plan    The plan being built. Must have everything else set up.
+
+void HectorRaDecXY::FitSurrogate (HectorXYPlan* Plan)
+{
+   HectorSurrogate* Surr = &(Plan->Surrogate);
+   Surr->Usable = false;
+   Surr->Order = 0;
+   Surr->Radius = 0.0;
+   Surr->MaxError = -1.0;
+   if (I_SurrTolerance <= 0.0) return;
+   
+   //  If a conversion fails, that isn't an error as far as the caller is
+   //  concerned - it just means the surrogate can't be used.
+   
+   HectorConvStatus Status;
+   
+   int Order = I_SurrOrder;
+   int NCoeffs = Order + 1;
+   double Radius = SurrRadiusDeg * DD2R;
+   double CenRa = Plan->Field.cra;
+   double CenDec = Plan->Field.cdec;
+   
+   //  The nodes, and the Chebyshev polynomials evaluated at each of them.
+   
+   std::vector<double> Nodes(NCoeffs);
+   std::vector<double> Cheby(NCoeffs * NCoeffs);
+   for (int INode = 0; INode < NCoeffs; INode++) {
+      Nodes[INode] = cos(DPI * (INode + 0.5) / NCoeffs);
+      for (int IOrder = 0; IOrder < NCoeffs; IOrder++) {
+         Cheby[INode * NCoeffs + IOrder] =
+              cos(DPI * IOrder * (INode + 0.5) / NCoeffs);
+      }
+   }
+   
+   //  The exact conversion at each node.
+   
+   bool FitOK = true;
+   std::vector<double> NodeX(NCoeffs * NCoeffs);
+   std::vector<double> NodeY(NCoeffs * NCoeffs);
+   for (int IXi = 0; IXi < NCoeffs && FitOK; IXi++) {
+      for (int IEta = 0; IEta < NCoeffs && FitOK; IEta++) {
+         double Ra,Dec;
+         slaDtp2s (Nodes[IXi] * Radius,Nodes[IEta] * Radius,
+                                               CenRa,CenDec,&Ra,&Dec);
+         FitOK = RaDec2Pos (Ra,Dec,&NodeX[IXi * NCoeffs + IEta],
+                                  &NodeY[IXi * NCoeffs + IEta],*Plan,&Status);
+      }
+   }
+   
+   //  The coefficients, using the discrete orthogonality of the Chebyshev
+   //  polynomials over the nodes.
+   
+   if (FitOK) {
+      Surr->Order = Order;
+      Surr->Radius = Radius;
+      for (int JXi = 0; JXi < NCoeffs; JXi++) {
+         for (int JEta = 0; JEta < NCoeffs; JEta++) {
+            double SumX = 0.0;
+            double SumY = 0.0;
+            for (int IXi = 0; IXi < NCoeffs; IXi++) {
+               for (int IEta = 0; IEta < NCoeffs; IEta++) {
+                  double Weight = Cheby[IXi * NCoeffs + JXi] *
+                                           Cheby[IEta * NCoeffs + JEta];
+                  SumX += Weight * NodeX[IXi * NCoeffs + IEta];
+                  SumY += Weight * NodeY[IXi * NCoeffs + IEta];
+               }
+            }
+            double Scale = ((JXi == 0) ? 1.0 : 2.0) *
+                              ((JEta == 0) ? 1.0 : 2.0) / (NCoeffs * NCoeffs);
+            Surr->CoeffsX[JXi * NCoeffs + JEta] = SumX * Scale;
+            Surr->CoeffsY[JXi * NCoeffs + JEta] = SumY * Scale;
+         }
+      }
+      
+      //  Now check it against the exact conversion. The grid includes the
+      //  edges of the square, where the error is usually largest.
+      
+      Surr->Usable = true;
+      double MaxError = 0.0;
+      for (int IXi = 0; IXi < SurrCheckPoints && FitOK; IXi++) {
+         double Xi = Radius * (2.0 * IXi / (SurrCheckPoints - 1) - 1.0);
+         for (int IEta = 0; IEta < SurrCheckPoints && FitOK; IEta++) {
+            double Eta = Radius * (2.0 * IEta / (SurrCheckPoints - 1) - 1.0);
+            double Ra,Dec,X,Y,SurrX,SurrY;
+            slaDtp2s (Xi,Eta,CenRa,CenDec,&Ra,&Dec);
+            FitOK = RaDec2Pos (Ra,Dec,&X,&Y,*Plan,&Status);
+            if (FitOK) {
+               if (SurrogateRaDec2Pos (Ra,Dec,&SurrX,&SurrY,*Plan)) {
+                  double Error = sqrt((SurrX - X) * (SurrX - X) +
+                                                (SurrY - Y) * (SurrY - Y));
+                  if (Error > MaxError) MaxError = Error;
+               }
+            }
+         }
+      }
+      Surr->Usable = FitOK && (MaxError <= I_SurrTolerance);
+      if (FitOK) Surr->MaxError = MaxError;
+   }
+   if (!FitOK) {
+      I_Debug.Logf ("Surrogate","Unable to fit surrogate conversion: %s",
+                                                        Status.Error.c_str());
+   } else {
+      I_Debug.Logf ("Surrogate",
+          "Surrogate conversion, order %d, max error %.4f microns, %s",
+                   Order,Surr->MaxError,Surr->Usable ? "in use" : "not used");
+   }
+}
+
+// ----------------------------------------------------------------------------------
+
+//                  S u r r o g a t e  R a  D e c  2  P o s
+//
+//  Converts an apparent Ra,Dec to an X,Y position on the field plate, as done
+//  by RaDec2Pos(), but using the fast approximation fitted by FitSurrogate().
+//  This returns false, without setting I_ErrorText, if the plan doesn't have
+//  a usable approximation or if the position is outside the area it covers,
+//  in which case the caller should use RaDec2Pos() instead.
+//
+//  Ra      Apparent RA in radians.
+//  Dec     Apparent Dec in radians.
+//  X       Calculated field plate X coordinate in microns.
+//  Y       Calculated field plate Y coordinate in microns.
+//  Plan    The field transform plan, normally I_Plan.
+
+bool HectorRaDecXY::SurrogateRaDec2Pos (
+   double Ra, double Dec, double *X, double *Y, const HectorXYPlan& Plan) const
+{
+   const HectorSurrogate& Surr = Plan.Surrogate;
+   if (!Surr.Usable) return false;
+   
+   double Xi,Eta;
+   int Status;
+   slaDs2tp (Ra,Dec,Plan.Field.cra,Plan.Field.cdec,&Xi,&Eta,&Status);
+   if (Status != 0) return false;
+   double U = Xi / Surr.Radius;
+   double V = Eta / Surr.Radius;
+   if (fabs(U) > 1.0 || fabs(V) > 1.0) return false;
+   
+   //  Chebyshev polynomials at U and V, from the usual recurrence.
+   
+   int NCoeffs = Surr.Order + 1;
+   double TU[HECTOR_SURR_MAX_ORDER + 1];
+   double TV[HECTOR_SURR_MAX_ORDER + 1];
+   TU[0] = 1.0;
+   TV[0] = 1.0;
+   TU[1] = U;
+   TV[1] = V;
+   for (int IOrder = 2; IOrder < NCoeffs; IOrder++) {
+      TU[IOrder] = 2.0 * U * TU[IOrder - 1] - TU[IOrder - 2];
+      TV[IOrder] = 2.0 * V * TV[IOrder - 1] - TV[IOrder - 2];
+   }
+   double SumX = 0.0;
+   double SumY = 0.0;
+   for (int JXi = 0; JXi < NCoeffs; JXi++) {
+      const double* CoeffsX = Surr.CoeffsX + JXi * NCoeffs;
+      const double* CoeffsY = Surr.CoeffsY + JXi * NCoeffs;
+      double RowX = 0.0;
+      double RowY = 0.0;
+      for (int JEta = 0; JEta < NCoeffs; JEta++) {
+         RowX += CoeffsX[JEta] * TV[JEta];
+         RowY += CoeffsY[JEta] * TV[JEta];
+      }
+      SumX += RowX * TU[JXi];
+      SumY += RowY * TU[JXi];
+   }
+   *X = SumX;
+   *Y = SumY;
+   return true;
+}
+
+// ----------------------------------------------------------------------------------
+
 //                    T e l e  C o r r  F r o m  R a  D e c
 //
 //  Given an apparent RA,Dec position on the sky and the corresponding X,Y
@@ -577,7 +1451,7 @@ bool HectorRaDecXY::RaDec2XY (
 //  CorrY   Y value with the telecontricity correction applied.
 
 void HectorRaDecXY::TeleCorrFromRaDec (
-   double Ra, double Dec, double X, double Y, double* CorrX, double* CorrY) {
+   double Ra, double Dec, double X, double Y, double* CorrX, double* CorrY) const {
 
 
   /*
@@ -616,7 +1490,7 @@ void HectorRaDecXY::TeleCorrFromRaDec (
     double X, double Y, double* CorrX, double* CorrY,
     bool TeleOffEnable,
     bool MechOffEnable,
-    DebugHandler *Debug) 
+    const DebugHandler *Debug) 
 {
 
    //  Given the Ra and Dec and the central Ra Dec of the field plate, work out
@@ -651,15 +1525,117 @@ void HectorRaDecXY::TeleCorrFromRaDec (
 //  If all goes well, this routine returns true. If there is an error, it
 //  returns false and sets an error description into I_ErrorText.
 //
+//  This uses the 'quick' versions of the 2dF routines, taking the field
+//  constant details from the plan set up by BuildPlan(). Rather than use
+//  TdfXy2rdQk(), which inverts the distortion model to a fixed accuracy,
+//  this uses Pos2Tangent() to invert it to the accuracy set by
+//  SetInverseTolerance(), keeping count of how well that went, and then
+//  Tangent2RaDec() to get the Ra,Dec.
+
+bool HectorRaDecXY::Pos2RaDec (
+   double X, double Y, double *Ra, double*Dec, const HectorXYPlan& Plan)
+{
+   double Xi,Eta;
+   Pos2Tangent (X,Y,&Xi,&Eta,Plan);
+   return Tangent2RaDec (Xi,Eta,Ra,Dec,Plan);
+}
+
+// ----------------------------------------------------------------------------------
 
-bool HectorRaDecXY::Pos2RaDec (double X, double Y, double *Ra, double*Dec)
+//                             P o s  2  T a n g e n t
+//
+//  This is the first half of Pos2RaDec(). It applies the linearity correction
+//  to a position on the field plate and then inverts the 2dF distortion model
+//  using TdfDistXyInvNewton() to get the corresponding position in the tangent
+//  plane, to the accuracy set by SetInverseTolerance(). The number of iterations
+//  and the final residual are accumulated in I_InvStats. Failure to reach the
+//  required accuracy is not treated as an error, but is counted and can be
+//  logged using the "Inverse" debug level.
+
+void HectorRaDecXY::Pos2Tangent (
+   double X, double Y, double *Xi, double *Eta, const HectorXYPlan& Plan)
 {
-   bool ReturnOK = true;
    double LinCorrX = X;
    double LinCorrY = Y;
-   if (I_EnableLin) TdfPos2xy (&I_Lin,X,Y,&LinCorrX,&LinCorrY);
+   if (I_EnableLin) TdfPos2xyQk (&Plan.Lin,X,Y,&LinCorrX,&LinCorrY);
+   double Residual;
+   int Iterations;
+   TdfDistXyInvNewton (&Plan.Field,LinCorrX,LinCorrY,I_InvTolerance,I_InvMaxIter,
+                                                Xi,Eta,&Residual,&Iterations);
+   I_InvStats.Calls++;
+   I_InvStats.Iterations += Iterations;
+   if (Residual > I_InvStats.MaxResidual) I_InvStats.MaxResidual = Residual;
+   if (Residual > I_InvTolerance) {
+      I_InvStats.Unconverged++;
+      I_Debug.Logf ("Inverse",
+         "Distortion inverse for X,Y %f %f did not converge: residual %g mu "
+                        "after %d iterations",LinCorrX,LinCorrY,Residual,Iterations);
+   }
+}
+
+// ----------------------------------------------------------------------------------
+
+//                        P o s  2  T a n g e n t  B a t c h
+//
+//  Does what Pos2Tangent() does for each of an array of positions, but inverts
+//  the distortion model for all of them at once using TdfDistXyInvBatch(),
+//  which can use vector instructions. The results, and the statistics kept in
+//  I_InvStats, are exactly those Pos2Tangent() would give.
+//
+//  NPosns  Number of positions.
+//  X       Array of field plate X coordinates in microns.
+//  Y       Array of field plate Y coordinates in microns.
+//  Xi      Array to receive the tangent plane xi coordinates.
+//  Eta     Array to receive the tangent plane eta coordinates.
+//  Plan    The field transform plan, normally I_Plan.
+
+void HectorRaDecXY::Pos2TangentBatch (
+   int NPosns, const double X[], const double Y[], double Xi[], double Eta[],
+                                                     const HectorXYPlan& Plan)
+{
+   std::vector<double> LinCorrX(X,X + NPosns);
+   std::vector<double> LinCorrY(Y,Y + NPosns);
+   if (I_EnableLin) {
+      for (int IPosn = 0; IPosn < NPosns; IPosn++) {
+         TdfPos2xyQk (&Plan.Lin,X[IPosn],Y[IPosn],&LinCorrX[IPosn],&LinCorrY[IPosn]);
+      }
+   }
+   std::vector<double> Residual(NPosns);
+   std::vector<int> Iterations(NPosns);
+   TdfDistXyInvBatch (&Plan.Field,NPosns,LinCorrX.data(),LinCorrY.data(),
+                          I_InvTolerance,I_InvMaxIter,Xi,Eta,Residual.data(),
+                                                            Iterations.data());
+   for (int IPosn = 0; IPosn < NPosns; IPosn++) {
+      I_InvStats.Calls++;
+      I_InvStats.Iterations += Iterations[IPosn];
+      if (Residual[IPosn] > I_InvStats.MaxResidual) {
+         I_InvStats.MaxResidual = Residual[IPosn];
+      }
+      if (Residual[IPosn] > I_InvTolerance) {
+         I_InvStats.Unconverged++;
+         I_Debug.Logf ("Inverse",
+            "Distortion inverse for X,Y %f %f did not converge: residual %g mu "
+                          "after %d iterations",LinCorrX[IPosn],LinCorrY[IPosn],
+                                             Residual[IPosn],Iterations[IPosn]);
+      }
+   }
+}
+
+// ----------------------------------------------------------------------------------
+
+//                          T a n g e n t  2  R a D e c
+//
+//  This is the second half of Pos2RaDec(). It converts a position in the
+//  tangent plane, as returned by Pos2Tangent(), to apparent Ra,Dec using
+//  TdfTan2rdQk(). If all goes well, this routine returns true. If there is an
+//  error, it returns false and sets an error description into I_ErrorText.
+
+bool HectorRaDecXY::Tangent2RaDec (
+   double Xi, double Eta, double *Ra, double *Dec, const HectorXYPlan& Plan)
+{
+   bool ReturnOK = true;
    StatusType Status = STATUS__OK;
-   TdfXy2rd (&I_XYPars,I_CenRa,I_CenDec,LinCorrX,LinCorrY,I_Mjd,Ra,Dec,&Status);
+   TdfTan2rdQk (&I_XYPars,&Plan.Field,Xi,Eta,Ra,Dec,&Status);
    if (Status != STATUS__OK) {
       ReturnOK = false;
       std::string StatusText = StatusToText(Status);
@@ -683,26 +1659,36 @@ bool HectorRaDecXY::Pos2RaDec (double X, double Y, double *Ra, double*Dec)
 //  if needed.
 //
 //  If all goes well, this routine returns true. If there is an error, it
-//  returns false and sets an error description into I_ErrorText.
+//  returns false and, unless the status structure passed already describes
+//  an earlier problem, sets an error description into that.
 //
+//  This uses the 'quick' versions of the 2dF routines, TdfRd2xyQk() and
+//  TdfXy2posQk(), taking the field constant details from the plan set up by
+//  BuildPlan(). These give exactly the same results as the originals.
 
-bool HectorRaDecXY::RaDec2Pos (double Ra, double Dec, double *X, double *Y)
+bool HectorRaDecXY::RaDec2Pos (
+   double Ra, double Dec, double *X, double *Y, const HectorXYPlan& Plan,
+   HectorConvStatus* Status) const
 {
    bool ReturnOK = true;
-   double LinCorrX;
-   double LinCorrY;
-   StatusType Status = STATUS__OK;
-   TdfRd2xy (&I_XYPars,I_CenRa,I_CenDec,Ra,Dec,I_Mjd,&LinCorrX,&LinCorrY,
-                                                                   &Status);
+   double LinCorrX = 0.0;
+   double LinCorrY = 0.0;
+   StatusType TdfStatus = STATUS__OK;
+   TdfErrType Report;
+   TdfErrType* PrevReport = TdfErrSetContext (&Report);
+   TdfRd2xyQk (const_cast<TdfXyType*>(&I_XYPars),&Plan.Field,Ra,Dec,
+                                              &LinCorrX,&LinCorrY,&TdfStatus);
+   TdfErrSetContext (PrevReport);
    *X = LinCorrX;
    *Y = LinCorrY;
-   if (Status != STATUS__OK) {
+   if (TdfStatus != STATUS__OK) {
       ReturnOK = false;
-      std::string StatusText = StatusToText(Status);
-      if (StatusText == "") StatusText = "Unexpected conversion error";
-      I_ErrorText = "Cannot convert Ra,Dec to X,Y - " + StatusText;
+      if (Status->Ok) {
+         Status->Ok = false;
+         Status->Error = ConvErrorText(TdfStatus,Report);
+      }
    } else {
-      if (I_EnableLin) TdfXy2pos (&I_Lin,LinCorrX,LinCorrY,X,Y);
+      if (I_EnableLin) TdfXy2posQk (&Plan.Lin,LinCorrX,LinCorrY,X,Y);
    }
    return ReturnOK;
 }
@@ -711,42 +1697,43 @@ bool HectorRaDecXY::RaDec2Pos (double Ra, double Dec, double *X, double *Y)
 
 //                      T e l e  C o r r  F r o m  X Y
 //
-//  Given X,Y coordinates on the field plate and the corresponding apparent RA,Dec
-//  position on the sky calculated on the basis of 2dF distortion, calacultes the
-//  telecentricity correction due to the various prism angles used by Hector and
-//  returns the telecentricity corrected X,Y values.
+//  Given X,Y coordinates on the field plate, calculates the telecentricity
+//  correction due to the various prism angles used by Hector and returns the
+//  telecentricity corrected X,Y values, together with the position in the
+//  tangent plane that corresponds to the corrected X,Y.
 //
 //  X       Field plate X coordinate in microns.
 //  Y       Field plate Y coordinate in microns.
 //  CorrX   X value with the telecontricity correction applied.
 //  CorrY   Y value with the telecontricity correction applied..
+//  Xi      Tangent plane xi coordinate of the corrected position.
+//  Eta     Tangent plane eta coordinate of the corrected position.
+//  Plan    The field transform plan, normally I_Plan.
 
 bool HectorRaDecXY::TeleCorrFromXY (
-   double X, double Y, double* CorrX, double* CorrY) {
+   double X, double Y, double* CorrX, double* CorrY, double* Xi, double* Eta,
+                                                   const HectorXYPlan& Plan) {
 
    bool ReturnOK = false;
    
    //  This sequence is a lot messier than that used by TeleCorrFromRaDec(), as
    //  we need the angle between the field centre and the position in question,
-   //  and it's easiest to get that from the calculated Ra,Dec. It's complicated
-   //  even more by the question of what happens on the boundary between two
-   //  Hector zones, as this code assumes that it is the Ra,Dec position that
-   //  determines the zone and hence the offset, so there is an element of
-   //  iteration involved here.
-
-   double Ra,Dec;
-   if (Pos2RaDec (X,Y,&Ra,&Dec)) {
-
-      //  Given the Ra and Dec and the central Ra Dec of the field plate, work out
-      //  the angle between the two positions. This angle determines the prism that
-      //  will be used for this position.
-      
-      double AngleRad = slaDsep (I_CenRa, I_CenDec, Ra, Dec);
-      
-      //  And that in turn determines the offset.
-      
-      int Zone = 0;
-      double Offset = TelecentricityOffset (AngleRad,&Zone);
+   //  and we don't have the Ra,Dec position. TangentOffset() gets the angle
+   //  from the tangent plane position, which is much quicker to calculate.
+   //  It's complicated even more by the question of what happens on the
+   //  boundary between two Hector zones, as this code assumes that it is the
+   //  Ra,Dec position that determines the zone and hence the offset, so there
+   //  is an element of iteration involved here.
+
+   double PosXi,PosEta;
+   Pos2Tangent (X,Y,&PosXi,&PosEta,Plan);
+   
+   //  The position determines the prism that will be used for this position,
+   //  and that in turn determines the offset.
+   
+   int Zone = 0;
+   double Offset = 0.0;
+   if (TangentOffset (PosXi,PosEta,Plan,&Offset,&Zone)) {
       
       //  Given that, we can now work out the X and Y positions in the field plate
       //  without the offset. Note that the offset is applied in the opposite
@@ -755,19 +1742,17 @@ bool HectorRaDecXY::TeleCorrFromXY (
       double R = sqrt (X * X + Y * Y);
       double NewY = Y * (R - Offset) / R;
       double NewX = X * (R - Offset) / R;
+      Pos2Tangent (NewX,NewY,Xi,Eta,Plan);
 
-      double NewRa, NewDec;
-      if (Pos2RaDec (NewX,NewY,&NewRa,&NewDec)) {
+      //  This is where it gets a bit tricky. This new position may fall into a
+      //  different Hector zone, giving a different offset. If so, then we have
+      //  used the wrong offset (assuming that the Ra,Dec position determines
+      //  the zone and hence the magnet type used by Hector), and have to
+      //  recalculate on the basis of the new zone.
 
-         //  This is where it gets a bit tricky. This new Ra,Dec may fall into a
-         //  different Hector zone, giving a different offset. If so, then we have
-         //  used the wrong offset (assuming that the Ra,Dec position determines
-         //  the zone and hence the magnet type used by Hector), and have to
-         //  recalculate on the basis of the new zone.
-
-         AngleRad = slaDsep (I_CenRa, I_CenDec, NewRa, NewDec);
-         int NewZone = 0;
-         double NewOffset = TelecentricityOffset (AngleRad,&NewZone);
+      int NewZone = 0;
+      double NewOffset = 0.0;
+      if (TangentOffset (*Xi,*Eta,Plan,&NewOffset,&NewZone)) {
          if (NewZone != Zone) {
             I_Debug.Logf ("Offsets",
                "Telecentricity offset crosses boundary of Zones %d and %d",
@@ -775,6 +1760,7 @@ bool HectorRaDecXY::TeleCorrFromXY (
             R = sqrt (X * X + Y * Y);
             NewY = Y * (R - NewOffset) / R;
             NewX = X * (R - NewOffset) / R;
+            Pos2Tangent (NewX,NewY,Xi,Eta,Plan);
          }
          *CorrX = NewX;
          *CorrY = NewY;
@@ -787,6 +1773,57 @@ bool HectorRaDecXY::TeleCorrFromXY (
 
 // ----------------------------------------------------------------------------------
 
+//                        T a n g e n t  O f f s e t
+//
+//  Calculates the telecentricity offset, and the Hector zone, for a position
+//  given in tangent plane coordinates, as returned by Pos2Tangent(). The zone
+//  is defined in terms of the angle between the apparent Ra,Dec of the position
+//  and the field centre, but getting the Ra,Dec takes most of the time needed
+//  for an X,Y to Ra,Dec conversion. The tangent plane is centred on the field
+//  centre, so the angle can be taken directly from the radius in the tangent
+//  plane instead. The two are not quite the same - they differ by a few arc
+//  seconds at most, because of differential refraction - and that is only
+//  significant for positions very close to a zone boundary. For those, this
+//  routine does the conversion to Ra,Dec and uses the angle from that, so the
+//  zone is always the same as the Ra,Dec position would give. Elsewhere, the
+//  offset will differ from that given by the Ra,Dec angle only in the zones
+//  where the prism offset varies with angle, and then by no more than a few
+//  hundredths of a micron.
+//
+//  If all goes well, this routine returns true. If there is an error
+//  converting to Ra,Dec, it returns false and sets an error description
+//  into I_ErrorText.
+//
+//  Xi      Tangent plane xi coordinate of the position.
+//  Eta     Tangent plane eta coordinate of the position.
+//  Plan    The field transform plan, normally I_Plan.
+//  Offset  Returned with the telecentricity offset in microns.
+//  Zone    Returned with the Hector zone for the position.
+
+bool HectorRaDecXY::TangentOffset (
+   double Xi, double Eta, const HectorXYPlan& Plan, double* Offset, int* Zone)
+{
+   bool ReturnOK = true;
+   double AngleRad = atan (sqrt (Xi * Xi + Eta * Eta));
+   double AngleAsec = AngleRad * DR2AS;
+   bool NearBoundary = false;
+   for (int IZone = 0; IZone < NumZones; IZone++) {
+      if (fabs(AngleAsec - ZoneTable[IZone].OuterDeg * 3600.0) < ZoneGuardAsec) {
+         NearBoundary = true;
+         break;
+      }
+   }
+   if (NearBoundary) {
+      double Ra,Dec;
+      ReturnOK = Tangent2RaDec (Xi,Eta,&Ra,&Dec,Plan);
+      if (ReturnOK) AngleRad = slaDsep (I_CenRa, I_CenDec, Ra, Dec);
+   }
+   if (ReturnOK) *Offset = TelecentricityOffset (AngleRad,Zone);
+   return ReturnOK;
+}
+
+// ----------------------------------------------------------------------------------
+
 //                  T e l e c e n t r i c i t y  O f f s e t
 //
 //  Calculates the offset in microns radially outward from a given field plate
@@ -805,7 +1842,7 @@ bool HectorRaDecXY::TeleCorrFromXY (
 //  AngleRad    The angle to the position in question, in radians.
 //  ZonPtr      If non-null, return the calculated zone here
 
-double HectorRaDecXY::TelecentricityOffset (double AngleRad, int* ZonePtr) {
+double HectorRaDecXY::TelecentricityOffset (double AngleRad, int* ZonePtr) const {
 
   // Call the static version, passing through various values from the object.
   return TelecentricityOffsetS(AngleRad, ZonePtr, 
@@ -842,7 +1879,7 @@ double HectorRaDecXY::TelecentricityOffsetS (
     double AngleRad, int* ZonePtr,
     bool TeleOffEnable,
     bool MechOffEnable,
-    DebugHandler *Debug) {
+    const DebugHandler *Debug) {
 
 
    //  In Peter Gillingham's document 2dF_distortion_prism_effects.pdf, there is a
@@ -860,40 +1897,33 @@ double HectorRaDecXY::TelecentricityOffsetS (
    //  what I call here the optical offset and which the spreadsheet calls Peter's
    //  "Hector minus 2dF um" figure is a shift radially outwards. Note that the
    //  calculations in the code use values in microns throughout.
+   //
+   //  The values are held in ZoneTable. In the angle range 0 to 0.396 degrees,
+   //  the prism angle offset is a constant 31 microns, and the mechanical offset
+   //  is 0.1173mm. In the angle range 0.396 to 0.627 degrees, the prism angle
+   //  offset is a constant 64 microns, and the mechanical offset is 0.2382mm. In
+   //  the angle range 0.627 to 0.823 degrees, the prism angle offset increases
+   //  linearly between 94 and 95 microns, and the mechanical offset is 0.3468mm.
+   //  In the angle range 0.823 to 1.0 degrees, the prism angle offset decreases
+   //  linearly between 118 and 116 microns and the mechanical offset is 0.4529mm.
+   //  An angle beyond the outermost zone shouldn't happen, but we trap it anyway,
+   //  using the values for the outer edge of the field, and a zone of zero.
    
    int Zone = 0;
-   double Offset = 31.0;
-   double MechOffset = 1173.0;
+   double Offset = ZoneTable[NumZones - 1].OuterOffset;
+   double MechOffset = ZoneTable[NumZones - 1].MechOffset;
    double AngleDeg = AngleRad * DR2D;
-   if (AngleDeg < 0.396) {
-      //  In the angle range 0 to 0.396 degrees, the prism angle offset is a
-      //  constant 31 microns, and the mechanical offset is 0.1173mm.
-      Offset = 31.0;
-      MechOffset = 117.3;
-      Zone = 1;
-   } else if (AngleDeg < 0.627) {
-      //  In the angle range 0.396 to 0.627 degrees, the prism angle offset is a
-      //  constant 64 microns, and the mechanical offset is 0.2382mm.
-      Offset = 64.0;
-      MechOffset = 238.2;
-      Zone = 2;
-   } else if (AngleDeg < 0.823) {
-      //  In the angle range 0.627 to 0.823 degrees, the prism angle offset
-      //  increases linearly between 94 and 95 microns, and the mechanical offset
-      //  is 0.3468mm.
-      Offset = 94.0 + (95.0 - 94.0) * (AngleDeg - 0.627) / (0.823 - 0.627);
-      MechOffset = 346.8;
-      Zone = 3;
-   } else if (AngleDeg < 1.0) {
-      //  In the angle range 0.823 to 1.0 degrees, the prism angle offset decreases
-      //  linearly between 118 and 116 microns and the mechanical offset is 0.4529mm.
-      Offset = 118.0 + (116.0 - 118.0) * (AngleDeg - 0.823) / (1.0 - 0.823);
-      MechOffset = 452.9;
-      Zone = 4;
-   } else {
-      //  This shouldn't happen, but we trap it anyway.
-      Offset = 116.0;
-      MechOffset = 452.9;
+   double InnerDeg = 0.0;
+   for (int IZone = 0; IZone < NumZones; IZone++) {
+      const HectorZoneDetails& Details = ZoneTable[IZone];
+      if (AngleDeg < Details.OuterDeg) {
+         Offset = Details.InnerOffset + (Details.OuterOffset - Details.InnerOffset)
+                           * (AngleDeg - InnerDeg) / (Details.OuterDeg - InnerDeg);
+         MechOffset = Details.MechOffset;
+         Zone = IZone + 1;
+         break;
+      }
+      InnerDeg = Details.OuterDeg;
    }
    
    //  We normally make use of both offsets, but it is possible to disable
@@ -951,10 +1981,39 @@ void HectorRaDecXY::ThermalOffset (
     double X, double Y, double Temp,
     double TargetTemp, double CTE, double* CorrX, double* CorrY,
     DebugHandler *Debug)
+{
+   double Expansion = ThermalExpansion (Temp,TargetTemp,CTE);
+   ApplyThermalExpansion (X,Y,Expansion,CorrX,CorrY);
+   if ((Debug)&&(Debug->Active("Temp"))) {
+      char Text[1024];
+      snprintf (Text,sizeof(Text),
+         "X,Y [%f,%f], Temp %.2f (K) Target temp %.2f (K), DeltaX,Y [%f,%f] mu",
+                                     X,Y,Temp,TargetTemp,*CorrX - X,*CorrY - Y);
+      Debug->Log("Temp",std::string(Text));
+   }
+}
+
+// ----------------------------------------------------------------------------------
+
+//                      T h e r m a l  E x p a n s i o n
+//
+//  Static member
+//
+//  Returns the fractional change in the distance of any point from the plate
+//  centre when the plate temperature changes from TargetTemp to Temp. This
+//  doesn't depend on the position, so the conversion routines work this out
+//  once, in BuildPlan(), and pass it to ApplyThermalExpansion() for each
+//  position.
+//
+//  Temp       Current emperature of plate, in Deg K.
+//  TargetTemp Target temperature of plate, in Deg K.
+//  CTE        Plate coefficient of thermal expansion (microns/metre per deg C).
+
+double HectorRaDecXY::ThermalExpansion (
+    double Temp, double TargetTemp, double CTE)
 {
    static const double MicronsPerMetre = 1.0e6;
    double DeltaT = Temp - TargetTemp;
-   double R = sqrt((X * X) + (Y * Y));
    double Alpha = CTE / MicronsPerMetre;
    
    //  We could use the simple approximation
@@ -970,21 +2029,155 @@ void HectorRaDecXY::ThermalOffset (
    //  because I'd forgotten most of my integral calculus. But this expression
    //  does reverse properly.
    
-   double Offset = R * (exp(Alpha * DeltaT) - 1);
+   return exp(Alpha * DeltaT) - 1;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                 A p p l y  T h e r m a l  E x p a n s i o n
+//
+//  Static member
+//
+//  Applies a fractional expansion, as calculated by ThermalExpansion(), to a
+//  plate position.
+//
+//  X          Plate position in X (with 0,0 at the plate centre) in microns.
+//  Y          Plate position in Y (with 0,0 at the plate centre) in microns.
+//  Expansion  Fractional expansion, from ThermalExpansion().
+//  CorrX      Corrected plate position in X.
+//  CorrY      Corrected plate position in Y.
+
+void HectorRaDecXY::ApplyThermalExpansion (
+    double X, double Y, double Expansion, double* CorrX, double* CorrY)
+{
+   double R = sqrt((X * X) + (Y * Y));
+   double Offset = R * Expansion;
    
    *CorrX = X * (R + Offset) / R;
    *CorrY = Y * (R + Offset) / R;
-   if ((Debug)&&(Debug->Active("Temp"))) {
-      char Text[1024];
-      snprintf (Text,sizeof(Text),
+}
+
+// ----------------------------------------------------------------------------------
+
+//                    P l a n  T h e r m a l  O f f s e t
+//
+//  The equivalent of ThermalOffset() used by the conversion routines, taking
+//  the expansion factor from the plan rather than recalculating it.
+//
+//  X          Plate position in X (with 0,0 at the plate centre) in microns.
+//  Y          Plate position in Y (with 0,0 at the plate centre) in microns.
+//  ToRobot    True if going from the observing temperature to the robot
+//             temperature (RaDec2XY()), false for the reverse (XY2RaDec()).
+//  Plan       The field transform plan, normally I_Plan.
+//  CorrX      Corrected plate position in X.
+//  CorrY      Corrected plate position in Y.
+
+void HectorRaDecXY::PlanThermalOffset (
+    double X, double Y, bool ToRobot, const HectorXYPlan& Plan,
+    double* CorrX, double* CorrY) const
+{
+   double Temp = ToRobot ? I_RobotTemp : I_ObsTemp;
+   double TargetTemp = ToRobot ? I_ObsTemp : I_RobotTemp;
+   double Expansion = ToRobot ? Plan.ThermalToRobot : Plan.ThermalToObs;
+   ApplyThermalExpansion (X,Y,Expansion,CorrX,CorrY);
+   if (I_Debug.Active("Temp")) {
+      I_Debug.Logf ("Temp",
          "X,Y [%f,%f], Temp %.2f (K) Target temp %.2f (K), DeltaX,Y [%f,%f] mu",
                                      X,Y,Temp,TargetTemp,*CorrX - X,*CorrY - Y);
-      Debug->Log("Temp",std::string(Text));
    }
 }
 
 // ----------------------------------------------------------------------------------
 
+//                   S e t  I n v e r s e  T o l e r a n c e
+//
+//  Sets the accuracy required when inverting the 2dF distortion model, as is
+//  done for every X,Y to Ra,Dec conversion. The inversion iterates until the
+//  X,Y position corresponding to the calculated tangent plane position is
+//  within the specified distance of the X,Y position being converted, or until
+//  the specified number of iterations have been used. The defaults are given
+//  by TDFXY_INV_TOL and TDFXY_INV_MAXITER in tdfxy.h.
+//
+//  Microns    The required accuracy, in microns on the field plate.
+//  MaxIter    The maximum number of iterations to use.
+
+void HectorRaDecXY::SetInverseTolerance (double Microns, int MaxIter)
+{
+   I_InvTolerance = Microns;
+   I_InvMaxIter = MaxIter;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                      G e t  I n v e r s e  S t a t s
+//
+//  Returns the statistics accumulated on the inversions of the distortion model
+//  since the object was created or since ResetInverseStats() was last called.
+//  The average number of iterations per inversion is Iterations/Calls.
+
+HectorInverseStats HectorRaDecXY::GetInverseStats (void)
+{
+   return I_InvStats;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                    R e s e t  I n v e r s e  S t a t s
+//
+//  Resets the statistics accumulated on the inversions of the distortion model.
+
+void HectorRaDecXY::ResetInverseStats (void)
+{
+   I_InvStats.Calls = 0;
+   I_InvStats.Iterations = 0;
+   I_InvStats.Unconverged = 0;
+   I_InvStats.MaxResidual = 0.0;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                         S e t  S u r r o g a t e
+//
+//  Requests the use of a fast approximation to the 2dF part of the Ra,Dec to
+//  X,Y conversion (see FitSurrogate()). This is fitted over the field each time
+//  the field transform plan is set up, and is only used if it agrees with the
+//  exact conversion to within the specified accuracy everywhere in the field.
+//  If it does not, or for positions outside the field, the exact conversion
+//  is used as usual. The Hector-specific corrections are always applied
+//  exactly. This can be called before or after Initialise(). It returns true
+//  if the approximation is now in use. A higher order gives a more accurate
+//  approximation, at the expense of a slower conversion.
+//
+//  MaxErrorMicrons  The largest error allowed, in microns. Zero (or negative)
+//                   turns off the approximation.
+//  Order            The order of the Chebyshev series used, in each of the
+//                   two coordinates. Must be from 1 to HECTOR_SURR_MAX_ORDER.
+
+bool HectorRaDecXY::SetSurrogate (double MaxErrorMicrons, int Order)
+{
+   if (Order < 1) Order = 1;
+   if (Order > HECTOR_SURR_MAX_ORDER) Order = HECTOR_SURR_MAX_ORDER;
+   I_SurrTolerance = MaxErrorMicrons;
+   I_SurrOrder = Order;
+   if (I_Initialised) FitSurrogate (&I_Plan);
+   return I_Initialised && I_Plan.Surrogate.Usable;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                    G e t  S u r r o g a t e  E r r o r
+//
+//  Returns the largest error, in microns, found when the fast approximation to
+//  the conversion set up by SetSurrogate() was last checked against the exact
+//  conversion. This is negative if no approximation has been fitted.
+
+double HectorRaDecXY::GetSurrogateError (void)
+{
+   return I_Initialised ? I_Plan.Surrogate.MaxError : -1.0;
+}
+
+// ----------------------------------------------------------------------------------
+
 //                            G e t  E r r o r
 //
 //  Returns a description of the latest error.
@@ -1053,6 +2246,11 @@ bool HectorRaDecXY::DisableLin (bool Disable) {
 
    bool Previous = !I_EnableLin;
    I_EnableLin = !Disable;
+   
+   //  Any fast approximation to the conversion includes the linearity
+   //  correction, so has to be fitted again if that changes.
+   
+   if (I_Initialised && Previous != Disable) FitSurrogate (&I_Plan);
    return Previous;
 }
 
@@ -1065,7 +2263,7 @@ bool HectorRaDecXY::DisableLin (bool Disable) {
 //  Converts a status code from the TdfXy routines to a text string. If the code
 //  is not recognised, an empty string is returned.
 
-const std::string HectorRaDecXY::StatusToText (StatusType Status)
+const std::string HectorRaDecXY::StatusToText (StatusType Status) const
 {
    std::string Text = "";
    
@@ -1109,6 +2307,27 @@ const std::string HectorRaDecXY::StatusToText (StatusType Status)
    return Text;
 }
 
+// ----------------------------------------------------------------------------------
+
+//                     C o n v  E r r o r  T e x t
+//
+//  Returns the error text for an Ra,Dec to X,Y conversion that failed with
+//  the specified status code, using the first line of the report recorded
+//  by the 2dF routines in the error context set up for the conversion. This
+//  is the most specific message they would have reported through Ers. If
+//  they didn't record anything, StatusToText() is used instead.
+
+const std::string HectorRaDecXY::ConvErrorText (
+                             StatusType Status, const TdfErrType& Report) const
+{
+   char Line[256];
+   std::string Text = "";
+   if (TdfErrText (&Report,0,sizeof(Line),Line)) Text = Line;
+   else Text = StatusToText(Status);
+   if (Text == "") Text = "Unexpected conversion error";
+   return "Cannot convert Ra,Dec to X,Y - " + Text;
+}
+
 
 // ----------------------------------------------------------------------------------
 
@@ -1116,7 +2335,10 @@ const std::string HectorRaDecXY::StatusToText (StatusType Status)
 
    o  The tdfxy routines report errors using ErsRep(). This is fine, apart from
       the slightly 'sticky lump' aspects, but it does complicate error reporting
-      a little in a non-DRAMA context.
+      a little in a non-DRAMA context. The per-position conversions avoid this
+      by setting a TdfErrType as the error context for the thread, which also
+      means nothing is formatted unless a conversion actually fails and the
+      caller wants to know why.
  
    o  The telecentricity correction code is simple enough when working out the
       correction from an Ra,Dec, as you just work out the angle from the Ra,Dec
@@ -1165,9 +2387,6 @@ const std::string HectorRaDecXY::StatusToText (StatusType Status)
  
    o  The linearity code was added rather late in the piece, and this may show.
 
-   o  In RaDec2XY(), Mdiff should really be an instance variable. Using a
-      static is a deplorable shortcut - but it is just a diagnostic.
- 
    o  I finally got the thermal expansion calculation to reverse exactly -
       you can see this from a trace with diff or diffmax specified as debug
       options. I still see a discrepancy in the hundredths of a micron for
@@ -97,6 +97,37 @@
 //     23rd Nov 2021.  Introduced I_RotXyMatrix to allow experimentation with
 //                     the XY coordinate system for the plate. Added RotXYMat
 //                     to the Initialise() call. KS.
+//     16th Oct 2026.  Added RaDec2XYBatch() and XY2RaDecBatch(), which convert
+//                     arrays of positions, doing the work that is the same for
+//                     every position in the field just once per call. The
+//                     private conversion routines now take an optional
+//                     TdfFieldType pointer to support this. HOP.
+//     16th Oct 2026.  Added the HectorXYPlan structure and I_Plan, with
+//                     BuildPlan() and PlanThermalOffset(). The private
+//                     conversion routines now take a HectorXYPlan reference
+//                     instead of a TdfFieldType pointer. Added the static
+//                     ThermalExpansion() and ApplyThermalExpansion(). HOP.
+//     16th Oct 2026.  Added CorrectPlateXY(). HOP.
+//     16th Oct 2026.  Added SetInverseTolerance(), GetInverseStats() and
+//                     ResetInverseStats(), with the HectorInverseStats
+//                     structure and associated instance variables. HOP.
+//     16th Oct 2026.  TeleCorrFromXY() now also returns the tangent plane
+//                     position of the corrected X,Y. Added Pos2Tangent(),
+//                     Pos2TangentBatch(), Tangent2RaDec() and TangentOffset(). HOP.
+//     16th Oct 2026.  Added SetObservation(). HOP.
+//     16th Oct 2026.  Added the HectorSurrogate structure, held in the plan,
+//                     with SetSurrogate(), GetSurrogateError(), FitSurrogate()
+//                     and SurrogateRaDec2Pos(). HOP.
+//     16th Oct 2026.  Added the HectorConvStatus structure and a const version
+//                     of RaDec2XYBatch() that can be used by several threads
+//                     at once. The routines it uses are now const, and take a
+//                     HectorConvStatus instead of setting I_ErrorText. Added
+//                     CheckRoundTrip() and I_MaxDiff. HOP.
+//     16th Oct 2026.  Added ConvErrorText(). HOP.
+//     16th Oct 2026.  Added ReadModels() and CopyModels(), so a program
+//                     handling a number of fields need only read the model
+//                     files once. Initialise() doesn't read them again if
+//                     they have already been read. HOP.
 //
 // ----------------------------------------------------------------------------------
 
@@ -112,6 +143,79 @@
 
 #include "DebugHandler.h"
 
+//  The largest order of Chebyshev series that can be used for the fast
+//  approximation to the Ra,Dec to X,Y conversion, and the order used by default.
+
+#define HECTOR_SURR_MAX_ORDER 20
+#define HECTOR_SURR_ORDER 10
+
+//  A HectorSurrogate holds a fast approximation to the conversion from apparent
+//  Ra,Dec to 2dF field plate X,Y performed by RaDec2Pos(). This is a pair of
+//  two-dimensional Chebyshev series in the tangent plane coordinates of the
+//  position relative to the field centre, fitted for one plan by FitSurrogate()
+//  and checked against the exact conversion over the whole area it covers.
+
+struct HectorSurrogate {
+   //  True if the approximation was found to be accurate enough to be used.
+   bool Usable;
+   //  Order of the series in each coordinate.
+   int Order;
+   //  Half-width of the square in the tangent plane covered, in radians.
+   double Radius;
+   //  Largest error found checking against the exact conversion (microns).
+   double MaxError;
+   //  Coefficients for X and Y, indexed by [IXi * (Order + 1) + IEta].
+   double CoeffsX[(HECTOR_SURR_MAX_ORDER + 1) * (HECTOR_SURR_MAX_ORDER + 1)];
+   double CoeffsY[(HECTOR_SURR_MAX_ORDER + 1) * (HECTOR_SURR_MAX_ORDER + 1)];
+};
+
+//  A HectorXYPlan holds everything the conversion routines need that depends
+//  only on the parameters passed to Initialise() (and SetObsWavelength()) and
+//  not on the position being converted. It is set up once, by BuildPlan(),
+//  and is then only ever read.
+
+struct HectorXYPlan {
+   //  Field centre details and distortion model at the observing wavelength.
+   TdfFieldType Field;
+   //  Linear model, normalized and inverted.
+   TdfLinQkType Lin;
+   //  Fractional thermal expansion going from robot to observing temperature.
+   double ThermalToObs;
+   //  Fractional thermal expansion going from observing to robot temperature.
+   double ThermalToRobot;
+   //  The XY rotation matrix.
+   double RotXyMat[4];
+   //  And its inverse.
+   double RotXyInv[4];
+   //  The fast approximation to RaDec2Pos(), if one is being used.
+   HectorSurrogate Surrogate;
+};
+
+//  A HectorConvStatus is passed to the const conversion routines to receive a
+//  description of the first problem they find, in place of the I_ErrorText used
+//  by the other routines, so that they can be used by several threads at once.
+
+struct HectorConvStatus {
+   //  True until a conversion fails.
+   bool Ok = true;
+   //  Description of the first failure.
+   std::string Error = "";
+};
+
+//  A HectorInverseStats structure accumulates statistics about the inversion
+//  of the 2dF distortion model performed for each X,Y to Ra,Dec conversion.
+
+struct HectorInverseStats {
+   //  Number of inversions performed.
+   long Calls;
+   //  Total number of Newton iterations used.
+   long Iterations;
+   //  Number of inversions that did not reach the required tolerance.
+   long Unconverged;
+   //  Largest final residual (microns on the field plate).
+   double MaxResidual;
+};
+
 class HectorRaDecXY {
 public:
    //  Constructor
@@ -123,14 +227,32 @@ public:
          double AtmosTemp, double Press, double Humid, double CenWave,
          double ObsWave, double RobotTemp, double ObsTemp, double RotXyMat[],
          const std::string& DistFilePath, const std::string& LinFilePath);
+   //  Read the distortion and linearity models, ahead of Initialise().
+   bool ReadModels (const std::string& DistFilePath,
+                                              const std::string& LinFilePath);
+   //  Use the models already read by another converter.
+   void CopyModels (const HectorRaDecXY& Source);
    //  Get model details - required for the output file header
    bool GetModel (double Pars[], int MaxPars, int* NumPars);
    //  Modify the observing wavelength being used - eg when changing fibre types.
    bool SetObsWavelength (double ObsWave);
+   //  Change the time and temperatures for the observation.
+   bool SetObservation (double CenRa, double CenDec, double Mjd,
+                       double AtmosTemp, double RobotTemp, double ObsTemp);
    //  Convert Ra,Dec to X,Y
    bool RaDec2XY (double Ra, double Dec, double* X, double* Y);
    //  Convert X,Y to ra,Dec
    bool XY2RaDec (double X, double Y, double* Ra, double* Dec);
+   //  Convert an array of Ra,Dec positions to X,Y
+   bool RaDec2XYBatch (const double Ra[], const double Dec[], int NPosns,
+                                     double X[], double Y[], bool Converted[]);
+   //  The same, but can be called by a number of threads at once.
+   bool RaDec2XYBatch (const double Ra[], const double Dec[], int NPosns,
+                  double X[], double Y[], bool Converted[],
+                                           HectorConvStatus* Status) const;
+   //  Convert an array of X,Y positions to Ra,Dec
+   bool XY2RaDecBatch (const double X[], const double Y[], int NPosns,
+                                  double Ra[], double Dec[], bool Converted[]);
    //  Control debugging.
    void SetDebugLevels (const std::string& Levels);
    //  Get description of latest error
@@ -141,6 +263,16 @@ public:
    bool DisableMechOffset (bool Disable);
    //  Disable/re-enable the linearity correction - old setting returned.
    bool DisableLin (bool Disable);
+   //  Set the accuracy required when inverting the distortion model.
+   void SetInverseTolerance (double Microns, int MaxIter);
+   //  Get statistics on the inversions of the distortion model.
+   HectorInverseStats GetInverseStats (void);
+   //  Reset those statistics.
+   void ResetInverseStats (void);
+   //  Use a fast approximation to the Ra,Dec to X,Y conversion, if accurate.
+   bool SetSurrogate (double MaxErrorMicrons, int Order = HECTOR_SURR_ORDER);
+   //  Get the largest error found in that approximation (microns).
+   double GetSurrogateError (void);
 
    //  Calculates the telecentricity correction based on an Ra,Dec value.
    static void TeleCorrFromRaDec (double CenRa, double CenDec, 
@@ -148,37 +280,85 @@ public:
                                   double* CorrX, double* CorrY,
                                   bool TeleOffEnable = true,
                                   bool MechOffEnable = true,
-                                  DebugHandler *Debug = nullptr);
+                                  const DebugHandler *Debug = nullptr);
 
 
    //  Calculate telecentricity offset in microns from angle from plate centre.
    static double TelecentricityOffsetS(double AngleRad, int* Zone = NULL,
                                        bool TeleOffEnable = true,
                                        bool MechOffEnable = true,
-                                       DebugHandler *Debug = nullptr);
+                                       const DebugHandler *Debug = nullptr);
 
    //  Calculate change in position due to temperature difference
    static void ThermalOffset (double X, double Y, double Temp,
                               double TargetTemp, double CTE, double* CorrX, double* CorrY,
                                DebugHandler *Debug);
 
+   //  Fractional expansion of the plate due to a temperature difference
+   static double ThermalExpansion (double Temp, double TargetTemp, double CTE);
+
+   //  Apply a fractional expansion, as from ThermalExpansion(), to a position
+   static void ApplyThermalExpansion (double X, double Y, double Expansion,
+                                                double* CorrX, double* CorrY);
+
 
 private:
    //  Utility routine to convert status codes to text.
-   const std::string StatusToText (StatusType Status);
+   const std::string StatusToText (StatusType Status) const;
+   //  Describes a failed Ra,Dec to X,Y conversion, given its deferred report.
+   const std::string ConvErrorText (
+                           StatusType Status, const TdfErrType& Report) const;
    //  Calculates the telecentricity correction based on an Ra,Dec value.
    void TeleCorrFromRaDec (double Ra, double Dec, double X, double Y,
-                                             double* CorrX, double* CorrY);
+                                       double* CorrX, double* CorrY) const;
    //  Calculates the telecentricity correction based on an X,Y value.
-   bool TeleCorrFromXY (double X, double Y, double* CorrX, double* CorrY);
+   bool TeleCorrFromXY (double X, double Y, double* CorrX, double* CorrY,
+                      double* Xi, double* Eta, const HectorXYPlan& Plan);
+   //  Telecentricity offset for a position given in tangent plane coordinates.
+   bool TangentOffset (double Xi, double Eta, const HectorXYPlan& Plan,
+                                                double* Offset, int* Zone);
    //  Calculate telecentricity offset in microns from angle from plate centre.
-   double TelecentricityOffset (double AngleRad, int* Zone = NULL);
+   double TelecentricityOffset (double AngleRad, int* Zone = NULL) const;
    //  Applies both 2dF linearity and XY->RaDec corrections.
-   bool Pos2RaDec (double X, double Y, double *Ra, double*Dec);
+   bool Pos2RaDec (double X, double Y, double *Ra, double*Dec,
+                                                  const HectorXYPlan& Plan);
+   //  Applies 2dF linearity correction and inverts the distortion model.
+   void Pos2Tangent (double X, double Y, double *Xi, double *Eta,
+                                                  const HectorXYPlan& Plan);
+   //  Does what Pos2Tangent() does for an array of positions.
+   void Pos2TangentBatch (int NPosns, const double X[], const double Y[],
+                       double Xi[], double Eta[], const HectorXYPlan& Plan);
+   //  Converts tangent plane coordinates to apparent Ra,Dec.
+   bool Tangent2RaDec (double Xi, double Eta, double *Ra, double *Dec,
+                                                  const HectorXYPlan& Plan);
    //  Applies both 2dF RaDec -> XY and linearity corrections.
-   bool RaDec2Pos (double Ra, double Dec, double *X, double *Y);
+   bool RaDec2Pos (double Ra, double Dec, double *X, double *Y,
+              const HectorXYPlan& Plan, HectorConvStatus* Status) const;
+   //  Approximates RaDec2Pos() using the surrogate in the plan, if possible.
+   bool SurrogateRaDec2Pos (double Ra, double Dec, double *X, double *Y,
+                                            const HectorXYPlan& Plan) const;
+   //  Fits and checks the surrogate in a plan.
+   void FitSurrogate (HectorXYPlan* Plan);
+   //  Does the work for RaDec2XY() and RaDec2XYBatch().
+   bool ConvertRaDec2XY (double Ra, double Dec, double* X, double* Y,
+              const HectorXYPlan& Plan, HectorConvStatus* Status) const;
+   //  Diagnostic check that a converted position converts back correctly.
+   void CheckRoundTrip (double Ra, double Dec, double X, double Y);
+   //  Does the work for XY2RaDec() and XY2RaDecBatch().
+   bool ConvertXY2RaDec (double X, double Y, double* Ra, double* Dec,
+                                                  const HectorXYPlan& Plan);
+   //  Applies the Hector corrections to a 2dF field plate position.
+   void CorrectPlateXY (double Ra, double Dec, double* X, double* Y,
+                                            const HectorXYPlan& Plan) const;
+   //  Sets up the field transform plan in I_Plan.
+   bool BuildPlan (void);
+   //  Applies the thermal correction using the expansion factors in the plan.
+   void PlanThermalOffset (double X, double Y, bool ToRobot,
+             const HectorXYPlan& Plan, double* CorrX, double* CorrY) const;
    //  Flag set once Initialise() has been called successfully.
    bool I_Initialised;
+   //  Flag set once the models have been read and I_XYPars set up.
+   bool I_XYParsSet;
    //  Field plate apparent central RA.
    double I_CenRa;
    //  Field plate apparent central Dec.
@@ -209,10 +389,28 @@ private:
    bool I_EnableMechOffset;
    //  Flag enabling the linearity correction - defaults to on.
    bool I_EnableLin;
+   //  Accuracy required when inverting the distortion model (microns).
+   double I_InvTolerance;
+   //  Maximum number of iterations used when inverting the distortion model.
+   int I_InvMaxIter;
+   //  Statistics on the inversions of the distortion model.
+   HectorInverseStats I_InvStats;
+   //  Largest error allowed for the surrogate conversion (microns), 0 if none.
+   double I_SurrTolerance;
+   //  Order of the Chebyshev series used for the surrogate conversion.
+   int I_SurrOrder;
+   //  Largest difference found by CheckRoundTrip() (radians).
+   double I_MaxDiff;
    //  File path for distortion SDS file.
    std::string I_DistFilePath;
    //  File path for linearityn SDS file.
    std::string I_LinFilePath;
+   //  True once ReadModels() has read I_Dist and I_Lin from the files below.
+   bool I_ModelsRead;
+   //  File path for the distortion SDS file read into I_Dist.
+   std::string I_ModelDistPath;
+   //  File path for the linearity SDS file read into I_Lin.
+   std::string I_ModelLinPath;
    //  Structure holding 2dF distortion values read from SDS file.
    TdfDistType I_Dist;
    //  Structure holding 2dF linearity correction values read from SDS file.
@@ -223,6 +421,8 @@ private:
    double I_RotXyMat[4];
    //  And its inverse.
    double I_RotXyInv[4];
+   //  The field transform plan, set up by BuildPlan().
+   HectorXYPlan I_Plan;
    //  Description of last error, if any.
    std::string I_ErrorText;
    //  Debug handler used to control level of debugging
@@ -240,6 +440,18 @@ private:
       they could be useful for some diagnostic routine that showed the current
       setup parameters.
  
+   o  I_Dist and I_Lin are plain structures, so CopyModels() can simply copy
+      them. The SDS routines used by ReadModels() to read them are not safe
+      to call from more than one thread at once, so a program converting a
+      number of fields in different threads should read the models once with
+      ReadModels() and have each thread's converter use CopyModels() before
+      it calls Initialise().
+ 
+   o  The plan in I_Plan holds its own copy of the linearity distortion map,
+      rather than pointing to the one in I_Lin, so a converter can be copied
+      or assigned - as HectorUtilProgDetails structures are - and the copy
+      used after the original has gone.
+ 
    o  I have no idea if there is actually going to be a new distortion SDS file
       produced for Hector, or whether one of the existing 2dF files will do.
       The only complication would be if thers's some question of using the
@@ -51,6 +51,23 @@
 //                     structure. Note about units added to comments for PMRa
 //                     and PMDec fields in HectorTarget structure. Added
 //                     PmCorrection to ProgDetails. KS.
+//     16th Oct 2026.  Added the HectorSweepEpoch structure, and SweepSpec and
+//                     SweepEpochs to the program details structure. HOP.
+//     16th Oct 2026.  Added SurrogateTolerance to the program details. HOP.
+//     16th Oct 2026.  Added Astrometry to the program details. HOP.
+//     16th Oct 2026.  Added Threads to the program details. HOP.
+//     16th Oct 2026.  Added UseClearMaps to the program details. HOP.
+//     16th Oct 2026.  Added UseCountTables to the program details. HOP.
+//     16th Oct 2026.  Added ProfitCacheDirectory to the program details. HOP.
+//     16th Oct 2026.  Added the HectorManifestTile and HectorSharedDetails
+//                     structures, and ManifestFileName, Workers and
+//                     UseTempCache to the program details. HOP.
+//     16th Oct 2026.  Added the HectorServiceSession and HectorServiceState
+//                     structures, and ServeSpec to the program details. HOP.
+//     16th Oct 2026.  HectorServiceState now holds HectorConfigSession objects,
+//                     and HectorServiceSession is no longer needed. HOP.
+//     16th Oct 2026.  Added PrintMeridianTime and MeridianTimeMessage to the
+//                     program details. HOP.
 //
 // ----------------------------------------------------------------------------------
 
@@ -58,12 +75,20 @@
 #define __HectorStructures__
 
 #include "HectorRaDecXY.h"
+#include "HectorAstrometry.h"
 //#include "HectorSkyCheck.h"
 #include "slalib.h"
 
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
+//  The service mode keeps a HectorConfigSession object for each session, but
+//  only HectorConfigUtil.cpp needs the details of that class.
+
+class HectorConfigSession;
+
 //  Possible target types - galaxy, guide star, unknown
 
 enum HectorTargetType {GALAXY,GUIDE,UNKNOWN};
@@ -144,6 +169,52 @@ struct HectorObsDetails {
    std::string LinFilePath = "";
 };
 
+//  A HectorSweepEpoch structure describes one of the observing times for
+//  which target positions are calculated when the program is run in 'sweep'
+//  mode, together with the plate temperatures to be assumed for that time.
+
+struct HectorSweepEpoch {
+   double Mjd = 0.0;          // Obs date and time as Mjd.
+   float RobotTemp = 0.0;     // Robot configuration temp, deg K.
+   float ObsTemp = 0.0;       // Estimated observation temp, deg K.
+};
+
+//  A HectorManifestTile structure describes one of the tiles (fields) listed
+//  in the manifest file when the program is run with the -manifest option.
+//  These are the values that are otherwise taken from the first eight
+//  command line arguments, together with the optional XY rotation matrix.
+
+struct HectorManifestTile {
+   int LineNumber = 0;                   // Line in the manifest file
+   std::string MainTargetFileName = "";  // Name of main (galaxy) target file
+   std::string GuideTargetFileName = ""; // Name of guide star target file
+   std::string OutputFileName = "";      // Output file to be written
+   std::string Label = "";               // Value of output file LABEL field
+   std::string PlateID = "";             // Value of output file PLATEID field
+   std::string DateAndTime = "";         // Obs date/time, as for the command line
+   float RobotTemp = 0.0;                // Robot configuration temp, deg K.
+   float ObsTemp = 0.0;                  // Estimated observation temp, deg K.
+   std::string RotMatString = "";        // Rotation matrix as specified as string
+   double XYRotMatrix[4] = {1.,0.,0.,1.};// Rotation matrix applied to X,Y values
+};
+
+//  A HectorSharedDetails structure holds the things that are the same for all
+//  the tiles listed in a manifest file, and so are only read once: the 2dF
+//  distortion and linearity models (held in a coordinate converter that is
+//  never itself initialised) and the sky fibre details, together with the
+//  outcome of reading the sky fibre file, so this can be reported for each
+//  tile just as it would have been had the file been read for that tile.
+
+struct HectorSharedDetails {
+   HectorRaDecXY Models;                 // Holds the models, once read
+   bool ModelsRead = false;              // True if the models have been read
+   std::vector<HectorSkyFibre> SkyFibreList;   // Sky fibre details, as read
+   bool SkyFibresRead = false;           // True if the sky fibre file was read
+   bool SkyFibresOk = true;              // False if reading it gave an error
+   std::string SkyFibresError = "";      // That error, if any
+   std::vector<std::string> SkyFibreWarnings;  // Any warnings reading it
+};
+
 //  A HectorFileHeader structure contains any details read from the input file that
 //  have to be included in the output file.
 
@@ -170,6 +241,8 @@ struct HectorUtilProgDetails {
    std::string Label = "";               // Value of output file LABEL field
    std::string PlateID = "";             // Value of output file PLATEID field
    std::string DateAndTime = "";         // Obs date/time, eg 2020 01 28 15 30 00.00"
+   bool PrintMeridianTime = true;        // Print the UT picked if no time given
+   std::string MeridianTimeMessage = ""; // Says what UT was picked, if one was
    bool MechCorrection = true;           // Apply mechanical offset corrections
    bool TeleCorrection = true;           // Apply telecentricity corrections
    bool LinCorrection = true;            // Apply linearity corrections
@@ -194,6 +267,7 @@ struct HectorUtilProgDetails {
    int NumberPars = 0;                   // Number of items used in Pars.
    HectorRaDecXY CoordConverter;         // Instance of coordinate converter
    bool ConverterInitialised = false;    // True once converter initialised
+   HectorAstrometry Astrometry;          // Mean <-> apparent for Mjd
    double CentreRa = 0.0;                // Central Ra in radians
    double CentreDec = 0.0;               // Central Dec in radians
    double FieldRadius = 0.0;             // Field radius in radians
@@ -201,11 +275,38 @@ struct HectorUtilProgDetails {
    std::string DistFileName = "";        // Name of 2dF distortion file
    std::string LinFileName = "";         // Name of 2dF linearity file
    std::string ProfitDirectory = "";     // Directory holding Profit maskfiles
+   std::string ProfitCacheDirectory = "";// Directory for cached mask data
+   bool UseTempCache = false;            // Cache mask data in a temporary dir
    std::string DebugLevels = "";         // Used to control debugging
+   std::string SweepSpec = "";           // Sweep mode epochs, as specified
+   std::vector<HectorSweepEpoch> SweepEpochs; // Sweep mode epochs, parsed
+   double SurrogateTolerance = 0.0;      // Max error for fast conversion, microns
+   int Threads = 0;                      // Threads for conversions, 0 => 1 per core
+   bool UseClearMaps = false;            // Check sky using clearance maps
+   bool UseCountTables = false;          // Speed sky checks with count tables
+   std::string ManifestFileName = "";    // File listing tiles, if any
+   int Workers = 0;                      // Tiles processed at once, 0 => 1 per core
+   std::string ServeSpec = "";           // Service socket path, or "-" for stdin
    std::string Error = "";               // Describes last error
    std::vector<std::string> Warnings;    // Any warning messages.
 };
 
+//  A HectorServiceState structure holds everything a service keeps from one
+//  request to the next: the models and sky fibre details, read just once as
+//  they are for a manifest, the sessions currently open, indexed by the IDs
+//  given them by the clients, and the session used to configure tiles. Each
+//  open session has been set up for a field centre, observing time,
+//  temperatures and XY rotation matrix, so that any number of conversions and
+//  sky checks can be made without setting these up again.
+
+struct HectorServiceState {
+   HectorSharedDetails Shared;           // Models and sky fibres, read once
+   std::map<std::string,std::shared_ptr<HectorConfigSession> > Sessions;
+                                         // Open sessions
+   std::shared_ptr<HectorConfigSession> TileSession;  // Configures tiles
+   bool QuitRequested = false;           // Set when a client asks to quit
+};
+
 #endif
 
 // ----------------------------------------------------------------------------------
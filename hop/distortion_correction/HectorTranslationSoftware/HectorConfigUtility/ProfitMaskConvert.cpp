@@ -0,0 +1,224 @@
+//
+//                  P r o f i t  M a s k  C o n v e r t . c p p
+//
+//  Function:
+//     Converts a Profit mask file into a tile-compressed FITS file.
+//
+//  Description:
+//     ProfitSkyCheck can read Profit mask files that are plain FITS files,
+//     gzipped FITS files, or tile-compressed FITS files. A gzipped file has to be
+//     decompressed in its entirety just to read any of it, which can take
+//     several seconds for each file. A tile-compressed file holds the image as
+//     a set of separately compressed rectangular tiles, and ProfitSkyCheck only
+//     needs to decompress the tiles that cover the field it is working on.
+//
+//     This program reads a mask file (which can be gzipped) and writes a
+//     tile-compressed version of it. By default, it keeps only whether or not
+//     each pixel is greater than zero - all ProfitSkyCheck uses - writing 1 or 0
+//     for each pixel, and compresses the result using the PLIO_1 algorithm,
+//     which does extremely well with this sort of data. If -rice is specified,
+//     the original pixel values are kept, and compressed using RICE_1. Either
+//     way, the compression is lossless as far as ProfitSkyCheck is concerned,
+//     and all the header keywords, in particular the WCS keywords, are copied.
+//
+//  Usage:
+//     ProfitMaskConvert <input_file> [<output_file>] [-rice]
+//
+//     If <output_file> is omitted, the output file name is the input file name
+//     with any .gz extension removed and .fz added. The output file must not
+//     already exist. If the input file name has the mask centre and range
+//     encoded in it, as ProfitSkyCheck expects, so will the default output file
+//     name, so the output file can go straight into the mask file directory (in
+//     place of the original).
+//
+//  Author(s): Hector Observations Pipeline team, (HOP)
+//
+//  History:
+//     16th Oct 2026.  Original version. HOP.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "fitsio.h"
+
+using std::string;
+
+//  The size of the (square) tiles used for the compressed image, in pixels.
+//  ProfitSkyCheck reads the part of the mask that covers the field, so tiles
+//  much smaller than that keep down the amount it has to decompress that it
+//  doesn't need, but very small tiles compress less well.
+
+static const long TileSize = 512;
+
+//  The number of pixels copied at a time.
+
+static const long PixelsPerCopy = 1024 * 1024;
+
+// ----------------------------------------------------------------------------------
+
+//                        R e p o r t  F i t s  E r r o r
+//
+//  Reports a cfitsio error, with a description of what was being done.
+
+static void ReportFitsError (const string& Action, int Status)
+{
+   char FitsError[80];
+   fits_get_errstatus (Status,FitsError);
+   printf ("Error %s: %s\n",Action.c_str(),FitsError);
+}
+
+// ----------------------------------------------------------------------------------
+
+//                                  M a i n
+
+int main (int argc, char* argv[])
+{
+   //  Sort out the command line arguments.
+
+   string InputFile = "";
+   string OutputFile = "";
+   bool KeepValues = false;
+   bool ArgsOK = true;
+   for (int IArg = 1; IArg < argc; IArg++) {
+      string Arg = argv[IArg];
+      if (Arg == "-rice") KeepValues = true;
+      else if (InputFile == "") InputFile = Arg;
+      else if (OutputFile == "") OutputFile = Arg;
+      else ArgsOK = false;
+   }
+   if (!ArgsOK || InputFile == "") {
+      printf ("Usage: ProfitMaskConvert <input_file> [<output_file>] [-rice]\n");
+      return 1;
+   }
+   if (OutputFile == "") {
+      OutputFile = InputFile;
+      size_t Len = OutputFile.length();
+      if (Len > 3 && !OutputFile.compare(Len - 3,3,".gz")) {
+         OutputFile.erase(Len - 3);
+      }
+      OutputFile += ".fz";
+   }
+
+   fitsfile* InFptr = NULL;
+   fitsfile* OutFptr = NULL;
+   int Status = 0;
+
+   //  This 'do' is just a sequence of operations any one of which could go wrong.
+
+   do {
+
+      //  Open the input file, and get the dimensions of its image.
+
+      fits_open_image (&InFptr,InputFile.c_str(),READONLY,&Status);
+      if (Status != 0) {
+         ReportFitsError ("opening " + InputFile,Status);
+         break;
+      }
+      int Bitpix = 0;
+      int NDims = 0;
+      long Dims[2] = {0,0};
+      fits_get_img_param (InFptr,2,&Bitpix,&NDims,Dims,&Status);
+      if (Status != 0) {
+         ReportFitsError ("getting image size of " + InputFile,Status);
+         break;
+      }
+      if (NDims != 2) {
+         printf ("Error: Data array in '%s' is not a 2D array\n",
+                                                          InputFile.c_str());
+         Status = BAD_NAXIS;
+         break;
+      }
+      long Nx = Dims[0];
+      long Ny = Dims[1];
+
+      //  Create the output file, and set it up for tile-compression. Just
+      //  writing the image then compresses it.
+
+      fits_create_file (&OutFptr,OutputFile.c_str(),&Status);
+      if (Status != 0) {
+         ReportFitsError ("creating " + OutputFile,Status);
+         break;
+      }
+      long TileDims[2] = {std::min(TileSize,Nx),std::min(TileSize,Ny)};
+      fits_set_compression_type (OutFptr,KeepValues ? RICE_1 : PLIO_1,&Status);
+      fits_set_tile_dim (OutFptr,2,TileDims,&Status);
+      fits_create_img (OutFptr,LONG_IMG,2,Dims,&Status);
+      if (Status != 0) {
+         ReportFitsError ("creating compressed image in " + OutputFile,Status);
+         break;
+      }
+
+      //  Copy all the header keywords, apart from those that describe the
+      //  structure of the file, which have already been set for the new image.
+
+      int NKeys = 0;
+      fits_get_hdrspace (InFptr,&NKeys,NULL,&Status);
+      for (int IKey = 1; IKey <= NKeys && Status == 0; IKey++) {
+         char Card[FLEN_CARD];
+         fits_read_record (InFptr,IKey,Card,&Status);
+         int KeyClass = fits_get_keyclass (Card);
+         if (KeyClass == TYP_STRUC_KEY || KeyClass == TYP_CMPRS_KEY ||
+                                              KeyClass == TYP_CKSUM_KEY) continue;
+         fits_write_record (OutFptr,Card,&Status);
+      }
+      if (Status != 0) {
+         ReportFitsError ("copying header keywords",Status);
+         break;
+      }
+
+      //  And copy the data, a block of rows at a time. The data is read as int,
+      //  whatever the type in the input file, and cfitsio will convert it if
+      //  necessary. It won't convert data when writing a compressed image,
+      //  which is why the new image is always created as 32-bit int. cfitsio
+      //  compresses each tile as it is completed, and needs each block to be
+      //  a whole number of rows of tiles.
+
+      long RowsPerCopy = std::max(1L,PixelsPerCopy / Nx);
+      RowsPerCopy = std::max(1L,RowsPerCopy / TileDims[1]) * TileDims[1];
+      std::vector<int> Buffer(std::min(RowsPerCopy,Ny) * Nx);
+      int Nullval = 0;
+      int Anynull = 0;
+      for (long FirstRow = 0; FirstRow < Ny && Status == 0;
+                                                   FirstRow += RowsPerCopy) {
+         long Rows = std::min(RowsPerCopy,Ny - FirstRow);
+         LONGLONG StartPixel = (LONGLONG)FirstRow * Nx + 1;
+         LONGLONG Pixels = (LONGLONG)Rows * Nx;
+         fits_read_img (InFptr,TINT,StartPixel,Pixels,&Nullval,Buffer.data(),
+                                                           &Anynull,&Status);
+         if (Status != 0) break;
+         if (!KeepValues) {
+            for (LONGLONG I = 0; I < Pixels; I++) {
+               Buffer[I] = (Buffer[I] > 0) ? 1 : 0;
+            }
+         }
+         fits_write_img (OutFptr,TINT,StartPixel,Pixels,Buffer.data(),&Status);
+      }
+      if (Status != 0) {
+         ReportFitsError ("copying data to " + OutputFile,Status);
+         break;
+      }
+
+   } while (false);
+
+   //  Close the files. If anything went wrong, delete the output file rather
+   //  than leave a partial one around.
+
+   int IgnoreStatus = 0;
+   if (InFptr) fits_close_file (InFptr,&IgnoreStatus);
+   if (OutFptr) {
+      IgnoreStatus = 0;
+      if (Status == 0) {
+         fits_close_file (OutFptr,&Status);
+         if (Status != 0) ReportFitsError ("closing " + OutputFile,Status);
+      } else {
+         fits_delete_file (OutFptr,&IgnoreStatus);
+      }
+   }
+   if (Status == 0) printf ("Written %s\n",OutputFile.c_str());
+
+   return (Status == 0) ? 0 : 1;
+}
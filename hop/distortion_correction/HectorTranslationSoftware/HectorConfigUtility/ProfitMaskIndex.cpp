@@ -0,0 +1,93 @@
+//
+//                    P r o f i t  M a s k  I n d e x . c p p
+//
+//  Function:
+//     Creates or updates the footprint index for a Profit mask file directory.
+//
+//  Description:
+//     ProfitSkyCheck has to know where on the sky each mask file in the mask
+//     file directory is, so it can find the ones that overlap the field it is
+//     working on. Without an index, it gets this from the file names, which
+//     means these have to have the area each mask covers encoded in them, and
+//     any file whose name doesn't has to be opened - slow for a gzipped file -
+//     and renamed.
+//
+//     This program writes an index file (ProfitMaskIndex.txt) into the mask
+//     file directory, giving the footprint on the sky of each mask file and all
+//     its header keywords. ProfitSkyCheck uses this, if it is there, to find the
+//     masks that overlap the field, and doesn't need to open a mask file until
+//     it needs its data. Whatever the files are called, they are not renamed.
+//
+//     If there is already an index, it is updated, and only the files that have
+//     been added or changed since it was written are opened, so this can be run
+//     quickly whenever the contents of the directory change. A file that has
+//     changed since the index was written is ignored by ProfitSkyCheck (with a
+//     warning) until this is run again.
+//
+//  Usage:
+//     ProfitMaskIndex [<directory>] [-debug <levels>]
+//
+//     If <directory> is omitted, the directory given by the environment variable
+//     PROFIT_DIR is used. -debug "*.Files" lists the files as they are indexed.
+//
+//  Author(s): Hector Observations Pipeline team, (HOP)
+//
+//  History:
+//     16th Oct 2026.  Original version. HOP.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#include "ProfitSkyCheck.h"
+
+using std::string;
+
+// ----------------------------------------------------------------------------------
+
+//                                  M a i n
+
+int main (int argc, char* argv[])
+{
+   //  Sort out the command line arguments.
+
+   string Directory = "";
+   string DebugLevels = "";
+   bool ArgsOK = true;
+   for (int IArg = 1; IArg < argc; IArg++) {
+      string Arg = argv[IArg];
+      if (Arg == "-debug" && IArg + 1 < argc) DebugLevels = argv[++IArg];
+      else if (Directory == "") Directory = Arg;
+      else ArgsOK = false;
+   }
+   if (Directory == "") {
+      const char* ProfitDir = getenv("PROFIT_DIR");
+      if (ProfitDir) Directory = ProfitDir;
+   }
+   if (!ArgsOK || Directory == "") {
+      printf ("Usage: ProfitMaskIndex [<directory>] [-debug <levels>]\n");
+      return 1;
+   }
+
+   //  All the work is done by the ProfitSkyCheck code. Any warnings about
+   //  files that couldn't be indexed are output when SkyChecker is destroyed.
+
+   int Status = 0;
+   {
+      ProfitSkyCheck SkyChecker;
+      SkyChecker.SetDebugLevels (DebugLevels);
+      int NEntries = 0;
+      int NChanged = 0;
+      int NRemoved = 0;
+      if (SkyChecker.UpdateMaskIndex (Directory,&NEntries,&NChanged,&NRemoved)) {
+         printf ("Index for %s lists %d mask files, %d new or changed, "
+                 "%d removed\n",Directory.c_str(),NEntries,NChanged,NRemoved);
+      } else {
+         printf ("Error: %s\n",SkyChecker.GetError().c_str());
+         Status = 1;
+      }
+   }
+
+   return Status;
+}
@@ -55,12 +55,93 @@
 //                     assume a common range for all mask files have gone. Also
 //                     the warnings about file names not matching the actual WCS
 //                     coordinates now use more realistic tests. KS.
+//     16th Oct 2026.  The mask data is now held as one bit per pixel, packed
+//                     into 64-bit words. ReadFileData() reads the data a block
+//                     of rows at a time and packs it as it goes, so the full
+//                     int array is never needed, and CheckUseForSky() now works
+//                     out which pixels in each row of the test area need to be
+//                     checked and tests them a word at a time using the new
+//                     MaskRangeSet(). It gives exactly the same results. HOP.
+//     16th Oct 2026.  Added BuildClearanceMaps(), which works out the distance
+//                     from each pixel in the field area of each mask to the
+//                     nearest non-zero pixel, using a separable Euclidean
+//                     distance transform, and GetClearRadius(), which uses
+//                     these maps to return the clear radius around a sky
+//                     position with a single lookup. Added the "ClearMap"
+//                     debug level. HOP.
+//     16th Oct 2026.  Added BuildCountTables(), which builds a summed-area table
+//                     of the non-zero pixels in the field area of each mask.
+//                     If these have been built, CheckUseForSky() only looks at
+//                     the individual pixels if the table shows there are some
+//                     non-zero pixels in the rectangle around the test circle.
+//                     The calculation of the field area has been moved into
+//                     GetFieldPixelRange(). Added the "CountTable" debug
+//                     level. HOP.
+//     16th Oct 2026.  Added support for tile-compressed (.fz) mask files. Files
+//                     are now opened using fits_open_image(), which finds the
+//                     image in a tile-compressed file, and the image dimensions
+//                     are found using fits_get_img_size(). ReadFileData() now
+//                     only reads the part of the mask that covers the field,
+//                     using fits_read_subset(), so for a tile-compressed file
+//                     only the tiles in that part are decompressed. Added
+//                     GetRadiusInPixels() and FitsExtensionPosn(). HOP.
+//     16th Oct 2026.  Initialise() now only reads the file headers. The mask
+//                     data is read by the new LoadMaskData() when a query first
+//                     needs it, and then only the blocks around the position
+//                     queried, using the new ReadMaskRect(). ReadFileData() has
+//                     been replaced by AddFileDetails(). ReadAndCheckFile() no
+//                     longer leaves the mask file open. RenameMaskFile() now
+//                     updates the path in the file's details. HOP.
+//     16th Oct 2026.  Added the optional mask cache - see SetCacheDirectory().
+//                     GetDetailsFromHeader() has been split out of
+//                     GetFileDetails() so that the header keywords can be taken
+//                     from a cache file instead of the mask file. HOP.
+//     16th Oct 2026.  Added the footprint index for a mask file directory - see
+//                     UpdateMaskIndex(). If there is an index, Initialise() uses
+//                     it to find the masks that overlap the field, and takes
+//                     their details from it instead of opening them. Added
+//                     UpdateMaskIndex(), MakeIndexEntry(), ReadMaskIndex(),
+//                     WriteMaskIndex(), BuildIndexBands(), FindIndexedMasks()
+//                     and AddIndexedFile(). HOP.
+//     16th Oct 2026.  Mask files are now read several at once, in separate
+//                     threads, where that helps. Initialise() now works out what
+//                     to do with each file before doing it, and reads the headers
+//                     of all the files it has to open at once, using the new
+//                     PrereadHeaders() and GetMaskDetails(). LoadMaskData() has
+//                     been split into PrepareMaskLoad(), ReadMaskLoad() and
+//                     FinishMaskLoad(), so that the new LoadFieldAreas() can read
+//                     the data for several masks at once. Added PreloadMasks()
+//                     and SetThreads(). HOP.
+//     16th Oct 2026.  Added CheckPositionsForSky(), which checks a list of
+//                     positions at once. The work CheckUseForSky() does for each
+//                     mask has been split out into GetSkyCheckRect() and
+//                     MaskRectContaminated() so the two share it, and that of
+//                     LocatePixFromCoords() and GetPixelDims() into LocatePixel()
+//                     and PixelDims(), which can be used from several threads.
+//                     LoadFieldAreas() now uses the new LoadMaskAreas(). An
+//                     error from WCS getting the pixel scale at a position now
+//                     leaves it unchecked, with that error, rather than ending
+//                     the search of the masks as if none had covered it. HOP.
+//     16th Oct 2026.  Different ProfitSkyCheck objects can now be used in
+//                     different threads at once: Initialise() and
+//                     UpdateMaskIndex() are serialised by G_InitMutex, and the
+//                     temporary names used for new cache and index files are
+//                     unique to the thread as well as the process. HOP.
 
 // ----------------------------------------------------------------------------------
 
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
@@ -80,6 +161,139 @@ using std::list;
 
 static const double DegToAsec = 60.0 * 60.0;
 
+//  The number of bits in each word of the packed mask data.
+
+static const int BitsPerWord = 64;
+
+//  The number of pixels read from a mask file at a time by ReadMaskRect().
+
+static const long PixelsPerRead = 1024 * 1024;
+
+//  LoadMaskData() reads mask data in square blocks of this many pixels, the
+//  same as the size of the tiles ProfitMaskConvert uses for a tile-compressed
+//  file. This must be a multiple of BitsPerWord.
+
+static const int LoadBlockSize = 512;
+
+//  A mask cache file starts with this structure, followed by the header keywords
+//  from the mask file, 80 characters each. The mask bits start at DataOffset,
+//  a multiple of CachePageBytes, each row taking WordsPerRow 64-bit words, as
+//  in MaskBits. The Source values are used to check the cache file is up to
+//  date with the mask file - see GetSourceKey(). The file is only ever read by
+//  the same sort of machine that wrote it, so the values are in native order.
+
+struct MaskCacheHeader {
+   char Magic[8];
+   int32_t Version;
+   int32_t NKeys;
+   int32_t Nx;
+   int32_t Ny;
+   int32_t WordsPerRow;
+   int32_t Spare;
+   int64_t DataOffset;
+   int64_t SourceSize;
+   int64_t SourceModTime;
+   uint64_t SourceChecksum;
+};
+
+static const char CacheMagic[8] = {'P','r','o','f','i','t','B','i'};
+static const int32_t CacheVersion = 1;
+
+//  The data in a cache file starts on a boundary of this many bytes, which is
+//  a multiple of the memory page size on any likely machine.
+
+static const long CachePageBytes = 16384;
+
+//  The number of bytes at each end of a mask file included in the checksum
+//  that GetSourceKey() works out.
+
+static const long CacheSampleBytes = 1024 * 1024;
+
+//  The clearance maps hold the clear radius around each pixel as a number of
+//  steps of this size, in arcsec, in a single byte, so the largest radius they
+//  can distinguish is 255 steps.
+
+static const double ClearMapStepAsec = 0.1;
+static const int ClearMapMaxSteps = 255;
+
+//  The number of rows of a clearance map worked out at a time.
+
+static const int ClearMapStripRows = 256;
+
+//  The footprint index for a mask file directory - see UpdateMaskIndex() - is a
+//  file with this name in the directory, and its first line is MaskIndexId.
+//  When the index is read, its entries are sorted into bands of Dec this wide.
+
+static const char* const MaskIndexName = "ProfitMaskIndex.txt";
+static const char* const MaskIndexId = "ProfitMaskIndex 1";
+static const double IndexBandDeg = 1.0;
+
+//  Initialise() may rename mask files, and it and UpdateMaskIndex() use wcspih(),
+//  which isn't reentrant, so only one object at a time in the process may be
+//  running either of them. This mutex makes sure of that.
+
+static std::mutex G_InitMutex;
+
+//  Used to make the temporary names of new cache and index files unique, even
+//  when several objects are writing them at once - see TempFileSuffix().
+
+static std::atomic<long> G_TempFileCount(0);
+
+//  Initialise() works out what needs to be done with each mask file that may be
+//  needed before doing any of it, and keeps the details in one of these.
+
+struct MaskFileAction {
+   string MaskFile = "";         //  Full path name of the mask file.
+   int IndexEntry = -1;          //  Footprint index entry to use, or -1 if none.
+   bool HasRanges = false;       //  The file name gives the Ra,Dec ranges.
+   double FileRaDeg = 0.0;       //  Central Ra,Dec from the file name (deg).
+   double FileDecDeg = 0.0;
+   double FileRaRangeDeg = 0.0;  //  Ra,Dec range from the file name (deg), or
+   double FileDecRangeDeg = 0.0; //  as found from the file header.
+};
+
+//  LoadMaskData() and LoadFieldAreas() keep the details of the mask data to be
+//  read from a mask file in one of these - see PrepareMaskLoad().
+
+struct ProfitMaskLoad {
+   ProfitFileDetails* Details = NULL; // The mask the data is for.
+   string Path = "";             //  Full path name of the mask file.
+   uint64_t** MaskBits = NULL;   //  New array of mask bits, to replace the old.
+   int WordsPerRow = 0;          //  Number of 64-bit words in each row of it.
+   int Ix0 = 0;                  //  Pixel coordinates (from 1) of the first
+   int Iy0 = 0;                  //  pixel in the new array.
+   int Nx = 0;                   //  Number of pixels in each row of it.
+   int Ny = 0;                   //  Number of rows in it.
+   std::vector<std::vector<int> > Needed; // Rectangles (Ix0,Ix1,Iy0,Iy1) to read.
+   string Error = "";            //  Description of any error.
+};
+
+//  GetSkyCheckRect() works out where a position to be checked falls in a mask,
+//  and the rectangle of pixels round it that has to be checked, in one of these.
+//  Result is one of the SkyRectResult values.
+
+enum SkyRectResult {
+   RECT_COVERED,                 //  The mask covers the position.
+   RECT_OUTSIDE,                 //  The position is outside the field area.
+   RECT_ERROR,                   //  Error from WCS locating the position.
+   RECT_ABANDONED                //  Error from WCS getting the pixel scale.
+};
+
+struct ProfitSkyRect {
+   SkyRectResult Result = RECT_OUTSIDE;
+   string Error = "";            //  Description of any error.
+   int PIx = 0;                  //  Pixel coordinates (from 1) of the pixel
+   int PIy = 0;                  //  that contains the position.
+   double CentreRaDeg = 0.0;     //  Ra,Dec of the centre of that pixel (deg).
+   double CentreDecDeg = 0.0;
+   double DeltaRaDeg = 0.0;      //  Ra,Dec range covered by that pixel (deg).
+   double DeltaDecDeg = 0.0;
+   int Ixst = 0;                 //  The rectangle of pixels to check, clipped
+   int Ixen = 0;                 //  to the field area.
+   int Iyst = 0;
+   int Iyen = 0;
+};
+
 // ----------------------------------------------------------------------------------
 //
 //                            C o n s t r u c t o r
@@ -91,12 +305,15 @@ static const double DegToAsec = 60.0 * 60.0;
 ProfitSkyCheck::ProfitSkyCheck (void) : I_Debug("Profit")
 {
    I_Initialised = false;
+   I_ClearMapsBuilt = false;
    I_ErrorText = "";
    
    //  The directory path and the field centre and size will be set when
    //  Initialise() is called.
    
    I_DirectoryPath = "";
+   I_CacheDirectory = "";
+   I_Threads = 0;
    I_CentralRaDeg = 0.0;
    I_CentralDecDeg = 0.0;
    I_FieldRadiusDeg = 0.0;
@@ -113,7 +330,8 @@ ProfitSkyCheck::ProfitSkyCheck (void) : I_Debug("Profit")
    //  they use need to be included in this list.
    
    I_Debug.LevelsList(
-        "Files,SkyCheck,SkyCheckFiles,SkyCheckCoords,SkyCheckDist");
+        "Files,SkyCheck,SkyCheckFiles,SkyCheckCoords,SkyCheckDist,ClearMap,"
+        "CountTable");
 
 }
 
@@ -125,9 +343,14 @@ ProfitSkyCheck::ProfitSkyCheck (void) : I_Debug("Profit")
 
 ProfitSkyCheck::~ProfitSkyCheck ()
 {
-   //  At present, nothing needs to be released. The arrays allocated to hold
-   //  the mask data are released automatically when the array manager closes
-   //  down.
+   //  The arrays allocated to hold the mask data are released automatically
+   //  when the array manager closes down, but any cache files mapped into
+   //  memory need to be unmapped.
+   
+   for (ProfitFileDetails& Details : I_FileDetails) {
+      if (Details.CacheMap) munmap (Details.CacheMap,Details.CacheMapSize);
+      Details.CacheMap = NULL;
+   }
    
    //  But we will output any warnings that we'd built up.
    
@@ -143,10 +366,14 @@ ProfitSkyCheck::~ProfitSkyCheck ()
 //  This routine does a lot of the work. It works through all the FITS files in
 //  the directory whose path is passed, opening them up and looking to see if they
 //  contain masks that cover any part of the area of sky currently of interest.
-//  If they do, it reads the mask data and adds the details about the file to
-//  the list of relevant files held in I_FileDetails. Note that the files are
-//  not left open - this routine reads what it needs into memory (mainly the
-//  mask data itself and the necessary coordinate data) and then closes the file.
+//  If they do, it adds the details about the file to the list of relevant files
+//  held in I_FileDetails. Note that the files are not left open - this routine
+//  reads the necessary coordinate data from the header and then closes the file.
+//  It does not read the mask data itself. That is read by LoadMaskData() when
+//  a query first needs it, and then only the part of the mask around the
+//  position queried - see programming notes. If the directory has a footprint
+//  index (see UpdateMaskIndex()), the files in the index are handled using the
+//  details it holds, and are never opened here.
 
 bool ProfitSkyCheck::Initialise (
    const string& DirectoryPath, double CentralRaDeg,
@@ -154,6 +381,8 @@ bool ProfitSkyCheck::Initialise (
 {
    bool ReturnOK = false;
    
+   std::lock_guard<std::mutex> Lock(G_InitMutex);
+   
    //  This 'do' is just a sequence of operations any one of which could go wrong.
    //  If anything goes wrong, I set OkSoFar false and break out of the sequence.
    //  Anything that does go wrong is supposed to put a sufficient explanation
@@ -186,76 +415,128 @@ bool ProfitSkyCheck::Initialise (
       OkSoFar = GetListOfMaskFiles();
       if (!OkSoFar) break;
       
-      //  Work through all the files in the directory.
-         
+      //  If there's a footprint index for the directory, find the masks it
+      //  lists that might overlap the field. A problem with the index isn't
+      //  fatal - the files are just handled as if there were no index.
+      
+      std::vector<bool> IndexOverlaps;
+      if (!ReadMaskIndex()) I_Warnings.push_back(I_ErrorText);
+      FindIndexedMasks (IndexOverlaps);
+      
+      //  Work through all the files in the directory, deciding what needs to
+      //  be done with each one, but without opening any of them. That way, the
+      //  headers of all the files that do need to be opened can be read at
+      //  once, which is where the time goes - see PrereadHeaders().
+      
+      std::vector<MaskFileAction> Actions;
+      std::vector<string> FilesToRead;
       for (const string& MaskFile : I_MaskFileList) {
          
          I_Debug.Log ("Files","Considering " + MaskFile);
+         MaskFileAction Action;
+         Action.MaskFile = MaskFile;
+         
+         //  If the file is in the index, we already know whether it overlaps
+         //  the field, and if it does and hasn't changed since it was indexed,
+         //  everything we need to know about it is in the index, whatever the
+         //  file is called. If it has changed, we treat it as if it weren't
+         //  in the index at all.
+         
+         std::map<string,int>::const_iterator Indexed =
+               I_IndexLookup.find(MaskFile.substr(I_DirectoryPath.length() + 1));
+         if (Indexed != I_IndexLookup.end()) {
+            if (!IndexOverlaps[Indexed->second]) continue;
+            if (IndexEntryCurrent (MaskFile,I_IndexEntries[Indexed->second])) {
+               Action.IndexEntry = Indexed->second;
+               Actions.push_back(Action);
+               continue;
+            }
+            I_Warnings.push_back("Footprint index entry for " + MaskFile +
+                                                           " is out of date");
+         }
          
          //  Extract the central Ra,Dec position from the file name. If we can't
          //  decode it, we don't treat this as an error, but we ignore the file
          //  and log a warning about it. See programming notes.
          
-         double FileRaDeg,FileDecDeg,FileRaRangeDeg,FileDecRangeDeg;
-         bool HasRanges;
          string Prefix;
          string Extension;
          if (!GetCoordsFromFileName (MaskFile,Prefix,Extension,
-             &FileRaDeg,&FileDecDeg,&HasRanges,&FileRaRangeDeg,&FileDecRangeDeg)) {
+                 &Action.FileRaDeg,&Action.FileDecDeg,&Action.HasRanges,
+                           &Action.FileRaRangeDeg,&Action.FileDecRangeDeg)) {
             I_Warnings.push_back(I_ErrorText);
             continue;   // Handle next file.
          }
          
-         //  We now have two possibilities, depending on whether or not the file
-         //  name included Ra,Dec range information or not.
+         //  If we have the Ra,Dec range from the file name, we can immediately
+         //  see if the mask file overlaps the field in question.  If not, we
+         //  ignore the file. If the file name doesn't include range
+         //  information, we have to open the file and examine the WCS data it
+         //  contains to find out.
+
+         if (Action.HasRanges && !FileOverlapsField(
+                     Action.FileRaDeg,Action.FileDecDeg,Action.FileRaRangeDeg,
+                     Action.FileDecRangeDeg,I_CentralRaDeg,I_CentralDecDeg,
+                                                         I_FieldRadiusDeg)) {
+            continue;   // Handle next file.
+         }
+         Actions.push_back(Action);
+         FilesToRead.push_back(MaskFile);
+      }
+      
+      PrereadHeaders (FilesToRead);
+      
+      //  Now handle each file that may be needed, in the same order.
+      
+      for (MaskFileAction& Action : Actions) {
+         const string& MaskFile = Action.MaskFile;
          
-         if (HasRanges) {
+         if (Action.IndexEntry >= 0) {
          
-            //  If we have the Ra,Dec range from the file name, we can immediately
-            //  see if the mask file overlaps the field in question.  If not, we
-            //  ignore the file.
-
-            if (!FileOverlapsField(
-                        FileRaDeg,FileDecDeg,FileRaRangeDeg,FileDecRangeDeg,
-                              I_CentralRaDeg,I_CentralDecDeg,I_FieldRadiusDeg)) {
-               continue;   // Handle next file.
-            }
+            //  The file is in the index. Add its details to I_FileDetails.
             
-            //  This is a file that overlaps the field. Open it up, check the
-            //  WCS data in the header against the file's claimed central Ra,Dec,
-            //  and range, read the mask data, and add the relevant details to
-            //  the file list in I_FileDetails.
+            OkSoFar = AddIndexedFile (MaskFile,I_IndexEntries[Action.IndexEntry]);
+            if (!OkSoFar) break;  // Break from file loop, showing a problem.
+         
+         } else if (Action.HasRanges) {
+         
+            //  This is a file whose name shows it overlaps the field. Check
+            //  the WCS data in the header against the file's claimed central
+            //  Ra,Dec, and range, and add the relevant details to the file list
+            //  in I_FileDetails.
             
-            OkSoFar = ReadAndCheckFile (MaskFile,FileRaDeg,FileDecDeg,
-                                           FileRaRangeDeg,FileDecRangeDeg);
+            OkSoFar = ReadAndCheckFile (MaskFile,Action.FileRaDeg,
+               Action.FileDecDeg,Action.FileRaRangeDeg,Action.FileDecRangeDeg);
             if (!OkSoFar) break;  // Break from file loop, showing a problem.
 
          } else {
          
             //  This is the trickier case where the file name does not include
             //  range information. In this case, we have to get that range
-            //  information by opening the file and examining the WCS data it
-            //  contains. Then we can decide if the mask file overlaps the field
-            //  in question and, if so, read its mask data and add the relevant
-            //  details to I_FileDetails. This sequence is best hived off to a
-            //  separate routine, CheckWCSandReadFile().
+            //  information from the WCS data in the file header. Then we can
+            //  decide if the mask file overlaps the field in question and, if
+            //  so, add the relevant details to I_FileDetails. This sequence is
+            //  best hived off to a separate routine, CheckWCSandReadFile().
             
-            OkSoFar = CheckWCSandReadFile (MaskFile,FileRaDeg,FileDecDeg,
-                                          &FileRaRangeDeg,&FileDecRangeDeg);
+            OkSoFar = CheckWCSandReadFile (MaskFile,Action.FileRaDeg,
+               Action.FileDecDeg,&Action.FileRaRangeDeg,&Action.FileDecRangeDeg);
             
             //  And we rename the file. Failure here shouldn't stop us - it
             //  may be that the files are write-protected, and that's fine.
             //  But we issue a warning.
             
             if (OkSoFar) {
-               if (!RenameMaskFile (MaskFile,FileRaRangeDeg,FileDecRangeDeg)) {
+               if (!RenameMaskFile (MaskFile,Action.FileRaRangeDeg,
+                                                    Action.FileDecRangeDeg)) {
                   I_Warnings.push_back(I_ErrorText);
                }
             }
          }
+         if (!OkSoFar) break;
          
          //break;  //  DEBUG - quit after one file (useful for testing sometimes).
       }
+      I_MaskHeaders.clear();
       if (!OkSoFar) break;
       
       //  Make sure we have some mask file data to work with - at least one
@@ -300,6 +581,27 @@ void ProfitSkyCheck::SetDebugLevels (const std::string& Levels)
    I_Debug.SetLevels(Levels);
 }
 
+// ----------------------------------------------------------------------------------
+//
+//                     F i t s  E x t e n s i o n  P o s n
+//
+//  Passed a (lower case) file name, returns the position of the start of its
+//  FITS extension - ".fits", ".fit" or ".fts", possibly followed by ".gz" or
+//  ".fz" - or string::npos if there isn't one. This assumes that the file is
+//  one that's been selected on the basis of having a FITS extension, and that
+//  these all start with ".f". The only complication is that ".fz" also starts
+//  with ".f", so if that's what we find, we look again in front of it.
+
+static size_t FitsExtensionPosn (const string& LowerName)
+{
+   size_t EndPosn = LowerName.rfind(".f");
+   if (EndPosn != string::npos && EndPosn > 0 &&
+                                 !LowerName.compare(EndPosn,string::npos,".fz")) {
+      EndPosn = LowerName.rfind(".f",EndPosn - 1);
+   }
+   return EndPosn;
+}
+
 // ----------------------------------------------------------------------------------
 //
 //                G e t  C o o r d s  F r o m  F i l e  N a m e
@@ -343,18 +645,15 @@ bool ProfitSkyCheck::GetCoordsFromFileName (const string& FileName,
    *DecRangeDeg = 0.0;
 
    //  Convert the file name to lower case, and try to split off the extension(s).
-   //  I'm assuming it's safe to look for a ".f" from the end of the string to
-   //  find the start of the extensions, since the file presumably has a .fits
-   //  .fts etc extension (possibly followed by a .gz). I'm assuming that this is
-   //  a file that's been selected on the basis of having a FITS extension, and
-   //  they all start with ".f".
+   //  FitsExtensionPosn() finds the ".f" that starts the .fits .fts etc
+   //  extension (possibly followed by a .gz or .fz).
    
    int NValues = 0;
    double Values[4];
    string LowerName = FileName;
    std::transform(LowerName.begin(),LowerName.end(),LowerName.begin(),
                         [](unsigned char c){ return std::tolower(c); });
-   size_t EndPosn = LowerName.rfind(".f");
+   size_t EndPosn = FitsExtensionPosn(LowerName);
    if (EndPosn != string::npos) {
    
       //  We've found a ".f". Clip off anything to the right of that, and
@@ -442,7 +741,7 @@ bool ProfitSkyCheck::RenameMaskFile (
    int NValues = 0;
    string Extension;
    string Prefix;
-   size_t EndPosn = LowerName.rfind(".f");
+   size_t EndPosn = FitsExtensionPosn(LowerName);
    if (EndPosn != string::npos) {
    
       //  We've got the start of the extension. Note the part of the filename
@@ -482,6 +781,14 @@ bool ProfitSkyCheck::RenameMaskFile (
          string ErrorString(string(strerror(errno)));
          I_ErrorText = "Error renaming '" + MaskFile + "': " + ErrorString;
          ReturnOK = false;
+      } else {
+      
+         //  If the file's details are already in the list of files in use, its
+         //  data still has to be read, so the details need the new name.
+         
+         for (ProfitFileDetails& Details : I_FileDetails) {
+            if (Details.Path == MaskFile) Details.Path = NewName;
+         }
       }
    } else {
    
@@ -512,10 +819,29 @@ bool ProfitSkyCheck::RenameMaskFile (
 //  and puts an error description in I_ErrorText. Most cases of failure should
 //  be because the coordinate is outside the range of the mask. In this case,
 //  Outside will be set true. If the function returns false with Outside set
-//  false, there has been some internal failure to converge.
+//  false, there has been some internal failure to converge. The work is done
+//  by LocatePixel().
 
 bool ProfitSkyCheck::LocatePixFromCoords (ProfitFileDetails& FileDetails,
                         double RaDeg,double DecDeg,int* Ix,int* Iy,bool* Outside)
+{
+   string Error = "";
+   bool ReturnOK = LocatePixel (FileDetails,RaDeg,DecDeg,Ix,Iy,Outside,&Error);
+   if (!ReturnOK) I_ErrorText = Error;
+   return ReturnOK;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                          L o c a t e  P i x e l
+//
+//  Does the work of LocatePixFromCoords(), returning any error description in
+//  Error rather than I_ErrorText. It only reads FileDetails - wcsp2s() doesn't
+//  change the wcsprm structure once it has been set up, unless the mask has
+//  distortions - so it can be used by several threads at once.
+
+bool ProfitSkyCheck::LocatePixel (ProfitFileDetails& FileDetails, double RaDeg,
+            double DecDeg, int* Ix, int* Iy, bool* Outside, string* Error)
 {
    bool ReturnOK = false;
    
@@ -567,11 +893,11 @@ bool ProfitSkyCheck::LocatePixFromCoords (ProfitFileDetails& FileDetails,
       if (IxTry == LastIx && IyTry == LastIy) {
          if ((IxTry == LastIx && (IxTry == 1 || IxTry == Nx)) ||
                  (IyTry == LastIy && (IyTry == 1 || IyTry == Nx))) {
-            I_ErrorText = "Coordinates " + FormatRaDecDeg(RaDeg,DecDeg) +
+            *Error = "Coordinates " + FormatRaDecDeg(RaDeg,DecDeg) +
                                               " are outside the mask range";
             *Outside = true;
          } else {
-            I_ErrorText = "Iteration stuck trying to locate " +
+            *Error = "Iteration stuck trying to locate " +
                               FormatRaDecDeg(RaDeg,DecDeg) + " in mask";
          }
          break;
@@ -581,14 +907,14 @@ bool ProfitSkyCheck::LocatePixFromCoords (ProfitFileDetails& FileDetails,
       LastIx = IxTry;
       LastIy = IyTry;
 
-      //  We use GetPixelDims() to return the actual central Ra,Dec for this
+      //  We use PixelDims() to return the actual central Ra,Dec for this
       //  pixel on the basis of the WCS information for the image. It also
       //  gives us the local values for the Ra,Dec scales, based on the way the
       //  sky coordinates vary across this particular pixel.
       
       double CenRa,CenDec,LocalDRa,LocalDDec;
-      if (!GetPixelDims(&FileDetails.Wcs, IxTry, IyTry, &CenRa, &CenDec,
-                                                       &LocalDRa, &LocalDDec)) {
+      if (!PixelDims(&FileDetails.Wcs, IxTry, IyTry, &CenRa, &CenDec,
+                                               &LocalDRa, &LocalDDec, Error)) {
          break;   //  Error converting coords.
       }
    
@@ -624,7 +950,7 @@ bool ProfitSkyCheck::LocatePixFromCoords (ProfitFileDetails& FileDetails,
    //  given a point outside the image would do this, for example.
    
    if (Tries >= MaxTries) {
-      I_ErrorText = "Failed to find pixel for coordinates: " +
+      *Error = "Failed to find pixel for coordinates: " +
          FormatRaDecDeg(RaDeg,DecDeg) + " after " +
          TcsUtil::FormatInt(MaxTries) + " iterations";
       ReturnOK = false;
@@ -650,11 +976,30 @@ bool ProfitSkyCheck::LocatePixFromCoords (ProfitFileDetails& FileDetails,
 //  If non-integer pixel coordinates are used, then this calculates for a 'pseudo
 //  pixel' from -0.5 to + 0.5 in each pixel coordinate. If the call to wcsp2s()
 //  that this uses fails, this returns false and sets an error description in
-//  I_ErrorText.
+//  I_ErrorText. The work is done by PixelDims().
 
 bool ProfitSkyCheck::GetPixelDims (
       wcsprm* WcsPtr,double FIx,double FIy,double* CentreRaDeg,double* CentreDecDeg,
       double* DeltaRaAsec,double* DeltaDecAsec)
+{
+   string Error = "";
+   bool ReturnOK = PixelDims (WcsPtr,FIx,FIy,CentreRaDeg,CentreDecDeg,
+                                              DeltaRaAsec,DeltaDecAsec,&Error);
+   if (!ReturnOK) I_ErrorText = Error;
+   return ReturnOK;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                            P i x e l  D i m s
+//
+//  Does the work of GetPixelDims(), returning any error description in Error
+//  rather than I_ErrorText, so that - like LocatePixel() - it can be used by
+//  several threads at once.
+
+bool ProfitSkyCheck::PixelDims (
+      wcsprm* WcsPtr,double FIx,double FIy,double* CentreRaDeg,double* CentreDecDeg,
+      double* DeltaRaAsec,double* DeltaDecAsec,string* Error)
 {
    bool ReturnOK = true;
    *DeltaRaAsec = 0.0;
@@ -683,7 +1028,7 @@ bool ProfitSkyCheck::GetPixelDims (
       char FitsError[80];
       int Status = 0;
       fits_get_errstatus (Status,FitsError);
-      I_ErrorText =
+      *Error =
          "Unable to convert at least one FITS coordinate using wcsp2s(): " +
                                                            string(FitsError);
       ReturnOK = false;
@@ -762,8 +1107,9 @@ bool ProfitSkyCheck::FileOverlapsField (
 //   range information. In this case the file needs to be opened and the range
 //   information determined from the WCS data in the header. If the central
 //   Ra,Dec and the determined range shows that this file potentially overlaps
-//   the current field of interest, then the file's mask data is read in and
-//   its details added to the list held in I_FileDetails. The routine is passed
+//   the current field of interest, then the file's details are added to the
+//   list held in I_FileDetails (the mask data itself is only read when a query
+//   needs it - see LoadMaskData()). The routine is passed
 //   the central Ra,Dec for the mask, which it is assumed was encoded in the
 //   file name, and it checks that this matches the WCS data held in the file.
 //   This routine returns the Ra,Dec range determined from the WCS data, and
@@ -775,23 +1121,20 @@ bool ProfitSkyCheck::CheckWCSandReadFile (
 {
    bool ReturnOK = true;
    
-   fitsfile* Fptr = NULL;
    ProfitFileDetails FileDetails;
    
    bool OKSoFar = true;
    
    do {
    
-      //  Open the file. An error here indicates this isn't a FITS format file.
-      
-      OKSoFar = OpenMaskFile (MaskFile,&Fptr);
-      if (!OKSoFar) break;
+      //  Get the file details including the WCS values. GetMaskDetails() gets
+      //  these from an up to date cache file if there is one, or from the
+      //  header already read by PrereadHeaders(), and otherwise opens the file.
+      //  An error here may just mean this isn't a mask file, althogh it may be
+      //  a perfectly good FITS file. We treat this as a severe error, but maybe
+      //  it should just be a warning?
       
-      //  Get the file details including the WCS values. An error here may just
-      //  mean this isn't a mask file, althogh it may be a perfectly good FITS file.
-      //  We treat this as a severe error, but maybe it should just be a warning?
-      
-      OKSoFar = GetFileDetails (MaskFile,Fptr,&FileDetails);
+      OKSoFar = GetMaskDetails (MaskFile,&FileDetails);
       if (!OKSoFar) break;
       
       //  Warn if the central Ra,Dec from the file name doesn't match that shown
@@ -817,16 +1160,12 @@ bool ProfitSkyCheck::CheckWCSandReadFile (
       if (!FileOverlapsField(FileRaDeg,FileDecDeg,*FileRaRangeDeg,*FileDecRangeDeg,
                           I_CentralRaDeg,I_CentralDecDeg,I_FieldRadiusDeg)) break;
       
-      //  If we get here, this overlaps the field. Read in its data and add to
-      //  the I_FileDetails list.
+      //  If we get here, this overlaps the field. Add it to the I_FileDetails
+      //  list. Its data will be read when it's needed.
       
-      OKSoFar = ReadFileData (MaskFile,Fptr,&FileDetails);
+      OKSoFar = AddFileDetails (&FileDetails);
    } while (false);
    
-   //  Close the file - this is safe, even if the file wasn't opened properly.
-   
-   CloseMaskFile (Fptr);
-   
    if (!OKSoFar) ReturnOK = false;
    
    return ReturnOK;
@@ -837,9 +1176,11 @@ bool ProfitSkyCheck::CheckWCSandReadFile (
 //                         O p e n  M a s k  F i l e
 //
 //  Opens a namesd FITS file, returning a pointer to the fitsfile structure
-//  used by the cfitsio routines. This routine returns true if the file was
-//  opened OK, false (with an error description set into I_ErrorText) if there
-//  was an error.
+//  used by the cfitsio routines. This uses fits_open_image(), which moves to
+//  the first HDU that contains an image - the primary HDU for a normal mask
+//  file, but the first extension for a tile-compressed one. This routine
+//  returns true if the file was opened OK, false (with an error description
+//  set into I_ErrorText) if there was an error.
 
 bool ProfitSkyCheck::OpenMaskFile (
    const std::string& MaskFile, fitsfile** Fptr)
@@ -849,7 +1190,7 @@ bool ProfitSkyCheck::OpenMaskFile (
    char FitsError[80];
    int Status = 0;
    I_Debug.Log ("Files","Opening file " + MaskFile);
-   fits_open_file (Fptr,MaskFile.c_str(),READONLY,&Status);
+   fits_open_image (Fptr,MaskFile.c_str(),READONLY,&Status);
    if (Status != 0) {
       fits_get_errstatus (Status,FitsError);
       I_ErrorText = "Failed to open '" + MaskFile + "' : " + string(FitsError);
@@ -894,12 +1235,37 @@ void ProfitSkyCheck::CloseMaskFile (fitsfile* Fptr)
 bool ProfitSkyCheck::GetFileDetails (
    const std::string& MaskFile, fitsfile* Fptr, ProfitFileDetails* FileDetails)
 {
-   static const int C_MaxDims = 7;
+   //  The header is read by ReadHeaderKeys(), and the rest of the work is done
+   //  from the header keywords, in a routine that can also work from a copy of
+   //  them held in a mask cache file or the footprint index.
    
-   bool ReturnOK = true;
+   ProfitMaskHeader Header;
+   if (!ReadHeaderKeys (MaskFile,Fptr,&Header)) {
+      I_ErrorText = Header.Error;
+      return false;
+   }
+   return GetDetailsFromHeader (MaskFile,&Header.Keys[0],Header.NKeys,
+                                               Header.Nx,Header.Ny,FileDetails);
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                      R e a d  H e a d e r  K e y s
+//
+//  Passed the addresss of a fitsfile structure for an already opened mask
+//  file, this routine gets the dimensions of its image, checking that it's
+//  2D, and all the header keywords, as returned by fits_hdr2str(), into a
+//  ProfitMaskHeader structure. It returns false, with an error description in
+//  the Error field of the structure, if anything goes wrong. This doesn't use
+//  anything other than what it's passed, so can be used by several threads at
+//  once, so long as cfitsio was built to allow that - see PrereadHeaders().
+
+bool ProfitSkyCheck::ReadHeaderKeys (
+       const std::string& MaskFile, fitsfile* Fptr, ProfitMaskHeader* Header)
+{
+   static const int C_MaxDims = 7;
    
    char* HeaderPtr = NULL;
-   wcsprm* WcsPtr = NULL;
 
    //  There are a few steps here, and I'm using the same overall scheme as in
    //  Initialise(), with a do structure that can be broken out of if anything
@@ -912,16 +1278,21 @@ bool ProfitSkyCheck::GetFileDetails (
       char FitsError[80];
       int Status = 0;
       
-      //  The file is already open. Get the dimensions of the main array from
-      //  the NAXIS and NAXIS1 and NAXIS2 keywords.
+      //  The file is already open. Get the dimensions of the main array. We
+      //  use fits_get_img_dim() and fits_get_img_size() rather than reading the
+      //  NAXIS keywords directly, as these give the dimensions of the image
+      //  in a tile-compressed file, not those of the table that holds it.
       
       long Dims[C_MaxDims];
-      int NDims;
-      fits_read_keys_lng(Fptr, const_cast<char*>("NAXIS"), 1, C_MaxDims, Dims,
-                                                              &NDims, &Status);
+      for (int Axis = 0; Axis < C_MaxDims; Axis++) Dims[Axis] = 1;
+      int NDims = 0;
+      fits_get_img_dim(Fptr, &NDims, &Status);
+      if (Status == 0 && NDims <= C_MaxDims) {
+         fits_get_img_size(Fptr, NDims, Dims, &Status);
+      }
       if (Status != 0) {
          fits_get_errstatus (Status,FitsError);
-         I_ErrorText = "Failed to get dimensions of '" + MaskFile + "' : " +
+         Header->Error = "Failed to get dimensions of '" + MaskFile + "' : " +
                                                              string(FitsError);
          OKSoFar = false;
          break;
@@ -930,31 +1301,65 @@ bool ProfitSkyCheck::GetFileDetails (
       //  We expect the mask array to be 2-dimensional.
       
       if (NDims != 2) {
-         I_ErrorText = "Data array in '" + MaskFile + "' is not a 2D array";
+         Header->Error = "Data array in '" + MaskFile + "' is not a 2D array";
          OKSoFar = false;
          break;
       }
       
-      //  Now onto the trickier part, handling the WCS coordinate system. This
-      //  is a standard sequence, using hdr2str() to get the keyword values,
-      //  then using wcspih() and wcsfix() to recognise and set up the wcs
-      //  structure in WcsPtr that we need to do the coordinate transforms.
-      //  (Some of this code was based on that used by AAOGlimpse, which would
-      //  fall back on the traditional CRPIX and CRDELT etc keywords if it
-      //  couldn't find useful WCS information. We assume we don't need to so
-      //  that here.)
+      //  The WCS coordinate system is worked out from the keyword values by
+      //  GetDetailsFromHeader(), and we get all of them using hdr2str().
       
       int NKeys;
-      int Nx = Dims[0];
-      int Ny = Dims[1];
       fits_hdr2str (Fptr,1,NULL,0,&HeaderPtr,&NKeys,&Status);
       if (Status != 0) {
          fits_get_errstatus (Status,FitsError);
-         I_ErrorText = "Unable to read FITS header keywords in '" + MaskFile
+         Header->Error = "Unable to read FITS header keywords in '" + MaskFile
                                                        + "' : " + string(FitsError);
          OKSoFar = false;
          break;
       }
+      Header->Nx = Dims[0];
+      Header->Ny = Dims[1];
+      Header->NKeys = NKeys;
+      Header->Keys.assign(HeaderPtr,size_t(NKeys) * 80);
+      Header->FromCache = false;
+      
+   } while (false);
+   
+   //  We can now release any resources we allocated during the process.
+   
+   int IgnoreStatus = 0;
+   if (HeaderPtr) fits_free_memory(HeaderPtr,&IgnoreStatus);
+   HeaderPtr = NULL;
+
+   return OKSoFar;
+
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                   G e t  D e t a i l s  F r o m  H e a d e r
+//
+//  Does most of the work for GetFileDetails(). Passed the header keywords for
+//  a 2D mask file, as returned by fits_hdr2str(), and the dimensions of its
+//  image, this works out the WCS information and the Ra,Dec centre and range,
+//  and fills in the ProfitFileDetails structure. This is separate from
+//  GetFileDetails() so it can work from the copy of the keywords held in a
+//  mask cache file without opening the mask file itself. Note that this may
+//  modify the header keywords passed. The routine returns true if all goes
+//  well. Otherwise it returns false, with an error description in I_ErrorText.
+
+bool ProfitSkyCheck::GetDetailsFromHeader (const std::string& MaskFile,
+       char* HeaderPtr, int NKeys, int Nx, int Ny, ProfitFileDetails* FileDetails)
+{
+   wcsprm* WcsPtr = NULL;
+   
+   bool OKSoFar = true;
+   
+   do {
+   
+      char FitsError[80] = "";
+      int Status = 0;
       
       //  Some early mask files needed some headers fixing or wcspih() rejected
       //  them. There shouldn't be any like that now, but check anyway.
@@ -973,13 +1378,10 @@ bool ProfitSkyCheck::GetFileDetails (
          break;
       }
       int Statuses[NWCSFIX];
-      int IntDims[C_MaxDims];
-      for (int Axis = 0; Axis < C_MaxDims; Axis++) {
-         IntDims[Axis] = int(Dims[Axis]);
-      }
+      int IntDims[2] = {Nx,Ny};
       (void) wcsfix (1,IntDims,WcsPtr,Statuses);
       
-      //  Set up wcs2ps() to convert 5 coordinate pairs - NDims is 2. The corners
+      //  Set up wcs2ps() to convert 5 coordinate pairs - the mask is 2D. The corners
       //  of the mask, and the very centre - note that the pixel coordinates
       //  of the very centre of the bottom left pixel are 1.0,1.0, and those
       //  of the top right pixel are Nx,Ny. The pixel range of the image goes
@@ -999,7 +1401,7 @@ bool ProfitSkyCheck::GetFileDetails (
       Pixcrd[8] = (float(Nx) + 1.0) / 2.0;
       Pixcrd[9] = (float(Ny) + 1.0) / 2.0;
       Status = 0;
-      wcsp2s(WcsPtr,5,NDims,Pixcrd,Imgcrd,Phi,Theta,Skycrd,Stat);
+      wcsp2s(WcsPtr,5,2,Pixcrd,Imgcrd,Phi,Theta,Skycrd,Stat);
       for (int I = 0; I < 5; I++) { if (Stat[I]) Status = Stat[I]; }
       if (Status != 0) {
          fits_get_errstatus (Status,FitsError);
@@ -1031,7 +1433,12 @@ bool ProfitSkyCheck::GetFileDetails (
       FileDetails->Path = MaskFile;
       FileDetails->Nx = Nx;
       FileDetails->Ny = Ny;
-      FileDetails->DataArray = NULL;
+      FileDetails->MaskBits = NULL;
+      FileDetails->WordsPerRow = 0;
+      FileDetails->MaskIx0 = 0;
+      FileDetails->MaskIy0 = 0;
+      FileDetails->MaskNx = 0;
+      FileDetails->MaskNy = 0;
       FileDetails->MidRa = MidRa;
       FileDetails->MidDec = MidDec;
       FileDetails->DeltaRa = DeltaRa;
@@ -1043,295 +1450,2505 @@ bool ProfitSkyCheck::GetFileDetails (
       
    } while (false);
    
-   //  We can now release any resources we allocated during the process.
-   
-   int IgnoreStatus = 0;
-   if (HeaderPtr) fits_free_memory(HeaderPtr,&IgnoreStatus);
-   HeaderPtr = NULL;
    if (WcsPtr) free(WcsPtr);
    WcsPtr = NULL;
-
-   ReturnOK = OKSoFar;
    
-   return ReturnOK;
-
+   return OKSoFar;
 }
 
 // ----------------------------------------------------------------------------------
 //
-//                      R e a d  F i l e  D a t a
+//                      A d d  F i l e  D e t a i l s
 //
-//  Passed the addresss of a fitsfile structure for an already opened 2D mask
-//  file, this routine reads in the mask data from that file and records the
-//  address of that data in a ProfitFileDetails structure. The routine
-//  returns true if it processes the file without problems. Otherwise it
-//  returns false - which may indicate that it isn't a valid FITS format file.
-//  If the data is read OK, its details are added to the list of mask data
-//  in use held in the list I_FileDetails.
+//  Passed a ProfitFileDetails structure that GetFileDetails() has filled in for a
+//  mask file that overlaps the field, this works out the area of the mask that
+//  might be needed - the part that covers the field, with a margin that allows
+//  for the largest radius around a position that we might want to look at (see
+//  programming notes) - and adds the structure to the list in I_FileDetails.
+//  It does not read any of the mask data. That is left to LoadMaskData(), which
+//  is called when a query first needs it. If the field turns out not to overlap
+//  the mask after all, we don't need the file, and it isn't added. The routine
+//  returns false (with an error description in I_ErrorText) only if the pixel
+//  scale of the mask makes no sense.
 
-bool ProfitSkyCheck::ReadFileData (
-   const std::string& MaskFile, fitsfile* Fptr, ProfitFileDetails* FileDetails)
+bool ProfitSkyCheck::AddFileDetails (ProfitFileDetails* FileDetails)
 {
-   bool ReturnOK = true;
+   int Nx = FileDetails->Nx;
+   int Ny = FileDetails->Ny;
+   int Ix0,Ix1,Iy0,Iy1;
+   GetFieldPixelRange (*FileDetails,&Ix0,&Ix1,&Iy0,&Iy1);
+   if (Ix0 > Ix1 || Iy0 > Iy1) {
+      I_Debug.Log ("Files","Field does not overlap " + FileDetails->Path);
+      return true;
+   }
+   int KX,KY;
+   if (!GetRadiusInPixels (*FileDetails,MaxClearRadius(),&KX,&KY)) return false;
+   Ix0 = std::max(1,Ix0 - KX);
+   Ix1 = std::min(Nx,Ix1 + KX);
+   Iy0 = std::max(1,Iy0 - KY);
+   Iy1 = std::min(Ny,Iy1 + KY);
    
-   char FitsError[80];
-   int Status = 0;
+   //  The area is made to start at the start of a word of mask bits, counting
+   //  from pixel 1, as are the blocks LoadMaskData() reads, so that it can copy
+   //  data it has already read a word at a time.
    
-   //  Note the assumption that the file is already open and contains 2D
-   //  data.
+   Ix0 = ((Ix0 - 1) / BitsPerWord) * BitsPerWord + 1;
    
-   //  We read in the mask data. Perhaps we should check BITPIX
-   //  to see what native format is being used for the data. This assumes
-   //  32 bit signed int data.
-
-   int Nx = FileDetails->Nx;
-   int Ny = FileDetails->Ny;
-   int** DataArray = (int**) I_ArrayManager.Malloc2D(sizeof(float),Ny,Nx);
-   long long StartPixel = 1;
-   long long PixelsThisTime = Nx * Ny;
-   float Nullval = 0.0;
-   int Anynull = 0;
-   int* BaseData = (int*) I_ArrayManager.BaseArray (DataArray);
-   fits_read_img(Fptr, TINT, StartPixel, PixelsThisTime, &Nullval,
-                                             BaseData, &Anynull, &Status);
-   if (Status == 0) {
+   FileDetails->AreaIx0 = Ix0;
+   FileDetails->AreaIy0 = Iy0;
+   FileDetails->AreaNx = Ix1 - Ix0 + 1;
+   FileDetails->AreaNy = Iy1 - Iy0 + 1;
    
-      //  All OK. Set the address of the Mask data in the file details structure,
-      //  and add that structure to the list of such structures that we use to
-      //  access the data from the various masks that overlap the field.
-
-      FileDetails->DataArray = DataArray;
-      I_FileDetails.push_back(*FileDetails);
-
-   } else {
+   //  A gzipped file has to be decompressed in its entirety to read any part
+   //  of it, so there's no point in reading only a part of the area from one.
    
-      fits_get_errstatus (Status,FitsError);
-      I_ErrorText = "Failed to read mask data from '" + MaskFile +
-                                           "' : " + string(FitsError);
-      I_ArrayManager.Free(DataArray);
-      DataArray = NULL;
-      ReturnOK = false;
-   }
-
-   return ReturnOK;
+   string LowerName = FileDetails->Path;
+   std::transform(LowerName.begin(),LowerName.end(),LowerName.begin(),
+                                 [](unsigned char c){ return std::tolower(c); });
+   size_t Len = LowerName.length();
+   FileDetails->LoadWhole = (Len > 3 && !LowerName.compare(Len - 3,3,".gz"));
+   
+   I_Debug.Logf ("Files","Field covers pixels [%d to %d, %d to %d] of %s",
+                                  Ix0,Ix1,Iy0,Iy1,FileDetails->Path.c_str());
+   I_FileDetails.push_back(*FileDetails);
+   
+   return true;
 }
 
+// ----------------------------------------------------------------------------------
+//
+//                        L o a d  M a s k  D a t a
+//
+//  Makes sure that the mask data for the rectangle of pixels with Ix from Ix0 to
+//  Ix1 and Iy from Iy0 to Iy1 of a mask file has been read into its MaskBits
+//  array. The rectangle is clipped to the area of the mask that covers the field.
+//  If any of it hasn't been read already, this opens the file and reads what's
+//  missing, extended out to whole blocks of LoadBlockSize pixels - or, for a
+//  gzipped file, the whole of the area, since reading any of it means
+//  decompressing the whole file anyway. The data already read is copied into
+//  the new, larger, array, so nothing is read twice. This returns false, with an
+//  error description in I_ErrorText, if the data can't be read. The work is
+//  split between PrepareMaskLoad(), ReadMaskLoad() and FinishMaskLoad(), so that
+//  LoadFieldAreas() can have several masks read at once.
+
+bool ProfitSkyCheck::LoadMaskData (ProfitFileDetails& Details,
+                                      int Ix0, int Ix1, int Iy0, int Iy1)
+{
+   ProfitMaskLoad Load;
+   PrepareMaskLoad (Details,Ix0,Ix1,Iy0,Iy1,&Load);
+   ReadMaskLoad (&Load);
+   return FinishMaskLoad (&Load);
+}
 
 // ----------------------------------------------------------------------------------
 //
-//                      R e a d  A n d  C h e c k  F i l e
+//                      P r e p a r e  M a s k  L o a d
 //
-//  Read one of the mask files, checking coordinates and reading its data.
-//  The file name passed should be the path name of a file that's already been
-//  identified as a FITS format file that is expected to have Profit mask data,
-//  and which is believed to cover an area of sky that overlaps the field in
-//  question, on the basis of the central Ra,Dec embedded in its filename. That
-//  Ra,Dec centre value is passed so it can be checked against the actual WCS
-//  data in the file. This routine accesses the header for the file, checks
-//  that it holds 2D data centered as expected, read in the data and adds a
-//  file details structure for the file to the list held in I_FileDetails.
+//  Does the first part of the work of LoadMaskData() for a mask file, working out
+//  what has to be read from the file, setting up a new MaskBits array for it and
+//  copying over any data already read, and setting up the ProfitMaskLoad
+//  structure with the details. If all the data needed has already been read - or
+//  the cache file can be used - the list of rectangles to be read is left empty.
+//  If this fails - which it only does if the new array can't be allocated - it
+//  puts the error description into the Error field of the ProfitMaskLoad.
 
-bool ProfitSkyCheck::ReadAndCheckFile (
-   const string& MaskFile, double FileRaDeg, double FileDecDeg,
-   double FileRaRangeDeg, double FileDecRangeDeg)
+void ProfitSkyCheck::PrepareMaskLoad (ProfitFileDetails& Details,
+                    int Ix0, int Ix1, int Iy0, int Iy1, ProfitMaskLoad* Load)
 {
-   bool ReturnOK = true;
+   Load->Details = &Details;
+   Load->Path = Details.Path;
+   Load->Needed.clear();
    
-   //  If we want to use this file, we'll put the relevant details in here
-   //  and add it to the I_FileDetails list.
+   int AreaIx1 = Details.AreaIx0 + Details.AreaNx - 1;
+   int AreaIy1 = Details.AreaIy0 + Details.AreaNy - 1;
+   Ix0 = std::max(Ix0,Details.AreaIx0);
+   Ix1 = std::min(Ix1,AreaIx1);
+   Iy0 = std::max(Iy0,Details.AreaIy0);
+   Iy1 = std::min(Iy1,AreaIy1);
+   if (Ix0 > Ix1 || Iy0 > Iy1) return;
    
-   ProfitFileDetails FileDetails;
+   //  Usually, we have the data already, and this needs to be quick.
    
-   fitsfile* Fptr = NULL;
-
-   //  There are a few steps here, and I'm using the same overall scheme as in
-   //  Initialise(), with a do structure that can be broken out of if anything
-   //  goes wrong. (There aren't as many as steps there used to be, because
-   //  quite a bit of the code was moved into GetFileDetails() in Jan 2022.)
+   int MaskIx1 = Details.MaskIx0 + Details.MaskNx - 1;
+   int MaskIy1 = Details.MaskIy0 + Details.MaskNy - 1;
+   bool HaveData = (Details.MaskBits != NULL);
+   if (HaveData && Ix0 >= Details.MaskIx0 && Ix1 <= MaskIx1 &&
+                             Iy0 >= Details.MaskIy0 && Iy1 <= MaskIy1) return;
    
-   bool OKSoFar = true;
+   //  If there's a cache directory, the first time any data is needed we use
+   //  the cache file, writing it first if there isn't an up to date one. That
+   //  gives us all of the mask. If that doesn't work, we say so, but carry on
+   //  and read from the mask file as usual.
    
-   do {
-
-      //  It looks as if this is a file we're interested in. We open it up and
-      //  start looking at the header values. We are mainly interested in the
-      //  WCS coordinates and the size of the main data (mask) array. First,
-      //  open the file.
-      
-      fitsfile* Fptr;
-      OKSoFar = OpenMaskFile (MaskFile,&Fptr);
-      if (!OKSoFar) break;
-
-      //  Now get the details of the file data array and its Ra,Dec coordinates
-      //  into FileDetails. It's not quite clear to me what the best thing to
-      //  do if there's an error from GetFileDetails(). It may just be that
-      //  we have a FITS file in the mask file directory that isn't actually
-      //  a mask. We could ignore it, but I suspect it's better to bail at
-      //  this point and do something about this rogue file. GetFileDetails()
-      //  will have already set I_ErrorText.
-      
-      OKSoFar = GetFileDetails (MaskFile,Fptr,&FileDetails);
-      if (!OKSoFar) break;
-      
-      //  We check for consistency. Is the central position what we expected
-      //  from the file name? Is the mask coverage roughly what we have been
-      //  assuming? If not, warn about this. A mask coverage less than expected
-      //  would be more of a problem than having more than expected. See comments
-      //  to CheckWCSandReadFile() for discussion of mask centre accuracy. (A
-      //  similar argument says the ranges should be good to 0.01 deg.)
-      
-      double MidRa = FileDetails.MidRa;
-      double MidDec = FileDetails.MidDec;
-      if ((fabs(MidRa - FileRaDeg) > 0.1) || (fabs(MidDec - FileDecDeg) > 0.1)) {
-         I_Warnings.push_back("File: " + MaskFile + " image centre from WCS " +
-                     FormatRaDecDeg(MidRa,MidDec) + " does not match file name");
-      }
-      
-      double RaRange1toNx = FileDetails.DeltaRa * (FileDetails.Nx - 1);
-      double DecRange1toNy = FileDetails.DeltaDec * (FileDetails.Ny - 1);
-      I_Debug.Logf ("Files","Ra range = %f, Dec range = %f",
-                                  fabs(RaRange1toNx),fabs(DecRange1toNy));
-      if ((fabs(fabs(RaRange1toNx) - fabs(FileRaRangeDeg)) > 0.01) ||
-         (fabs(fabs(DecRange1toNy) - fabs(FileDecRangeDeg)) > 0.01)) {
-         I_Warnings.push_back("File: " + MaskFile + " image range from WCS " +
-            FormatRaDecDeg(fabs(RaRange1toNx),fabs(DecRange1toNy)) +
-                     " differs significantly from assumed range " +
-                             FormatRaDecDeg(FileRaRangeDeg,FileDecRangeDeg));
-      }
-      
-      OKSoFar = ReadFileData (MaskFile,Fptr,&FileDetails);
-      if (!OKSoFar) break;
-      
-   } while (false);
+   if (I_CacheDirectory != "" && !HaveData && !Details.CacheTried) {
+      Details.CacheTried = true;
+      if (!Details.CacheValid) Details.CacheValid = WriteMaskCache(Details);
+      if (Details.CacheValid && MapMaskCache(Details)) return;
+      I_Warnings.push_back(I_ErrorText);
+   }
    
-   //  We can now release any resources we allocated during the process.
-                  
-   CloseMaskFile(Fptr);
-
-   ReturnOK = OKSoFar;
+   //  Work out the new part of the mask to hold. This includes whatever we
+   //  already have, so it is always a rectangle.
    
-   return ReturnOK;
+   if (Details.LoadWhole) {
+      Ix0 = Details.AreaIx0;
+      Ix1 = AreaIx1;
+      Iy0 = Details.AreaIy0;
+      Iy1 = AreaIy1;
+   } else {
+      Ix0 = std::max(Details.AreaIx0,((Ix0 - 1) / LoadBlockSize) * LoadBlockSize + 1);
+      Ix1 = std::min(AreaIx1,((Ix1 - 1) / LoadBlockSize + 1) * LoadBlockSize);
+      Iy0 = std::max(Details.AreaIy0,((Iy0 - 1) / LoadBlockSize) * LoadBlockSize + 1);
+      Iy1 = std::min(AreaIy1,((Iy1 - 1) / LoadBlockSize + 1) * LoadBlockSize);
+   }
+   if (HaveData) {
+      Ix0 = std::min(Ix0,Details.MaskIx0);
+      Ix1 = std::max(Ix1,MaskIx1);
+      Iy0 = std::min(Iy0,Details.MaskIy0);
+      Iy1 = std::max(Iy1,MaskIy1);
+   }
+   int NewNx = Ix1 - Ix0 + 1;
+   int NewNy = Iy1 - Iy0 + 1;
+   int WordsPerRow = (NewNx + BitsPerWord - 1) / BitsPerWord;
+   uint64_t** MaskBits = (uint64_t**)
+                I_ArrayManager.Malloc2D(sizeof(uint64_t),NewNy,WordsPerRow);
+   if (MaskBits == NULL) {
+      Load->Error = "Unable to allocate memory for mask data for " + Details.Path;
+      return;
+   }
+   for (int Row = 0; Row < NewNy; Row++) {
+      memset (MaskBits[Row],0,WordsPerRow * sizeof(uint64_t));
+   }
+   
+   //  Copy over the data we already have, and list the rectangles that are
+   //  still needed - all of it, if we have nothing yet, otherwise up to four:
+   //  the full width of the new array below and above what we have, and to
+   //  the left and right of it.
+   
+   std::vector<std::vector<int> >& Needed = Load->Needed;
+   if (!HaveData) {
+      Needed.push_back({Ix0,Ix1,Iy0,Iy1});
+   } else {
+      int WordOffset = (Details.MaskIx0 - Ix0) / BitsPerWord;
+      for (int Row = 0; Row < Details.MaskNy; Row++) {
+         memcpy (MaskBits[Details.MaskIy0 - Iy0 + Row] + WordOffset,
+                 Details.MaskBits[Row],Details.WordsPerRow * sizeof(uint64_t));
+      }
+      if (Iy0 < Details.MaskIy0) Needed.push_back({Ix0,Ix1,Iy0,Details.MaskIy0 - 1});
+      if (Iy1 > MaskIy1) Needed.push_back({Ix0,Ix1,MaskIy1 + 1,Iy1});
+      if (Ix0 < Details.MaskIx0) {
+         Needed.push_back({Ix0,Details.MaskIx0 - 1,Details.MaskIy0,MaskIy1});
+      }
+      if (Ix1 > MaskIx1) Needed.push_back({MaskIx1 + 1,Ix1,Details.MaskIy0,MaskIy1});
+   }
+   for (const std::vector<int>& Rect : Needed) {
+      I_Debug.Logf ("Files","Reading pixels [%d to %d, %d to %d] of %s",
+                     Rect[0],Rect[1],Rect[2],Rect[3],Details.Path.c_str());
+   }
+   Load->MaskBits = MaskBits;
+   Load->WordsPerRow = WordsPerRow;
+   Load->Ix0 = Ix0;
+   Load->Iy0 = Iy0;
+   Load->Nx = NewNx;
+   Load->Ny = NewNy;
 }
 
-
 // ----------------------------------------------------------------------------------
 //
-//                   G e t  L i s t  O f  M a s k  F i l e s
+//                         R e a d  M a s k  L o a d
 //
-//  Looks at the contents of the directory given by I_DirectoryPath and fills
-//  up the list at I_MaskFileList with the full path names of all the FITS
-//  files (compressed or uncompressed) in the directory. If there is an error,
-//  (including there being no such files in the directory) this returns false
-//  with an error description in I_ErrorText.
+//  Does the second part of the work of LoadMaskData(), opening the mask file and
+//  reading the rectangles of pixels listed in a ProfitMaskLoad structure set up
+//  by PrepareMaskLoad() into its new MaskBits array. If anything goes wrong, it
+//  puts an error description into the Error field of the structure. This doesn't
+//  use anything other than what's in the structure, so several threads can use
+//  it at once, each for a different mask, so long as cfitsio was built to allow
+//  that - see LoadFieldAreas().
+
+void ProfitSkyCheck::ReadMaskLoad (ProfitMaskLoad* Load)
+{
+   if (Load->Needed.empty() || Load->Error != "") return;
+   
+   fitsfile* Fptr = NULL;
+   int Status = 0;
+   fits_open_image (&Fptr,Load->Path.c_str(),READONLY,&Status);
+   bool Opened = (Status == 0);
+   for (const std::vector<int>& Rect : Load->Needed) {
+      ReadMaskRect (Fptr,Load->MaskBits,Load->Ix0,Load->Iy0,
+                                    Rect[0],Rect[1],Rect[2],Rect[3],&Status);
+      if (Status != 0) break;
+   }
+   if (Status != 0) {
+      char FitsError[80];
+      fits_get_errstatus (Status,FitsError);
+      if (Opened) {
+         Load->Error = "Failed to read mask data from '" + Load->Path +
+                                              "' : " + string(FitsError);
+      } else {
+         Load->Error = "Failed to open '" + Load->Path + "' : " + string(FitsError);
+      }
+   }
+   int IgnoreStatus = 0;
+   if (Fptr) fits_close_file (Fptr,&IgnoreStatus);
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                       F i n i s h  M a s k  L o a d
+//
+//  Does the last part of the work of LoadMaskData(). If the data in a
+//  ProfitMaskLoad structure was read successfully by ReadMaskLoad(), the new
+//  MaskBits array replaces the old one for the mask. Otherwise, the new array is
+//  released, and this returns false with the error description in I_ErrorText.
+
+bool ProfitSkyCheck::FinishMaskLoad (ProfitMaskLoad* Load)
+{
+   if (Load->Error != "") {
+      if (Load->MaskBits) I_ArrayManager.Free(Load->MaskBits);
+      Load->MaskBits = NULL;
+      I_ErrorText = Load->Error;
+      return false;
+   }
+   if (Load->Needed.empty()) return true;
+   
+   ProfitFileDetails& Details = *(Load->Details);
+   if (Details.MaskBits) I_ArrayManager.Free(Details.MaskBits);
+   Details.MaskBits = Load->MaskBits;
+   Details.WordsPerRow = Load->WordsPerRow;
+   Details.MaskIx0 = Load->Ix0;
+   Details.MaskIy0 = Load->Iy0;
+   Details.MaskNx = Load->Nx;
+   Details.MaskNy = Load->Ny;
+   Load->MaskBits = NULL;
+   
+   return true;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                       L o a d  F i e l d  A r e a s
+//
+//  Makes sure that all the mask data in the area covering the field has been
+//  read for each mask - or, if WholeOnly is true, just for the masks that have
+//  to be read whole anyway (see AddFileDetails()). The masks are read several
+//  at once by LoadMaskAreas(). If more than one mask can't be read, the error
+//  returned in I_ErrorText is the one for the first of them.
+
+bool ProfitSkyCheck::LoadFieldAreas (bool WholeOnly)
+{
+   std::vector<std::vector<int> > Areas;
+   for (ProfitFileDetails& Details : I_FileDetails) {
+      std::vector<int> Area;
+      if (!WholeOnly || Details.LoadWhole) {
+         Area = {Details.AreaIx0,Details.AreaIx0 + Details.AreaNx - 1,
+                         Details.AreaIy0,Details.AreaIy0 + Details.AreaNy - 1};
+      }
+      Areas.push_back(Area);
+   }
+   std::vector<string> Errors;
+   return LoadMaskAreas (Areas,&Errors);
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                       L o a d  M a s k  A r e a s
+//
+//  Makes sure that the mask data for a rectangle of pixels has been read for
+//  each mask. Areas has an entry for each mask, in the order of I_FileDetails,
+//  giving the rectangle as Ix0,Ix1,Iy0,Iy1 (as for LoadMaskData()), or empty if
+//  nothing is needed from that mask. The masks that still need reading are read
+//  at once, each in its own thread, up to the number of threads set by
+//  SetThreads(). The threads only use ReadMaskLoad(), and everything else is
+//  done in this thread in the order of the masks in I_FileDetails, so any
+//  errors and the order of any warnings don't depend on the number of threads.
+//  Errors is returned with an entry for each mask, blank unless its data
+//  couldn't be read. If any couldn't, this returns false, with the error for
+//  the first of them in I_ErrorText.
+
+bool ProfitSkyCheck::LoadMaskAreas (
+            const std::vector<std::vector<int> >& Areas, std::vector<string>* Errors)
+{
+   int NMasks = int(I_FileDetails.size());
+   Errors->assign(NMasks,"");
+   std::vector<ProfitMaskLoad> Loads(NMasks);
+   std::vector<int> ToRead;
+   int IMask = 0;
+   for (ProfitFileDetails& Details : I_FileDetails) {
+      if (IMask < int(Areas.size()) && Areas[IMask].size() == 4) {
+         const std::vector<int>& Area = Areas[IMask];
+         PrepareMaskLoad (Details,Area[0],Area[1],Area[2],Area[3],&Loads[IMask]);
+         if (!Loads[IMask].Needed.empty()) ToRead.push_back(IMask);
+      }
+      IMask++;
+   }
+   
+   //  Each thread takes the next mask that hasn't been taken yet, until there
+   //  aren't any left. This thread does the same.
+   
+   int NToRead = int(ToRead.size());
+   int NThreads = ThreadsToUse(NToRead,true);
+   std::atomic<int> NextLoad(0);
+   auto ReadLoads = [&]() {
+      for (int ILoad = NextLoad++; ILoad < NToRead; ILoad = NextLoad++) {
+         ReadMaskLoad (&Loads[ToRead[ILoad]]);
+      }
+   };
+   std::vector<std::thread> Threads;
+   for (int IThread = 1; IThread < NThreads; IThread++) {
+      Threads.push_back(std::thread(ReadLoads));
+   }
+   ReadLoads();
+   for (std::thread& Thread : Threads) Thread.join();
+   if (NToRead > 0) {
+      I_Debug.Logf ("Files","Read data for %d masks using %d threads",
+                                                            NToRead,NThreads);
+   }
+   
+   //  A mask with nothing to read has no Details set, and FinishMaskLoad()
+   //  has nothing to do for it.
+   
+   bool ReturnOK = true;
+   string FirstError = "";
+   for (IMask = 0; IMask < NMasks; IMask++) {
+      if (Loads[IMask].Details == NULL) continue;
+      if (!FinishMaskLoad (&Loads[IMask])) {
+         (*Errors)[IMask] = I_ErrorText;
+         if (ReturnOK) FirstError = I_ErrorText;
+         ReturnOK = false;
+      }
+   }
+   if (!ReturnOK) I_ErrorText = FirstError;
+   
+   return ReturnOK;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                         P r e l o a d  M a s k s
+//
+//  Can be called once the object has been initialised to read the data for all
+//  the masks that would have to be read whole when a query first needed any of
+//  their data - the gzipped ones - and to read them all at once, each in its own
+//  thread, up to the number set by SetThreads(). Queries then need no more
+//  reading of those masks. Other masks are still read as queries need them,
+//  as only the parts needed are read. This doesn't change the results of any
+//  query. It returns false, with an error description that can be obtained
+//  by calling GetError(), if any of the data can't be read.
+
+bool ProfitSkyCheck::PreloadMasks (void)
+{
+   if (!I_Initialised) {
+      I_ErrorText = "The ProfitSkyCheck object has not been initialised properly.";
+      return false;
+   }
+   return LoadFieldAreas (true);
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                           S e t  T h r e a d s
+//
+//  Sets the number of threads used to read mask files at once, in Initialise(),
+//  PreloadMasks(), BuildClearanceMaps() and BuildCountTables(), and to check
+//  positions in CheckPositionsForSky(). Passing zero - the default - uses one
+//  per processor core. The results are the same whatever the number of threads.
+
+void ProfitSkyCheck::SetThreads (int Threads)
+{
+   I_Threads = Threads;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                        R e a d  M a s k  R e c t
+//
+//  Reads a rectangle of pixels, with Ix from Ix0 to Ix1 and Iy from Iy0 to Iy1,
+//  from an open mask file, and sets the corresponding bits in a mask bit array
+//  whose first pixel is [BitsIx0,BitsIy0] for each pixel greater than zero. The
+//  bits must already be clear. This asks for the data as 32 bit signed int,
+//  whatever BITPIX says, and reads it a block of rows at a time, so only ever
+//  needs a small int buffer. fits_read_subset() only reads the pixels in the
+//  block, and for a tile-compressed file only decompresses the tiles that contain
+//  them. This uses the usual cfitsio inherited status convention - it does
+//  nothing if Status is non-zero on entry.
+
+void ProfitSkyCheck::ReadMaskRect (fitsfile* Fptr, uint64_t** MaskBits,
+       int BitsIx0, int BitsIy0, int Ix0, int Ix1, int Iy0, int Iy1, int* Status)
+{
+   int RectNx = Ix1 - Ix0 + 1;
+   long RectNy = Iy1 - Iy0 + 1;
+   long RowsPerRead = PixelsPerRead / RectNx;
+   if (RowsPerRead < 1) RowsPerRead = 1;
+   if (RowsPerRead > RectNy) RowsPerRead = RectNy;
+   std::vector<int> Buffer(RowsPerRead * RectNx);
+   int Nullval = 0;
+   int Anynull = 0;
+   int FirstBit = Ix0 - BitsIx0;
+   for (long FirstRow = 0; FirstRow < RectNy && *Status == 0;
+                                                   FirstRow += RowsPerRead) {
+      long Rows = std::min(RowsPerRead,RectNy - FirstRow);
+      long FirstPixel[2] = {Ix0,Iy0 + FirstRow};
+      long LastPixel[2] = {Ix1,Iy0 + FirstRow + Rows - 1};
+      long Increment[2] = {1,1};
+      fits_read_subset(Fptr, TINT, FirstPixel, LastPixel, Increment, &Nullval,
+                                          Buffer.data(), &Anynull, Status);
+      if (*Status != 0) break;
+      for (long Row = 0; Row < Rows; Row++) {
+         const int* RowData = &Buffer[Row * RectNx];
+         uint64_t* RowBits = MaskBits[Iy0 + FirstRow + Row - BitsIy0];
+         for (int X = 0; X < RectNx; X++) {
+            if (RowData[X] > 0) {
+               int Bit = FirstBit + X;
+               RowBits[Bit / BitsPerWord] |= uint64_t(1) << (Bit % BitsPerWord);
+            }
+         }
+      }
+   }
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                      S e t  C a c h e  D i r e c t o r y
+//
+//  Specifies a directory to be used for mask cache files - see programming notes.
+//  The first time the data for a mask file is needed, all of it is read and
+//  written, as one bit per pixel, into a cache file in this directory, and from
+//  then on - in this or any later run - the cache file is mapped into memory
+//  instead of the mask file being read. This should be called before
+//  Initialise(). If it isn't called, or the directory is passed as a null
+//  string, no cache is used.
+
+void ProfitSkyCheck::SetCacheDirectory (const std::string& CacheDirectory)
+{
+   I_CacheDirectory = CacheDirectory;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                      C a c h e  F i l e  N a m e
+//
+//  Returns the full path name of the cache file for a mask file. This is the name
+//  of the mask file, without its directory, with ".bits" added, in the cache
+//  directory.
+
+string ProfitSkyCheck::CacheFileName (const std::string& MaskFile)
+{
+   string Name = MaskFile;
+   size_t SlashPosn = Name.rfind('/');
+   if (SlashPosn != string::npos) Name = Name.substr(SlashPosn + 1);
+   return I_CacheDirectory + '/' + Name + ".bits";
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                      T e m p  F i l e  S u f f i x
+//
+//  Returns a suffix to add to the name of a cache or index file to give the
+//  temporary name it is written under before being renamed. This includes the
+//  process id and a count kept for the whole process, so no two threads, in
+//  this process or any other, can be writing to the same temporary file.
+
+string ProfitSkyCheck::TempFileSuffix (void)
+{
+   char Suffix[48];
+   snprintf (Suffix,sizeof(Suffix),".%ld.%ld.tmp",long(getpid()),
+                                                      long(G_TempFileCount++));
+   return Suffix;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                      G e t  S o u r c e  K e y
+//
+//  Gets the values that are used to check that a cache file is up to date with the
+//  mask file it was made from: the size of the mask file, its modification time
+//  (seconds since 1970), and a checksum. Working out a checksum of the whole of
+//  a large mask file would take almost as long as reading it, which is what the
+//  cache is there to avoid, so the checksum is of the first and last
+//  CacheSampleBytes of the file, which will catch a file that has been replaced
+//  by another of the same size with its modification time preserved. This returns
+//  false if the file can't be read.
+
+bool ProfitSkyCheck::GetSourceKey (const std::string& MaskFile,
+                     int64_t* Size, int64_t* ModTime, uint64_t* Checksum)
+{
+   struct stat FileStat;
+   if (stat(MaskFile.c_str(),&FileStat) != 0) return false;
+   *Size = int64_t(FileStat.st_size);
+   *ModTime = int64_t(FileStat.st_mtime);
+   
+   FILE* File = fopen(MaskFile.c_str(),"rb");
+   if (File == NULL) return false;
+   
+   //  This is a 64-bit FNV-1a hash of the sampled bytes.
+   
+   uint64_t Hash = 0xcbf29ce484222325ULL;
+   std::vector<unsigned char> Buffer(CacheSampleBytes);
+   long Starts[2] = {0,0};
+   int NSamples = 1;
+   if (*Size > 2 * CacheSampleBytes) {
+      Starts[1] = long(*Size - CacheSampleBytes);
+      NSamples = 2;
+   }
+   bool ReadOK = true;
+   for (int Sample = 0; Sample < NSamples && ReadOK; Sample++) {
+      if (fseek(File,Starts[Sample],SEEK_SET) != 0) {
+         ReadOK = false;
+         break;
+      }
+      size_t Bytes = fread(Buffer.data(),1,Buffer.size(),File);
+      if (ferror(File)) ReadOK = false;
+      for (size_t I = 0; I < Bytes; I++) {
+         Hash = (Hash ^ Buffer[I]) * 0x100000001b3ULL;
+      }
+   }
+   fclose(File);
+   *Checksum = Hash;
+   
+   return ReadOK;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                      G e t  C a c h e d  D e t a i l s
+//
+//  If there is an up to date cache file for a mask file, this fills in the
+//  ProfitFileDetails structure for the mask using the header keywords held in
+//  the cache file, just as GetFileDetails() would from the mask file itself,
+//  and returns true. The mask file itself isn't opened, which saves having to
+//  decompress the whole of a gzipped file just to read its header. If there is
+//  no cache directory, or no up to date cache file, this returns false, and
+//  GetFileDetails() needs to be used as usual. That isn't an error.
+
+bool ProfitSkyCheck::GetCachedDetails (
+                    const std::string& MaskFile, ProfitFileDetails* FileDetails)
+{
+   if (I_CacheDirectory == "") return false;
+   
+   string CacheFile = CacheFileName(MaskFile);
+   ProfitMaskHeader Header;
+   if (!ReadCachedHeader (MaskFile,CacheFile,&Header)) {
+      I_Debug.Log ("Files","No up to date cache file for " + MaskFile);
+      return false;
+   }
+   
+   //  Now the details can be worked out from the keywords, just as from the
+   //  mask file itself.
+   
+   I_Debug.Log ("Files","Using header from cache file " + CacheFile);
+   if (!GetDetailsFromHeader (MaskFile,&Header.Keys[0],Header.NKeys,
+                                        Header.Nx,Header.Ny,FileDetails)) {
+      return false;
+   }
+   FileDetails->CacheValid = true;
+   
+   return true;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                      R e a d  C a c h e d  H e a d e r
+//
+//  If the named cache file is up to date for a mask file, this reads the mask
+//  dimensions and the header keywords held in the cache file into a
+//  ProfitMaskHeader structure, and returns true. If it isn't, or there's no such
+//  cache file, this returns false, which isn't an error. Like ReadHeaderKeys(),
+//  this doesn't use anything other than what it's passed, so can be used by
+//  several threads at once.
+
+bool ProfitSkyCheck::ReadCachedHeader (const std::string& MaskFile,
+                     const std::string& CacheFile, ProfitMaskHeader* Header)
+{
+   int64_t Size,ModTime;
+   uint64_t Checksum;
+   if (!GetSourceKey(MaskFile,&Size,&ModTime,&Checksum)) return false;
+   
+   FILE* File = fopen(CacheFile.c_str(),"rb");
+   if (File == NULL) return false;
+   
+   //  Read the fixed part of the header, and check it matches the mask file.
+   //  If it does, read the header keywords that follow it.
+   
+   bool ReturnOK = false;
+   MaskCacheHeader CacheHeader;
+   if (fread(&CacheHeader,sizeof(CacheHeader),1,File) == 1 &&
+         !memcmp(CacheHeader.Magic,CacheMagic,sizeof(CacheHeader.Magic)) &&
+         CacheHeader.Version == CacheVersion &&
+         CacheHeader.SourceSize == Size && CacheHeader.SourceModTime == ModTime &&
+         CacheHeader.SourceChecksum == Checksum && CacheHeader.NKeys > 0) {
+      std::vector<char> Keys(size_t(CacheHeader.NKeys) * 80);
+      if (fread(Keys.data(),80,CacheHeader.NKeys,File) ==
+                                                 size_t(CacheHeader.NKeys)) {
+         Header->Nx = CacheHeader.Nx;
+         Header->Ny = CacheHeader.Ny;
+         Header->NKeys = CacheHeader.NKeys;
+         Header->Keys.assign(Keys.data(),Keys.size());
+         Header->FromCache = true;
+         ReturnOK = true;
+      }
+   }
+   fclose(File);
+   
+   return ReturnOK;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                        R e a d  M a s k  H e a d e r
+//
+//  Gets the dimensions and header keywords for a mask file into a
+//  ProfitMaskHeader structure, from the named cache file if that's up to date,
+//  and otherwise by opening the mask file and using ReadHeaderKeys(). If no cache
+//  file is to be used, CacheFile should be passed as a null string. This returns
+//  false, with an error description in the Error field of the structure, if the
+//  header can't be read. Like ReadHeaderKeys(), this doesn't use anything other
+//  than what it's passed, so can be used by several threads at once.
+
+bool ProfitSkyCheck::ReadMaskHeader (const std::string& MaskFile,
+                      const std::string& CacheFile, ProfitMaskHeader* Header)
+{
+   if (CacheFile != "" && ReadCachedHeader (MaskFile,CacheFile,Header)) {
+      return true;
+   }
+   
+   fitsfile* Fptr = NULL;
+   int Status = 0;
+   fits_open_image (&Fptr,MaskFile.c_str(),READONLY,&Status);
+   if (Status != 0) {
+      char FitsError[80];
+      fits_get_errstatus (Status,FitsError);
+      Header->Error = "Failed to open '" + MaskFile + "' : " + string(FitsError);
+      return false;
+   }
+   bool ReturnOK = ReadHeaderKeys (MaskFile,Fptr,Header);
+   int IgnoreStatus = 0;
+   fits_close_file (Fptr,&IgnoreStatus);
+   
+   return ReturnOK;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                        G e t  M a s k  D e t a i l s
+//
+//  Fills in the ProfitFileDetails structure for a mask file, using the header
+//  already read by PrereadHeaders() if there is one, and otherwise reading the
+//  header from the cache file, if there's an up to date one, or from the mask
+//  file. Returns false, with an error description in I_ErrorText, if the header
+//  can't be read or doesn't describe a usable mask.
+
+bool ProfitSkyCheck::GetMaskDetails (
+                    const std::string& MaskFile, ProfitFileDetails* FileDetails)
+{
+   ProfitMaskHeader Header;
+   std::map<string,ProfitMaskHeader>::iterator Preread =
+                                                  I_MaskHeaders.find(MaskFile);
+   if (Preread != I_MaskHeaders.end()) {
+      Header = Preread->second;
+      I_MaskHeaders.erase(Preread);
+   } else {
+      string CacheFile = (I_CacheDirectory == "") ? "" : CacheFileName(MaskFile);
+      I_Debug.Log ("Files","Reading header of " + MaskFile);
+      ReadMaskHeader (MaskFile,CacheFile,&Header);
+   }
+   if (Header.Error != "") {
+      I_ErrorText = Header.Error;
+      return false;
+   }
+   if (Header.FromCache) {
+      I_Debug.Log ("Files","Using header from cache file for " + MaskFile);
+   }
+   if (!GetDetailsFromHeader (MaskFile,&Header.Keys[0],Header.NKeys,
+                                           Header.Nx,Header.Ny,FileDetails)) {
+      return false;
+   }
+   FileDetails->CacheValid = Header.FromCache;
+   
+   return true;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                        P r e r e a d  H e a d e r s
+//
+//  Reads the headers of a number of mask files at once, each in its own thread,
+//  and saves them in I_MaskHeaders, from where GetMaskDetails() will pick them
+//  up. Almost all the time taken by Initialise() goes in opening mask files -
+//  for a gzipped file, cfitsio has to decompress the whole file just to get at
+//  its header - so this is where several threads help. The threads only use
+//  ReadMaskHeader(), which doesn't use anything shared with the other threads,
+//  so any errors and the order of any warnings don't depend on the number of
+//  threads. If cfitsio wasn't built to be used by several threads at once, or
+//  there's only one thread to use, this does nothing and GetMaskDetails() reads
+//  the headers one by one.
+
+void ProfitSkyCheck::PrereadHeaders (const std::vector<std::string>& MaskFiles)
+{
+   I_MaskHeaders.clear();
+   int NFiles = int(MaskFiles.size());
+   int NThreads = ThreadsToUse(NFiles,true);
+   if (NThreads < 2) return;
+   
+   std::vector<string> CacheFiles(NFiles,"");
+   if (I_CacheDirectory != "") {
+      for (int IFile = 0; IFile < NFiles; IFile++) {
+         CacheFiles[IFile] = CacheFileName(MaskFiles[IFile]);
+      }
+   }
+   
+   //  Each thread takes the next file that hasn't been taken yet, until there
+   //  aren't any left. This thread does the same.
+   
+   std::vector<ProfitMaskHeader> Headers(NFiles);
+   std::atomic<int> NextFile(0);
+   auto ReadHeaders = [&]() {
+      for (int IFile = NextFile++; IFile < NFiles; IFile = NextFile++) {
+         ReadMaskHeader (MaskFiles[IFile],CacheFiles[IFile],&Headers[IFile]);
+      }
+   };
+   std::vector<std::thread> Threads;
+   for (int IThread = 1; IThread < NThreads; IThread++) {
+      Threads.push_back(std::thread(ReadHeaders));
+   }
+   ReadHeaders();
+   for (std::thread& Thread : Threads) Thread.join();
+   
+   for (int IFile = 0; IFile < NFiles; IFile++) {
+      I_MaskHeaders[MaskFiles[IFile]] = Headers[IFile];
+   }
+   I_Debug.Logf ("Files","Read headers of %d mask files using %d threads",
+                                                             NFiles,NThreads);
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                         T h r e a d s  T o  U s e
+//
+//  Returns the number of threads to use for a given number of separate jobs,
+//  such as reading mask files: the number set by SetThreads(), or one per
+//  processor core, but no more than there are jobs. If the jobs use cfitsio
+//  (UsesFits true) and it wasn't built to be used by several threads at once
+//  (see the Makefile), this is always one.
+
+int ProfitSkyCheck::ThreadsToUse (int Jobs, bool UsesFits)
+{
+   int NThreads = I_Threads;
+   if (NThreads <= 0) NThreads = std::thread::hardware_concurrency();
+   if (NThreads > Jobs) NThreads = Jobs;
+   if (UsesFits && !fits_is_reentrant()) NThreads = 1;
+   if (NThreads < 1) NThreads = 1;
+   return NThreads;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                      W r i t e  M a s k  C a c h e
+//
+//  Reads all the data from a mask file and writes it, one bit per pixel, into
+//  a cache file for the mask, along with a header giving the mask dimensions,
+//  the values used to check the cache file is up to date, and the mask file's
+//  header keywords. The cache file is written under a temporary name and then
+//  renamed, so another process reading the cache directory never sees a
+//  partly written file. This returns true if it all works. Otherwise it
+//  returns false with an error description in I_ErrorText.
+
+bool ProfitSkyCheck::WriteMaskCache (const ProfitFileDetails& Details)
+{
+   string CacheFile = CacheFileName(Details.Path);
+   string TempFile = CacheFile + TempFileSuffix();
+   
+   int Nx = Details.Nx;
+   int Ny = Details.Ny;
+   int WordsPerRow = (Nx + BitsPerWord - 1) / BitsPerWord;
+   
+   fitsfile* Fptr = NULL;
+   FILE* File = NULL;
+   char* HeaderPtr = NULL;
+   uint64_t** BlockBits = NULL;
+   int Status = 0;
+   
+   bool OKSoFar = true;
+   
+   do {
+   
+      //  Set up the header. The source key is worked out before the mask file
+      //  is read, so if it changes while we read it the cache will be seen as
+      //  out of date next time.
+      
+      MaskCacheHeader Header;
+      memset (&Header,0,sizeof(Header));
+      memcpy (Header.Magic,CacheMagic,sizeof(Header.Magic));
+      Header.Version = CacheVersion;
+      Header.Nx = Nx;
+      Header.Ny = Ny;
+      Header.WordsPerRow = WordsPerRow;
+      if (!GetSourceKey(Details.Path,&Header.SourceSize,&Header.SourceModTime,
+                                                   &Header.SourceChecksum)) {
+         I_ErrorText = "Unable to read '" + Details.Path + "'";
+         OKSoFar = false;
+         break;
+      }
+      
+      OKSoFar = OpenMaskFile (Details.Path,&Fptr);
+      if (!OKSoFar) break;
+      int NKeys = 0;
+      fits_hdr2str (Fptr,1,NULL,0,&HeaderPtr,&NKeys,&Status);
+      if (Status != 0) break;
+      Header.NKeys = NKeys;
+      long HeaderBytes = long(sizeof(Header)) + long(NKeys) * 80;
+      Header.DataOffset =
+               ((HeaderBytes + CachePageBytes - 1) / CachePageBytes) * CachePageBytes;
+      
+      File = fopen(TempFile.c_str(),"wb");
+      if (File == NULL) {
+         I_ErrorText = "Unable to create cache file '" + TempFile + "': " +
+                                                         string(strerror(errno));
+         OKSoFar = false;
+         break;
+      }
+      std::vector<char> Padding(Header.DataOffset - HeaderBytes,0);
+      if (fwrite(&Header,sizeof(Header),1,File) != 1 ||
+          fwrite(HeaderPtr,80,NKeys,File) != size_t(NKeys) ||
+          fwrite(Padding.data(),1,Padding.size(),File) != Padding.size()) {
+         I_ErrorText = "Error writing cache file '" + TempFile + "': " +
+                                                         string(strerror(errno));
+         OKSoFar = false;
+         break;
+      }
+      
+      //  Now the data, a block of rows at a time.
+      
+      BlockBits = (uint64_t**)
+            I_ArrayManager.Malloc2D(sizeof(uint64_t),LoadBlockSize,WordsPerRow);
+      if (BlockBits == NULL) {
+         I_ErrorText = "Unable to allocate memory to write cache file for " +
+                                                                   Details.Path;
+         OKSoFar = false;
+         break;
+      }
+      for (int Iy0 = 1; Iy0 <= Ny && OKSoFar; Iy0 += LoadBlockSize) {
+         int Rows = std::min(LoadBlockSize,Ny - Iy0 + 1);
+         memset (BlockBits[0],0,size_t(Rows) * WordsPerRow * sizeof(uint64_t));
+         ReadMaskRect (Fptr,BlockBits,1,Iy0,1,Nx,Iy0,Iy0 + Rows - 1,&Status);
+         if (Status != 0) break;
+         size_t Words = size_t(Rows) * WordsPerRow;
+         if (fwrite(BlockBits[0],sizeof(uint64_t),Words,File) != Words) {
+            I_ErrorText = "Error writing cache file '" + TempFile + "': " +
+                                                         string(strerror(errno));
+            OKSoFar = false;
+         }
+      }
+      if (!OKSoFar || Status != 0) break;
+      
+      //  Close the file - which can still fail if the disk is full - and give
+      //  it its proper name.
+      
+      int CloseStatus = fclose(File);
+      File = NULL;
+      if (CloseStatus != 0 || rename(TempFile.c_str(),CacheFile.c_str()) != 0) {
+         I_ErrorText = "Error writing cache file '" + CacheFile + "': " +
+                                                         string(strerror(errno));
+         OKSoFar = false;
+         break;
+      }
+      I_Debug.Log ("Files","Written cache file " + CacheFile);
+      
+   } while (false);
+   
+   if (Status != 0) {
+      char FitsError[80];
+      fits_get_errstatus (Status,FitsError);
+      I_ErrorText = "Failed to read mask data from '" + Details.Path +
+                                              "' : " + string(FitsError);
+      OKSoFar = false;
+   }
+   
+   //  Tidy up, including removing any partly written file.
+   
+   if (File) fclose(File);
+   if (!OKSoFar) remove(TempFile.c_str());
+   if (BlockBits) I_ArrayManager.Free(BlockBits);
+   int IgnoreStatus = 0;
+   if (HeaderPtr) fits_free_memory(HeaderPtr,&IgnoreStatus);
+   CloseMaskFile (Fptr);
+   
+   return OKSoFar;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                        M a p  M a s k  C a c h e
+//
+//  Maps the cache file for a mask file into memory, read-only, and sets up the
+//  MaskBits array for the mask to use the data in it, which covers the whole of
+//  the mask. The cache file must have been found to be up to date already. This
+//  returns true if it all works. Otherwise it returns false with an error
+//  description in I_ErrorText.
+
+bool ProfitSkyCheck::MapMaskCache (ProfitFileDetails& Details)
+{
+   string CacheFile = CacheFileName(Details.Path);
+   int Nx = Details.Nx;
+   int Ny = Details.Ny;
+   int WordsPerRow = (Nx + BitsPerWord - 1) / BitsPerWord;
+   
+   int Fd = open(CacheFile.c_str(),O_RDONLY);
+   if (Fd < 0) {
+      I_ErrorText = "Unable to open cache file '" + CacheFile + "': " +
+                                                         string(strerror(errno));
+      return false;
+   }
+   struct stat FileStat;
+   void* Map = MAP_FAILED;
+   size_t MapSize = 0;
+   if (fstat(Fd,&FileStat) == 0) {
+      MapSize = size_t(FileStat.st_size);
+      if (MapSize >= sizeof(MaskCacheHeader)) {
+         Map = mmap(NULL,MapSize,PROT_READ,MAP_SHARED,Fd,0);
+      }
+   }
+   close(Fd);
+   if (Map == MAP_FAILED) {
+      I_ErrorText = "Unable to map cache file '" + CacheFile + "'";
+      return false;
+   }
+   
+   //  Check the file is what we expect. It could have been replaced since the
+   //  header was checked, but only by another process writing an equally
+   //  valid version of it.
+   
+   const MaskCacheHeader* Header = (const MaskCacheHeader*) Map;
+   if (memcmp(Header->Magic,CacheMagic,sizeof(Header->Magic)) ||
+         Header->Version != CacheVersion || Header->Nx != Nx ||
+         Header->Ny != Ny || Header->WordsPerRow != WordsPerRow ||
+         MapSize != size_t(Header->DataOffset) +
+                       size_t(Ny) * size_t(WordsPerRow) * sizeof(uint64_t)) {
+      munmap (Map,MapSize);
+      I_ErrorText = "Cache file '" + CacheFile + "' is not as expected";
+      return false;
+   }
+   uint64_t** MaskBits = (uint64_t**) I_ArrayManager.Malloc1D(sizeof(uint64_t*),Ny);
+   if (MaskBits == NULL) {
+      munmap (Map,MapSize);
+      I_ErrorText = "Unable to allocate memory for mask data for " + Details.Path;
+      return false;
+   }
+   uint64_t* Data = (uint64_t*) ((char*) Map + Header->DataOffset);
+   for (int Row = 0; Row < Ny; Row++) {
+      MaskBits[Row] = Data + size_t(Row) * WordsPerRow;
+   }
+   I_Debug.Log ("Files","Mapped cache file " + CacheFile);
+   
+   Details.MaskBits = MaskBits;
+   Details.WordsPerRow = WordsPerRow;
+   Details.MaskIx0 = 1;
+   Details.MaskIy0 = 1;
+   Details.MaskNx = Nx;
+   Details.MaskNy = Ny;
+   Details.CacheMap = Map;
+   Details.CacheMapSize = MapSize;
+   
+   return true;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                      R e a d  A n d  C h e c k  F i l e
+//
+//  Read the header of one of the mask files, checking its coordinates. The
+//  file name passed should be the path name of a file that's already been
+//  identified as a FITS format file that is expected to have Profit mask data,
+//  and which is believed to cover an area of sky that overlaps the field in
+//  question, on the basis of the central Ra,Dec embedded in its filename. That
+//  Ra,Dec centre value is passed so it can be checked against the actual WCS
+//  data in the file. This routine accesses the header for the file, checks
+//  that it holds 2D data centered as expected, and adds a file details
+//  structure for the file to the list held in I_FileDetails. The mask data
+//  itself is only read when a query needs it - see LoadMaskData().
+
+bool ProfitSkyCheck::ReadAndCheckFile (
+   const string& MaskFile, double FileRaDeg, double FileDecDeg,
+   double FileRaRangeDeg, double FileDecRangeDeg)
+{
+   bool ReturnOK = true;
+   
+   //  If we want to use this file, we'll put the relevant details in here
+   //  and add it to the I_FileDetails list.
+   
+   ProfitFileDetails FileDetails;
+   
+   //  There are a few steps here, and I'm using the same overall scheme as in
+   //  Initialise(), with a do structure that can be broken out of if anything
+   //  goes wrong. (There aren't as many as steps there used to be, because
+   //  quite a bit of the code was moved into GetFileDetails() in Jan 2022.)
+   
+   bool OKSoFar = true;
+   
+   do {
+
+      //  It looks as if this is a file we're interested in. We look at the
+      //  header values. We are mainly interested in the WCS coordinates and the
+      //  size of the main data (mask) array. GetMaskDetails() gets the details
+      //  of the file data array and its Ra,Dec coordinates into FileDetails,
+      //  from an up to date cache file if there is one, or from the header
+      //  already read by PrereadHeaders(), and otherwise by opening the file.
+      //  It's not quite clear to me what the best thing to do if there's an
+      //  error here. It may just be that we have a FITS file in the mask file
+      //  directory that isn't actually a mask. We could ignore it, but I suspect
+      //  it's better to bail at this point and do something about this rogue
+      //  file. GetMaskDetails() will have already set I_ErrorText.
+      
+      OKSoFar = GetMaskDetails (MaskFile,&FileDetails);
+      if (!OKSoFar) break;
+      
+      //  We check for consistency. Is the central position what we expected
+      //  from the file name? Is the mask coverage roughly what we have been
+      //  assuming? If not, warn about this. A mask coverage less than expected
+      //  would be more of a problem than having more than expected. See comments
+      //  to CheckWCSandReadFile() for discussion of mask centre accuracy. (A
+      //  similar argument says the ranges should be good to 0.01 deg.)
+      
+      double MidRa = FileDetails.MidRa;
+      double MidDec = FileDetails.MidDec;
+      if ((fabs(MidRa - FileRaDeg) > 0.1) || (fabs(MidDec - FileDecDeg) > 0.1)) {
+         I_Warnings.push_back("File: " + MaskFile + " image centre from WCS " +
+                     FormatRaDecDeg(MidRa,MidDec) + " does not match file name");
+      }
+      
+      double RaRange1toNx = FileDetails.DeltaRa * (FileDetails.Nx - 1);
+      double DecRange1toNy = FileDetails.DeltaDec * (FileDetails.Ny - 1);
+      I_Debug.Logf ("Files","Ra range = %f, Dec range = %f",
+                                  fabs(RaRange1toNx),fabs(DecRange1toNy));
+      if ((fabs(fabs(RaRange1toNx) - fabs(FileRaRangeDeg)) > 0.01) ||
+         (fabs(fabs(DecRange1toNy) - fabs(FileDecRangeDeg)) > 0.01)) {
+         I_Warnings.push_back("File: " + MaskFile + " image range from WCS " +
+            FormatRaDecDeg(fabs(RaRange1toNx),fabs(DecRange1toNy)) +
+                     " differs significantly from assumed range " +
+                             FormatRaDecDeg(FileRaRangeDeg,FileDecRangeDeg));
+      }
+      
+      OKSoFar = AddFileDetails (&FileDetails);
+      if (!OKSoFar) break;
+      
+   } while (false);
+   
+   ReturnOK = OKSoFar;
+   
+   return ReturnOK;
+}
+
+
+// ----------------------------------------------------------------------------------
+//
+//                   G e t  L i s t  O f  M a s k  F i l e s
+//
+//  Looks at the contents of the directory given by I_DirectoryPath and fills
+//  up the list at I_MaskFileList with the full path names of all the FITS
+//  files (compressed or uncompressed) in the directory. If there is an error,
+//  (including there being no such files in the directory) this returns false
+//  with an error description in I_ErrorText.
 
 bool ProfitSkyCheck::GetListOfMaskFiles (void)
 {
-   DIR *DirPtr;
-   struct dirent *EntryPtr;
+   DIR *DirPtr;
+   struct dirent *EntryPtr;
+
+   bool ReturnOK = true;
+   
+   //  Open the directory
+   
+   errno = 0;
+   if ((DirPtr = opendir(I_DirectoryPath.c_str())) == NULL) {
+      string ErrorString(string(strerror(errno)));
+      I_ErrorText = "Unable to open mask file directory '" + I_DirectoryPath +
+                                                            "': " + ErrorString;
+      ReturnOK = false;
+   } else {
+
+      //  Loop through all the files in the directory, looking for FITS files.
+      
+      int Count = 0;
+      int CompressedCount = 0;
+      do {
+         errno = 0;
+         if ((EntryPtr = readdir(DirPtr)) != NULL) {
+            string FileName = string(EntryPtr->d_name);
+            
+            //  Getting the file name is one thing, manipulating the file name in
+            //  C++ to see if it a) is compressed, b) has a recognised FITS file
+            //  extension, is more work. The transform gets a lower case version,
+            //  then we look for the last extension - ie anything after the last
+            //  '.'. If that is ".gz" we strip that off, and then get the extension.
+            //  We do the same for ".fz", the usual extension for a tile-compressed
+            //  file. If that extension is ".fits" or any of the usual other
+            //  options, we assume this is a FITS file.
+            
+            bool Compressed = false;
+            bool FitsFile = false;
+            string LowerName = FileName;
+            std::transform(LowerName.begin(),LowerName.end(),LowerName.begin(),
+                                 [](unsigned char c){ return std::tolower(c); });
+            size_t ExtPosn = LowerName.rfind('.');
+            if (ExtPosn != string::npos) {
+               string Ext = LowerName.substr(ExtPosn);
+               if (!Ext.compare(".gz") || !Ext.compare(".fz")) {
+                  Compressed = true;
+                  LowerName.erase(ExtPosn);
+                  ExtPosn = LowerName.rfind('.');
+                  if (ExtPosn != string::npos) {
+                     Ext = LowerName.substr(ExtPosn);
+                  }
+               }
+               if (!Ext.compare(".fits")) FitsFile = true;
+               else if (!Ext.compare(".fit")) FitsFile = true;
+               else if (!Ext.compare(".fts")) FitsFile = true;
+            }
+            
+            //  Add anything we think is a FITS file to I_MakeFileList. We add
+            //  the full path name, including the directory. That should make it
+            //  easier later.
+            
+            if (FitsFile) {
+               I_MaskFileList.push_back(I_DirectoryPath + '/' + FileName);
+               Count++;
+               if (Compressed) CompressedCount++;
+            }
+            if (!FitsFile) I_Debug.Logf ("Files","'%s' is not a FITS file",
+                                                            FileName.c_str());
+         }
+      } while (EntryPtr != NULL);
+      closedir(DirPtr);
+      
+      //  Not finding any FITS files at all is an error.
+      
+      if (Count == 0) {
+         I_ErrorText = "No FITS files found in mask file directory '" +
+                                                       I_DirectoryPath + "'";
+         ReturnOK = false;
+      }
+      
+      I_Debug.Logf ("Files", "Found %d FITS files, %d were compressed",
+                                                      Count,CompressedCount);
+   }
+   return ReturnOK;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                      U p d a t e  M a s k  I n d e x
+//
+//  Creates or updates the footprint index for a mask file directory - see
+//  programming notes. This is intended to be run by a separate program
+//  (ProfitMaskIndex) whenever mask files are added to, removed from or changed
+//  in the directory, rather than as part of a normal run, and shouldn't be used
+//  with an object that has been initialised. An existing index is updated: only
+//  the files that aren't in it or have changed since it was written are opened.
+//  Files that don't look like mask files are left out of the index, with a
+//  warning. This returns the number of files in the index, the number of those
+//  whose entries are new or have changed, and the number of entries removed
+//  because their files have gone. It returns false, with an error description
+//  in I_ErrorText, if the directory can't be read or the index can't be
+//  written.
+
+bool ProfitSkyCheck::UpdateMaskIndex (const std::string& DirectoryPath,
+                                   int* NEntries, int* NChanged, int* NRemoved)
+{
+   *NEntries = 0;
+   *NChanged = 0;
+   *NRemoved = 0;
+   
+   std::lock_guard<std::mutex> Lock(G_InitMutex);
+   
+   if (I_Initialised) {
+      I_ErrorText = "The ProfitSkyCheck object has already been initialised";
+      return false;
+   }
+   
+   I_DirectoryPath = DirectoryPath;
+   I_MaskFileList.clear();
+   if (!GetListOfMaskFiles()) return false;
+   
+   //  Start from the existing index, if there is one. If it can't be read, it
+   //  just gets rebuilt from scratch.
+   
+   if (!ReadMaskIndex()) {
+      I_Warnings.push_back(I_ErrorText + " - rebuilding it");
+      I_IndexEntries.clear();
+      I_IndexLookup.clear();
+   }
+   int OldEntries = int(I_IndexEntries.size());
+   
+   std::vector<ProfitIndexEntry> NewEntries;
+   int Matched = 0;
+   for (const string& MaskFile : I_MaskFileList) {
+      string Name = MaskFile.substr(I_DirectoryPath.length() + 1);
+      
+      //  If the file is in the index and its size and modification time
+      //  haven't changed, its entry can be used as it is. If just the
+      //  modification time has changed, but not the checksum, the file has
+      //  presumably just been copied or touched, and only that needs updating.
+      
+      std::map<string,int>::const_iterator Indexed = I_IndexLookup.find(Name);
+      if (Indexed != I_IndexLookup.end()) {
+         Matched++;
+         const ProfitIndexEntry& Entry = I_IndexEntries[Indexed->second];
+         struct stat FileStat;
+         if (stat(MaskFile.c_str(),&FileStat) == 0 &&
+                              int64_t(FileStat.st_size) == Entry.Size) {
+            if (int64_t(FileStat.st_mtime) == Entry.ModTime) {
+               NewEntries.push_back(Entry);
+               continue;
+            }
+            int64_t Size,ModTime;
+            uint64_t Checksum;
+            if (GetSourceKey(MaskFile,&Size,&ModTime,&Checksum) &&
+                      Size == Entry.Size && Checksum == Entry.Checksum) {
+               NewEntries.push_back(Entry);
+               NewEntries.back().ModTime = ModTime;
+               (*NChanged)++;
+               continue;
+            }
+         }
+      }
+      
+      //  Otherwise the file has to be opened to work out its entry.
+      
+      I_Debug.Log ("Files","Indexing " + MaskFile);
+      ProfitIndexEntry Entry;
+      if (!MakeIndexEntry(MaskFile,&Entry)) {
+         I_Warnings.push_back(I_ErrorText + " - not indexed");
+         continue;
+      }
+      NewEntries.push_back(Entry);
+      (*NChanged)++;
+   }
+   *NRemoved = OldEntries - Matched;
+   
+   //  The index is written sorted by file name, just to make it easier to read.
+   
+   std::sort(NewEntries.begin(),NewEntries.end(),
+      [](const ProfitIndexEntry& A,const ProfitIndexEntry& B){
+                                                     return A.Name < B.Name; });
+   I_IndexEntries = NewEntries;
+   I_IndexLookup.clear();
+   for (size_t IEntry = 0; IEntry < I_IndexEntries.size(); IEntry++) {
+      I_IndexLookup[I_IndexEntries[IEntry].Name] = int(IEntry);
+   }
+   *NEntries = int(I_IndexEntries.size());
+   
+   return WriteMaskIndex();
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                        M a k e  I n d e x  E n t r y
+//
+//  Opens a mask file and works out its entry for the footprint index: the
+//  values used to check it hasn't changed, the details of its image, its
+//  footprint on the sky, and its header keywords. Returns false, with an
+//  error description in I_ErrorText, if the file can't be read or doesn't
+//  look like a mask file.
+
+bool ProfitSkyCheck::MakeIndexEntry (
+                          const std::string& MaskFile, ProfitIndexEntry* Entry)
+{
+   fitsfile* Fptr = NULL;
+   char* HeaderPtr = NULL;
+   int Status = 0;
+   
+   bool OKSoFar = true;
+   
+   do {
+      
+      Entry->Name = MaskFile.substr(MaskFile.rfind('/') + 1);
+      if (!GetSourceKey(MaskFile,&Entry->Size,&Entry->ModTime,&Entry->Checksum)) {
+         I_ErrorText = "Unable to read '" + MaskFile + "'";
+         OKSoFar = false;
+         break;
+      }
+      
+      //  GetFileDetails() does the basic checks and works out the WCS
+      //  information. The header keywords are saved as they are in the file.
+      
+      OKSoFar = OpenMaskFile (MaskFile,&Fptr);
+      if (!OKSoFar) break;
+      ProfitFileDetails FileDetails;
+      OKSoFar = GetFileDetails (MaskFile,Fptr,&FileDetails);
+      if (!OKSoFar) break;
+      fits_get_img_type (Fptr,&Entry->Bitpix,&Status);
+      int NKeys = 0;
+      fits_hdr2str (Fptr,1,NULL,0,&HeaderPtr,&NKeys,&Status);
+      if (Status != 0) break;
+      Entry->NKeys = NKeys;
+      Entry->Header.assign(HeaderPtr,size_t(NKeys) * 80);
+      Entry->Nx = FileDetails.Nx;
+      Entry->Ny = FileDetails.Ny;
+      Entry->MidRa = FileDetails.MidRa;
+      Entry->MidDec = FileDetails.MidDec;
+      
+      //  The footprint is the outer corners of the mask and the centres of its
+      //  edges. Because the edges are great circles, not lines of constant Dec,
+      //  the centre of the top or bottom edge can be further from the equator
+      //  than either of its corners.
+      
+      double X0 = 0.5;
+      double X1 = double(FileDetails.Nx) + 0.5;
+      double XM = (X0 + X1) * 0.5;
+      double Y0 = 0.5;
+      double Y1 = double(FileDetails.Ny) + 0.5;
+      double YM = (Y0 + Y1) * 0.5;
+      const int NPoints = ProfitIndexEntry::FootprintPoints;
+      double Pixcrd[NPoints * 2] = {
+                 X0,Y0, XM,Y0, X1,Y0, X1,YM, X1,Y1, XM,Y1, X0,Y1, X0,YM };
+      double Imgcrd[NPoints * 2];
+      double Phi[NPoints],Theta[NPoints];
+      int Stat[NPoints];
+      int WcsStatus = wcsp2s(&FileDetails.Wcs,NPoints,2,Pixcrd,
+                                     Imgcrd,Phi,Theta,Entry->Footprint,Stat);
+      if (WcsStatus != 0) {
+         I_ErrorText = "Unable to work out the footprint of '" + MaskFile + "'";
+         OKSoFar = false;
+         break;
+      }
+   
+   } while (false);
+   
+   if (Status != 0) {
+      char FitsError[80];
+      fits_get_errstatus (Status,FitsError);
+      I_ErrorText = "Unable to read FITS header of '" + MaskFile + "' : " +
+                                                            string(FitsError);
+      OKSoFar = false;
+   }
+   
+   int IgnoreStatus = 0;
+   if (HeaderPtr) fits_free_memory(HeaderPtr,&IgnoreStatus);
+   CloseMaskFile (Fptr);
+   
+   return OKSoFar;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                      M a s k  I n d e x  F i l e  N a m e
+//
+//  Returns the full path name of the footprint index for the mask file directory.
+
+string ProfitSkyCheck::MaskIndexFileName (void)
+{
+   return I_DirectoryPath + '/' + MaskIndexName;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                        R e a d  M a s k  I n d e x
+//
+//  Reads the footprint index for the mask file directory into I_IndexEntries,
+//  and sets up I_IndexLookup and the Dec bands in I_IndexBands. If there is no
+//  index, that isn't an error - the index is optional - and this just leaves
+//  I_IndexEntries empty. If the index can't be read, or isn't in the expected
+//  format, this returns false with an error description in I_ErrorText.
+//
+//  The index is a text file. After a first line identifying it, each mask file
+//  has an entry like this, with the Footprint line giving the Ra,Dec of the
+//  points round the edge of the mask, and the Keys line giving the number of
+//  header keywords, which follow, one to a line:
+//
+//     Mask segmap_gama_350.6_-32.1.fits.gz
+//     Key <size> <modification time> <checksum (hex)>
+//     Image <bitpix> <nx> <ny>
+//     Centre <ra> <dec>
+//     Footprint <ra> <dec> <ra> <dec> ...
+//     Keys <nkeys>
+//     SIMPLE  =                    T
+//     ...
+//     End
+
+bool ProfitSkyCheck::ReadMaskIndex (void)
+{
+   I_IndexEntries.clear();
+   I_IndexLookup.clear();
+   I_IndexBands.clear();
+   
+   string IndexFile = MaskIndexFileName();
+   FILE* File = fopen(IndexFile.c_str(),"r");
+   if (File == NULL) {
+      I_Debug.Log ("Files","No footprint index " + IndexFile);
+      return true;
+   }
+   
+   //  A small utility to read a line without its newline. It returns false at
+   //  the end of the file.
+   
+   char Line[256];
+   auto ReadLine = [&](void) -> bool {
+      if (fgets(Line,sizeof(Line),File) == NULL) return false;
+      Line[strcspn(Line,"\r\n")] = '\0';
+      return true;
+   };
+   
+   bool ReadOK = ReadLine() && !strcmp(Line,MaskIndexId);
+   ProfitIndexEntry Entry;
+   while (ReadOK && ReadLine()) {
+      char Keyword[16] = "";
+      sscanf (Line,"%15s",Keyword);
+      string Item = Keyword;
+      const char* Values = Line + strlen(Keyword);
+      long long Size = 0,ModTime = 0;
+      unsigned long long Checksum = 0;
+      if (Item == "Mask") {
+         Entry = ProfitIndexEntry();
+         Entry.Name = (*Values == ' ') ? Values + 1 : Values;
+      } else if (Item == "Key") {
+         ReadOK = (sscanf(Values,"%lld %lld %llx",&Size,&ModTime,&Checksum) == 3);
+         Entry.Size = Size;
+         Entry.ModTime = ModTime;
+         Entry.Checksum = Checksum;
+      } else if (Item == "Image") {
+         ReadOK = (sscanf(Values,"%d %d %d",
+                              &Entry.Bitpix,&Entry.Nx,&Entry.Ny) == 3);
+      } else if (Item == "Centre") {
+         ReadOK = (sscanf(Values,"%lf %lf",&Entry.MidRa,&Entry.MidDec) == 2);
+      } else if (Item == "Footprint") {
+         int Chars = 0;
+         for (int I = 0; I < ProfitIndexEntry::FootprintPoints * 2 && ReadOK; I++) {
+            ReadOK = (sscanf(Values,"%lf%n",&Entry.Footprint[I],&Chars) == 1);
+            Values += Chars;
+         }
+      } else if (Item == "Keys") {
+         ReadOK = (sscanf(Values,"%d",&Entry.NKeys) == 1 && Entry.NKeys > 0);
+         for (int Key = 0; Key < Entry.NKeys && ReadOK; Key++) {
+            ReadOK = ReadLine();
+            string Card = Line;
+            Card.resize(80,' ');
+            Entry.Header += Card;
+         }
+      } else if (Item == "End") {
+         ReadOK = (Entry.Name != "" && Entry.Nx > 0 && Entry.Ny > 0 &&
+                                                           Entry.NKeys > 0);
+         I_IndexLookup[Entry.Name] = int(I_IndexEntries.size());
+         I_IndexEntries.push_back(Entry);
+      } else {
+         ReadOK = false;
+      }
+   }
+   fclose(File);
+   
+   if (!ReadOK) {
+      I_ErrorText = "Footprint index '" + IndexFile +
+                                          "' is not in the expected format";
+      I_IndexEntries.clear();
+      I_IndexLookup.clear();
+      return false;
+   }
+   I_Debug.Logf ("Files","Read %d entries from footprint index %s",
+                            int(I_IndexEntries.size()),IndexFile.c_str());
+   
+   BuildIndexBands();
+   
+   return true;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                        W r i t e  M a s k  I n d e x
+//
+//  Writes the entries in I_IndexEntries into the footprint index for the mask
+//  file directory - see ReadMaskIndex() for the format. The index is written
+//  under a temporary name and then renamed, so a program reading it never sees
+//  a partly written one. Returns false, with an error description in
+//  I_ErrorText, if the index can't be written.
+
+bool ProfitSkyCheck::WriteMaskIndex (void)
+{
+   string IndexFile = MaskIndexFileName();
+   string TempFile = IndexFile + TempFileSuffix();
+   
+   FILE* File = fopen(TempFile.c_str(),"w");
+   if (File == NULL) {
+      I_ErrorText = "Unable to create footprint index '" + TempFile + "': " +
+                                                         string(strerror(errno));
+      return false;
+   }
+   fprintf (File,"%s\n",MaskIndexId);
+   for (const ProfitIndexEntry& Entry : I_IndexEntries) {
+      fprintf (File,"Mask %s\n",Entry.Name.c_str());
+      fprintf (File,"Key %lld %lld %016llx\n",(long long)Entry.Size,
+                (long long)Entry.ModTime,(unsigned long long)Entry.Checksum);
+      fprintf (File,"Image %d %d %d\n",Entry.Bitpix,Entry.Nx,Entry.Ny);
+      fprintf (File,"Centre %.9f %.9f\n",Entry.MidRa,Entry.MidDec);
+      fprintf (File,"Footprint");
+      for (int I = 0; I < ProfitIndexEntry::FootprintPoints * 2; I++) {
+         fprintf (File," %.9f",Entry.Footprint[I]);
+      }
+      fprintf (File,"\nKeys %d\n",Entry.NKeys);
+      for (int Key = 0; Key < Entry.NKeys; Key++) {
+         fprintf (File,"%.80s\n",Entry.Header.c_str() + size_t(Key) * 80);
+      }
+      fprintf (File,"End\n");
+   }
+   bool WriteOK = !ferror(File);
+   if (fclose(File) != 0) WriteOK = false;
+   if (!WriteOK || rename(TempFile.c_str(),IndexFile.c_str()) != 0) {
+      I_ErrorText = "Error writing footprint index '" + IndexFile + "': " +
+                                                         string(strerror(errno));
+      remove(TempFile.c_str());
+      return false;
+   }
+   I_Debug.Logf ("Files","Written %d entries to footprint index %s",
+                            int(I_IndexEntries.size()),IndexFile.c_str());
+   return true;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                      B u i l d  I n d e x  B a n d s
+//
+//  Works out the extent in Ra and Dec of each entry in I_IndexEntries from its
+//  footprint, and sets up I_IndexBands, which lists, for each band of Dec
+//  IndexBandDeg wide, the entries whose footprint covers any of that band.
+//  FindIndexedMasks() then only has to look at the entries in the bands that
+//  the field covers.
+
+void ProfitSkyCheck::BuildIndexBands (void)
+{
+   int NBands = int(ceil(180.0 / IndexBandDeg));
+   I_IndexBands.assign(NBands,std::vector<int>());
+   for (size_t IEntry = 0; IEntry < I_IndexEntries.size(); IEntry++) {
+      ProfitIndexEntry& Entry = I_IndexEntries[IEntry];
+      
+      //  The Ra extent is taken relative to the centre of the mask, so a mask
+      //  that covers Ra zero is handled properly.
+      
+      Entry.RaHalfRange = 0.0;
+      Entry.DecMin = Entry.MidDec;
+      Entry.DecMax = Entry.MidDec;
+      for (int I = 0; I < ProfitIndexEntry::FootprintPoints; I++) {
+         double DiffRa = fabs(remainder(Entry.Footprint[I * 2] - Entry.MidRa,360.0));
+         double Dec = Entry.Footprint[I * 2 + 1];
+         Entry.RaHalfRange = std::max(Entry.RaHalfRange,DiffRa);
+         Entry.DecMin = std::min(Entry.DecMin,Dec);
+         Entry.DecMax = std::max(Entry.DecMax,Dec);
+      }
+      int FirstBand = std::max(0,int(floor((Entry.DecMin + 90.0) / IndexBandDeg)));
+      int LastBand = std::min(NBands - 1,
+                                int(floor((Entry.DecMax + 90.0) / IndexBandDeg)));
+      for (int Band = FirstBand; Band <= LastBand; Band++) {
+         I_IndexBands[Band].push_back(int(IEntry));
+      }
+   }
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                      F i n d  I n d e x e d  M a s k s
+//
+//  Sets Overlaps to show which of the entries in I_IndexEntries are for masks
+//  that may overlap the field. Like FileOverlapsField(), this treats the mask
+//  and the field as rectangles in Ra,Dec, the important thing being not to miss
+//  a mask that does overlap, but it uses the extent of the mask's footprint
+//  rather than its nominal range.
+
+void ProfitSkyCheck::FindIndexedMasks (std::vector<bool>& Overlaps)
+{
+   Overlaps.assign(I_IndexEntries.size(),false);
+   if (I_IndexBands.size() == 0) return;
+   
+   int NBands = int(I_IndexBands.size());
+   double FieldDecMin = I_CentralDecDeg - I_FieldRadiusDeg;
+   double FieldDecMax = I_CentralDecDeg + I_FieldRadiusDeg;
+   double FieldRaHalfRange = I_FieldRadiusDeg / cos(I_CentralDecDeg * DD2R);
+   int FirstBand = std::max(0,int(floor((FieldDecMin + 90.0) / IndexBandDeg)));
+   int LastBand = std::min(NBands - 1,
+                                int(floor((FieldDecMax + 90.0) / IndexBandDeg)));
+   for (int Band = FirstBand; Band <= LastBand; Band++) {
+      for (int IEntry : I_IndexBands[Band]) {
+         if (Overlaps[IEntry]) continue;
+         const ProfitIndexEntry& Entry = I_IndexEntries[IEntry];
+         double DiffRa = fabs(remainder(I_CentralRaDeg - Entry.MidRa,360.0));
+         if (DiffRa > Entry.RaHalfRange + FieldRaHalfRange) continue;
+         if (FieldDecMax < Entry.DecMin || FieldDecMin > Entry.DecMax) continue;
+         Overlaps[IEntry] = true;
+      }
+   }
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                     I n d e x  E n t r y  C u r r e n t
+//
+//  Returns true if a mask file hasn't changed since its entry in the footprint
+//  index was written - if its size and modification time are still the same.
+
+bool ProfitSkyCheck::IndexEntryCurrent (
+                    const std::string& MaskFile, const ProfitIndexEntry& Entry)
+{
+   struct stat FileStat;
+   return (stat(MaskFile.c_str(),&FileStat) == 0 &&
+                   int64_t(FileStat.st_size) == Entry.Size &&
+                           int64_t(FileStat.st_mtime) == Entry.ModTime);
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                        A d d  I n d e x e d  F i l e
+//
+//  Passed the entry in the footprint index for a mask file that overlaps the
+//  field, and which IndexEntryCurrent() shows hasn't changed since the index was
+//  written, this adds the details of the file to the list held in I_FileDetails,
+//  using the header keywords from the index, without opening the file at all.
+//  This returns false, with an error description in I_ErrorText, only if the
+//  header keywords in the index don't give usable WCS information.
+
+bool ProfitSkyCheck::AddIndexedFile (
+                    const std::string& MaskFile, const ProfitIndexEntry& Entry)
+{
+   //  If there's an up to date cache file, we use that, as usual, which means
+   //  the details know the cache file is valid.
+   
+   ProfitFileDetails FileDetails;
+   if (!GetCachedDetails (MaskFile,&FileDetails)) {
+      std::vector<char> Keys(Entry.Header.begin(),Entry.Header.end());
+      Keys.push_back('\0');
+      if (!GetDetailsFromHeader (MaskFile,Keys.data(),Entry.NKeys,
+                                           Entry.Nx,Entry.Ny,&FileDetails)) {
+         return false;
+      }
+   }
+   I_Debug.Logf ("Files","Using footprint index for %s, BITPIX %d",
+                                             MaskFile.c_str(),Entry.Bitpix);
+   
+   return AddFileDetails (&FileDetails);
+}
 
-   bool ReturnOK = true;
+// ----------------------------------------------------------------------------------
+//
+//                        C h e c k  U s e  F o r  S k y
+//
+//  Checks whether the specified area (centered on RaDeg,DecDeg, with a radius of
+//  RadiusDeg) is clear of any catalogue objects. If it is clear, this
+//  sets Clear to true. Otherwise, it sets Clear to false. Note that the bool
+//  returned as the function value is used to indicate success or failure (this
+//  will fail if the Catalogue was not initialised, for example), and not whether
+//  or not the area is clear.
+
+bool ProfitSkyCheck::CheckUseForSky (
+   double RaDeg, double DecDeg, double RadiusDeg, bool* Clear)
+{
+   bool ReturnOK = false;
    
-   //  Open the directory
+   *Clear = false;
    
-   errno = 0;
-   if ((DirPtr = opendir(I_DirectoryPath.c_str())) == NULL) {
-      string ErrorString(string(strerror(errno)));
-      I_ErrorText = "Unable to open mask file directory '" + I_DirectoryPath +
-                                                            "': " + ErrorString;
-      ReturnOK = false;
+   bool Checked = false;
+   
+   //  Check we're initialised.
+   
+   if (!I_Initialised) {
+      I_ErrorText = "The ProfitSkyCheck object has not been initialised properly.";
    } else {
+   
+      //  Keep an eye on the coordinate range we're being asked to handle, for
+      //  diagnostic purposes.
+      
+      if (RaDeg < I_RaDecRange[0]) I_RaDecRange[0] = RaDeg;
+      if (DecDeg < I_RaDecRange[1]) I_RaDecRange[1] = DecDeg;
+      if (RaDeg > I_RaDecRange[2]) I_RaDecRange[2] = RaDeg;
+      if (DecDeg > I_RaDecRange[3]) I_RaDecRange[3] = DecDeg;
 
-      //  Loop through all the files in the directory, looking for FITS files.
+      I_Debug.Log ("SkyCheckCoords",
+                       "Checking coordinates " + FormatRaDecDeg(RaDeg,DecDeg));
       
-      int Count = 0;
-      int CompressedCount = 0;
-      do {
-         errno = 0;
-         if ((EntryPtr = readdir(DirPtr)) != NULL) {
-            string FileName = string(EntryPtr->d_name);
+      int FileCount = 0;
+      int ClearCount = 0;
+      
+      //  Now, this is what all the hard work has been for. We should have a list
+      //  of structures, each of which describes one mask file that overlaps at
+      //  least part of the field in question. At least one of these should overlap
+      //  this particular position. We try to find it in each file and see if
+      //  the position is clear. If any file indicates that it is obscured, we
+      //  assume it is not clear. (We'd expect files to agree, if they overlap,
+      //  but the images are not identical in their overlap regions. See programming
+      //  notes.)
+      
+      ReturnOK = true;
+      for (struct ProfitFileDetails& Details : I_FileDetails) {
+      
+         //  Find the pixel containing the point of interest, and the rectangle
+         //  of pixels round it that needs to be checked. If we have an error,
+         //  we bail out. Just being outside the part of the mask that covers
+         //  the field isn't an error from our point of view here - it's just
+         //  not covered by this mask. An error getting the pixel scale is
+         //  just as much an error - the position can't be checked.
+         
+         ProfitSkyRect Rect;
+         GetSkyCheckRect (Details,RaDeg,DecDeg,RadiusDeg,&Rect);
+         if (Rect.Result == RECT_OUTSIDE) continue;
+         if (Rect.Result == RECT_ERROR || Rect.Result == RECT_ABANDONED) {
+            I_ErrorText = Rect.Error;
+            ReturnOK = false;
+            break;
+         }
+         
+         //  Make sure we have the mask data for that range. The first time a
+         //  position in this part of the mask is checked, this is where the
+         //  data is read from the file.
+         
+         if (!LoadMaskData (Details,Rect.Ixst,Rect.Ixen,Rect.Iyst,Rect.Iyen)) {
+            ReturnOK = false;
+            break;
+         }
+         
+         Checked = true;
+         FileCount++;
+         bool Contaminated =
+                  MaskRectContaminated (Details,RaDeg,DecDeg,RadiusDeg,Rect);
+         
+         //  At this point, we've gone through the pixels in this Profit
+         //  file. If Contaminated is set, then this file shows contamination
+         //  in at least one pixel within the test radius. However, if
+         //  Contaminated is clear, then at least this one file shows no
+         //  contamination, and we take that as an OK to use this position.
+         
+         if (!Contaminated) {
+            I_Debug.Logf ("SkyCheck","Checked all pixels in range. All clear.");
+            *Clear = true;
+            ClearCount++;
             
-            //  Getting the file name is one thing, manipulating the file name in
-            //  C++ to see if it a) is compressed, b) has a recognised FITS file
-            //  extension, is more work. The transform gets a lower case version,
-            //  then we look for the last extension - ie anything after the last
-            //  '.'. If that is ".gz" we strip that off, and then get the extension.
-            //  If that extension is ".fits" or any of the usual other options,
-            //  we assume this is a FITS file.
+            //  We don't need to check the rest of the Profit files now, since
+            //  we've found one clear, and it may be a useful disgnostic if
+            //  we actually look at all the rest of the files.
             
-            bool Compressed = false;
-            bool FitsFile = false;
-            string LowerName = FileName;
-            std::transform(LowerName.begin(),LowerName.end(),LowerName.begin(),
-                                 [](unsigned char c){ return std::tolower(c); });
-            size_t ExtPosn = LowerName.rfind('.');
-            if (ExtPosn != string::npos) {
-               string Ext = LowerName.substr(ExtPosn);
-               if (!Ext.compare(".gz")) {
-                  Compressed = true;
-                  LowerName.erase(ExtPosn);
-                  ExtPosn = LowerName.rfind('.');
-                  if (ExtPosn != string::npos) {
-                     Ext = LowerName.substr(ExtPosn);
-                  }
-               }
-               if (!Ext.compare(".fits")) FitsFile = true;
-               else if (!Ext.compare(".fit")) FitsFile = true;
-               else if (!Ext.compare(".fts")) FitsFile = true;
+            if (!I_Debug.Active("SkyCheckFiles")) break;
+         }
+      }
+      
+      if (I_Debug.Active("SkyCheckFiles")) {
+         I_Debug.Logf ("SkyCheckFiles",
+            "Profit files checked %d, files clear %d",FileCount,ClearCount);
+         if (ClearCount != 0 && ClearCount != FileCount) {
+            I_Debug.Log("SkyCheckFiles","Note: Profit files disagree.");
+         }
+      }
+
+      //  We've now gone through all the mask files with any overlap with the
+      //  field. At least one of them should have had data for this point. If
+      //  none did, the point is probably outside the specified field - maybe
+      //  we should have checked that, but this is a more direct test.
+      
+      if (ReturnOK && !Checked) {
+         I_ErrorText = "No mask found that covers the coordinates " +
+                                 FormatRaDecDeg(RaDeg,DecDeg) + ".";
+         ReturnOK = false;
+      }
+   }
+   
+   return ReturnOK;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                  C h e c k  P o s i t i o n s  F o r  S k y
+//
+//  Checks a list of positions for use as sky positions, each centred on RaDeg,
+//  DecDeg and needing to be clear out to RadiusDeg. For each, Status is set to
+//  SKY_CLEAR or SKY_OBSCURED, as CheckUseForSky() would set Clear, or left as
+//  SKY_UNCHECKED - with the error CheckUseForSky() would have given in Reason -
+//  if the position couldn't be checked (for example, because no mask covers it).
+//  The results are exactly what CheckUseForSky() would give for each position,
+//  but this works out which mask data is needed for all the positions first,
+//  reads it all, several masks at once, and then checks the positions in
+//  several threads, in an order that keeps those close together in the same
+//  mask together. The bool returned as the function value is only false if
+//  the object hasn't been initialised - failing to check a position is not
+//  an error, just a result. See programming notes.
+
+bool ProfitSkyCheck::CheckPositionsForSky (std::vector<ProfitSkyPosn>& Posns)
+{
+   if (!I_Initialised) {
+      I_ErrorText = "The ProfitSkyCheck object has not been initialised properly.";
+      return false;
+   }
+   
+   int NPosns = int(Posns.size());
+   for (ProfitSkyPosn& Posn : Posns) {
+      Posn.Status = SKY_UNCHECKED;
+      Posn.Reason = "";
+   }
+   
+   //  The diagnostics CheckUseForSky() can produce only make sense for one
+   //  position at a time, so if any are wanted, that's how the positions
+   //  are checked.
+   
+   if (I_Debug.Active("SkyCheck") || I_Debug.Active("SkyCheckFiles") ||
+         I_Debug.Active("SkyCheckCoords") || I_Debug.Active("SkyCheckDist")) {
+      for (ProfitSkyPosn& Posn : Posns) {
+         bool Clear = false;
+         if (CheckUseForSky (Posn.RaDeg,Posn.DecDeg,Posn.RadiusDeg,&Clear)) {
+            Posn.Status = Clear ? SKY_CLEAR : SKY_OBSCURED;
+         } else {
+            Posn.Reason = I_ErrorText;
+         }
+      }
+      return true;
+   }
+   
+   //  Keep an eye on the coordinate range we're being asked to handle, for
+   //  diagnostic purposes.
+   
+   for (const ProfitSkyPosn& Posn : Posns) {
+      if (Posn.RaDeg < I_RaDecRange[0]) I_RaDecRange[0] = Posn.RaDeg;
+      if (Posn.DecDeg < I_RaDecRange[1]) I_RaDecRange[1] = Posn.DecDeg;
+      if (Posn.RaDeg > I_RaDecRange[2]) I_RaDecRange[2] = Posn.RaDeg;
+      if (Posn.DecDeg > I_RaDecRange[3]) I_RaDecRange[3] = Posn.DecDeg;
+   }
+   
+   //  The positions are handed out to the threads in chunks, each thread
+   //  taking the next chunk that hasn't been taken yet until there aren't any
+   //  left. wcsp2s() can only be used by several threads at once if the wcsprm
+   //  structure has already been set up - which wcsset() makes sure of - and
+   //  the mask has no distortions. (The Profit masks don't have any.)
+   
+   const int ChunkSize = 16;
+   int NChunks = (NPosns + ChunkSize - 1) / ChunkSize;
+   int NThreads = ThreadsToUse(NChunks,false);
+   std::vector<ProfitFileDetails*> Masks;
+   for (ProfitFileDetails& Details : I_FileDetails) {
+      if (wcsset(&Details.Wcs) != 0) NThreads = 1;
+      if (Details.Wcs.lin.dispre || Details.Wcs.lin.disseq) NThreads = 1;
+      Masks.push_back(&Details);
+   }
+   int NMasks = int(Masks.size());
+   auto RunChunks = [&](std::function<void(int)> CheckPosn) {
+      std::atomic<int> NextChunk(0);
+      auto RunThread = [&]() {
+         for (int IChunk = NextChunk++; IChunk < NChunks; IChunk = NextChunk++) {
+            int Last = std::min((IChunk + 1) * ChunkSize,NPosns);
+            for (int I = IChunk * ChunkSize; I < Last; I++) CheckPosn(I);
+         }
+      };
+      std::vector<std::thread> Threads;
+      for (int IThread = 1; IThread < NThreads; IThread++) {
+         Threads.push_back(std::thread(RunThread));
+      }
+      RunThread();
+      for (std::thread& Thread : Threads) Thread.join();
+   };
+   
+   //  First, find where each position falls in each mask, going through the
+   //  masks in order just as CheckUseForSky() does, and stopping at the first
+   //  error. Rects[IPosn * NMasks + IMask] is for position IPosn in mask IMask.
+   
+   std::vector<ProfitSkyRect> Rects(size_t(NPosns) * NMasks);
+   RunChunks ([&](int IPosn) {
+      const ProfitSkyPosn& Posn = Posns[IPosn];
+      for (int IMask = 0; IMask < NMasks; IMask++) {
+         ProfitSkyRect& Rect = Rects[size_t(IPosn) * NMasks + IMask];
+         GetSkyCheckRect (*Masks[IMask],Posn.RaDeg,Posn.DecDeg,Posn.RadiusDeg,&Rect);
+         if (Rect.Result == RECT_ERROR || Rect.Result == RECT_ABANDONED) break;
+      }
+   });
+   
+   //  Now make sure all the mask data needed is read, covering the rectangles
+   //  for all the positions in each mask. A mask whose data can't be read
+   //  leaves unchecked any position that needs it.
+   
+   std::vector<std::vector<int> > Areas(NMasks);
+   for (int IPosn = 0; IPosn < NPosns; IPosn++) {
+      for (int IMask = 0; IMask < NMasks; IMask++) {
+         const ProfitSkyRect& Rect = Rects[size_t(IPosn) * NMasks + IMask];
+         if (Rect.Result != RECT_COVERED) continue;
+         std::vector<int>& Area = Areas[IMask];
+         if (Area.empty()) {
+            Area = {Rect.Ixst,Rect.Ixen,Rect.Iyst,Rect.Iyen};
+         } else {
+            Area[0] = std::min(Area[0],Rect.Ixst);
+            Area[1] = std::max(Area[1],Rect.Ixen);
+            Area[2] = std::min(Area[2],Rect.Iyst);
+            Area[3] = std::max(Area[3],Rect.Iyen);
+         }
+      }
+   }
+   std::vector<string> LoadErrors;
+   LoadMaskAreas (Areas,&LoadErrors);
+   
+   //  Sort the positions by the first mask that covers them, and then by
+   //  where they are in it, a band of rows at a time, so that positions
+   //  checked one after the other use neighbouring parts of the mask data.
+   
+   const int BandRows = 64;
+   std::vector<int> SortKeys(size_t(NPosns) * 3);
+   for (int IPosn = 0; IPosn < NPosns; IPosn++) {
+      int* Key = &SortKeys[size_t(IPosn) * 3];
+      Key[0] = NMasks;
+      Key[1] = Key[2] = 0;
+      for (int IMask = 0; IMask < NMasks; IMask++) {
+         const ProfitSkyRect& Rect = Rects[size_t(IPosn) * NMasks + IMask];
+         if (Rect.Result == RECT_COVERED) {
+            Key[0] = IMask;
+            Key[1] = Rect.PIy / BandRows;
+            Key[2] = Rect.PIx;
+            break;
+         }
+      }
+   }
+   std::vector<int> Order(NPosns);
+   for (int IPosn = 0; IPosn < NPosns; IPosn++) Order[IPosn] = IPosn;
+   std::stable_sort (Order.begin(),Order.end(),[&](int I1, int I2) {
+      return std::lexicographical_compare(&SortKeys[size_t(I1) * 3],
+          &SortKeys[size_t(I1) * 3 + 3],&SortKeys[size_t(I2) * 3],
+                                                &SortKeys[size_t(I2) * 3 + 3]);
+   });
+   
+   //  Finally, check the positions in that order. For each, this follows the
+   //  same logic as CheckUseForSky(), going through the masks in order until
+   //  one shows the position is clear.
+   
+   RunChunks ([&](int I) {
+      int IPosn = Order[I];
+      ProfitSkyPosn& Posn = Posns[IPosn];
+      bool Checked = false;
+      for (int IMask = 0; IMask < NMasks; IMask++) {
+         const ProfitSkyRect& Rect = Rects[size_t(IPosn) * NMasks + IMask];
+         if (Rect.Result == RECT_OUTSIDE) continue;
+         if (Rect.Result == RECT_ERROR || Rect.Result == RECT_ABANDONED) {
+            Posn.Reason = Rect.Error;
+            return;
+         }
+         if (LoadErrors[IMask] != "") {
+            Posn.Reason = LoadErrors[IMask];
+            return;
+         }
+         Checked = true;
+         if (!MaskRectContaminated (*Masks[IMask],Posn.RaDeg,Posn.DecDeg,
+                                                       Posn.RadiusDeg,Rect)) {
+            Posn.Status = SKY_CLEAR;
+            return;
+         }
+      }
+      if (Checked) {
+         Posn.Status = SKY_OBSCURED;
+      } else {
+         Posn.Reason = "No mask found that covers the coordinates " +
+                                 FormatRaDecDeg(Posn.RaDeg,Posn.DecDeg) + ".";
+      }
+   });
+   I_Debug.Logf ("Files","Checked %d positions using %d threads",NPosns,NThreads);
+   
+   return true;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                       G e t  S k y  C h e c k  R e c t
+//
+//  Works out where a position (RaDeg,DecDeg) to be checked for use as a sky
+//  position falls in a mask, and the rectangle of pixels that has to be checked
+//  to see if everything within RadiusDeg of it is clear, clipped to the part of
+//  the mask that covers the field. This only needs the WCS details for the mask,
+//  not its data. The result is returned in Rect. Result is RECT_OUTSIDE if the
+//  mask doesn't cover the position, RECT_ERROR if WCS couldn't locate it, and
+//  RECT_ABANDONED if WCS couldn't give the pixel scale there, with a description
+//  of the problem in Error. This changes nothing but Rect, so with no debug
+//  levels active it can be used by several threads at once.
+
+void ProfitSkyCheck::GetSkyCheckRect (ProfitFileDetails& Details, double RaDeg,
+                     double DecDeg, double RadiusDeg, ProfitSkyRect* Rect)
+{
+   Rect->Result = RECT_OUTSIDE;
+   Rect->Error = "";
+   
+   //  This code does rather assume that the first axis (the X-axis) of the
+   //  data is Ra and the second (the Y-axis) is Dec. If anyone switches
+   //  this around in the Profit files, some recoding will be needed.
+   
+   //  Find the pixel containing the point of interest. LocatePixel() returns
+   //  false for both an error from WCS and for a point outside the mask. Just
+   //  being outside isn't an error from our point of view here, so we have to
+   //  check just what it's complaining about.
+   
+   int PIx = 0, PIy = 0;
+   bool Outside= false;
+   string Error = "";
+   if (!LocatePixel (Details,RaDeg,DecDeg,&PIx,&PIy,&Outside,&Error)) {
+      if (Outside) {
+         I_Debug.Log ("SkyCheckFiles","Not covered by " + Details.Path);
+         Rect->Result = RECT_OUTSIDE;
+      } else {
+         I_Debug.Log ("SkyCheckFiles","WCS error from " + Details.Path);
+         Rect->Result = RECT_ERROR;
+         Rect->Error = Error;
+      }
+      return;
+   }
+   
+   //  We only use the data for the part of the mask that covers the
+   //  field, so a point outside that part is treated as not covered by
+   //  the mask at all.
+   
+   int AreaIx1 = Details.AreaIx0 + Details.AreaNx - 1;
+   int AreaIy1 = Details.AreaIy0 + Details.AreaNy - 1;
+   if (PIx < Details.AreaIx0 || PIx > AreaIx1 ||
+                           PIy < Details.AreaIy0 || PIy > AreaIy1) {
+      I_Debug.Log ("SkyCheckFiles","Outside field area of " + Details.Path);
+      Rect->Result = RECT_OUTSIDE;
+      return;
+   }
+   I_Debug.Log ("SkyCheckFiles",
+                       "Checking against data in file " + Details.Path);
+   
+   bool Debug = I_Debug.Active("SkyCheck");
+   if (Debug) {
+      I_Debug.Logf ("SkyCheck","Start pixel [%d,%d], coords %s",PIx,PIy,
+                                     FormatRaDecDeg(RaDeg,DecDeg).c_str());
+   }
+   
+   //  We want to know the local pixel to degree scale in both Ra,Dec,
+   //  which we get from looking at the range covered by this central
+   //  pixel. We want to look at all the pixels in a circle of the
+   //  specified radius around the central one. First we work out the
+   //  rectangle that encloses that circle. All the pixels we need to
+   //  look at will be within that rectangle, whose pixel coordinates
+   //  go from Ixst,Iyst to Ixen,Iyen. Note that here, the bottom left
+   //  pixel in the image is [1,1], with a centre at [1.0,1.0].
+   
+   double FIx = double(PIx);
+   double FIy = double(PIy);
+   double CentreRaDeg,CentreDecDeg,DeltaRaAsec,DeltaDecAsec;
+   if (!PixelDims (&Details.Wcs,FIx,FIy,&CentreRaDeg,
+                     &CentreDecDeg,&DeltaRaAsec,&DeltaDecAsec,&Error)) {
+      Rect->Result = RECT_ABANDONED;
+      Rect->Error = Error;
+      return;
+   }
+   double DeltaRaDeg = DeltaRaAsec / DegToAsec;
+   double DeltaDecDeg = DeltaDecAsec / DegToAsec;
+   
+   if (Debug) {
+      I_Debug.Logf ("SkyCheck","Radius = %f asec",RadiusDeg * DegToAsec);
+      I_Debug.Log  ("SkyCheck","Deltas = " +
+                                 FormatRaDecDeg(DeltaRaDeg,DeltaDecDeg));
+      I_Debug.Logf ("SkyCheck","Deltas = [%f,%f] pix",
+            fabs(RadiusDeg / DeltaRaDeg),fabs(RadiusDeg / DeltaDecDeg));
+   }
+   
+   int Ixst = int(FIx - 0.5 - fabs(RadiusDeg / DeltaRaDeg));
+   int Ixen = int(FIx + 0.5 + fabs(RadiusDeg / DeltaRaDeg));
+   int Iyst = int(FIy - 0.5 - fabs(RadiusDeg / DeltaDecDeg));
+   int Iyen = int(FIy + 0.5 + fabs(RadiusDeg / DeltaDecDeg));
+   
+   I_Debug.Logf ("SkyCheck",
+                    "Range %d to %d, %d to %d",Ixst,Ixen,Iyst,Iyen);
+   
+   //  Keep the Ra,Dec ranges within the bounds of the part of the image
+   //  that covers the field.
+   
+   if (Ixen > AreaIx1) Ixen = AreaIx1;
+   if (Iyen > AreaIy1) Iyen = AreaIy1;
+   if (Ixst < Details.AreaIx0) Ixst = Details.AreaIx0;
+   if (Iyst < Details.AreaIy0) Iyst = Details.AreaIy0;
+   
+   I_Debug.Logf ("SkyCheck","Mod Range %d to %d, %d to %d",
+                                                 Ixst,Ixen,Iyst,Iyen);
+   
+   Rect->Result = RECT_COVERED;
+   Rect->PIx = PIx;
+   Rect->PIy = PIy;
+   Rect->CentreRaDeg = CentreRaDeg;
+   Rect->CentreDecDeg = CentreDecDeg;
+   Rect->DeltaRaDeg = DeltaRaDeg;
+   Rect->DeltaDecDeg = DeltaDecDeg;
+   Rect->Ixst = Ixst;
+   Rect->Ixen = Ixen;
+   Rect->Iyst = Iyst;
+   Rect->Iyen = Iyen;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                  M a s k  R e c t  C o n t a m i n a t e d
+//
+//  Checks whether any non-zero pixel of a mask is within RadiusDeg of a position
+//  (RaDeg,DecDeg), given the rectangle of pixels round the position worked out
+//  by GetSkyCheckRect(). The mask data for that rectangle must already have been
+//  read. This returns true if there is such a pixel. It doesn't change anything,
+//  so with no debug levels active it can be used by several threads at once.
+
+bool ProfitSkyCheck::MaskRectContaminated (const ProfitFileDetails& Details,
+        double RaDeg, double DecDeg, double RadiusDeg, const ProfitSkyRect& Rect)
+{
+   //  It's convenient to have the details of the pixel containing the test
+   //  position and of the rectangle round it as they were when this was part
+   //  of CheckUseForSky().
+   
+   int PIx = Rect.PIx;
+   double FIx = double(Rect.PIx);
+   double FIy = double(Rect.PIy);
+   double CentreRaDeg = Rect.CentreRaDeg;
+   double CentreDecDeg = Rect.CentreDecDeg;
+   double DeltaRaDeg = Rect.DeltaRaDeg;
+   double DeltaDecDeg = Rect.DeltaDecDeg;
+   int Ixst = Rect.Ixst;
+   int Ixen = Rect.Ixen;
+   int Iyst = Rect.Iyst;
+   int Iyen = Rect.Iyen;
+   
+   //  Now we need to look at all the pixels in the rectangle. For each,
+   //  we calculate the minimum distance from the centre of the test circle
+   //  (RaDeg,DecDeg) to the rectangle formed by the pixel. We assume that
+   //  in the are of interest the Ra/Dec to pixel scale is constant and
+   //  given by DeltaRa, DeltaDec. We compare this minimum distance with
+   //  the radius of the test circle (RadiusDeg). CheckPixel() does this
+   //  for one pixel, returning true if the pixel needs to be checked.
+   //
+   //  The pixel centre is worked out on the basis of the distance of
+   //  the pixel from the centre of the test circle, whose pixel
+   //  coordinates are [FIx,FIy] and whose Ra,Dec coords are
+   //  [CentreRaDeg,CentreDecDeg]. Calling GetPixelDims() for each pixel
+   //  would be more accurate (but hardly significantly so) and much
+   //  slower.
+   //
+   //  We assume the size of the pixel we're testing is DeltaRaDeg
+   //  by DeltaDecDeg. The question is now one of calculating the
+   //  minimum distance from a point to an axis aligned rectangle
+   //  of given width. (The code here is based on that given in
+   //  https://gamedev.stackexchange.com/questions/44483/how-do-i-
+   //  calculate-distance-between-a-point-and-an-axis-aligned-rectangle
+   //  from Sam Hocevar and isn't quite the fastest possible, but it's
+   //  neat. If both of the DistRa or DistDec values are < 0.0, then
+   //  the point is within the rectangle.)
+   
+   auto RaDist = [&](int Ix) {
+      return fabs(RaDeg - ((double(Ix) - FIx) * DeltaRaDeg + CentreRaDeg));
+   };
+   auto CheckPixel = [&](int Ix, int Iy, double* DistRa, double* DistDec) {
+      double Dec = (double(Iy) - FIy) * DeltaDecDeg + CentreDecDeg;
+      double DistSq = 0.0;
+      *DistRa = RaDist(Ix) - fabs(DeltaRaDeg) * 0.5;
+      *DistDec = fabs(DecDeg - Dec) - fabs(DeltaDecDeg) * 0.5;
+      if ((*DistRa > 0.0) || (*DistDec > 0.0)) {
+         DistSq = *DistRa * *DistRa + *DistDec * *DistDec;
+      }
+      return (DistSq <= (RadiusDeg * RadiusDeg));
+   };
+   
+   bool Contaminated = false;
+   double DistRa = 0.0, DistDec = 0.0;
+   
+   if (I_Debug.Active("SkyCheckDist")) {
+   
+      //  For this diagnostic, we look at every pixel in turn.
+      
+      for (int Ix = Ixst; Ix <= Ixen; Ix++) {
+         for (int Iy = Iyst; Iy <= Iyen; Iy++) {
+            bool Check = CheckPixel (Ix,Iy,&DistRa,&DistDec);
+            I_Debug.Logf("SkyCheckDist",
+               "Pixel[%d,%d] = %d, Ra,Dec dist = %f,%f will %s",
+               Ix,Iy,int(MaskPixelSet(Details,Ix,Iy)),
+               DistRa * DegToAsec, DistDec * DegToAsec,
+               Check ? "check" : "ignore");
+            if (Check && MaskPixelSet(Details,Ix,Iy)) {
+               I_Debug.Logf ("SkyCheck",
+                          "Test pixel [%d,%d], is non-zero",Ix,Iy);
+               Contaminated = true;
+               break;
             }
+         }
+         if (Contaminated) break;
+      }
+      
+   } else if (CountInRect(Details,Ixst,Ixen,Iyst,Iyen) == 0) {
+   
+      //  If we have a count table, and it shows there are no non-zero
+      //  pixels at all in the rectangle, there's nothing to check.
+      
+      I_Debug.Log ("SkyCheck","Count table shows range is clear.");
+      
+   } else {
+   
+      //  Normally, we work through the rectangle a row at a time. The
+      //  pixels to be checked in each row form at most two runs, one
+      //  each side of the pixel closest in Ra to the test position, so
+      //  we find where they start and end and then test each run a word
+      //  of the mask at a time. (Usually there is just one run, but see
+      //  the programming notes.) First, the pixel closest in Ra, which is
+      //  the same for every row.
+      
+      int Ixc = std::min(std::max(PIx,Ixst),Ixen);
+      while (Ixc > Ixst && RaDist(Ixc - 1) < RaDist(Ixc)) Ixc--;
+      while (Ixc < Ixen && RaDist(Ixc + 1) < RaDist(Ixc)) Ixc++;
+      
+      for (int Iy = Iyst; Iy <= Iyen && !Contaminated; Iy++) {
+         for (int Step = -1; Step <= 1 && !Contaminated; Step += 2) {
+         
+            //  Moving out from Ixc in the direction given by Step, the
+            //  Ra distance only increases. There may be a pixel or so
+            //  close to Ixc that doesn't need checking, then a run of
+            //  pixels that do, then the rest that don't. We skip the
+            //  first ones, then use a binary search for the end of the
+            //  run.
             
-            //  Add anything we think is a FITS file to I_MakeFileList. We add
-            //  the full path name, including the directory. That should make it
-            //  easier later.
-            
-            if (FitsFile) {
-               I_MaskFileList.push_back(I_DirectoryPath + '/' + FileName);
-               Count++;
-               if (Compressed) CompressedCount++;
+            int Ixend = (Step > 0) ? Ixen : Ixst;
+            int Ix = Ixc;
+            bool Check = CheckPixel (Ix,Iy,&DistRa,&DistDec);
+            while (!Check && DistRa < 0.0 && Ix != Ixend) {
+               Ix += Step;
+               Check = CheckPixel (Ix,Iy,&DistRa,&DistDec);
+            }
+            if (!Check) continue;
+            int In = Ix;
+            int Out = Ixend + Step;
+            while (abs(Out - In) > 1) {
+               int Mid = In + (Out - In) / 2;
+               if (CheckPixel (Mid,Iy,&DistRa,&DistDec)) In = Mid;
+               else Out = Mid;
+            }
+            int FirstIx = std::min(Ix,In);
+            int LastIx = std::max(Ix,In);
+            if (MaskRangeSet (Details,Iy,FirstIx,LastIx)) {
+            
+               //  We've found contamination, and that's all we need.
+               
+               I_Debug.Logf ("SkyCheck",
+                   "Test pixels [%d to %d,%d] include a non-zero pixel",
+                                                  FirstIx,LastIx,Iy);
+               Contaminated = true;
             }
-            if (!FitsFile) I_Debug.Logf ("Files","'%s' is not a FITS file",
-                                                            FileName.c_str());
          }
-      } while (EntryPtr != NULL);
-      closedir(DirPtr);
+      }
+   }
+   
+   return Contaminated;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                    B u i l d  C l e a r a n c e  M a p s
+//
+//  Works out, for each pixel in the part of each mask file that covers the field,
+//  the distance on the sky to the nearest non-zero pixel. Once this has been
+//  called, GetClearRadius() can be used to get the clear radius around any
+//  position in the field. This needs Initialise() to have been called first.
+//  Building the maps takes time in proportion to the number of mask pixels in
+//  the field, so is only worth doing if the clear radius is wanted, or if a
+//  large number of positions are to be checked.
+
+bool ProfitSkyCheck::BuildClearanceMaps (void)
+{
+   bool ReturnOK = false;
+   
+   if (!I_Initialised) {
+      I_ErrorText = "The ProfitSkyCheck object has not been initialised properly.";
+   } else {
       
-      //  Not finding any FITS files at all is an error.
+      //  All the data in the field area is needed, so read any that hasn't
+      //  been read yet for all the masks at once.
       
-      if (Count == 0) {
-         I_ErrorText = "No FITS files found in mask file directory '" +
-                                                       I_DirectoryPath + "'";
-         ReturnOK = false;
+      ReturnOK = LoadFieldAreas(false);
+      for (struct ProfitFileDetails& Details : I_FileDetails) {
+         if (ReturnOK && !BuildClearanceMap(Details)) {
+            ReturnOK = false;
+            break;
+         }
       }
-      
-      I_Debug.Logf ("Files", "Found %d FITS files, %d were compressed",
-                                                      Count,CompressedCount);
+      I_ClearMapsBuilt = ReturnOK;
    }
    return ReturnOK;
 }
 
 // ----------------------------------------------------------------------------------
 //
-//                        C h e c k  U s e  F o r  S k y
+//                    B u i l d  C l e a r a n c e  M a p
 //
-//  Checks whether the specified area (centered on RaDeg,DecDeg, with a radius of
-//  RadiusDeg) is clear of any catalogue objects. If it is clear, this
-//  sets Clear to true. Otherwise, it sets Clear to false. Note that the bool
-//  returned as the function value is used to indicate success or failure (this
-//  will fail if the Catalogue was not initialised, for example), and not whether
-//  or not the area is clear.
+//  Works out the clearance map for a single mask file, setting the ClearMap
+//  details in the structure describing the file. The map covers the part of the
+//  mask that includes the field, but allows for non-zero pixels outside that
+//  part out to the largest radius the map can hold. If the field doesn't
+//  overlap the mask at all, no map is needed and ClearMap is left NULL. This
+//  uses a separable exact Euclidean distance transform - see the programming
+//  notes.
 
-bool ProfitSkyCheck::CheckUseForSky (
-   double RaDeg, double DecDeg, double RadiusDeg, bool* Clear)
+bool ProfitSkyCheck::BuildClearanceMap (ProfitFileDetails& Details)
 {
-   bool ReturnOK = false;
+   int Ny = Details.Ny;
    
-   *Clear = false;
+   //  The size of a pixel on the sky, in arcsec, in the Dec direction. The Ra
+   //  size depends on Dec, and we use the size for each row when we work out
+   //  the distances along it. KX and KY are the number of pixels the largest
+   //  radius we need to look at might cover.
    
-   bool Checked = false;
+   double ScaleY = fabs(Details.DeltaDec) * DegToAsec;
+   int KX,KY;
+   if (!GetRadiusInPixels (Details,MaxClearRadius(),&KX,&KY)) return false;
    
-   //  Check we're initialised.
+   //  The map needs all the mask data for the area that covers the field.
+   
+   if (!LoadMaskData (Details,Details.AreaIx0,Details.AreaIx0 + Details.AreaNx - 1,
+                 Details.AreaIy0,Details.AreaIy0 + Details.AreaNy - 1)) return false;
+   
+   //  Work out the pixel range covered by the field, and the range of the
+   //  part of the mask that we have, which should include it.
+   
+   int Ix0,Ix1,Iy0,Iy1;
+   GetFieldPixelRange (Details,&Ix0,&Ix1,&Iy0,&Iy1);
+   int MaskIx1 = Details.MaskIx0 + Details.MaskNx - 1;
+   int MaskIy1 = Details.MaskIy0 + Details.MaskNy - 1;
+   Ix0 = std::max(Ix0,Details.MaskIx0);
+   Ix1 = std::min(Ix1,MaskIx1);
+   Iy0 = std::max(Iy0,Details.MaskIy0);
+   Iy1 = std::min(Iy1,MaskIy1);
+   
+   Details.ClearMap = NULL;
+   Details.ClearNx = 0;
+   Details.ClearNy = 0;
+   if (Ix0 > Ix1 || Iy0 > Iy1) {
+      I_Debug.Log ("ClearMap","Field does not overlap " + Details.Path);
+      return true;
+   }
+   int MNx = Ix1 - Ix0 + 1;
+   int MNy = Iy1 - Iy0 + 1;
+   I_Debug.Logf ("ClearMap","Map for %s covers [%d to %d, %d to %d]",
+                                  Details.Path.c_str(),Ix0,Ix1,Iy0,Iy1);
+   uint8_t** ClearMap =
+                (uint8_t**) I_ArrayManager.Malloc2D(sizeof(uint8_t),MNy,MNx);
+   
+   //  The map only covers that area, but a non-zero pixel up to KX columns
+   //  or KY rows outside it can be within the largest radius of a pixel in
+   //  it, so the distances are worked out over the wider range of columns
+   //  Ox0 to Ox1, and each strip of rows of the map uses the KY rows either
+   //  side of it as well, all clipped to the part of the mask we have.
+   //
+   //  The first pass works down each column of the strip and its neighbours, and
+   //  sets ColDist to the number of rows to the nearest non-zero pixel in that
+   //  column, or NoPixel if there are none. Values larger than KY may be too
+   //  big, as the nearest such pixel may be further out than the neighbouring
+   //  rows, but that doesn't matter as any such distance is larger than the
+   //  largest radius the map can hold. This works a row at a time, first
+   //  downwards then upwards, so the mask is accessed in the order it's held.
+   
+   int Ox0 = std::max(Details.MaskIx0,Ix0 - KX);
+   int Ox1 = std::min(MaskIx1,Ix1 + KX);
+   int ONx = Ox1 - Ox0 + 1;
+   int XOffset = Ix0 - Ox0;
+   
+   const uint16_t NoPixel = 0xFFFF;
+   int MaxHaloRows = ClearMapStripRows + 2 * KY;
+   std::vector<uint16_t> ColDist((size_t)MaxHaloRows * ONx);
+   std::vector<double> ColDistSq(ONx);
+   std::vector<int> Parabola(ONx);
+   std::vector<double> Boundary(ONx + 1);
+   
+   for (int StripY = 0; StripY < MNy; StripY += ClearMapStripRows) {
+      int StripRows = std::min(ClearMapStripRows,MNy - StripY);
+      int HaloIy0 = std::max(Details.MaskIy0,Iy0 + StripY - KY);
+      int HaloIy1 = std::min(MaskIy1,Iy0 + StripY + StripRows - 1 + KY);
+      int HaloRows = HaloIy1 - HaloIy0 + 1;
+      for (int Row = 0; Row < HaloRows; Row++) {
+         int Iy = HaloIy0 + Row;
+         uint16_t* Dist = &ColDist[(size_t)Row * ONx];
+         const uint16_t* Prev = (Row > 0) ? Dist - ONx : NULL;
+         for (int X = 0; X < ONx; X++) {
+            if (MaskPixelSet(Details,Ox0 + X,Iy)) Dist[X] = 0;
+            else if (Prev && Prev[X] != NoPixel) Dist[X] = Prev[X] + 1;
+            else Dist[X] = NoPixel;
+         }
+      }
+      for (int Row = HaloRows - 2; Row >= 0; Row--) {
+         uint16_t* Dist = &ColDist[(size_t)Row * ONx];
+         const uint16_t* Next = Dist + ONx;
+         for (int X = 0; X < ONx; X++) {
+            if (Next[X] != NoPixel && Next[X] + 1 < Dist[X]) {
+               Dist[X] = Next[X] + 1;
+            }
+         }
+      }
+      
+      //  The second pass works along each row of the strip. The squared distance
+      //  from pixel X to the nearest non-zero pixel is the minimum over all the
+      //  columns Q of (ScaleX * (X - Q))^2 + ColDistSq[Q], a lower envelope of
+      //  parabolas which can be found in linear time (Felzenszwalb and
+      //  Huttenlocher). Parabola[] lists the columns whose parabolas form the
+      //  envelope, and Boundary[] where each takes over from the previous one.
+      //  Columns with no non-zero pixel don't contribute at all. Here, X and Q
+      //  count from column Ox0, and only the columns from Ix0 on are kept.
+      
+      for (int Row = 0; Row < StripRows; Row++) {
+         int Y = StripY + Row;
+         int Iy = Iy0 + Y;
+         double RowDecDeg = Details.MidDec +
+                   (double(Iy) - (double(Ny) + 1.0) * 0.5) * Details.DeltaDec;
+         double ScaleX = fabs(Details.DeltaRa) * cos(RowDecDeg * DD2R) * DegToAsec;
+         double Weight = ScaleX * ScaleX;
+         const uint16_t* Dist = &ColDist[(size_t)(Iy - HaloIy0) * ONx];
+         int NParabolas = 0;
+         for (int Q = 0; Q < ONx; Q++) {
+            if (Dist[Q] == NoPixel) continue;
+            double DistY = double(Dist[Q]) * ScaleY;
+            ColDistSq[Q] = DistY * DistY;
+            double Start = 0.0;
+            while (NParabolas > 0) {
+               int P = Parabola[NParabolas - 1];
+               Start = ((ColDistSq[Q] + Weight * double(Q) * double(Q)) -
+                        (ColDistSq[P] + Weight * double(P) * double(P))) /
+                                                   (2.0 * Weight * double(Q - P));
+               if (Start > Boundary[NParabolas - 1]) break;
+               NParabolas--;
+            }
+            Parabola[NParabolas] = Q;
+            Boundary[NParabolas] = (NParabolas == 0) ? -HUGE_VAL : Start;
+            NParabolas++;
+         }
+         uint8_t* MapRow = ClearMap[Y];
+         if (NParabolas == 0) {
+            for (int X = 0; X < MNx; X++) MapRow[X] = ClearMapMaxSteps;
+         } else {
+            Boundary[NParabolas] = HUGE_VAL;
+            int IParabola = 0;
+            for (int X = XOffset; X < XOffset + MNx; X++) {
+               while (Boundary[IParabola + 1] < double(X)) IParabola++;
+               int P = Parabola[IParabola];
+               double DistSq = Weight * double(X - P) * double(X - P) +
+                                                                ColDistSq[P];
+               double Steps = sqrt(DistSq) / ClearMapStepAsec;
+               MapRow[X - XOffset] = (Steps >= ClearMapMaxSteps) ?
+                                         ClearMapMaxSteps : uint8_t(Steps);
+            }
+         }
+      }
+   }
+   
+   Details.ClearMap = ClearMap;
+   Details.ClearIx0 = Ix0;
+   Details.ClearIy0 = Iy0;
+   Details.ClearNx = MNx;
+   Details.ClearNy = MNy;
+   
+   return true;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                        G e t  C l e a r  R a d i u s
+//
+//  Returns the radius, in arcsec, around the specified sky position that is
+//  clear of any non-zero mask pixels. This is the distance from the centre of the
+//  mask pixel containing the position to the centre of the nearest non-zero
+//  pixel, rounded down to a multiple of 0.1 arcsec, and if that's more than
+//  MaxClearRadius() then MaxClearRadius() is returned. Where more than one mask
+//  covers the position, the largest clear radius is used, just as any mask
+//  showing clear is enough for CheckUseForSky(). BuildClearanceMaps() must have
+//  been called first. As with CheckUseForSky(), the function value indicates
+//  success or failure, not whether the position is clear.
+
+bool ProfitSkyCheck::GetClearRadius (double RaDeg, double DecDeg, double* ClearAsec)
+{
+   bool ReturnOK = false;
+   
+   *ClearAsec = 0.0;
    
    if (!I_Initialised) {
       I_ErrorText = "The ProfitSkyCheck object has not been initialised properly.";
+   } else if (!I_ClearMapsBuilt) {
+      I_ErrorText = "No clearance maps have been built for the field.";
    } else {
    
       //  Keep an eye on the coordinate range we're being asked to handle, for
@@ -1345,206 +3962,328 @@ bool ProfitSkyCheck::CheckUseForSky (
       I_Debug.Log ("SkyCheckCoords",
                        "Checking coordinates " + FormatRaDecDeg(RaDeg,DecDeg));
       
-      int FileCount = 0;
-      int ClearCount = 0;
-      
-      //  Now, this is what all the hard work has been for. We should have a list
-      //  of structures, each of which describes one mask file that overlaps at
-      //  least part of the field in question. At least one of these should overlap
-      //  this particular position. We try to find it in each file and see if
-      //  the position is clear. If any file indicates that it is obscured, we
-      //  assume it is not clear. (We'd expect files to agree, if they overlap,
-      //  but the images are not identical in their overlap regions. See programming
-      //  notes.)
-      
+      bool Covered = false;
       ReturnOK = true;
       for (struct ProfitFileDetails& Details : I_FileDetails) {
-         bool Contaminated = false;
-
-         //  This code does rather assume that the first axis (the X-axis) of the
-         //  data is Ra and the second (the Y-axis) is Dec. If anyone switches
-         //  this around in the Profit files, some recoding will be needed.
-         
-         int Nx = Details.Nx;
-         int Ny = Details.Ny;
+         if (Details.ClearMap == NULL) continue;
          
-         //  Find the pixel containing the point of interest. If we have an error,
-         //  we bail out. LocatePixFromCoords() returns false for both an error
-         //  from WCS and for a point outside the mask. Just being outside isn't
-         //  an error from our point of view here, so we have to check just what
-         //  it's complaining about.
+         //  Find the pixel containing the point, treating a position outside
+         //  the mask just as CheckUseForSky() does.
          
          int PIx = 0, PIy = 0;
          bool Outside= false;
          if (!LocatePixFromCoords (Details,RaDeg,DecDeg,&PIx,&PIy,&Outside)) {
             if (Outside) {
                I_Debug.Log ("SkyCheckFiles","Not covered by " + Details.Path);
-               continue;  // Not covered by this mask. Try the next.
+               continue;
             }
             I_Debug.Log ("SkyCheckFiles","WCS error from " + Details.Path);
             ReturnOK = false;
-            break;                  // Error from WCS - treat as a real error.
+            break;
          }
-         I_Debug.Log ("SkyCheckFiles",
-                             "Checking against data in file " + Details.Path);
-         
-         I_Debug.Logf ("SkyCheck","Start pixel [%d,%d], coords %s",PIx,PIy,
-                                        FormatRaDecDeg(RaDeg,DecDeg).c_str());
-         
-         //  We want to know the local pixel to degree scale in both Ra,Dec,
-         //  which we get from looking at the range covered by this central
-         //  pixel. We want to look at all the pixels in a circle of the
-         //  specified radius around the central one. First we work out the
-         //  rectangle that encloses that circle. All the pixels we need to
-         //  look at will be within that rectangle, whose pixel coordinates
-         //  go from Ixst,Iyst to Ixen,Iyen. Note that here, the bottom left
-         //  pixel in the image is [1,1], with a centre at [1.0,1.0].
-         
-         double FIx = double(PIx);
-         double FIy = double(PIy);
-         double CentreRaDeg,CentreDecDeg,DeltaRaAsec,DeltaDecAsec;
-         if (!GetPixelDims (&Details.Wcs,FIx,FIy,&CentreRaDeg,
-                                 &CentreDecDeg,&DeltaRaAsec,&DeltaDecAsec)) {
-            break;  // Error from WCS.
+         int X = PIx - Details.ClearIx0;
+         int Y = PIy - Details.ClearIy0;
+         if (X < 0 || X >= Details.ClearNx || Y < 0 || Y >= Details.ClearNy) {
+            I_Debug.Log ("SkyCheckFiles","Outside clearance map for " +
+                                                                Details.Path);
+            continue;
          }
-         double DeltaRaDeg = DeltaRaAsec / DegToAsec;
-         double DeltaDecDeg = DeltaDecAsec / DegToAsec;
-         
-         I_Debug.Logf ("SkyCheck","Radius = %f asec",RadiusDeg * DegToAsec);
-         I_Debug.Log  ("SkyCheck","Deltas = " +
-                                    FormatRaDecDeg(DeltaRaDeg,DeltaDecDeg));
-         I_Debug.Logf ("SkyCheck","Deltas = [%f,%f] pix",
-               fabs(RadiusDeg / DeltaRaDeg),fabs(RadiusDeg / DeltaDecDeg));
-         
-         int Ixst = int(FIx - 0.5 - fabs(RadiusDeg / DeltaRaDeg));
-         int Ixen = int(FIx + 0.5 + fabs(RadiusDeg / DeltaRaDeg));
-         int Iyst = int(FIy - 0.5 - fabs(RadiusDeg / DeltaDecDeg));
-         int Iyen = int(FIy + 0.5 + fabs(RadiusDeg / DeltaDecDeg));
-         
-         I_Debug.Logf ("SkyCheck",
-                          "Range %d to %d, %d to %d",Ixst,Ixen,Iyst,Iyen);
-         
-         //  Keep the Ra,Dec ranges within the bounds of the image.
-         
-         if (Ixen > Nx) Ixen = Nx;
-         if (Iyen > Ny) Iyen = Ny;
-         if (Ixst < 1) Ixst = 1;
-         if (Iyst < 1) Iyst = 1;
-         
-         I_Debug.Logf ("SkyCheck","Mod Range %d to %d, %d to %d",
-                                                       Ixst,Ixen,Iyst,Iyen);
-         
-         //  Now run through all the pixels in the rectangle. For each, calculate
-         //  the minimum distance from the centre of the test circle (RaDeg,DecDeg)
-         //  to the rectangle formed by the pixel. We assume that in the are of
-         //  interest the Ra/Dec to pixel scale is constant and given by DeltaRa,
-         //  DeltaDec. We compare this minimum distance with the radius of the test
-         //  circle (RadiusDeg).
-         
-         Checked = true;
-         FileCount++;
-         for (int Ix = Ixst; Ix <= Ixen; Ix++) {
-            for (int Iy = Iyst; Iy <= Iyen; Iy++) {
-               
-               //  This gives the centre of the pixel in question and the local
-               //  delta Ra,Dec values on the basis of the WCS coordinates in
-               //  the file. This will be more accurate (but hardly significantly
-               //  so) and much slower than the simple extrapolation actually used.
-               //  But it may be useful for diagnostic purposes, or to provide
-               //  a double check on things, so it stays in for now, commented out.
-               
-               //double WRa,WDec,DRa,DDec;
-               //GetPixelDims (&Details.Wcs,Ix,Iy,&WRa,&WDec,&DRa,&DDec);
+         double Clear = double(Details.ClearMap[Y][X]) * ClearMapStepAsec;
+         I_Debug.Logf ("ClearMap","Pixel [%d,%d] in %s, clear radius %.1f asec",
+                                         PIx,PIy,Details.Path.c_str(),Clear);
+         if (!Covered || Clear > *ClearAsec) *ClearAsec = Clear;
+         Covered = true;
+      }
+      
+      if (ReturnOK && !Covered) {
+         I_ErrorText = "No clearance map covers the coordinates " +
+                                 FormatRaDecDeg(RaDeg,DecDeg) + ".";
+         ReturnOK = false;
+      }
+   }
+   
+   return ReturnOK;
+}
 
-               //  Ra,Dec of the centre of the pixel in question, on the basis
-               //  of the distance of the point from the centre of the test
-               //  circle (whose pixel coordinates are [FIx,FIy] and whose
-               //  Ra,Dec coords are [CentreRaDeg,CentreDecDeg].
-               
-               double Ra = (double(Ix) - FIx) * DeltaRaDeg + CentreRaDeg;
-               double Dec = (double(Iy) - FIy) * DeltaDecDeg + CentreDecDeg;
-               
-               //  We assume the size of the pixel we're testing is DeltaRaDeg
-               //  by DeltaDecDeg. The question is now one of calculating the
-               //  minimum distance from a point to an axis aligned rectangle
-               //  of given width. (The code here is based on that given in
-               //  https://gamedev.stackexchange.com/questions/44483/how-do-i-
-               //  calculate-distance-between-a-point-and-an-axis-aligned-rectangle
-               //  from Sam Hocevar and isn't quite the fastest possible, but it's
-               //  neat. If both of the DistRa or DistDec values are < 0.0, then
-               //  the point is within the rectangle.)
-               
-               double DistSq = 0.0;
-               double DistRa = fabs(RaDeg - Ra) - fabs(DeltaRaDeg) * 0.5;
-               double DistDec = fabs(DecDeg - Dec) - fabs(DeltaDecDeg) * 0.5;
-               if ((DistRa > 0.0) || (DistDec > 0.0)) {
-                  DistSq = DistRa * DistRa + DistDec * DistDec;
-               }
-               bool CheckPixel = (DistSq <= (RadiusDeg * RadiusDeg));
-               
-               I_Debug.Logf("SkyCheckDist",
-                  "Pixel[%d,%d] = %d, Ra,Dec dist = %f,%f will %s",
-                  Ix,Iy,Details.DataArray[Iy - 1][Ix - 1],
-                  DistRa * DegToAsec, DistDec * DegToAsec,
-                  CheckPixel ? "check" : "ignore");
-               
-               if (CheckPixel) {
-                  if (Details.DataArray[Iy - 1][Ix - 1] > 0.0) {
-                  
-                     //  We've found one contaminated pixel, and that's all
-                     //  we need. We have to break out of both the X & Y loops.
-                     
-                     I_Debug.Logf ("SkyCheck",
-                         "Test pixel [%d,%d], is non-zero (%d)",
-                                  Ix,Iy,Details.DataArray[Iy - 1][Ix - 1]);
-                     Contaminated = true;
-                     break;
-                  }
-               }
-            }
-            if (Contaminated) break;
+// ----------------------------------------------------------------------------------
+//
+//                       M a x  C l e a r  R a d i u s
+//
+//  Returns the largest clear radius, in arcsec, that the clearance maps can
+//  distinguish. Any position with at least this radius clear around it is
+//  reported by GetClearRadius() as having this clear radius.
+
+double ProfitSkyCheck::MaxClearRadius (void)
+{
+   return ClearMapStepAsec * ClearMapMaxSteps;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                    G e t  R a d i u s  I n  P i x e l s
+//
+//  Works out the number of pixels, KX in the first (Ra) axis and KY in the
+//  second (Dec) axis, that a given radius on the sky might cover in a mask file.
+//  The size of a pixel in Ra gets smaller as Dec gets further from zero, so
+//  this uses the smallest size anywhere in the mask. If the pixel sizes make no
+//  sense, this returns false with an error description in I_ErrorText.
+
+bool ProfitSkyCheck::GetRadiusInPixels (const ProfitFileDetails& Details,
+                                      double RadiusAsec, int* KX, int* KY)
+{
+   double ScaleY = fabs(Details.DeltaDec) * DegToAsec;
+   double EdgeDecDeg = fabs(Details.MidDec) +
+                              fabs(Details.DeltaDec) * double(Details.Ny) * 0.5;
+   if (EdgeDecDeg > 89.0) EdgeDecDeg = 89.0;
+   double MinScaleX = fabs(Details.DeltaRa) * cos(EdgeDecDeg * DD2R) * DegToAsec;
+   if (ScaleY <= 0.0 || MinScaleX <= 0.0) {
+      I_ErrorText = "Invalid pixel scale for mask file " + Details.Path;
+      return false;
+   }
+   *KX = int(RadiusAsec / MinScaleX) + 1;
+   *KY = int(RadiusAsec / ScaleY) + 1;
+   return true;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                    G e t  F i e l d  P i x e l  R a n g e
+//
+//  Works out the range of pixels in a mask file that covers the field. This
+//  converts the corners and the centres of the edges of the Ra,Dec rectangle
+//  that encloses the field to pixel coordinates, and allows a margin
+//  (generously) for the non-linearity of the mask coordinates between those
+//  points. If WCS has problems with any of them (a field at the pole, perhaps)
+//  this just returns the whole mask. The range is clipped to the mask, so if
+//  the field doesn't overlap the mask at all, Ix0 will be greater than Ix1 or
+//  Iy0 greater than Iy1.
+
+void ProfitSkyCheck::GetFieldPixelRange (ProfitFileDetails& Details,
+                                  int* Ix0, int* Ix1, int* Iy0, int* Iy1)
+{
+   int Nx = Details.Nx;
+   int Ny = Details.Ny;
+   
+   *Ix0 = 1;
+   *Ix1 = Nx;
+   *Iy0 = 1;
+   *Iy1 = Ny;
+   double FieldEdgeDec = fabs(I_CentralDecDeg) + I_FieldRadiusDeg;
+   if (FieldEdgeDec < 89.0) {
+      double RaHalfRange = I_FieldRadiusDeg / cos(FieldEdgeDec * DD2R);
+      double World[8 * 2], Imgcrd[8 * 2], Pixcrd[8 * 2], Phi[8], Theta[8];
+      int Stat[8];
+      int NPoints = 0;
+      for (int IRa = -1; IRa <= 1; IRa++) {
+         for (int IDec = -1; IDec <= 1; IDec++) {
+            if (IRa == 0 && IDec == 0) continue;
+            World[NPoints * 2] = I_CentralRaDeg + IRa * RaHalfRange;
+            World[NPoints * 2 + 1] = I_CentralDecDeg + IDec * I_FieldRadiusDeg;
+            NPoints++;
          }
-         
-         //  At this point, we've gone through the pixels in this Profit
-         //  file. If Contaminated is set, then this file shows contamination
-         //  in at least one pixel within the test radius. However, if
-         //  Contaminated is clear, then at least this one file shows no
-         //  contamination, and we take that as an OK to use this position.
-         
-         if (!Contaminated) {
-            I_Debug.Logf ("SkyCheck","Checked all pixels in range. All clear.");
-            *Clear = true;
-            ClearCount++;
-            
-            //  We don't need to check the rest of the Profit files now, since
-            //  we've found one clear, and it may be a useful disgnostic if
-            //  we actually look at all the rest of the files.
-            
-            if (!I_Debug.Active("SkyCheckFiles")) break;
+      }
+      int Status = wcss2p(&Details.Wcs,NPoints,2,World,Phi,Theta,
+                                                     Imgcrd,Pixcrd,Stat);
+      if (Status == 0) {
+         double XMin = Pixcrd[0], XMax = Pixcrd[0];
+         double YMin = Pixcrd[1], YMax = Pixcrd[1];
+         for (int IPoint = 1; IPoint < NPoints; IPoint++) {
+            XMin = std::min(XMin,Pixcrd[IPoint * 2]);
+            XMax = std::max(XMax,Pixcrd[IPoint * 2]);
+            YMin = std::min(YMin,Pixcrd[IPoint * 2 + 1]);
+            YMax = std::max(YMax,Pixcrd[IPoint * 2 + 1]);
          }
+         int MarginX = Nx / 100 + 1;
+         int MarginY = Ny / 100 + 1;
+         *Ix0 = std::max(1.0,floor(XMin) - MarginX);
+         *Ix1 = std::min(double(Nx),ceil(XMax) + MarginX);
+         *Iy0 = std::max(1.0,floor(YMin) - MarginY);
+         *Iy1 = std::min(double(Ny),ceil(YMax) + MarginY);
       }
+   }
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                       B u i l d  C o u n t  T a b l e s
+//
+//  Builds, for the part of each mask file that covers the field, a summed-area
+//  table giving the number of non-zero pixels in the rectangle from the corner
+//  of that area to each pixel. Once this has been called, CheckUseForSky() can
+//  tell that the rectangle enclosing the test circle is clear from just four
+//  values in the table, and only needs to look at the individual pixels when
+//  it isn't. This needs Initialise() to have been called first. The tables
+//  need four bytes for each pixel in the field area - see programming notes.
+
+bool ProfitSkyCheck::BuildCountTables (void)
+{
+   bool ReturnOK = false;
+   
+   if (!I_Initialised) {
+      I_ErrorText = "The ProfitSkyCheck object has not been initialised properly.";
+   } else {
       
-      if (I_Debug.Active("SkyCheckFiles")) {
-         I_Debug.Logf ("SkyCheckFiles",
-            "Profit files checked %d, files clear %d",FileCount,ClearCount);
-         if (ClearCount != 0 && ClearCount != FileCount) {
-            I_Debug.Log("SkyCheckFiles","Note: Profit files disagree.");
+      //  All the data in the field area is needed, so read any that hasn't
+      //  been read yet for all the masks at once.
+      
+      ReturnOK = LoadFieldAreas(false);
+      for (struct ProfitFileDetails& Details : I_FileDetails) {
+         if (ReturnOK && !BuildCountTable(Details)) {
+            ReturnOK = false;
+            break;
          }
       }
+   }
+   return ReturnOK;
+}
 
-      //  We've now gone through all the mask files with any overlap with the
-      //  field. At least one of them should have had data for this point. If
-      //  none did, the point is probably outside the specified field - maybe
-      //  we should have checked that, but this is a more direct test.
-      
-      if (!Checked) {
-         I_ErrorText = "No mask found that covers the coordinates " +
-                                 FormatRaDecDeg(RaDeg,DecDeg) + ".";
-         ReturnOK = false;
+// ----------------------------------------------------------------------------------
+//
+//                        B u i l d  C o u n t  T a b l e
+//
+//  Builds the summed-area table for a single mask file, setting the CountTable
+//  details in the structure describing the file. CountTable[Y][X] is the number
+//  of non-zero pixels with Ix from CountIx0 to CountIx0 + X - 1 and Iy from
+//  CountIy0 to CountIy0 + Y - 1, so row 0 and column 0 are all zero, which saves
+//  having to treat the edges of the table as special cases. If the field
+//  doesn't overlap the mask at all, no table is needed and CountTable is left
+//  NULL.
+
+bool ProfitSkyCheck::BuildCountTable (ProfitFileDetails& Details)
+{
+   Details.CountTable = NULL;
+   Details.CountNx = 0;
+   Details.CountNy = 0;
+   
+   //  The table needs all the mask data for the area that covers the field.
+   
+   if (!LoadMaskData (Details,Details.AreaIx0,Details.AreaIx0 + Details.AreaNx - 1,
+                 Details.AreaIy0,Details.AreaIy0 + Details.AreaNy - 1)) return false;
+   
+   int Ix0,Ix1,Iy0,Iy1;
+   GetFieldPixelRange (Details,&Ix0,&Ix1,&Iy0,&Iy1);
+   Ix0 = std::max(Ix0,Details.MaskIx0);
+   Ix1 = std::min(Ix1,Details.MaskIx0 + Details.MaskNx - 1);
+   Iy0 = std::max(Iy0,Details.MaskIy0);
+   Iy1 = std::min(Iy1,Details.MaskIy0 + Details.MaskNy - 1);
+   if (Ix0 > Ix1 || Iy0 > Iy1) {
+      I_Debug.Log ("CountTable","Field does not overlap " + Details.Path);
+      return true;
+   }
+   int TNx = Ix1 - Ix0 + 1;
+   int TNy = Iy1 - Iy0 + 1;
+   I_Debug.Logf ("CountTable","Table for %s covers [%d to %d, %d to %d]",
+                                  Details.Path.c_str(),Ix0,Ix1,Iy0,Iy1);
+   uint32_t** CountTable = (uint32_t**)
+               I_ArrayManager.Malloc2D(sizeof(uint32_t),TNy + 1,TNx + 1);
+   if (CountTable == NULL) {
+      I_ErrorText = "Unable to allocate memory for count table for " +
+                                                                 Details.Path;
+      return false;
+   }
+   
+   //  Each entry is the one above it plus the number of non-zero pixels to its
+   //  left in the same row. Pulling the bits out of the mask a word at a time
+   //  keeps this reasonably quick.
+   
+   for (int X = 0; X <= TNx; X++) CountTable[0][X] = 0;
+   for (int Y = 1; Y <= TNy; Y++) {
+      const uint64_t* MaskRow = Details.MaskBits[Iy0 + Y - 1 - Details.MaskIy0];
+      const uint32_t* Above = CountTable[Y - 1];
+      uint32_t* Counts = CountTable[Y];
+      uint32_t RowCount = 0;
+      Counts[0] = 0;
+      int Bit = Ix0 - Details.MaskIx0;
+      uint64_t Word = MaskRow[Bit / BitsPerWord] >> (Bit % BitsPerWord);
+      for (int X = 1; X <= TNx; X++) {
+         RowCount += uint32_t(Word & 1);
+         Counts[X] = Above[X] + RowCount;
+         Bit++;
+         if (Bit % BitsPerWord == 0) {
+            if (X < TNx) Word = MaskRow[Bit / BitsPerWord];
+         } else {
+            Word >>= 1;
+         }
       }
    }
    
-   return ReturnOK;
+   Details.CountTable = CountTable;
+   Details.CountIx0 = Ix0;
+   Details.CountIy0 = Iy0;
+   Details.CountNx = TNx;
+   Details.CountNy = TNy;
+   
+   return true;
+}
+
+// ----------------------------------------------------------------------------------
+//
+//                          C o u n t  I n  R e c t
+//
+//  Returns the number of non-zero pixels in the rectangle of a mask with Ix from
+//  Ixst to Ixen and Iy from Iyst to Iyen, using the summed-area table built by
+//  BuildCountTable(). If there is no table, or the rectangle isn't entirely
+//  within it, this returns -1, and the pixels have to be checked individually.
+
+long ProfitSkyCheck::CountInRect (const ProfitFileDetails& Details,
+                                        int Ixst, int Ixen, int Iyst, int Iyen)
+{
+   if (Details.CountTable == NULL) return -1;
+   int X0 = Ixst - Details.CountIx0;
+   int X1 = Ixen - Details.CountIx0 + 1;
+   int Y0 = Iyst - Details.CountIy0;
+   int Y1 = Iyen - Details.CountIy0 + 1;
+   if (X0 < 0 || Y0 < 0 || X1 > Details.CountNx || Y1 > Details.CountNy) {
+      return -1;
+   }
+   const uint32_t* const* Table = Details.CountTable;
+   return long(Table[Y1][X1]) - long(Table[Y0][X1]) -
+                                    long(Table[Y1][X0]) + long(Table[Y0][X0]);
+}
+
+// ----------------------------------------------------------------------------------
+
+//                        M a s k  P i x e l  S e t
+//
+//  Returns true if the specified pixel in a mask is set - ie was non-zero in
+//  the mask file. Ix,Iy are pixel coordinates, with the bottom left pixel [1,1],
+//  and must be within the part of the mask held in MaskBits.
+
+bool ProfitSkyCheck::MaskPixelSet (
+                       const ProfitFileDetails& Details, int Ix, int Iy)
+{
+   int Bit = Ix - Details.MaskIx0;
+   return (Details.MaskBits[Iy - Details.MaskIy0][Bit / BitsPerWord] >>
+                                                  (Bit % BitsPerWord)) & 1;
+}
+
+// ----------------------------------------------------------------------------------
+
+//                        M a s k  R a n g e  S e t
+//
+//  Returns true if any of the pixels from FirstIx to LastIx inclusive in row Iy
+//  of a mask is set - ie was non-zero in the mask file. Pixel coordinates are as
+//  for MaskPixelSet(), and FirstIx must not be greater than LastIx. This tests
+//  the bits a whole word at a time, masking off any bits outside the range in
+//  the first and last words.
+
+bool ProfitSkyCheck::MaskRangeSet (
+         const ProfitFileDetails& Details, int Iy, int FirstIx, int LastIx)
+{
+   const uint64_t* Row = Details.MaskBits[Iy - Details.MaskIy0];
+   int FirstBit = FirstIx - Details.MaskIx0;
+   int LastBit = LastIx - Details.MaskIx0;
+   int FirstWord = FirstBit / BitsPerWord;
+   int LastWord = LastBit / BitsPerWord;
+   uint64_t FirstMask = ~uint64_t(0) << (FirstBit % BitsPerWord);
+   uint64_t LastMask =
+                 ~uint64_t(0) >> (BitsPerWord - 1 - LastBit % BitsPerWord);
+   if (FirstWord == LastWord) return (Row[FirstWord] & FirstMask & LastMask);
+   if (Row[FirstWord] & FirstMask) return true;
+   for (int Word = FirstWord + 1; Word < LastWord; Word++) {
+      if (Row[Word]) return true;
+   }
+   return (Row[LastWord] & LastMask);
 }
 
 // ----------------------------------------------------------------------------------
@@ -1697,6 +4436,14 @@ int main(int argc, char* argv[])
          if (Clear) printf ("Clear\n");
          else printf("Obscured\n");
       }
+      double ClearAsec = 0.0;
+      Status = TheChecker.BuildClearanceMaps() &&
+                TheChecker.GetClearRadius(atof(argv[5]),atof(argv[6]),&ClearAsec);
+      if (!Status) {
+         printf ("Error: %s\n",TheChecker.GetError().c_str());
+      } else {
+         printf ("Clear radius %.1f arcsec\n",ClearAsec);
+      }
    }
    return 0;
 }
@@ -1749,9 +4496,148 @@ int main(int argc, char* argv[])
       case you'd probably want to take the worst case.) I doubt if this makes a lot
       of difference in practice.
  
-   o  This assumes the main data array in the ProFit files is integer. It may
-      be that the code should check BITPIX and use whatever format is being used
-      to avoid unnecessary conversion.
+   o  The mask data is held as one bit per pixel, bit 0 of word 0 of each row
+      being the pixel with Ix = MaskIx0. The last word of a row may have unused bits,
+      and these are always clear. The data is still read as int, which cfitsio
+      converts to if BITPIX says otherwise.
+ 
+   o  The distance test in CheckUseForSky() has a quirk: if the test position
+      is outside a pixel's Dec range, DistRa is squared and included in the
+      distance even when the position is inside the pixel's Ra range, where
+      DistRa is negative. So in a row near the edge of the test circle, the
+      pixels closest in Ra to the test position can be left out while those a
+      little further away are checked. That's why the pixels to be checked in
+      a row can form two runs rather than one. It makes very little practical
+      difference, and the row-based test keeps it so as to give exactly the
+      same results as the original pixel by pixel test.
+ 
+   o  The clearance maps built by BuildClearanceMaps() use the separable exact
+      Euclidean distance transform described by Felzenszwalb and Huttenlocher
+      ("Distance Transforms of Sampled Functions", 2012). The first pass finds
+      the distance to the nearest non-zero pixel in each column, the second
+      combines these along each row, and both take time proportional to the
+      number of pixels, whatever the radius. The pixel sizes used are the true
+      sizes on the sky, so the Ra size allows for cos(Dec) for each row, and
+      the distances are centre to centre. This is not quite the same test as
+      CheckUseForSky(), which measures to the nearest edge of a non-zero pixel
+      and doesn't allow for cos(Dec), so for positions right on the boundary the
+      two can differ by up to about a pixel. Areas beyond the edge of a mask are
+      taken as clear, just as CheckUseForSky() ignores them.
+ 
+   o  Only the part of each mask that covers the field, as worked out by
+      GetFieldPixelRange(), with a margin of the number of pixels covered by
+      MaxClearRadius(), is ever read. That allows for any sky position in
+      the field being checked with any radius up to that. (HectorConfigUtil
+      limits the clearance to 10 arcsec.) A position outside that part of the
+      mask is treated as if it were outside the mask altogether. AddFileDetails()
+      works out that area when Initialise() looks at the file header.
+ 
+   o  Initialise() doesn't read any mask data at all. LoadMaskData() reads it
+      when CheckUseForSky() first needs it, and then only the blocks of
+      LoadBlockSize pixels that cover the rectangle around the position being
+      checked. Later checks that need more of the mask read just the blocks
+      that are missing, and the MaskBits array grows (always as a rectangle)
+      to hold them. A mask that overlaps the field but has no sky positions in
+      it is never read at all, and one where only a corner is used only has
+      that corner read. For a tile-compressed file, cfitsio only decompresses
+      the tiles that overlap the blocks being read - which is why the block size
+      matches the ProfitMaskConvert tile size - and that's where the time goes.
+      For a gzipped file, cfitsio has to decompress the whole file to read any of
+      it, so the whole of the area covering the field is read the first time,
+      and the file is never opened again. BuildClearanceMaps() and
+      BuildCountTables() need all of the area covering the field, so these read
+      it all anyway. The results are the same as reading it all at the start.
+ 
+   o  The mask cache files hold the data for the whole of a mask, not just
+      the area covering the field, so that the same cache file can be used
+      whatever the field. They use one bit per pixel, so for a typical large
+      mask they're a lot smaller than the uncompressed FITS file, if larger
+      than the gzipped one. They are mapped read-only into memory using
+      mmap(), so the data is only read from disk as it's used, and any number
+      of processes using the same cache file share one copy of it in the
+      system's page cache - useful when a pipeline is configuring many tiles
+      in the same area of sky. The cache file also holds the header keywords
+      of the mask file, so a mask file with an up to date cache file is never
+      opened at all, which matters for a gzipped file, as cfitsio has to
+      decompress the whole thing just to read the header. A cache file is
+      taken as up to date if the size, modification time, and a checksum of
+      the start and end of the mask file match those recorded when it was
+      written. If anything goes wrong with the cache, this just carries on
+      reading the mask file as usual, with a warning.
+ 
+   o  The footprint index is an optional text file in the mask file directory,
+      written by UpdateMaskIndex() - usually run using ProfitMaskIndex - that
+      lists, for each mask file, its footprint on the sky (the Ra,Dec of its
+      corners and of the centres of its edges), its image details and all its
+      header keywords. With an index, Initialise() doesn't need to open any
+      mask file just to find out where it is, so the file names no longer need
+      to have the mask ranges encoded in them - a file in the index is never
+      renamed - and a mask that overlaps the field is set up from the header
+      keywords in the index without opening it. When the index is read, the
+      entries are sorted into Dec bands, IndexBandDeg wide, so finding the
+      masks that overlap the field only means looking at those in the few
+      bands the field covers. (A HEALPix scheme or an R-tree would do the same
+      job, but with at most a few thousand masks the bands are quite enough.)
+      The directory is still listed, so a file that isn't in the index is
+      handled as it always was, and a file whose size or modification time
+      doesn't match its index entry is treated as not being in the index, with
+      a warning. The checksum in the index is only used by UpdateMaskIndex(),
+      to avoid re-reading a file that has just been touched or copied.
+ 
+   o  Reading a gzipped mask file is slow, and almost all the time goes into
+      decompressing it, which cfitsio does for the whole file as soon as it's
+      opened - even just to read the header. So where several files need to
+      be read, they are read at once, each in its own thread, up to the number
+      set by SetThreads() (by default, one per processor core). Only the
+      opening and reading of the files is done in the threads - in
+      PrereadHeaders() and LoadFieldAreas() - and the threads share nothing but
+      an atomic counter used to hand out the files. Everything else, including
+      all use of wcslib (wcspih() is not reentrant), all use of the
+      ArrayManager (which isn't thread-safe), writing cache files, and
+      reporting warnings and errors, is done in the calling thread in the
+      same order as before, so the results and any messages don't depend on
+      the number of threads. This needs cfitsio to have been built with
+      --enable-reentrant, which the Makefile now does. If it wasn't,
+      fits_is_reentrant() returns false and everything is done in one thread.
+ 
+   o  CheckPositionsForSky() is for a caller with a lot of positions to check
+      at once - typically several candidate positions for each sky fibre. It
+      does the same work for each position as CheckUseForSky(), and gives the
+      same results, but in three passes over all the positions rather than
+      one position at a time. The first works out where each position falls
+      in each mask (GetSkyCheckRect()), which only needs the WCS details. The
+      second reads all the mask data those positions need, several masks at
+      once, using LoadMaskAreas() - so nothing is read while positions are
+      being checked, and a gzipped mask is only ever decompressed once. The
+      third checks the mask pixels round each position (MaskRectContaminated())
+      with the positions sorted by mask and by position in the mask, so
+      consecutive checks use neighbouring mask data. The first and third
+      passes are split between threads. This is safe because, once the wcsprm
+      structure for a mask has been set up, wcsp2s() only reads it - unless the
+      mask has distortions, when it uses a work array in the structure, so then
+      this uses just one thread - and the mask data is only read. Nothing
+      else is shared except the debug handler, and with any of the sky check
+      debug levels active the positions are just passed to CheckUseForSky()
+      one at a time, so the diagnostics come out as they always did.
+ 
+   o  Separate ProfitSkyCheck objects - one for each of a number of fields
+      being configured at once, say - can be used in separate threads. Apart
+      from wcspih(), the only things they share are the mask files and the
+      cache and index files. So G_InitMutex makes sure only one object at a
+      time is in Initialise() or UpdateMaskIndex(), which is where wcspih()
+      is called and mask files get renamed, and TempFileSuffix() makes sure
+      two objects writing the cache file for the same mask don't write to
+      the same temporary file - whichever is renamed last simply replaces the
+      other, which is identical. Everything else is per object.
+ 
+   o  The count tables built by BuildCountTables() hold a 32-bit count for each
+      pixel of the field area of each mask, so need 32 times the memory of the
+      mask bits for that area. That's why they're optional. They don't change
+      the results of CheckUseForSky() at all - a rectangle with no non-zero
+      pixels can't have any in the part of it that's checked - but they mean
+      that the time taken for a clear position no longer depends on the radius.
+      A position near the edge of the field, where the rectangle goes outside
+      the table, is just checked as usual.
  
    o  In testing, I hit an embarassing bug in the TCS routine that formats a
       value in degrees into degrees,arcminutes,arcsec and fractions of arcsec.
@@ -31,6 +31,56 @@
 //     'worst-case' result - ie false if any file shows that area to be
 //     contaminated.
 //
+//     Optionally, once the object has been initialised, BuildClearanceMaps()
+//     can be called to work out, for each pixel of the masks in the area of the
+//     field, the distance to the nearest non-zero pixel. GetClearRadius() can
+//     then be used to get the clear radius around any position in the field,
+//     rather than just a yes/no answer for a given radius, and this takes the
+//     same time whatever the radius.
+//
+//     BuildCountTables() can also be called once the object has been
+//     initialised, to build a summed-area table of the non-zero pixels in the
+//     area of the field. This doesn't change the results of CheckUseForSky(),
+//     but it does make it quicker, particularly for large radii.
+//
+//     Initialise() only reads the headers of the mask files. The mask data is
+//     read when a query first needs it, and then only the part of the mask
+//     around the position being queried, so a mask that overlaps the field
+//     but is never queried is never read.
+//
+//     If SetCacheDirectory() is called before Initialise(), the first time the
+//     data for a mask is needed it is all read and written, one bit per pixel,
+//     into a cache file in that directory, and from then on - in this run or
+//     any later one - the cache file is mapped into memory instead. Processes
+//     using the same cache file share the same copy of the data in memory.
+//
+//     UpdateMaskIndex() - usually run using the ProfitMaskIndex program - writes
+//     a footprint index for a mask file directory, giving where on the sky each
+//     mask is along with its header keywords. If there is an index, Initialise()
+//     uses it to find the masks that overlap the field, and doesn't need to open
+//     a mask file until its data is needed. The mask file names then don't need
+//     to give the area each mask covers.
+//
+//     Mask files are read several at once, each in its own thread, where that
+//     helps - the headers of the files Initialise() has to open, and the data
+//     read by PreloadMasks(), BuildClearanceMaps() and BuildCountTables().
+//     SetThreads() sets how many threads are used. The results are the same
+//     however many are used.
+//
+//     CheckPositionsForSky() checks a whole list of possible sky positions at
+//     once, rather than one at a time as CheckUseForSky() does. It reads the
+//     mask data needed for all of them first, then checks them in an order that
+//     keeps positions close together on the same mask together, using several
+//     threads. It gives each position the result CheckUseForSky() would give,
+//     so a caller with a list of candidate positions for each fibre can check
+//     them all and then pick the first clear one for each fibre.
+//
+//     The mask files can be plain FITS files, gzipped FITS files (.gz), or
+//     tile-compressed FITS files (.fz). For a tile-compressed file, only the
+//     tiles that cover the field need to be decompressed, and this is much
+//     faster than reading a whole gzipped file. ProfitMaskConvert will convert
+//     an existing mask file into a tile-compressed one.
+//
 //     Note that most routines return a boolean function value, which will be
 //     true if everything went OK. If there is a problem, this is returned set
 //     to false, and a description of the error can be obtained by calling
@@ -56,6 +106,38 @@
 //                    renamed so that they do. A number of new routines have
 //                    been added to support this, and any variables used to
 //                    assume a common range for all mask files have gone. KS.
+//     16th Oct 2026. The mask data is now held as one bit per pixel, in the
+//                    MaskBits array that replaces DataArray. Added MaskPixelSet()
+//                    and MaskRangeSet(). HOP.
+//     16th Oct 2026. Added BuildClearanceMaps(), GetClearRadius() and
+//                    MaxClearRadius(), and the ClearMap details in the
+//                    ProfitFileDetails structure. HOP.
+//     16th Oct 2026. Added BuildCountTables(), BuildCountTable(), CountInRect()
+//                    and GetFieldPixelRange(), and the CountTable details in
+//                    the ProfitFileDetails structure. HOP.
+//     16th Oct 2026. MaskBits now only holds the part of the mask that covers
+//                    the field, given by the new MaskIx0,MaskIy0,MaskNx,MaskNy
+//                    fields in ProfitFileDetails. Added GetRadiusInPixels(). HOP.
+//     16th Oct 2026. Mask data is now only read when a query needs it. Replaced
+//                    ReadFileData() with AddFileDetails(), LoadMaskData() and
+//                    ReadMaskRect(), and added the Area details and LoadWhole
+//                    to ProfitFileDetails. HOP.
+//     16th Oct 2026. Added SetCacheDirectory() and the mask cache routines, and
+//                    the Cache details in ProfitFileDetails. Split
+//                    GetDetailsFromHeader() out of GetFileDetails(). HOP.
+//     16th Oct 2026. Added UpdateMaskIndex() and the footprint index routines,
+//                    and the ProfitIndexEntry structure. HOP.
+//     16th Oct 2026. Initialise() now reads the headers of the mask files it
+//                    needs to open several at once, and PreloadMasks(),
+//                    BuildClearanceMaps() and BuildCountTables() read mask data
+//                    for several masks at once. Added SetThreads(), and the
+//                    ProfitMaskHeader structure. HOP.
+//     16th Oct 2026. Added CheckPositionsForSky(), the ProfitSkyPosn structure
+//                    and the ProfitSkyStatus values, and GetSkyCheckRect(),
+//                    MaskRectContaminated() and LoadMaskAreas(). LocatePixel()
+//                    and PixelDims() now do the work of LocatePixFromCoords()
+//                    and GetPixelDims(). HOP.
+//     16th Oct 2026. Added TempFileSuffix(). HOP.
 
 // ----------------------------------------------------------------------------------
 
@@ -64,7 +146,10 @@
 
 #include <string>
 #include <list>
+#include <map>
+#include <vector>
 #include <stdlib.h>
+#include <stdint.h>
 
 #include "fitsio.h"
 #include "wcslib.h"
@@ -83,7 +168,31 @@ struct ProfitFileDetails {
    std::string Path = "";        //  Full file path name.
    int Nx = 0;                   //  Number of pixels in the first (RA) axis
    int Ny = 0;                   //  Number of pixels in the second (Dec) axis
-   int** DataArray = NULL;       //  2D Array allocated for the mask data.
+   uint64_t** MaskBits = NULL;   //  2D Array of mask bits, 1 => pixel non-zero.
+   int WordsPerRow = 0;          //  Number of 64-bit words in each row of MaskBits.
+   int MaskIx0 = 0;              //  Pixel coordinates (from 1) of the first
+   int MaskIy0 = 0;              //  pixel in MaskBits.
+   int MaskNx = 0;               //  Number of pixels in each row of MaskBits.
+   int MaskNy = 0;               //  Number of rows in MaskBits.
+   int AreaIx0 = 0;              //  Pixel coordinates (from 1) of the first
+   int AreaIy0 = 0;              //  pixel of the area that covers the field.
+   int AreaNx = 0;               //  Number of pixels in each row of that area.
+   int AreaNy = 0;               //  Number of rows in that area.
+   bool LoadWhole = false;       //  Read all that area when any is needed.
+   bool CacheValid = false;      //  There is an up to date cache file.
+   bool CacheTried = false;      //  Use of the cache file has been tried.
+   void* CacheMap = NULL;        //  Address of the mapped cache file, if any.
+   size_t CacheMapSize = 0;      //  Size of the mapped cache file in bytes.
+   uint8_t** ClearMap = NULL;    //  Clear radius for pixels in the field area.
+   int ClearIx0 = 0;             //  Pixel coordinates (from 1) of the first
+   int ClearIy0 = 0;             //  pixel in ClearMap.
+   int ClearNx = 0;              //  Number of pixels in each row of ClearMap.
+   int ClearNy = 0;              //  Number of rows in ClearMap.
+   uint32_t** CountTable = NULL; //  Summed-area table of non-zero pixels.
+   int CountIx0 = 0;             //  Pixel coordinates (from 1) of the first
+   int CountIy0 = 0;             //  pixel counted in CountTable.
+   int CountNx = 0;              //  Number of pixels counted in each row.
+   int CountNy = 0;              //  Number of rows counted.
    double MidRa = 0.0;           //  RA of the centre of the mask (deg).
    double MidDec = 0.0;          //  Dec of the centre of the mask (deg).
    double DeltaRa = 0.0;         //  Average RA range covered by one pixel (deg).
@@ -91,6 +200,68 @@ struct ProfitFileDetails {
    wcsprm Wcs;                   //  The detailed WCS information for the file.
 };
 
+//  There is a structure of type ProfitIndexEntry for each mask file listed in the
+//  footprint index for the mask file directory. This holds everything needed to
+//  decide whether the mask overlaps the field and to set up its ProfitFileDetails
+//  without opening the file.
+
+struct ProfitIndexEntry {
+   static const int FootprintPoints = 8;
+   std::string Name = "";        //  File name, without the directory.
+   int64_t Size = 0;             //  File size in bytes.
+   int64_t ModTime = 0;          //  File modification time (secs since 1970).
+   uint64_t Checksum = 0;        //  Checksum of the file - see GetSourceKey().
+   int Bitpix = 0;               //  BITPIX for the mask image.
+   int Nx = 0;                   //  Number of pixels in the first (RA) axis
+   int Ny = 0;                   //  Number of pixels in the second (Dec) axis
+   double MidRa = 0.0;           //  RA of the centre of the mask (deg).
+   double MidDec = 0.0;          //  Dec of the centre of the mask (deg).
+   double Footprint[FootprintPoints * 2] = {}; // Ra,Dec round the edge (deg).
+   int NKeys = 0;                //  Number of header keywords.
+   std::string Header = "";      //  Header keywords, 80 characters each.
+   double RaHalfRange = 0.0;     //  Max Ra of footprint from MidRa (deg).
+   double DecMin = 0.0;          //  Min Dec of footprint (deg).
+   double DecMax = 0.0;          //  Max Dec of footprint (deg).
+};
+
+//  A structure of type ProfitMaskHeader holds what's needed from the header of a
+//  mask file to set up its ProfitFileDetails. Initialise() can read these for a
+//  number of files at once, in separate threads - see PrereadHeaders().
+
+struct ProfitMaskHeader {
+   int Nx = 0;                   //  Number of pixels in the first (RA) axis
+   int Ny = 0;                   //  Number of pixels in the second (Dec) axis
+   int NKeys = 0;                //  Number of header keywords.
+   std::string Keys = "";        //  Header keywords, 80 characters each.
+   bool FromCache = false;       //  Read from an up to date cache file.
+   std::string Error = "";       //  Description of any error reading them.
+};
+
+//  The result of checking a position for use as a sky position, as given by
+//  CheckPositionsForSky(). A position is unchecked if there was an error or no
+//  mask covers it.
+
+enum ProfitSkyStatus {SKY_UNCHECKED,SKY_CLEAR,SKY_OBSCURED};
+
+//  A structure of type ProfitSkyPosn describes one position to be checked by
+//  CheckPositionsForSky(), and holds the result of the check.
+
+struct ProfitSkyPosn {
+   double RaDeg = 0.0;           //  Ra of the position (deg).
+   double DecDeg = 0.0;          //  Dec of the position (deg).
+   double RadiusDeg = 0.0;       //  Radius that must be clear (deg).
+   ProfitSkyStatus Status = SKY_UNCHECKED; // Result of the check.
+   std::string Reason = "";      //  Why the position is unchecked, if it is.
+};
+
+//  Details of mask data to be read from a file - see ProfitSkyCheck.cpp.
+
+struct ProfitMaskLoad;
+
+//  Where a position to be checked falls in a mask - see ProfitSkyCheck.cpp.
+
+struct ProfitSkyRect;
+
 class ProfitSkyCheck {
 public:
    //  Constructor
@@ -102,6 +273,25 @@ public:
                                  double CentralDecDeg, double FieldRadiusDeg);
    //  Querry a potential sky position - Clear returns result of the querry.
    bool CheckUseForSky (double RaDeg, double DecDeg, double RadiusDeg, bool* Clear);
+   //  Check a list of potential sky positions, setting the Status of each.
+   bool CheckPositionsForSky (std::vector<ProfitSkyPosn>& Posns);
+   //  Work out the clear radius around each mask pixel in the field area.
+   bool BuildClearanceMaps (void);
+   //  Get the clear radius in arcsec around a sky position, once maps are built.
+   bool GetClearRadius (double RaDeg, double DecDeg, double* ClearAsec);
+   //  The largest clear radius GetClearRadius() can return, in arcsec.
+   static double MaxClearRadius (void);
+   //  Build summed-area tables to speed up CheckUseForSky().
+   bool BuildCountTables (void);
+   //  Use a directory for cache files of decompressed mask data.
+   void SetCacheDirectory (const std::string& CacheDirectory);
+   //  Set the number of threads used to read masks or check positions (0 => 1 per core).
+   void SetThreads (int Threads);
+   //  Read all the data for the masks that have to be read whole, at once.
+   bool PreloadMasks (void);
+   //  Create or update the footprint index for a mask file directory.
+   bool UpdateMaskIndex (const std::string& DirectoryPath,
+                                 int* NEntries, int* NChanged, int* NRemoved);
    //  Get description of latest error
    std::string GetError (void) { return I_ErrorText; }
    //  Control debugging.
@@ -127,9 +317,76 @@ private:
    //  Get the details of an open mask file - size, coordinates, range, etc.
    bool GetFileDetails (const std::string& MaskFile,
                           fitsfile* Fptr, ProfitFileDetails* FileDetails);
-   //  Read the data from an open file and add to list of mask data in use.
-   bool ReadFileData (const std::string& MaskFile,
-                          fitsfile* Fptr, ProfitFileDetails* FileDetails);
+   //  Read the dimensions and header keywords of an open mask file.
+   static bool ReadHeaderKeys (const std::string& MaskFile,
+                                  fitsfile* Fptr, ProfitMaskHeader* Header);
+   //  Read the dimensions and header keywords of a mask from its cache file.
+   static bool ReadCachedHeader (const std::string& MaskFile,
+                         const std::string& CacheFile, ProfitMaskHeader* Header);
+   //  Read the dimensions and header keywords of a mask, from cache if possible.
+   static bool ReadMaskHeader (const std::string& MaskFile,
+                         const std::string& CacheFile, ProfitMaskHeader* Header);
+   //  Read the headers for a list of mask files, several at once.
+   void PrereadHeaders (const std::vector<std::string>& MaskFiles);
+   //  Get the details of a mask file, using any header already read.
+   bool GetMaskDetails (const std::string& MaskFile,
+                                             ProfitFileDetails* FileDetails);
+   //  Work out how many threads to use for a number of jobs.
+   int ThreadsToUse (int Jobs, bool UsesFits);
+   //  Get the details of a mask file from its header keywords.
+   bool GetDetailsFromHeader (const std::string& MaskFile, char* HeaderPtr,
+                  int NKeys, int Nx, int Ny, ProfitFileDetails* FileDetails);
+   //  Get the details of a mask file from its cache file, if up to date.
+   bool GetCachedDetails (const std::string& MaskFile,
+                                             ProfitFileDetails* FileDetails);
+   //  Write the cache file for a mask file.
+   bool WriteMaskCache (const ProfitFileDetails& Details);
+   //  Map the cache file for a mask file into memory as its mask data.
+   bool MapMaskCache (ProfitFileDetails& Details);
+   //  Get the full path name of the cache file for a mask file.
+   std::string CacheFileName (const std::string& MaskFile);
+   //  Get a suffix that makes the name of a new file being written unique.
+   static std::string TempFileSuffix (void);
+   //  Get the size, modification time and checksum of a mask file.
+   static bool GetSourceKey (const std::string& MaskFile,
+                        int64_t* Size, int64_t* ModTime, uint64_t* Checksum);
+   //  Work out the footprint index entry for a mask file.
+   bool MakeIndexEntry (const std::string& MaskFile, ProfitIndexEntry* Entry);
+   //  Get the full path name of the footprint index.
+   std::string MaskIndexFileName (void);
+   //  Read the footprint index for the mask file directory, if there is one.
+   bool ReadMaskIndex (void);
+   //  Write the footprint index for the mask file directory.
+   bool WriteMaskIndex (void);
+   //  Sort the footprint index entries into bands of Dec.
+   void BuildIndexBands (void);
+   //  Find the footprint index entries for masks that may overlap the field.
+   void FindIndexedMasks (std::vector<bool>& Overlaps);
+   //  Add the details of a mask file in the footprint index to the list in use.
+   bool AddIndexedFile (const std::string& MaskFile, const ProfitIndexEntry& Entry);
+   //  See if the footprint index entry for a mask file is up to date.
+   bool IndexEntryCurrent (const std::string& MaskFile,
+                                                const ProfitIndexEntry& Entry);
+   //  Work out the area of a mask covering the field and add to list in use.
+   bool AddFileDetails (ProfitFileDetails* FileDetails);
+   //  Make sure the mask data for a rectangle of pixels has been read.
+   bool LoadMaskData (ProfitFileDetails& Details,
+                                     int Ix0, int Ix1, int Iy0, int Iy1);
+   //  Work out what needs to be read for LoadMaskData() and set up to read it.
+   void PrepareMaskLoad (ProfitFileDetails& Details,
+                  int Ix0, int Ix1, int Iy0, int Iy1, ProfitMaskLoad* Load);
+   //  Read the mask data set up by PrepareMaskLoad().
+   static void ReadMaskLoad (ProfitMaskLoad* Load);
+   //  Install the mask data read by ReadMaskLoad(), or report any error.
+   bool FinishMaskLoad (ProfitMaskLoad* Load);
+   //  Read the field area of all the masks, or those read whole, several at once.
+   bool LoadFieldAreas (bool WholeOnly);
+   //  Make sure the mask data for a rectangle of pixels in each mask is read.
+   bool LoadMaskAreas (const std::vector<std::vector<int> >& Areas,
+                                             std::vector<std::string>* Errors);
+   //  Read a rectangle of pixels from an open mask file into a bit array.
+   static void ReadMaskRect (fitsfile* Fptr, uint64_t** MaskBits, int BitsIx0,
+             int BitsIy0, int Ix0, int Ix1, int Iy0, int Iy1, int* Status);
    //  Check WCS range of a mask file and read its data if it overlaps field.
    bool CheckWCSandReadFile (
           const std::string& MaskFile, double FileRaDeg, double FileDecDeg,
@@ -142,6 +399,10 @@ private:
    //  Utility giving Ra,Dec coords and range for a single pixel.
    bool GetPixelDims (wcsprm* WcsPtr,double FIx,double FIy,double* CentreRaDeg,
                   double* CentreDecDeg, double* DeltaRaAsec,double* DeltaDecAsec);
+   //  Does the work of GetPixelDims(), returning any error in Error.
+   static bool PixelDims (wcsprm* WcsPtr,double FIx,double FIy,double* CentreRaDeg,
+                  double* CentreDecDeg, double* DeltaRaAsec,double* DeltaDecAsec,
+                                                             std::string* Error);
    //  Check for overlap between a mask file area and the field being configured.
    bool FileOverlapsField (
       double MaskCentreRa, double MaskCentreDec, double MaskRaRange,
@@ -150,14 +411,47 @@ private:
    //  Locate a pixel that contains the specified sky coordinates.
    bool LocatePixFromCoords (ProfitFileDetails& FileDetails,
                         double RaDeg,double DecDeg,int* Ix,int* Iy,bool* Outside);
+   //  Does the work of LocatePixFromCoords(), returning any error in Error.
+   static bool LocatePixel (ProfitFileDetails& FileDetails, double RaDeg,
+           double DecDeg, int* Ix, int* Iy, bool* Outside, std::string* Error);
+   //  Work out where a position falls in a mask and the pixels to check round it.
+   void GetSkyCheckRect (ProfitFileDetails& Details, double RaDeg,
+                       double DecDeg, double RadiusDeg, ProfitSkyRect* Rect);
+   //  See if any mask pixel within a radius of a position is set (non-zero).
+   bool MaskRectContaminated (const ProfitFileDetails& Details, double RaDeg,
+                 double DecDeg, double RadiusDeg, const ProfitSkyRect& Rect);
+   //  Work out the clear radius map for one mask file.
+   bool BuildClearanceMap (ProfitFileDetails& Details);
+   //  Build the summed-area table for one mask file.
+   bool BuildCountTable (ProfitFileDetails& Details);
+   //  Count the non-zero pixels in a rectangle using the summed-area table.
+   long CountInRect (const ProfitFileDetails& Details,
+                                        int Ixst, int Ixen, int Iyst, int Iyen);
+   //  Work out how many pixels a given radius might cover in a mask file.
+   bool GetRadiusInPixels (const ProfitFileDetails& Details,
+                                      double RadiusAsec, int* KX, int* KY);
+   //  Work out the range of pixels in a mask file that covers the field.
+   void GetFieldPixelRange (ProfitFileDetails& Details,
+                                     int* Ix0, int* Ix1, int* Iy0, int* Iy1);
    //  Format a pair of coordinates in degrees into a string.
-   std::string FormatRaDecDeg (double RaDeg, double DecDeg);
+   static std::string FormatRaDecDeg (double RaDeg, double DecDeg);
+   //  See if a single pixel of a mask is set (non-zero).
+   static bool MaskPixelSet (const ProfitFileDetails& Details, int Ix, int Iy);
+   //  See if any pixel in a range of one row of a mask is set (non-zero).
+   static bool MaskRangeSet (const ProfitFileDetails& Details,
+                                           int Iy, int FirstIx, int LastIx);
    //  Initialisation flag
    bool I_Initialised;
+   //  Set once BuildClearanceMaps() has been called successfully.
+   bool I_ClearMapsBuilt;
    //  Description of last error, if any.
    std::string I_ErrorText;
    //  The directory holding the Profit files.
    std::string I_DirectoryPath;
+   //  The directory holding the mask cache files, if any.
+   std::string I_CacheDirectory;
+   //  Number of threads to use to read masks or check positions (0 => 1 per core).
+   int I_Threads;
    //  The RA centre of the field being checked, in degrees.
    double I_CentralRaDeg;
    //  The Dec centre of the field being checked, in degrees.
@@ -170,6 +464,14 @@ private:
    ArrayManager I_ArrayManager;
    //  List of all the full FITS file path names in the mask file directory.
    std::list<std::string> I_MaskFileList;
+   //  Headers read by PrereadHeaders(), by full file path name.
+   std::map<std::string,ProfitMaskHeader> I_MaskHeaders;
+   //  Entries in the footprint index for the mask file directory, if any.
+   std::vector<ProfitIndexEntry> I_IndexEntries;
+   //  Positions in I_IndexEntries of the entries, by file name.
+   std::map<std::string,int> I_IndexLookup;
+   //  For each band of Dec, the index entries whose footprints cover it.
+   std::vector<std::vector<int> > I_IndexBands;
    //  Details of all the various relevant Profit files.
    std::list<ProfitFileDetails> I_FileDetails;
    //  Any non-fatal warnings generated as the code runs.
@@ -184,9 +486,29 @@ private:
 
 /*                        P r o g r a m m i n g  N o t e s
 
-   o  This assumes the main data array in the ProFit files is integer. It may
-      be that the code should check BITPIX and use whatever format is being used
-      to avoid unnecessary conversion.
+   o  This reads the main data array in the ProFit files as integer, which
+      cfitsio will convert to if necessary, and keeps only whether or not each
+      pixel is greater than zero, as that is all CheckUseForSky() needs. Keeping
+      one bit per pixel rather than an int needs 32 times less memory, which
+      matters with several large masks overlapping a field.
+ 
+   o  Only the part of each mask that covers the field, with a margin that
+      allows for the largest radius of interest, is ever read into MaskBits,
+      and that only as queries need it. MaskBits may hold just some of that
+      area, given by MaskIx0,MaskIy0,MaskNx,MaskNy. With a tile-compressed mask
+      file, cfitsio only has to decompress the tiles that part covers. Positions
+      outside the area are treated as not being covered by the mask at all. See
+      the notes in ProfitSkyCheck.cpp.
+ 
+   o  The clearance maps are only built for the part of each mask that covers
+      the field, plus a margin, and hold the clear radius for each pixel in
+      steps of 0.1 arcsec in a single byte, so are at most 8 times the size of
+      the mask bits for that area. See the notes in ProfitSkyCheck.cpp.
+ 
+   o  CheckPositionsForSky() gives exactly the results CheckUseForSky() would
+      give for each position, but the mask data is all read before any position
+      is checked, and the positions are checked in several threads. See the
+      notes in ProfitSkyCheck.cpp.
  
 */
 
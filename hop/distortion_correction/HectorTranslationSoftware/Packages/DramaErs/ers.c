@@ -47,6 +47,11 @@
 				case.
       27-May-1998 - TJF - Fix linux compilation warnings.
       04-Mar-2014 - TJF - Add ErsGetAtCtx().
+      16-Oct-2026 - HOP - The message table is now thread local on systems
+                          that support it, so each thread has its own Ers
+                          context, just as each VxWorks task already had.
+                          Messages output directly to stderr are written
+                          with a single call so they can't be interleaved.
  
 
  *     @(#) $Id: ACMM:DramaErs/ers.c,v 3.19 09-Dec-2020 17:17:02+11 ks $
@@ -120,6 +125,19 @@ void  PlugFree(const char *,void * where);
 #ifndef VxWorks
 #define intContext() (0)
 #endif
+/*
+ * ERS_THREAD_LOCAL makes a static variable local to each thread. Under VxWorks
+ * the message table is made a task variable by ErsStart instead.
+ */
+#if defined(VxWorks)
+#    define ERS_THREAD_LOCAL
+#elif defined(__GNUC__)
+#    define ERS_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#    define ERS_THREAD_LOCAL __declspec(thread)
+#else
+#    define ERS_THREAD_LOCAL
+#endif
 /*
  *  Fudge prorotypes for C run time library system functions 
  */
@@ -149,9 +167,10 @@ typedef struct {
     } ErsBlockType;
 
 /*
- *  ErsBlock is the message table
+ *  ErsBlock is the message table. Each thread has its own, so a thread
+ *  that wants its messages stored must call ErsStart itself.
  */
-static ErsBlockType *ErsBlock = 0;
+static ERS_THREAD_LOCAL ErsBlockType *ErsBlock = 0;
 
 /*
  *+			E r s S t a r t
@@ -169,7 +188,10 @@ static ErsBlockType *ErsBlock = 0;
 	messages reported with ErsRep are written directly to the user standard
 	Error output, not stored.
 
-	
+	The Ers context set up by this routine belongs to the calling task
+	(under VxWorks) or thread (on systems that support thread local
+	storage). Other threads are not affected, and each thread that wants
+	its messages stored must call this routine itself.
 
  *  Language:
       C
@@ -218,6 +240,7 @@ static ErsBlockType *ErsBlock = 0;
  *  History:
       06-Oct-1992 - TJF - Original version
       06-Mar-1994 - TJF - Add interrupt variable and return ErsBlock.
+      16-Oct-2026 - HOP - ErsBlock is now thread local.
  */
 extern ErsTaskIdType ErsStart(
     ErsOutRoutineType outRoutine,
@@ -375,9 +398,7 @@ extern void Ers___Report (int flags,  const char * message, StatusType *status)
  */
     if (!ErsBlock)
     {
-	fputs("!!",stderr);
-	fputs(message,stderr);
-	fputs("\n",stderr);
+	fprintf(stderr,"!!%s\n",message);
     }
     else if ((ErsBlock->interrupt)||(intContext()))
     {
@@ -45,6 +45,10 @@
 //
 //  History:
 //     16th Jan 2021.  Original version. KS.
+//     16th Oct 2026.  Added I_NumActive, so Active() - and so Log() and Logf() -
+//                     can return at once when no levels are active, rather
+//                     than matching the level against each name in turn. HOP.
+//     16th Oct 2026.  Active(), Log(), Logf() and ListLevels() are now const. HOP.
 
 #ifndef __DebugHandler__
 #define __DebugHandler__
@@ -63,6 +67,7 @@ public:
 
    DebugHandler (const std::string& SubSystem) {
       I_SubSystem = SubSystem;
+      I_NumActive = 0;
    }
    
    ~DebugHandler () {}
@@ -71,12 +76,13 @@ public:
       TcsUtil::Tokenize(List,I_Levels,",");
       I_Flags.resize(I_Levels.size());
       for (int& Flag : I_Flags) { Flag = false; }
+      I_NumActive = 0;
    }
    
-   std::string ListLevels (void) {
+   std::string ListLevels (void) const {
       bool First = true;
       std::string Levels = "";
-      for (std::string& Level : I_Levels) {
+      for (const std::string& Level : I_Levels) {
          if (!First) Levels = Levels + ",";
          First = false;
          Levels = Levels + Level;
@@ -92,8 +98,9 @@ public:
       SetUnsetLevels (Levels,false);
    }
    
-   bool Active (const std::string& Level) {
+   bool Active (const std::string& Level) const {
       bool Match = false;
+      if (I_NumActive == 0) return Match;
       int NLevels = I_Levels.size();
       for (int I = 0; I < NLevels; I++) {
          if (TcsUtil::MatchCaseBlind(I_Levels[I].c_str(),Level.c_str())) {
@@ -104,14 +111,14 @@ public:
       return Match;
    }
    
-   void Log (const std::string& Level,const std::string Text) {
+   void Log (const std::string& Level,const std::string Text) const {
       if (Active(Level)) {
          printf ("[%s.%s] %s\n",
                      I_SubSystem.c_str(),Level.c_str(),Text.c_str());
       }
    }
    
-   void Logf (const std::string& Level,const char * const Format, ...) {
+   void Logf (const std::string& Level,const char * const Format, ...) const {
       if (Active(Level)) {
          char Message[1024];
          va_list Args;
@@ -156,6 +163,8 @@ private:
             }
          }
       }
+      I_NumActive = 0;
+      for (int Flag : I_Flags) { if (Flag) I_NumActive++; }
    }
 
    //  The name of the current sub-system.
@@ -164,6 +173,8 @@ private:
    std::vector<std::string> I_Levels;
    //  Flags for each level, true when the level is active.
    std::vector<int> I_Flags;
+   //  The number of levels that are active.
+   int I_NumActive;
 };
 
 #endif
@@ -21,10 +21,47 @@ static void *use_rcsId = (0 ? (void *)(&use_rcsId) : (void *) &rcsId);
 
 #include "tdfxy.h"
 
+/*
+ * The batch distortion routines can use the x86 AVX and AVX-512 vector
+ * instructions, if the processor supports them. The vector kernels are
+ * compiled for those instruction sets using the GCC/Clang target attribute,
+ * and are selected at run time, so the rest of this file is still compiled
+ * for the baseline architecture. On other architectures or compilers, only
+ * the scalar versions are used.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TDFXY_X86_SIMD 1
+#include <immintrin.h>
+#include <pthread.h>
+#endif
+
 #ifndef PATH_MAX
 #define PATH_MAX 1024
 #endif
 
+/*
+ * TDFXY_THREAD_LOCAL makes a static variable local to each thread, where the
+ * compiler supports this. (It is used for the error context pointer set by
+ * TdfErrSetContext().)
+ */
+#if defined(__GNUC__)
+#define TDFXY_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#define TDFXY_THREAD_LOCAL __declspec(thread)
+#else
+#define TDFXY_THREAD_LOCAL
+#endif
+
+/*
+ * The reports that can be recorded in a TdfErrType, and the values each one
+ * records.
+ */
+#define TDFXY_REP_FIELDPOSN 1  /* Illegal field centre or source position -
+                                  cra, cdec, ra, dec  */
+#define TDFXY_REP_POSN 2       /* Illegal source position - cra, cdec, ra, dec */
+#define TDFXY_REP_ZDFIELD 3    /* Field centre ZD too large - zd, ra, dec, mjd */
+#define TDFXY_REP_ZD 4         /* Source ZD too large - no values */
+
 #define DEBUG printf
 
 /*
@@ -131,40 +168,283 @@ static void ValidateArguments(
         return;
       }
 }
-static void ReportInvalidFieldDetails(
-    double cra, 
-    double cdec, 
-    double ra, 
-    double dec, 
-    StatusType status)
+/*
+ * The error context for the calling thread, set by TdfErrSetContext(). If this
+ * is null, problems are reported through Ers.
+ */
+static TDFXY_THREAD_LOCAL TdfErrType *Tdf___ErrContext = 0;
+
+/*
+ * Report a problem found by one of the conversion routines. If the calling
+ * thread has set an error context, this just records the report and the
+ * values needed to describe it, leaving any formatting to TdfErrText().
+ * Otherwise, the messages describing it are reported through Ers, exactly
+ * as they always were.
+ */
+static void Tdf___Report(
+    int report,
+    StatusType *status,
+    double v0,
+    double v1,
+    double v2,
+    double v3)
+{
+    TdfErrType local;
+    TdfErrType *err = Tdf___ErrContext;
+    char text[ERS_C_LEN];
+    int line;
+
+    if (!err)
+    {
+        err = &local;
+        err->count = 0;
+    }
+    if (err->count++ == 0)
+    {
+        err->status = *status;
+        err->report = report;
+        err->values[0] = v0;
+        err->values[1] = v1;
+        err->values[2] = v2;
+        err->values[3] = v3;
+    }
+    if (err == &local)
+    {
+        for (line = 0; TdfErrText(err, line, sizeof(text), text); line++)
+            ErsRepNF(0, status, text);
+    }
+}
+/*
+ * Format a position as used by TdfErrText() - the value in radians followed
+ * by its sexagesimal form.
+ */
+static void Tdf___PosnText(
+    const char *what,
+    double ra,
+    double dec,
+    int maxLen,
+    char *text)
 {
     char ra_sign;
     char dec_sign;
     int hmsf[4];
     int dmsf[4];
 
-    ErsRep(0, &status, "Invalid argument range in call to TdfRd2xy");
-
-    slaDr2tf(2, cra, &ra_sign, hmsf);
-    slaDr2af(2, cdec, &dec_sign, dmsf);
-    ErsRep(0, &status,
-           "Supplied Field Centre (app) RA = %.6f(%c%.2d:%.2d:%.2d.%d) Dec = %.6f(%c%.2d:%.2d:%.2d.%d)",
-           cra,
-           ra_sign, hmsf[0], hmsf[1], hmsf[2], hmsf[3],
-           cdec,
-           dec_sign, dmsf[0], dmsf[1], dmsf[2], dmsf[3]);
-
     slaDr2tf(2, ra, &ra_sign, hmsf);
     slaDr2af(2, dec, &dec_sign, dmsf);
-    
-    ErsRep(0, &status,
-           "Supplied Object Position (app) RA = %.6f(%c%.2d:%.2d:%.2d.%d) Dec = %.6f(%c%.2d:%.2d:%.2d.%d)",
-           cra,
+    ErsSPrintf(maxLen, text,
+           "%s RA = %.6f(%c%.2d:%.2d:%.2d.%d) Dec = %.6f(%c%.2d:%.2d:%.2d.%d)",
+           what,
+           ra,
            ra_sign, hmsf[0], hmsf[1], hmsf[2], hmsf[3],
-           cdec,
+           dec,
            dec_sign, dmsf[0], dmsf[1], dmsf[2], dmsf[3]);
+}
+/*+				T d f E r r S e t C o n t e x t
+ *  Function name:
+      TdfErrSetContext
+
+ *  Function:
+      Set the error context for the calling thread.
+
+ *  Description:
+      Normally, the conversion routines report any problems they find
+      through Ers, formatting the messages as they do so. Ers is not
+      designed to have more than one thread reporting at the same time,
+      and formatting the messages is wasted effort if the caller is only
+      going to look at the status. This routine lets the calling thread
+      supply a TdfErrType structure of its own. Until the context is
+      reset, problems found by TdfRd2tan(), TdfRd2tanQk(), TdfRd2xy(),
+      TdfRd2xyQk(), TdfFieldInit() and the routines they call in this
+      thread are recorded in that structure, without any formatting,
+      and are not reported through Ers. TdfErrText() can then be used
+      to get the messages that would have been reported.
+
+      The context is local to the calling thread, so threads can each
+      use their own without any locking. Problems found while setting
+      up the conversion parameters (TdfXyInit() and the file reading
+      routines) are always reported through Ers.
+
+ *  Language:
+      C
+
+ *  Declaration:
+       TdfErrType *TdfErrSetContext(TdfErrType *err)
+
+ *  Parameters:   (">" input, "!" modified, "W" workspace, "<" output)
+      (<) err       (TdfErrType *) The structure to be used. This is
+                         cleared, ready for use. If this is null, problems
+                         are reported through Ers again.
+
+ *  Returned value:
+      The previous context for the thread (null if there was none), so that
+      it can be restored when the caller has finished.
+
+ *  Support: Hector Observations Pipeline team, {HOP}
+
+ *  Version date: 16-Oct-2026
+ *-
+ */
+TdfErrType *TdfErrSetContext(TdfErrType *err)
+{
+    TdfErrType *previous = Tdf___ErrContext;
+
+    if (err)
+    {
+        err->status = STATUS__OK;
+        err->report = 0;
+        err->count = 0;
+    }
+    Tdf___ErrContext = err;
+    return previous;
+}
+/*+				T d f E r r T e x t
+ *  Function name:
+      TdfErrText
+
+ *  Function:
+      Get the text of a deferred error report.
+
+ *  Description:
+      Formats one line of the messages describing the first problem
+      recorded in a TdfErrType structure by the conversion routines (see
+      TdfErrSetContext()). These are the same messages that would have
+      been reported through Ers. The lines are numbered from zero, and
+      this returns zero if there is no such line, so all the lines can
+      be obtained by calling this with line set to 0, 1, 2 and so on
+      until it returns zero.
+
+ *  Language:
+      C
+
+ *  Declaration:
+       int TdfErrText(const TdfErrType *err, int line, int maxLen,
+                      char *text)
+
+ *  Parameters:   (">" input, "!" modified, "W" workspace, "<" output)
+      (>) err       (const TdfErrType *) The recorded report.
+      (>) line      (int) The line number of the message wanted.
+      (>) maxLen    (int) The size of the text buffer.
+      (<) text      (char *) Receives the line, nul terminated. This is
+                         set to an empty string if there is no such line.
+
+ *  Returned value:
+      1 if the line was returned, 0 if there is no such line.
+
+ *  Support: Hector Observations Pipeline team, {HOP}
+
+ *  Version date: 16-Oct-2026
+ *-
+ */
+int TdfErrText(const TdfErrType *err, int line, int maxLen, char *text)
+{
+    const double *v = err->values;
+    int n = 0;                  /* Number of the next candidate line */
 
+    if (maxLen > 0) text[0] = '\0';
+    if (err->count == 0) return 0;
 
+    /*
+     * Each report is a fixed sequence of lines, some of which only apply
+     * to some problems. n counts the lines that apply, and when it reaches
+     * the line requested, that one is formatted.
+     */
+    switch (err->report)
+    {
+    case TDFXY_REP_FIELDPOSN:
+    case TDFXY_REP_POSN:
+        if (err->report == TDFXY_REP_FIELDPOSN)
+        {
+            if (((v[0] > D2PI) || (v[0] < 0.0)) && (n++ == line))
+            {
+                ErsSPrintf(maxLen, text,
+                           "Illegal Centre RA - %f radians", v[0]);
+                return 1;
+            }
+            if (((v[1] > DPI) || (v[1] < (-DPI))) && (n++ == line))
+            {
+                ErsSPrintf(maxLen, text,
+                           "Illegal Centre Dec - %f radians", v[1]);
+                return 1;
+            }
+        }
+        if (((v[2] > D2PI) || (v[2] < 0.0)) && (n++ == line))
+        {
+            ErsSPrintf(maxLen, text, "Illegal RA - %f radians", v[2]);
+            return 1;
+        }
+        if (((v[3] > DPI) || (v[3] < (-DPI))) && (n++ == line))
+        {
+            ErsSPrintf(maxLen, text, "Illegal Dec - %f radians", v[3]);
+            return 1;
+        }
+        if (n++ == line)
+        {
+            ErsSPrintf(maxLen, text,
+                       "Invalid argument range in call to TdfRd2xy");
+            return 1;
+        }
+        if (n++ == line)
+        {
+            Tdf___PosnText("Supplied Field Centre (app)", v[0], v[1],
+                           maxLen, text);
+            return 1;
+        }
+        if (n++ == line)
+        {
+            Tdf___PosnText("Supplied Object Position (app)", v[2], v[3],
+                           maxLen, text);
+            return 1;
+        }
+        break;
+    case TDFXY_REP_ZDFIELD:
+        if (line == 0)
+        {
+            ErsSPrintf(maxLen, text,
+               "The selected observation date and time leads to an invalid zenith distance of %.0f degrees.",
+               v[0]/DD2R);
+            return 1;
+        }
+        else if (line == 1)
+        {
+            char ra_sign;
+            char dec_sign;
+            int hmsf[4];
+            int dmsf[4];
+
+            slaDr2tf(2, v[1], &ra_sign, hmsf);
+            slaDr2af(2, v[2], &dec_sign, dmsf);
+            ErsSPrintf(maxLen, text,
+               "Field Centre (apparent) RA = %c%.2d:%.2d:%.2d.%d, Dec = %c%.2d:%.2d:%.2d.%d  (%.6f, %.6f radians).",
+               ra_sign, hmsf[0], hmsf[1], hmsf[2], hmsf[3],
+               dec_sign, dmsf[0], dmsf[1], dmsf[2], dmsf[3],
+               v[1], v[2]);
+            return 1;
+        }
+        else if (line == 2)
+        {
+            char time_sign;
+            int ymdf[4];
+            int thmsf[4];
+            int j;
+
+            slaDjcal(2, v[3], ymdf, &j);
+            slaCd2tf(0, v[3] - (int)v[3], &time_sign, thmsf);
+            ErsSPrintf(maxLen, text,
+               "Selected Observation Date/Time (UT) = %.4d/%.2d/%.2d %.2d:%.2d:%.2d (MJD = %.6f, ).",
+               ymdf[0], ymdf[1], ymdf[2], thmsf[0], thmsf[1], thmsf[2], v[3]);
+            return 1;
+        }
+        break;
+    case TDFXY_REP_ZD:
+        if (line == 0)
+        {
+            ErsSPrintf(maxLen, text, "ZD greater than 70 degrees");
+            return 1;
+        }
+        break;
+    }
+    return 0;
 }
 /*
  * Check if we can observer the the specified field center at the
@@ -198,32 +478,8 @@ static void CheckMjd(
     slaAopqk(ra,dec, xypars.cenAoprms, &a,&zd,&h,&d,&r);
     if (zd > 70*DD2R)
     {
-        char ra_sign;
-        char dec_sign;
-        char time_sign;
-        int hmsf[4];
-        int dmsf[4];
-        int ymdf[4];
-        int thmsf[4];
-        int j;
         *status = TDFXY__ZDERR;
-        ErsRep(0, status,
-               "The selected observation date and time leads to an invalid zenith distance of %.0f degrees.",
-               zd/DD2R);
-
-        slaDr2tf(2, ra, &ra_sign, hmsf);
-        slaDr2af(2, dec, &dec_sign, dmsf);
-        slaDjcal(2, mjd, ymdf, &j);
-        slaCd2tf(0, mjd - (int)mjd, &time_sign, thmsf);
- 
-        ErsRep(0, status,
-               "Field Centre (apparent) RA = %c%.2d:%.2d:%.2d.%d, Dec = %c%.2d:%.2d:%.2d.%d  (%.6f, %.6f radians).",
-               ra_sign, hmsf[0], hmsf[1], hmsf[2], hmsf[3],
-               dec_sign, dmsf[0], dmsf[1], dmsf[2], dmsf[3],
-               ra, dec);
-        ErsRep(0, status,
-               "Selected Observation Date/Time (UT) = %.4d/%.2d/%.2d %.2d:%.2d:%.2d (MJD = %.6f, ).",
-               ymdf[0], ymdf[1], ymdf[2], thmsf[0], thmsf[1], thmsf[2], mjd);
+        Tdf___Report(TDFXY_REP_ZDFIELD, status, zd, ra, dec, mjd);
     }
 
     
@@ -342,6 +598,55 @@ void TdfXyInit(double mjd, double dut, double temp, double press,
    xypars->dist = dist;
 
 }
+/*+				T d f X y N e w T i m e
+
+ *  Function name:
+      TdfXyNewTime
+
+ *  Function:
+      Update 2dF x,y transformation parameters for a new time
+
+ *  Description:
+      Updates the apparent to observed parameters set up by TdfXyInit()
+      for a different date and time, without recalculating the parts that
+      do not depend on time, in particular the refraction constants.
+
+      slaAoppat() (as called by TdfFieldInit() and TdfRd2tan()) only
+      updates the local sidereal time. The equation of the equinoxes that
+      slaAoppa() includes in the parameters is left at its value for the
+      date originally passed to TdfXyInit(). That is a good approximation
+      over a single night, but this routine also updates that, so that the
+      parameters are those TdfXyInit() would have set up for the new time,
+      to within rounding.
+
+ *  Language:
+      C
+
+ *  Declaration:
+       TdfXyNewTime(TdfXyType *xypars, double oldMjd, double mjd)
+
+ *  Parameters:   (">" input, "!" modified, "W" workspace, "<" output)
+      (!) xypars    (TdfXyType)  2dF xy Transformation parameters - set up
+                             by a call to TdfXyInit.
+      (>) oldMjd    (double) UTC date and time, as modified julian date,
+                             for which xypars was last set up.
+      (>) mjd       (double) The new UTC date and time, as modified julian
+                             date.
+
+ *  Support: Hector Observations Pipeline team, {HOP}
+
+ *  Version date: 16-Oct-2026
+ *-
+ */
+void TdfXyNewTime(TdfXyType *xypars, double oldMjd, double mjd)
+{
+   double eqeqx = slaEqeqx(mjd) - slaEqeqx(oldMjd);
+
+   xypars->cenAoprms[12] += eqeqx;
+   xypars->obsAoprms[12] += eqeqx;
+   slaAoppat(mjd,xypars->cenAoprms);
+   slaAoppat(mjd,xypars->obsAoprms);
+}
 /*+				T d f R d 2 t a n
  *  Function name:
       TdfRd2tan
@@ -393,40 +698,101 @@ void TdfRd2tan(
     StatusType *status)
 
 {
-   double mha,mdec;           /* -ha,dec of source on AAT mount system  */
-   int jstat;
+   TdfFieldType field;        /* Field constant part of the conversion */
 
 
    if (*status != STATUS__OK) return;
 
-   if ((cra > D2PI) || (cra < 0.0))
-     {
-       *status = TDFXY__ILLRA;
-       ErsRep(0,status,"Illegal Centre RA - %f radians",cra);
-     }
-   if ((cdec > DPI) || (cdec < (-DPI)))
-     {
-       *status = TDFXY__ILLDEC;
-       ErsRep(0,status,"Illegal Centre Dec - %f radians",cdec);
-     }
-   if ((ra > D2PI) || (ra < 0.0))
-     {
-       *status = TDFXY__ILLRA;
-       ErsRep(0,status,"Illegal RA - %f radians",ra);
-     }
-   if ((dec > DPI) || (dec < (-DPI)))
-     {
-       *status = TDFXY__ILLDEC;
-       ErsRep(0,status,"Illegal Dec - %f radians",dec);
-     }
+   if ((cra > D2PI) || (cra < 0.0)) *status = TDFXY__ILLRA;
+   if ((cdec > DPI) || (cdec < (-DPI))) *status = TDFXY__ILLDEC;
+   if ((ra > D2PI) || (ra < 0.0)) *status = TDFXY__ILLRA;
+   if ((dec > DPI) || (dec < (-DPI))) *status = TDFXY__ILLDEC;
 
    if (*status != STATUS__OK)
    {
-       ReportInvalidFieldDetails(cra, cdec, ra, dec, *status);
+       Tdf___Report(TDFXY_REP_FIELDPOSN, status, cra, cdec, ra, dec);
        return;
    }
 
 
+/*  Field centre work - the same for every source in the field  */
+
+   TdfFieldInit(xypars, cra, cdec, mjd, &field, status);
+   if (*status != STATUS__OK) return;
+   *cmha = field.cmha;
+   *cmdec = field.cmdec;
+
+/*  Per-source work  */
+
+   TdfRd2tanQk(xypars, &field, ra, dec, xi, eta, status);
+
+}
+
+/*+				T d f F i e l d I n i t
+ *  Function name:
+      TdfFieldInit
+
+ *  Function:
+      Perform the field constant part of an RA,Dec <-> x,y conversion.
+
+ *  Description:
+      TdfRd2tan() and TdfXy2rd() each start by updating the apparent to
+      observed parameters for the time of observation, checking that the
+      field can be observed at that time and working out the position of
+      the field centre on the AAT mount system, and TdfDistXy() and
+      TdfDistXyInv() work out the distortion model for the observing
+      wavelength every time they are called. None of this depends on
+      the source being converted, so when many sources in the one field
+      are to be converted it is much cheaper to do this once, using this
+      routine, and then to call TdfRd2tanQk(), TdfRd2xyQk() or TdfXy2rdQk()
+      for each source.
+
+      Note that, like TdfRd2tan(), this updates the apparent to observed
+      parameters in xypars for the given mjd.
+
+ *  Language:
+      C
+
+ *  Declaration:
+       TdfFieldInit(TdfXyType *xypars, double cra, double cdec, double mjd,
+                    TdfFieldType *field, StatusType *status)
+
+ *  Parameters:   (">" input, "!" modified, "W" workspace, "<" output)
+      (!) xypars    (TdfXyType)  2dF xy Transformation parameters - set up
+                             by a call to TdfXyInit.
+      (>) cra       (double) Apparent RA of field centre.
+      (>) cdec      (double) Apparent Dec of field centre.
+      (>) mjd       (double) UTC date and time expressed as Modified
+                              Julian Date.
+      (<) field     (TdfFieldType *) Field centre details, to be passed
+                             to the per-source "Qk" routines.
+      (!) status    (StatusType*) Modified status.
+                         TDFXY__ZDERR -> ZD greater than 70 degrees.
+
+ *  Support: Hector Observations Pipeline team, {HOP}
+
+ *  Version date: 16-Oct-2026
+ *-
+ */
+void TdfFieldInit(
+    TdfXyType *xypars, double cra, double cdec, double mjd,
+    TdfFieldType *field,
+    StatusType *status)
+
+{
+   if (*status != STATUS__OK) return;
+
+   field->cra = cra;
+   field->cdec = cdec;
+   field->mjd = mjd;
+
+/*  Distortion model for the observing wavelength */
+
+   Tdf___DistLambda(xypars->obsLambda,xypars->dist,
+                    &field->a,&field->b,&field->c,&field->d);
+   field->x0a = xypars->dist.x0/field->a;
+   field->y0a = xypars->dist.y0/field->a;
+
 /*  Update Apparent to observed parameters  */
 
    slaAoppat(mjd,xypars->cenAoprms);
@@ -439,7 +805,69 @@ void TdfRd2tan(
 
 /*  Mount frame position of field centre  */
 
-   Tdf___App2mount(1, xypars,cra,cdec,cmha,cmdec,status);
+   Tdf___App2mount(1, xypars,cra,cdec,&field->cmha,&field->cmdec,status);
+
+}
+
+/*+				T d f R d 2 t a n Q k
+ *  Function name:
+      TdfRd2tanQk
+
+ *  Function:
+      Determine 2df tangent plane coordinates from apparent RA and Dec -
+      quick version for use once the field centre has been set up.
+
+ *  Description:
+      As TdfRd2tan(), but takes the field centre details from a
+      TdfFieldType structure already set up by TdfFieldInit(), and so only
+      does the work that depends on the source position.
+
+ *  Language:
+      C
+
+ *  Declaration:
+       TdfRd2tanQk(TdfXyType *xypars, const TdfFieldType *field, double ra,
+                double dec, double *xi, double *eta, StatusType *status)
+
+ *  Parameters:   (">" input, "!" modified, "W" workspace, "<" output)
+      (>) xypars    (TdfXyType)  2dF xy Transformation parameters - as
+                             updated by TdfFieldInit().
+      (>) field     (TdfFieldType *) Field centre details, from
+                             TdfFieldInit().
+      (>) ra        (double) Apparent RA of source.
+      (>) dec       (double) Apparent Dec of source.
+      (<) xi      (double *) Tangent plane coordinates (radians)
+      (<) eta     (double *)
+      (!) status    (StatusType*) Modified status.
+                         TDFXY__ILLRA ->  Illegal RA.
+                         TDFXY__ILLDEC ->  Illegal Dec.
+                         TDFXY__ZDERR -> ZD greater than 70 degrees.
+
+ *  Support: Hector Observations Pipeline team, {HOP}
+
+ *  Version date: 16-Oct-2026
+ *-
+ */
+void TdfRd2tanQk(
+    TdfXyType *xypars, const TdfFieldType *field, double ra,
+    double dec, double *xi, double *eta,
+    StatusType *status)
+
+{
+   double mha,mdec;           /* -ha,dec of source on AAT mount system  */
+   int jstat;
+
+
+   if (*status != STATUS__OK) return;
+
+   if ((ra > D2PI) || (ra < 0.0)) *status = TDFXY__ILLRA;
+   if ((dec > DPI) || (dec < (-DPI))) *status = TDFXY__ILLDEC;
+
+   if (*status != STATUS__OK)
+   {
+       Tdf___Report(TDFXY_REP_POSN, status, field->cra, field->cdec, ra, dec);
+       return;
+   }
 
 /*  Mount frame position of source  */
 
@@ -448,7 +876,7 @@ void TdfRd2tan(
 
 /*  Project to tangent plane  */
 
-   slaDs2tp(mha,mdec,*cmha,*cmdec,xi,eta,&jstat);
+   slaDs2tp(mha,mdec,field->cmha,field->cmdec,xi,eta,&jstat);
 
 
    switch (jstat)
@@ -472,7 +900,6 @@ void TdfRd2tan(
 
 }
 
-
 /*+				T d f R d 2 x y
 
  *  Function name:
@@ -531,116 +958,755 @@ void TdfRd2xy(TdfXyType *xypars, double cra, double cdec, double ra,
 
 }
 
+/*+				T d f R d 2 x y Q k
+
+ *  Function name:
+      TdfRd2xyQk
+
+ *  Function:
+      Determine 2df x,y from apparent RA and Dec - quick version for use
+      once the field centre has been set up.
+
+ *  Description:
+      As TdfRd2xy(), but takes the field centre details from a TdfFieldType
+      structure already set up by TdfFieldInit(). When converting a number
+      of sources in the same field, call TdfFieldInit() once and then call
+      this for each source.
+
+ *  Language:
+      C
+
+ *  Declaration:
+       TdfRd2xyQk(TdfXyType *xypars, const TdfFieldType *field, double ra,
+                double dec, double *x, double *y, StatusType *status)
+
+ *  Parameters:   (">" input, "!" modified, "W" workspace, "<" output)
+      (>) xypars    (TdfXyType)  2dF xy Transformation parameters - as
+                             updated by TdfFieldInit().
+      (>) field     (TdfFieldType *) Field centre details, from
+                             TdfFieldInit().
+      (>) ra        (double) Apparent RA of source.
+      (>) dec       (double) Apparent Dec of source.
+      (<) x         (double*) x position of source on field plate (microns).
+      (<) y         (double*) y position of source on field plate (microns).
+      (!) status    (StatusType*) Modified status.
+                         TDFXY__ILLRA ->  Illegal RA.
+                         TDFXY__ILLDEC ->  Illegal Dec.
+                         TDFXY__ZDERR -> ZD greater than 70 degrees.
+
+ *  Support: Hector Observations Pipeline team, {HOP}
+
+ *  Version date: 16-Oct-2026
+ *-
+ */
+void TdfRd2xyQk(TdfXyType *xypars, const TdfFieldType *field, double ra,
+                double dec, double *x, double *y, StatusType *status)
+
+{
+   double xi,eta;             /* tangent plane coordinates  */
+
+
+   if (*status != STATUS__OK) return;
+   TdfRd2tanQk(xypars, field, ra, dec, &xi, &eta, status);
+   if (*status != STATUS__OK) return;
+   TdfDistXyQk(field,xi,eta,x,y);
+
+}
+
+
+
+/*
+ *   TdfDistXy
+ *
+ *   This function converts the standard coordinates (xi, eta
+ *    in radians) to x,y in microns correcting for distortion.
+ *
+ *     (>)  dist  (TdfDistType)    Structure specifying parameters of
+ *                                   distortion model
+ *     (>)  lambda (double)        Wavelength of observation 
+ *     (>)  adc_a (double)         Angle of ADC element A
+ *     (>)  adc_b (double)         Angle of ADC element B
+ *     (>)  mha (double)           Hour angle of telescope mount (radians)
+ *     (>)  mdec (double)          Declination of telescope mount (radians)
+ *     (>)  xi (double)            Tangent Plane coordinate (radians)
+ *     (>)  eta (double)           Tangent Plane coordinate (radians)
+ *     (<)  x  (double *)          Rectangular coordinates 
+ *     (<)  y  (double *)             on field plate (microns)
+ *     (!)  status (StatusType*)   Inherited status
+ *
+ */
+
+
+void TdfDistXy(TdfDistType dist, double lambda, 
+               double adc_a DUNUSED , double adc_b DUNUSED,
+               double mha DUNUSED , double mdec DUNUSED ,
+               double xi, double eta, double *x, double *y, 
+               StatusType *status DUNUSED)
+
+{
+    double x1,y1,r2;
+    double a,b,c,d;
+
+/*  Get distortion model for observing wavelength  */
+
+    Tdf___DistLambda(lambda,dist,&a,&b,&c,&d);    
+
+/*  Correct for offset of distortion pattern centre  */
+
+    x1 = (xi - dist.x0/a);
+    y1 = (eta - dist.y0/a);
+    r2 = x1*x1+y1*y1;
+
+/*  Correct for radial distortion  */
+
+    *x = xi*(a + r2*(b + r2*(c + d * r2)));
+    *y = eta*(a + r2*(b + r2*(c + d * r2)));
+}
+
+/*
+ *   TdfDistXyInv
+ *
+ *   This function converts to standard coordinates (xi, eta
+ *    in radians) from x,y in microns correcting for distortion.
+ *   It is the exact inverse of TdfDistXy, to the accuracy given by
+ *   TDFXY_INV_TOL.
+ *
+ *     (>)  dist  (TdfDistType)    Structure specifying parameters of
+ *                                   distortion model
+ *     (>)  lambda (double)        Wavelength of observation (microns)
+ *     (>)  adc_a (double)         Angle of ADC element A
+ *     (>)  adc_b (double)         Angle of ADC element B
+ *     (>)  mha (double)           Hour angle of telescope mount (radians)
+ *     (>)  mdec (double)          Declination of telescope mount (radians)
+ *     (>)  x  (double)            Rectangular coordinates 
+ *     (>)  y  (double)              on field plate (microns)
+ *     (<)  xi (double*)           Tangent Plane coordinate (radians)
+ *     (<)  eta (double*)          Tangent Plane coordinate (radians)
+ *     (!)  status (StatusType*)   Inherited status
+ *
+ */
+
+void TdfDistXyInv(TdfDistType dist, double lambda, 
+                  double adc_a DUNUSED, double adc_b DUNUSED,
+                  double mha   DUNUSED, double mdec  DUNUSED,
+                  double x, double y, double *xi, double *eta, 
+                  StatusType *status DUNUSED)
+
+{
+
+    TdfFieldType field;
+    double residual;
+    int iterations;
+
+/*  Get distortion model for observing wavelength  */
+
+    memset(&field,0,sizeof(field));
+    Tdf___DistLambda(lambda,dist,&field.a,&field.b,&field.c,&field.d); 
+    field.x0a = dist.x0/field.a;
+    field.y0a = dist.y0/field.a;
+
+/*  Because the distortion model is expressed in terms of a radial
+    distance in the form of xi and eta, and we have x and y, the calculation
+    has to be done iteratively. This used to do 5 fixed point iterations,
+    which are not enough near the edge of the Hector field, so now it uses
+    TdfDistXyInvNewton(), which iterates until the result is accurate. */
+
+    TdfDistXyInvNewton(&field,x,y,TDFXY_INV_TOL,TDFXY_INV_MAXITER,xi,eta,
+                       &residual,&iterations);
+}
+
+/*
+ *   TdfDistXyQk
+ *
+ *   As TdfDistXy(), but uses the distortion model for the observing
+ *   wavelength already calculated by TdfFieldInit() rather than working
+ *   it out again for each position.
+ *
+ *     (>)  field (TdfFieldType*)  Field details, from TdfFieldInit()
+ *     (>)  xi (double)            Tangent Plane coordinate (radians)
+ *     (>)  eta (double)           Tangent Plane coordinate (radians)
+ *     (<)  x  (double *)          Rectangular coordinates 
+ *     (<)  y  (double *)             on field plate (microns)
+ *
+ */
+
+void TdfDistXyQk(const TdfFieldType *field, double xi, double eta,
+                 double *x, double *y)
+
+{
+    double x1,y1,r2;
+    double a = field->a;
+    double b = field->b;
+    double c = field->c;
+    double d = field->d;
+
+/*  Correct for offset of distortion pattern centre  */
+
+    x1 = (xi - field->x0a);
+    y1 = (eta - field->y0a);
+    r2 = x1*x1+y1*y1;
+
+/*  Correct for radial distortion  */
+
+    *x = xi*(a + r2*(b + r2*(c + d * r2)));
+    *y = eta*(a + r2*(b + r2*(c + d * r2)));
+}
+
+/*
+ *   TdfDistXyInvQk
+ *
+ *   As TdfDistXyInv(), but uses the distortion model for the observing
+ *   wavelength already calculated by TdfFieldInit(). It is the exact
+ *   inverse of TdfDistXyQk, to the accuracy given by TDFXY_INV_TOL.
+ *   TdfDistXyInvNewton() can be used instead to control the accuracy,
+ *   or to see how accurate the result is.
+ *
+ *     (>)  field (TdfFieldType*)  Field details, from TdfFieldInit()
+ *     (>)  x  (double)            Rectangular coordinates 
+ *     (>)  y  (double)              on field plate (microns)
+ *     (<)  xi (double*)           Tangent Plane coordinate (radians)
+ *     (<)  eta (double*)          Tangent Plane coordinate (radians)
+ *
+ */
+
+void TdfDistXyInvQk(const TdfFieldType *field, double x, double y,
+                    double *xi, double *eta)
+
+{
+    double residual;
+    int iterations;
+
+/*  Iterate exactly as in TdfDistXyInv()  */
+
+    TdfDistXyInvNewton(field,x,y,TDFXY_INV_TOL,TDFXY_INV_MAXITER,xi,eta,
+                       &residual,&iterations);
+}
+
+/*+			T d f D i s t X y I n v N e w t o n
+
+ *  Function name:
+      TdfDistXyInvNewton
+
+ *  Function:
+      Invert the distortion model to a given accuracy, using Newton's method.
+
+ *  Description:
+      TdfDistXyInv() and TdfDistXyInvQk() used to do five fixed point
+      iterations, without checking how well they had converged, and near
+      the edge of the Hector field that was not enough. They now call this
+      routine, with the default tolerance and iteration limit. This uses
+      Newton's method, with the analytic derivatives of the distortion
+      model, and stops as soon as the x,y position given by applying the
+      distortion model (exactly as in TdfDistXyQk()) to the calculated
+      xi,eta is within a specified distance of the x,y position being
+      inverted. It returns that final distance and the number of
+      Newton iterations used, so the caller can monitor the accuracy
+      actually achieved. Convergence is quadratic, so one or two iterations
+      are usually enough, and positions near the field centre, where the
+      distortion is smallest, need the fewest.
+
+      If the tolerance has not been reached after maxIter iterations, the
+      routine returns its final estimate, and the residual will be larger
+      than the tolerance. It is up to the caller to decide what to do
+      about that.
+
+ *  Language:
+      C
+
+ *  Declaration:
+       TdfDistXyInvNewton(const TdfFieldType *field, double x, double y,
+                double tol, int maxIter, double *xi, double *eta,
+                double *residual, int *iterations)
+
+ *  Parameters:   (">" input, "!" modified, "W" workspace, "<" output)
+      (>) field     (TdfFieldType *) Field details, from TdfFieldInit().
+      (>) x         (double) Rectangular coordinates on field plate
+      (>) y         (double)   (microns).
+      (>) tol       (double) Required accuracy, in microns on the field
+                          plate. TDFXY_INV_TOL is a sensible value.
+      (>) maxIter   (int) Maximum number of iterations to use.
+                          TDFXY_INV_MAXITER is a sensible value.
+      (<) xi        (double*) Tangent plane coordinates (radians).
+      (<) eta       (double*)
+      (<) residual  (double*) Distance in microns between x,y and the
+                          result of applying the distortion model to xi,eta.
+      (<) iterations (int*) Number of Newton iterations used.
+
+ *  Support: Hector Observations Pipeline team, {HOP}
+
+ *  Version date: 17-Oct-2026
+ *-
+ */
+
+void TdfDistXyInvNewton(const TdfFieldType *field, double x, double y,
+                        double tol, int maxIter, double *xi, double *eta,
+                        double *residual, int *iterations)
+{
+    double a = field->a;
+    double b = field->b;
+    double c = field->c;
+    double d = field->d;
+    double xiEst = x/a;
+    double etaEst = y/a;
+    double res = 0.0;
+    int iter = 0;
+
+    for (;;)
+    {
+        double x1,y1,r2,p,dp,fx,fy;
+        double j11,j12,j21,j22,det;
+
+/*  Apply the model to the current estimate, and see how close we are. */
+
+        x1 = xiEst - field->x0a;
+        y1 = etaEst - field->y0a;
+        r2 = x1*x1+y1*y1;
+        p = a + r2*(b + r2*(c + d*r2));
+        fx = xiEst*p - x;
+        fy = etaEst*p - y;
+        res = sqrt(fx*fx + fy*fy);
+        if (res <= tol || iter >= maxIter) break;
+
+/*  The Jacobian of (xi*p, eta*p) with respect to (xi, eta). dp is the
+    derivative of the polynomial with respect to r2, and r2 changes with
+    xi and eta as 2*x1 and 2*y1 respectively. */
+
+        dp = b + r2*(2.0*c + 3.0*d*r2);
+        j11 = p + 2.0*xiEst*dp*x1;
+        j12 = 2.0*xiEst*dp*y1;
+        j21 = 2.0*etaEst*dp*x1;
+        j22 = p + 2.0*etaEst*dp*y1;
+        det = j11*j22 - j12*j21;
+        if (det == 0.0) break;
+
+/*  Newton step */
+
+        xiEst -= (fx*j22 - fy*j12)/det;
+        etaEst -= (fy*j11 - fx*j21)/det;
+        iter++;
+    }
+
+    *xi = xiEst;
+    *eta = etaEst;
+    *residual = res;
+    *iterations = iter;
+}
+
+/*
+ * Vector kernels used by TdfDistXyBatch() and TdfDistXyInvBatch(). These
+ * perform exactly the same operations, in the same order, as the scalar
+ * code in TdfDistXyQk() and TdfDistXyInvNewton(). They deliberately do not use
+ * fused multiply-add instructions, so the results are bit for bit the same
+ * as those from the scalar code. Each handles as many whole vectors as it
+ * can and returns the number of positions it processed, leaving the rest
+ * for the scalar code.
+ *
+ * The inverse kernels run the Newton iteration for all the positions in a
+ * vector together, keeping a mask of the ones still iterating. A position
+ * drops out of the mask at exactly the point TdfDistXyInvNewton() would
+ * stop for it - when it is within the tolerance, or its Jacobian is
+ * singular - and from then on its estimate, residual and iteration count
+ * are left alone. The vector as a whole stops when none are left, or the
+ * iteration limit is reached.
+ */
+
+#ifdef TDFXY_X86_SIMD
+
+__attribute__((target("avx")))
+static int Tdf___DistXyAvx(const TdfFieldType *field, int n,
+                  const double xi[], const double eta[], double x[], double y[])
+{
+    __m256d a = _mm256_set1_pd(field->a);
+    __m256d b = _mm256_set1_pd(field->b);
+    __m256d c = _mm256_set1_pd(field->c);
+    __m256d d = _mm256_set1_pd(field->d);
+    __m256d x0a = _mm256_set1_pd(field->x0a);
+    __m256d y0a = _mm256_set1_pd(field->y0a);
+    int i;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        __m256d vxi = _mm256_loadu_pd(xi + i);
+        __m256d veta = _mm256_loadu_pd(eta + i);
+        __m256d x1 = _mm256_sub_pd(vxi,x0a);
+        __m256d y1 = _mm256_sub_pd(veta,y0a);
+        __m256d r2 = _mm256_add_pd(_mm256_mul_pd(x1,x1),_mm256_mul_pd(y1,y1));
+        __m256d p = _mm256_add_pd(c,_mm256_mul_pd(d,r2));
+        p = _mm256_add_pd(b,_mm256_mul_pd(r2,p));
+        p = _mm256_add_pd(a,_mm256_mul_pd(r2,p));
+        _mm256_storeu_pd(x + i,_mm256_mul_pd(vxi,p));
+        _mm256_storeu_pd(y + i,_mm256_mul_pd(veta,p));
+    }
+    return i;
+}
+
+__attribute__((target("avx")))
+static int Tdf___DistXyInvAvx(const TdfFieldType *field, int n,
+                  const double x[], const double y[], double tol, int maxIter,
+                  double xi[], double eta[], double residual[], int iterations[])
+{
+    __m256d a = _mm256_set1_pd(field->a);
+    __m256d b = _mm256_set1_pd(field->b);
+    __m256d c = _mm256_set1_pd(field->c);
+    __m256d d = _mm256_set1_pd(field->d);
+    __m256d x0a = _mm256_set1_pd(field->x0a);
+    __m256d y0a = _mm256_set1_pd(field->y0a);
+    __m256d vtol = _mm256_set1_pd(tol);
+    __m256d zero = _mm256_setzero_pd();
+    __m256d one = _mm256_set1_pd(1.0);
+    __m256d two = _mm256_set1_pd(2.0);
+    __m256d three = _mm256_set1_pd(3.0);
+    int i, iter;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        __m256d vx = _mm256_loadu_pd(x + i);
+        __m256d vy = _mm256_loadu_pd(y + i);
+        __m256d xiEst = _mm256_div_pd(vx,a);
+        __m256d etaEst = _mm256_div_pd(vy,a);
+        __m256d res = zero;
+        __m256d count = zero;
+        __m256d active = _mm256_cmp_pd(zero,zero,_CMP_EQ_OQ);
+
+        for (iter = 0; ; iter++)
+        {
+            __m256d x1 = _mm256_sub_pd(xiEst,x0a);
+            __m256d y1 = _mm256_sub_pd(etaEst,y0a);
+            __m256d r2 = _mm256_add_pd(_mm256_mul_pd(x1,x1),_mm256_mul_pd(y1,y1));
+            __m256d p = _mm256_add_pd(c,_mm256_mul_pd(d,r2));
+            __m256d fx, fy, dp, txi, teta, j11, j12, j21, j22, det;
+            p = _mm256_add_pd(b,_mm256_mul_pd(r2,p));
+            p = _mm256_add_pd(a,_mm256_mul_pd(r2,p));
+            fx = _mm256_sub_pd(_mm256_mul_pd(xiEst,p),vx);
+            fy = _mm256_sub_pd(_mm256_mul_pd(etaEst,p),vy);
+            res = _mm256_blendv_pd(res,_mm256_sqrt_pd(_mm256_add_pd(
+                           _mm256_mul_pd(fx,fx),_mm256_mul_pd(fy,fy))),active);
+            active = _mm256_and_pd(active,_mm256_cmp_pd(res,vtol,_CMP_NLE_UQ));
+            if (iter >= maxIter || _mm256_movemask_pd(active) == 0) break;
+
+            dp = _mm256_add_pd(b,_mm256_mul_pd(r2,_mm256_add_pd(
+                 _mm256_mul_pd(two,c),_mm256_mul_pd(_mm256_mul_pd(three,d),r2))));
+            txi = _mm256_mul_pd(_mm256_mul_pd(two,xiEst),dp);
+            teta = _mm256_mul_pd(_mm256_mul_pd(two,etaEst),dp);
+            j11 = _mm256_add_pd(p,_mm256_mul_pd(txi,x1));
+            j12 = _mm256_mul_pd(txi,y1);
+            j21 = _mm256_mul_pd(teta,x1);
+            j22 = _mm256_add_pd(p,_mm256_mul_pd(teta,y1));
+            det = _mm256_sub_pd(_mm256_mul_pd(j11,j22),_mm256_mul_pd(j12,j21));
+            active = _mm256_and_pd(active,_mm256_cmp_pd(det,zero,_CMP_NEQ_UQ));
+            if (_mm256_movemask_pd(active) == 0) break;
+
+            xiEst = _mm256_blendv_pd(xiEst,_mm256_sub_pd(xiEst,_mm256_div_pd(
+                 _mm256_sub_pd(_mm256_mul_pd(fx,j22),_mm256_mul_pd(fy,j12)),det)),
+                                                                       active);
+            etaEst = _mm256_blendv_pd(etaEst,_mm256_sub_pd(etaEst,_mm256_div_pd(
+                 _mm256_sub_pd(_mm256_mul_pd(fy,j11),_mm256_mul_pd(fx,j21)),det)),
+                                                                       active);
+            count = _mm256_add_pd(count,_mm256_and_pd(active,one));
+        }
+        _mm256_storeu_pd(xi + i,xiEst);
+        _mm256_storeu_pd(eta + i,etaEst);
+        _mm256_storeu_pd(residual + i,res);
+        _mm_storeu_si128((__m128i *)(iterations + i),_mm256_cvtpd_epi32(count));
+    }
+    return i;
+}
+
+__attribute__((target("avx512f")))
+static int Tdf___DistXyAvx512(const TdfFieldType *field, int n,
+                  const double xi[], const double eta[], double x[], double y[])
+{
+    __m512d a = _mm512_set1_pd(field->a);
+    __m512d b = _mm512_set1_pd(field->b);
+    __m512d c = _mm512_set1_pd(field->c);
+    __m512d d = _mm512_set1_pd(field->d);
+    __m512d x0a = _mm512_set1_pd(field->x0a);
+    __m512d y0a = _mm512_set1_pd(field->y0a);
+    int i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        __m512d vxi = _mm512_loadu_pd(xi + i);
+        __m512d veta = _mm512_loadu_pd(eta + i);
+        __m512d x1 = _mm512_sub_pd(vxi,x0a);
+        __m512d y1 = _mm512_sub_pd(veta,y0a);
+        __m512d r2 = _mm512_add_pd(_mm512_mul_pd(x1,x1),_mm512_mul_pd(y1,y1));
+        __m512d p = _mm512_add_pd(c,_mm512_mul_pd(d,r2));
+        p = _mm512_add_pd(b,_mm512_mul_pd(r2,p));
+        p = _mm512_add_pd(a,_mm512_mul_pd(r2,p));
+        _mm512_storeu_pd(x + i,_mm512_mul_pd(vxi,p));
+        _mm512_storeu_pd(y + i,_mm512_mul_pd(veta,p));
+    }
+    return i;
+}
+
+__attribute__((target("avx512f")))
+static int Tdf___DistXyInvAvx512(const TdfFieldType *field, int n,
+                  const double x[], const double y[], double tol, int maxIter,
+                  double xi[], double eta[], double residual[], int iterations[])
+{
+    __m512d a = _mm512_set1_pd(field->a);
+    __m512d b = _mm512_set1_pd(field->b);
+    __m512d c = _mm512_set1_pd(field->c);
+    __m512d d = _mm512_set1_pd(field->d);
+    __m512d x0a = _mm512_set1_pd(field->x0a);
+    __m512d y0a = _mm512_set1_pd(field->y0a);
+    __m512d vtol = _mm512_set1_pd(tol);
+    __m512d zero = _mm512_setzero_pd();
+    __m512d one = _mm512_set1_pd(1.0);
+    __m512d two = _mm512_set1_pd(2.0);
+    __m512d three = _mm512_set1_pd(3.0);
+    int i, iter;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        __m512d vx = _mm512_loadu_pd(x + i);
+        __m512d vy = _mm512_loadu_pd(y + i);
+        __m512d xiEst = _mm512_div_pd(vx,a);
+        __m512d etaEst = _mm512_div_pd(vy,a);
+        __m512d res = zero;
+        __m512d count = zero;
+        __mmask8 active = 0xFF;
+
+        for (iter = 0; ; iter++)
+        {
+            __m512d x1 = _mm512_sub_pd(xiEst,x0a);
+            __m512d y1 = _mm512_sub_pd(etaEst,y0a);
+            __m512d r2 = _mm512_add_pd(_mm512_mul_pd(x1,x1),_mm512_mul_pd(y1,y1));
+            __m512d p = _mm512_add_pd(c,_mm512_mul_pd(d,r2));
+            __m512d fx, fy, dp, txi, teta, j11, j12, j21, j22, det;
+            p = _mm512_add_pd(b,_mm512_mul_pd(r2,p));
+            p = _mm512_add_pd(a,_mm512_mul_pd(r2,p));
+            fx = _mm512_sub_pd(_mm512_mul_pd(xiEst,p),vx);
+            fy = _mm512_sub_pd(_mm512_mul_pd(etaEst,p),vy);
+            res = _mm512_mask_mov_pd(res,active,_mm512_sqrt_pd(_mm512_add_pd(
+                           _mm512_mul_pd(fx,fx),_mm512_mul_pd(fy,fy))));
+            active &= _mm512_cmp_pd_mask(res,vtol,_CMP_NLE_UQ);
+            if (iter >= maxIter || active == 0) break;
+
+            dp = _mm512_add_pd(b,_mm512_mul_pd(r2,_mm512_add_pd(
+                 _mm512_mul_pd(two,c),_mm512_mul_pd(_mm512_mul_pd(three,d),r2))));
+            txi = _mm512_mul_pd(_mm512_mul_pd(two,xiEst),dp);
+            teta = _mm512_mul_pd(_mm512_mul_pd(two,etaEst),dp);
+            j11 = _mm512_add_pd(p,_mm512_mul_pd(txi,x1));
+            j12 = _mm512_mul_pd(txi,y1);
+            j21 = _mm512_mul_pd(teta,x1);
+            j22 = _mm512_add_pd(p,_mm512_mul_pd(teta,y1));
+            det = _mm512_sub_pd(_mm512_mul_pd(j11,j22),_mm512_mul_pd(j12,j21));
+            active &= _mm512_cmp_pd_mask(det,zero,_CMP_NEQ_UQ);
+            if (active == 0) break;
+
+            xiEst = _mm512_mask_sub_pd(xiEst,active,xiEst,_mm512_div_pd(
+                 _mm512_sub_pd(_mm512_mul_pd(fx,j22),_mm512_mul_pd(fy,j12)),det));
+            etaEst = _mm512_mask_sub_pd(etaEst,active,etaEst,_mm512_div_pd(
+                 _mm512_sub_pd(_mm512_mul_pd(fy,j11),_mm512_mul_pd(fx,j21)),det));
+            count = _mm512_mask_add_pd(count,active,count,one);
+        }
+        _mm512_storeu_pd(xi + i,xiEst);
+        _mm512_storeu_pd(eta + i,etaEst);
+        _mm512_storeu_pd(residual + i,res);
+        _mm256_storeu_si256((__m256i *)(iterations + i),_mm512_cvtpd_epi32(count));
+    }
+    return i;
+}
+
+#endif
+
+/*
+ * The vector instruction set to be used by the batch routines. This is
+ * worked out the first time it is needed, and can be changed by
+ * TdfSetBatchSimd(). The batch routines are called by several threads at
+ * once, so pthread_once() makes sure the processor is only examined once
+ * and that every thread then sees the result. Without the vector kernels
+ * there is nothing to examine, and the level is always TDFXY_SIMD_NONE.
+ */
+static int Tdf___SimdLevel = TDFXY_SIMD_NONE;
+
+#ifdef TDFXY_X86_SIMD
+
+static pthread_once_t Tdf___SimdOnce = PTHREAD_ONCE_INIT;
+
+static void Tdf___FindSimdLevel(void)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) Tdf___SimdLevel = TDFXY_SIMD_AVX512;
+    else if (__builtin_cpu_supports("avx")) Tdf___SimdLevel = TDFXY_SIMD_AVX;
+}
+
+#endif
+
+static int Tdf___GetSimdLevel(void)
+{
+#ifdef TDFXY_X86_SIMD
+    pthread_once(&Tdf___SimdOnce,Tdf___FindSimdLevel);
+#endif
+    return Tdf___SimdLevel;
+}
+
+/*+				T d f S e t B a t c h S i m d
+
+ *  Function name:
+      TdfSetBatchSimd
+
+ *  Function:
+      Control the use of vector instructions by the batch routines.
+
+ *  Description:
+      By default, TdfDistXyBatch() and TdfDistXyInvBatch() use the widest
+      vector instructions supported by the processor (AVX-512 or AVX on
+      x86 machines). This routine allows that to be restricted, mainly for
+      testing and benchmarking. The level requested is reduced to the best
+      level the processor actually supports. The results are the same
+      whichever level is used. This should not be called while other
+      threads may be using the batch routines.
+
+ *  Language:
+      C
+
+ *  Declaration:
+       int TdfSetBatchSimd(int level)
+
+ *  Parameters:   (">" input, "!" modified, "W" workspace, "<" output)
+      (>) level     (int) One of TDFXY_SIMD_NONE, TDFXY_SIMD_AVX or
+                          TDFXY_SIMD_AVX512.
+
+ *  Returned value:
+      The level previously in use.
 
+ *  Support: Hector Observations Pipeline team, {HOP}
 
-/*
- *   TdfDistXy
- *
- *   This function converts the standard coordinates (xi, eta
- *    in radians) to x,y in microns correcting for distortion.
- *
- *     (>)  dist  (TdfDistType)    Structure specifying parameters of
- *                                   distortion model
- *     (>)  lambda (double)        Wavelength of observation 
- *     (>)  adc_a (double)         Angle of ADC element A
- *     (>)  adc_b (double)         Angle of ADC element B
- *     (>)  mha (double)           Hour angle of telescope mount (radians)
- *     (>)  mdec (double)          Declination of telescope mount (radians)
- *     (>)  xi (double)            Tangent Plane coordinate (radians)
- *     (>)  eta (double)           Tangent Plane coordinate (radians)
- *     (<)  x  (double *)          Rectangular coordinates 
- *     (<)  y  (double *)             on field plate (microns)
- *     (!)  status (StatusType*)   Inherited status
- *
+ *  Version date: 17-Oct-2026
+ *-
  */
 
+int TdfSetBatchSimd(int level)
+{
+    int previous = Tdf___GetSimdLevel();
+    int best = TDFXY_SIMD_NONE;
 
-void TdfDistXy(TdfDistType dist, double lambda, 
-               double adc_a DUNUSED , double adc_b DUNUSED,
-               double mha DUNUSED , double mdec DUNUSED ,
-               double xi, double eta, double *x, double *y, 
-               StatusType *status DUNUSED)
+#ifdef TDFXY_X86_SIMD
+    if (__builtin_cpu_supports("avx512f")) best = TDFXY_SIMD_AVX512;
+    else if (__builtin_cpu_supports("avx")) best = TDFXY_SIMD_AVX;
+#endif
+    if (level > best) level = best;
+    if (level < TDFXY_SIMD_NONE) level = TDFXY_SIMD_NONE;
+    Tdf___SimdLevel = level;
+    return previous;
+}
 
-{
-    double x1,y1,r2;
-    double a,b,c,d;
+/*+				T d f D i s t X y B a t c h
 
-/*  Get distortion model for observing wavelength  */
+ *  Function name:
+      TdfDistXyBatch
 
-    Tdf___DistLambda(lambda,dist,&a,&b,&c,&d);    
+ *  Function:
+      Apply the distortion model to an array of tangent plane positions.
 
-/*  Correct for offset of distortion pattern centre  */
+ *  Description:
+      Does the same as calling TdfDistXyQk() for each of a set of positions,
+      held as separate arrays of xi and eta values. Where possible this
+      uses vector instructions to process several positions at once. The
+      results are the same as those from TdfDistXyQk().
 
-    x1 = (xi - dist.x0/a);
-    y1 = (eta - dist.y0/a);
-    r2 = x1*x1+y1*y1;
+ *  Language:
+      C
 
-/*  Correct for radial distortion  */
+ *  Declaration:
+       TdfDistXyBatch(const TdfFieldType *field, int n, const double xi[],
+                      const double eta[], double x[], double y[])
 
-    *x = xi*(a + r2*(b + r2*(c + d * r2)));
-    *y = eta*(a + r2*(b + r2*(c + d * r2)));
-}
+ *  Parameters:   (">" input, "!" modified, "W" workspace, "<" output)
+      (>) field     (TdfFieldType *) Field details, from TdfFieldInit().
+      (>) n         (int) Number of positions.
+      (>) xi        (double[]) Tangent plane coordinates (radians).
+      (>) eta       (double[])
+      (<) x         (double[]) Rectangular coordinates on field plate
+      (<) y         (double[])   (microns).
 
-/*
- *   TdfDistXyInv
- *
- *   This function converts to standard coordinates (xi, eta
- *    in radians) from x,y in microns correcting for distortion.
- *   It is the exact inverse of TdfDistXy.
- *
- *     (>)  dist  (TdfDistType)    Structure specifying parameters of
- *                                   distortion model
- *     (>)  lambda (double)        Wavelength of observation (microns)
- *     (>)  adc_a (double)         Angle of ADC element A
- *     (>)  adc_b (double)         Angle of ADC element B
- *     (>)  mha (double)           Hour angle of telescope mount (radians)
- *     (>)  mdec (double)          Declination of telescope mount (radians)
- *     (>)  x  (double)            Rectangular coordinates 
- *     (>)  y  (double)              on field plate (microns)
- *     (<)  xi (double*)           Tangent Plane coordinate (radians)
- *     (<)  eta (double*)          Tangent Plane coordinate (radians)
- *     (!)  status (StatusType*)   Inherited status
- *
- */
+ *  Support: Hector Observations Pipeline team, {HOP}
 
-void TdfDistXyInv(TdfDistType dist, double lambda, 
-                  double adc_a DUNUSED, double adc_b DUNUSED,
-                  double mha   DUNUSED, double mdec  DUNUSED,
-                  double x, double y, double *xi, double *eta, 
-                  StatusType *status DUNUSED)
+ *  Version date: 16-Oct-2026
+ *-
+ */
 
+void TdfDistXyBatch(const TdfFieldType *field, int n, const double xi[],
+                    const double eta[], double x[], double y[])
 {
+    int i = 0;
+
+#ifdef TDFXY_X86_SIMD
+    int level = Tdf___GetSimdLevel();
+    if (level == TDFXY_SIMD_AVX512)
+        i = Tdf___DistXyAvx512(field,n,xi,eta,x,y);
+    else if (level == TDFXY_SIMD_AVX)
+        i = Tdf___DistXyAvx(field,n,xi,eta,x,y);
+#endif
+    for (; i < n; i++) TdfDistXyQk(field,xi[i],eta[i],&x[i],&y[i]);
+}
 
-    double x1,y1,r2;
-    double a,b,c,d;
-    int i;
+/*+				T d f D i s t X y I n v B a t c h
 
-/*  Get distortion model for observing wavelength  */
+ *  Function name:
+      TdfDistXyInvBatch
 
-    Tdf___DistLambda(lambda,dist,&a,&b,&c,&d); 
+ *  Function:
+      Invert the distortion model for an array of field plate positions.
 
-/*  Because the distortion model is expressed in terms of a radial
-    distance in the form of xi and eta, and we have x and y, the calculation
-    has to be done iteratively. We make an initial estimate of xi and eta
-    ignoring distortion and improve it iteratively. Since the distortion
-    corrections are relatively small the process normally converges 
-    rapidly - Here we do 5 iterations which should be sufficient  */
-   
-/*  Initial approximation  */
+ *  Description:
+      Does the same as calling TdfDistXyInvNewton() for each of a set of
+      positions, held as separate arrays of x and y values, with the same
+      tolerance and iteration limit for all of them. Where possible this
+      uses vector instructions to iterate for several positions at once.
+      The results, including the residuals and iteration counts, are the
+      same as those from TdfDistXyInvNewton().
 
-    *xi = x/a;
-    *eta = y/a;
+ *  Language:
+      C
 
-/*  Recalculate iteratively to get improved estimates of xi and eta  */
+ *  Declaration:
+       TdfDistXyInvBatch(const TdfFieldType *field, int n, const double x[],
+                const double y[], double tol, int maxIter, double xi[],
+                double eta[], double residual[], int iterations[])
 
-    for (i=0;i<5;i++)
-    {
-      x1 = (*xi - dist.x0/a);
-      y1 = (*eta - dist.y0/a);
-      r2 = x1*x1+y1*y1;
-      *xi = x/(a + r2*(b + r2*(c + d*r2)));
-      *eta = y/(a + r2*(b + r2*(c + d*r2)));
-    }
+ *  Parameters:   (">" input, "!" modified, "W" workspace, "<" output)
+      (>) field     (TdfFieldType *) Field details, from TdfFieldInit().
+      (>) n         (int) Number of positions.
+      (>) x         (double[]) Rectangular coordinates on field plate
+      (>) y         (double[])   (microns).
+      (>) tol       (double) Required accuracy, in microns on the field
+                          plate. TDFXY_INV_TOL is a sensible value.
+      (>) maxIter   (int) Maximum number of iterations to use.
+                          TDFXY_INV_MAXITER is a sensible value.
+      (<) xi        (double[]) Tangent plane coordinates (radians).
+      (<) eta       (double[])
+      (<) residual  (double[]) Final distance in microns between each x,y
+                          and the distortion model applied to its xi,eta.
+      (<) iterations (int[]) Number of Newton iterations used for each.
+
+ *  Support: Hector Observations Pipeline team, {HOP}
+
+ *  Version date: 17-Oct-2026
+ *-
+ */
+
+void TdfDistXyInvBatch(const TdfFieldType *field, int n, const double x[],
+                       const double y[], double tol, int maxIter, double xi[],
+                       double eta[], double residual[], int iterations[])
+{
+    int i = 0;
+
+#ifdef TDFXY_X86_SIMD
+    int level = Tdf___GetSimdLevel();
+    if (level == TDFXY_SIMD_AVX512)
+        i = Tdf___DistXyInvAvx512(field,n,x,y,tol,maxIter,xi,eta,
+                                  residual,iterations);
+    else if (level == TDFXY_SIMD_AVX)
+        i = Tdf___DistXyInvAvx(field,n,x,y,tol,maxIter,xi,eta,
+                               residual,iterations);
+#endif
+    for (; i < n; i++)
+        TdfDistXyInvNewton(field,x[i],y[i],tol,maxIter,&xi[i],&eta[i],
+                           &residual[i],&iterations[i]);
 }
 
 
@@ -705,7 +1771,7 @@ void Tdf___App2mount(int cen, TdfXyType *xypars, double ra, double dec,
    if (zd > 70*DD2R) 
      {
         *status = TDFXY__ZDERR;
-        ErsRep(0,status,"ZD greater than 70 degrees");
+        Tdf___Report(TDFXY_REP_ZD, status, 0.0, 0.0, 0.0, 0.0);
         return;
      }
 
@@ -777,43 +1843,136 @@ void TdfXy2rd(TdfXyType *xypars, double cra, double cdec, double x,
                 StatusType *status)
 
 {
-   double cmha,cmdec;         /* -ha,dec of field centre on AAT mount system */
-   double mha,mdec;           /* -ha,dec of source on AAT mount system  */
-   double xi,eta;             /* tangent plane coordinates  */
+   TdfFieldType field;        /* Field constant part of the conversion */
 
-   double obs[3];             /* Observed Az, El cartesian vector  */
-   double mount[3];           /* Mount -HA, Dec cartesian vector  */
-   double a,e;                /* Observed Az, El */
-   double zd;                 /* Observed Zd */
+   if (*status != STATUS__OK) return;
+
+/*  Field centre work - the same for every source in the field  */
+
+   TdfFieldInit(xypars, cra, cdec, mjd, &field, status);
 
    if (*status != STATUS__OK) return;
 
-/*  Update Apparent to observed parameters  */
+/*  Per-source work  */
 
-   slaAoppat(mjd,xypars->cenAoprms);
-   slaAoppat(mjd,xypars->obsAoprms);
+   TdfXy2rdQk(xypars, &field, x, y, ra, dec, status);
 
-/*  Check we can observe this position */
+}
 
-   CheckMjd(cra, cdec, mjd, *xypars, status);
+/*+				T d f X y 2 r d Q k
 
+ *  Function name:
+      TdfXy2rdQk
 
-/*  Mount frame position of field centre  */
+ *  Function:
+      Determine apparent RA and Dec from 2dF x and y - quick version for
+      use once the field centre has been set up.
 
-   Tdf___App2mount(1, xypars,cra,cdec,&cmha,&cmdec,status);
+ *  Description:
+      As TdfXy2rd(), but takes the field centre details from a TdfFieldType
+      structure already set up by TdfFieldInit(). When converting a number
+      of positions in the same field, call TdfFieldInit() once and then call
+      this for each position.
 
-   if (*status != STATUS__OK) return;
+ *  Language:
+      C
+
+ *  Declaration:
+       TdfXy2rdQk(TdfXyType *xypars, const TdfFieldType *field, double x,
+                double y, double *ra, double *dec, StatusType *status)
+
+ *  Parameters:   (">" input, "!" modified, "W" workspace, "<" output)
+      (>) xypars    (TdfXyType)  2dF xy Transformation parameters - as
+                          updated by TdfFieldInit().
+      (>) field     (TdfFieldType *) Field centre details, from
+                          TdfFieldInit().
+      (>) x         (double) x position of source on field plate (microns).
+      (>) y         (double) y position of source on field plate (microns).
+      (<) ra        (double*) Apparent RA of source.
+      (<) dec       (double*) Apparent Dec of source.
+      (!) status    (StatusType*) Modified status.
+
+ *  Support: Hector Observations Pipeline team, {HOP}
+
+ *  Version date: 16-Oct-2026
+ *-
+ */
+
+void TdfXy2rdQk(TdfXyType *xypars, const TdfFieldType *field, double x,
+                double y, double *ra, double *dec, StatusType *status)
 
+{
+   double xi,eta;             /* tangent plane coordinates  */
+
+   if (*status != STATUS__OK) return;
 
 /*  Correct for distortion  */
 
-   TdfDistXyInv(xypars->dist,xypars->obsLambda,0,0,
-           -cmha,cmdec,x,y,&xi,&eta,status);
+   TdfDistXyInvQk(field,x,y,&xi,&eta);
+
+/*  And convert the tangent plane position to RA,Dec */
+
+   TdfTan2rdQk(xypars,field,xi,eta,ra,dec,status);
+
+}
+
+/*+				T d f T a n 2 r d Q k
+
+ *  Function name:
+      TdfTan2rdQk
+
+ *  Function:
+      Determine apparent RA and Dec from 2dF tangent plane coordinates -
+      quick version for use once the field centre has been set up.
+
+ *  Description:
+      This is the second half of TdfXy2rdQk(), which first removes the
+      distortion model from the field plate x,y position to get tangent
+      plane coordinates, then calls this routine. It is available
+      separately so that a different inversion of the distortion model,
+      such as TdfDistXyInvNewton(), can be used.
+
+ *  Language:
+      C
+
+ *  Declaration:
+       TdfTan2rdQk(TdfXyType *xypars, const TdfFieldType *field, double xi,
+                double eta, double *ra, double *dec, StatusType *status)
+
+ *  Parameters:   (">" input, "!" modified, "W" workspace, "<" output)
+      (>) xypars    (TdfXyType)  2dF xy Transformation parameters - as
+                          updated by TdfFieldInit().
+      (>) field     (TdfFieldType *) Field centre details, from
+                          TdfFieldInit().
+      (>) xi        (double) Tangent plane coordinates (radians)
+      (>) eta       (double)
+      (<) ra        (double*) Apparent RA of source.
+      (<) dec       (double*) Apparent Dec of source.
+      (!) status    (StatusType*) Modified status.
+
+ *  Support: Hector Observations Pipeline team, {HOP}
+
+ *  Version date: 16-Oct-2026
+ *-
+ */
+
+void TdfTan2rdQk(TdfXyType *xypars, const TdfFieldType *field, double xi,
+                double eta, double *ra, double *dec, StatusType *status)
+
+{
+   double mha,mdec;           /* -ha,dec of source on AAT mount system  */
+
+   double obs[3];             /* Observed Az, El cartesian vector  */
+   double mount[3];           /* Mount -HA, Dec cartesian vector  */
+   double a,e;                /* Observed Az, El */
+   double zd;                 /* Observed Zd */
+
+   if (*status != STATUS__OK) return;
 
 
 /*  Deproject from tangent plane to give mount -ha, dec  */
 
-   slaDtp2s(xi,eta,cmha,cmdec,&mha,&mdec);
+   slaDtp2s(xi,eta,field->cmha,field->cmdec,&mha,&mdec);
 
 /*  Convert to cartesian  */
 
@@ -1113,6 +2272,153 @@ void TdfPos2xy(TdfLinType *linpars, double xp, double yp, double *x, double *y)
     *y = d1 + e1*xp + f1*yp;
 }
 
+/*+				T d f L i n I n i t
+
+ *  Function name:
+      TdfLinInit
+
+ *  Function:
+      Set up the normalized linear model in both directions.
+
+ *  Description:
+      TdfXy2pos() and TdfPos2xy() normalize the linear model coefficients
+      for the extra scale, rotation and non-perpendicularity every time
+      they are called, and TdfPos2xy() then inverts the model. None of this
+      depends on the position being converted. This routine does it once,
+      so that TdfXy2posQk() and TdfPos2xyQk() can then be used for each
+      position, giving exactly the same results as TdfXy2pos() and
+      TdfPos2xy().
+
+      As in TdfXy2pos(), an extra scale of zero is reported and then
+      treated as a scale of one.
+
+ *  Language:
+      C
+
+ *  Declaration:
+       TdfLinInit(const TdfLinType *linpars, TdfLinQkType *linqk,
+                  StatusType *status);
+
+ *  Parameters:   (">" input, "!" modified, "W" workspace, "<" output)
+      (>) linpars   (TdfLinType*)  Linear transformation parameters for the
+                          gantry to be used.
+      (<) linqk     (TdfLinQkType*) Normalized model, for TdfXy2posQk() and
+                          TdfPos2xyQk(). This holds its own copy of the
+                          distortion map in linpars.
+      (!) status    (StatusType*) Modified status.
+
+ *  Support: Hector Observations Pipeline team, {HOP}
+
+ *  Version date: 16-Oct-2026
+ *-
+ */
+
+void TdfLinInit(const TdfLinType *linpars, TdfLinQkType *linqk,
+                StatusType *status)
+
+{
+    double a,b,c,d,e,f;
+    double scale;
+    int i;
+
+    if (*status != STATUS__OK) return;
+
+    scale = linpars->extraScale;
+    if (scale == 0)
+    {
+        fprintf(stderr,"TdfLinInit:Illegal extra scale of zero ignore\n");
+        scale = 1;
+    }
+
+/*  Field plate to positioner - as TdfXy2pos()  */
+
+    for (i = 0; i < 6; i++) linqk->coeffs[i] = linpars->coeffs[i];
+    TdfNormalizeLinear(linpars->extraRotation, scale, linpars->extraNonPerp,
+                       &linqk->coeffs[0], &linqk->coeffs[1], &linqk->coeffs[2],
+                       &linqk->coeffs[3], &linqk->coeffs[4], &linqk->coeffs[5],
+                       status);
+    if (*status != STATUS__OK) return;
+
+/*  Positioner to field plate - as TdfPos2xy()  */
+
+    a = linpars->coeffs[0];
+    b = linpars->coeffs[1];
+    c = linpars->coeffs[2];
+    d = linpars->coeffs[3];
+    e = linpars->coeffs[4];
+    f = linpars->coeffs[5];
+    TdfNormalizeLinear(-1.0*linpars->extraRotation,
+                       1/scale,
+                       -1.0*linpars->extraNonPerp,
+                       &a, &b, &c, &d, &e, &f,
+                       status);
+    if (*status != STATUS__OK) return;
+
+    a = -a;
+    b = -b;
+    c = -c;
+   
+    linqk->invCoeffs[0] = (a*f - d*c)/(e*c - b*f);
+    linqk->invCoeffs[1] = c/(e*c - b*f);
+    linqk->invCoeffs[2] = f/(e*c - b*f);
+    linqk->invCoeffs[3] = (a*e - d*b)/(b*f - e*c);
+    linqk->invCoeffs[4] = b/(f*b - c*e);
+    linqk->invCoeffs[5] = e/(f*b - c*e);
+
+    linqk->distMap = linpars->distMap;
+}
+
+/*
+ *   TdfXy2posQk
+ *
+ *   As TdfXy2pos(), but uses the normalized model set up by TdfLinInit().
+ *
+ *     (>) linqk     (TdfLinQkType*) Model set up by TdfLinInit().
+ *     (>) x         (double) Field plate x coordinate of star.
+ *     (>) y         (double) Field plate y coordinate of star.
+ *     (<) xp        (double*) Positioner X coordinate (microns).
+ *     (<) yp        (double*) Positioner Y coordinate (microns).
+ *
+ */
+
+void TdfXy2posQk(const TdfLinQkType *linqk, double x, double y,
+                 double *xp, double *yp)
+
+{
+    const double *coeffs = linqk->coeffs;
+
+    *yp = coeffs[0] + coeffs[1]*x + coeffs[2]*y;
+    *xp = coeffs[3] + coeffs[4]*x + coeffs[5]*y;
+
+    Tdf___ApplyDistMap(&linqk->distMap, 1, xp, yp);
+}
+
+/*
+ *   TdfPos2xyQk
+ *
+ *   As TdfPos2xy(), but uses the normalized and inverted model set up
+ *   by TdfLinInit().
+ *
+ *     (>) linqk     (TdfLinQkType*) Model set up by TdfLinInit().
+ *     (>) xp        (double) positioner X coordinate of star.
+ *     (>) yp        (double) positioner Y coordinate of star.
+ *     (<) x         (double*) field plate x coordinate (microns).
+ *     (<) y         (double*) field plate y coordinate (microns).
+ *
+ */
+
+void TdfPos2xyQk(const TdfLinQkType *linqk, double xp, double yp,
+                 double *x, double *y)
+
+{
+    const double *inv = linqk->invCoeffs;
+
+    Tdf___ApplyDistMap(&linqk->distMap, 0, &xp, &yp);
+
+    *x = inv[0] + inv[1]*xp + inv[2]*yp;
+    *y = inv[3] + inv[4]*xp + inv[5]*yp;
+}
+
 
 /*+				T d f G e t D i s t
 
@@ -79,6 +79,63 @@ typedef struct TdfXyType
       double obsLambda;      /*  Observing wavelength  */
    }  TdfXyType;
 
+/*
+ * Field constant details of a conversion, set up by TdfFieldInit() and
+ * used by the per-source "Qk" conversion routines. This allows the work
+ * that is the same for all sources in a field (updating the apparent to
+ * observed parameters, the ZD check, the mount position of the field
+ * centre and the distortion model at the observing wavelength) to be
+ * done just once when converting many sources.
+ */
+typedef struct TdfFieldType
+   {
+      double cra;            /*  Apparent RA of field centre  */
+      double cdec;           /*  Apparent Dec of field centre  */
+      double mjd;            /*  UTC date and time as MJD  */
+      double cmha;           /*  -ha of field centre on AAT mount system  */
+      double cmdec;          /*  dec of field centre on AAT mount system  */
+      double a;              /*  Distortion model coefficients at the */
+      double b;              /*   observing wavelength, as returned by */
+      double c;              /*   Tdf___DistLambda()  */
+      double d;
+      double x0a;            /*  Distortion pattern centre offset, x0/a  */
+      double y0a;            /*  Distortion pattern centre offset, y0/a  */
+   }  TdfFieldType;
+
+/*
+ * The linear model of a TdfLinType, normalized for the extra scale, rotation
+ * and non-perpendicularity, in both directions. Set up by TdfLinInit() and
+ * used by TdfXy2posQk() and TdfPos2xyQk() so that the normalization and the
+ * inversion of the model are not repeated for every position. distMap is a
+ * copy of the map in the TdfLinType it was set up from, so that this can be
+ * copied, or outlive that TdfLinType, and still be used.
+ */
+typedef struct TdfLinQkType
+   {
+      double coeffs[6];      /*  Normalized field plate to positioner model */
+      double invCoeffs[6];   /*  Normalized positioner to field plate model */
+      TdfDistMapType distMap;  /*  Sky to field plate distortion map */
+   }  TdfLinQkType;
+
+/*
+ * A deferred error report. While a thread has one of these set as its error
+ * context by TdfErrSetContext(), the problems found by the conversion routines
+ * it calls are recorded here instead of being reported through Ers, and the
+ * messages describing them are only formatted if TdfErrText() is called.
+ */
+#define TDFXY_ERR_NVALUES 4
+typedef struct TdfErrType
+   {
+      StatusType status;     /*  Status set by the first problem recorded  */
+      int report;            /*  Which report describes it, for TdfErrText() */
+      int count;             /*  Number of problems recorded - 0 => none */
+      double values[TDFXY_ERR_NVALUES];  /* Values needed to describe it  */
+   }  TdfErrType;
+
+TdfErrType *TdfErrSetContext(TdfErrType *err);
+
+int TdfErrText(const TdfErrType *err, int line, int maxLen, char *text);
+
 void TdfXyInit(double mjd, double dut, double temp, double press, 
                 double humid, double cenWave, double obsWave,
                 double ma, double me, double np,
@@ -86,6 +143,8 @@ void TdfXyInit(double mjd, double dut, double temp, double press,
                 double adc_b, TdfDistType dist, 
                 TdfXyType *xypars, StatusType *status);
 
+void TdfXyNewTime(TdfXyType *xypars, double oldMjd, double mjd);
+
 void TdfRd2xy(TdfXyType *xypars, double cra, double cdec, double ra, 
                 double dec, double mjd, double *x, double *y, 
                 StatusType *status);
@@ -98,6 +157,40 @@ void TdfDistXyInv(TdfDistType dist, double lambda, double adc_a, double adc_b,
              double mha, double mdec,
              double x, double y, double *xi, double *eta, StatusType *status);
 
+void TdfDistXyQk(const TdfFieldType *field, double xi, double eta,
+             double *x, double *y);
+
+void TdfDistXyInvQk(const TdfFieldType *field, double x, double y,
+             double *xi, double *eta);
+
+/*
+ * Default accuracy (microns on the field plate) and iteration limit for
+ * TdfDistXyInvNewton().
+ */
+#define TDFXY_INV_TOL 1.0e-6
+#define TDFXY_INV_MAXITER 10
+
+void TdfDistXyInvNewton(const TdfFieldType *field, double x, double y,
+             double tol, int maxIter, double *xi, double *eta,
+             double *residual, int *iterations);
+
+/*
+ * Vector instruction sets that can be used by the batch routines,
+ * TdfDistXyBatch() and TdfDistXyInvBatch(). See TdfSetBatchSimd().
+ */
+#define TDFXY_SIMD_NONE 0
+#define TDFXY_SIMD_AVX 1
+#define TDFXY_SIMD_AVX512 2
+
+int TdfSetBatchSimd(int level);
+
+void TdfDistXyBatch(const TdfFieldType *field, int n, const double xi[],
+             const double eta[], double x[], double y[]);
+
+void TdfDistXyInvBatch(const TdfFieldType *field, int n, const double x[],
+             const double y[], double tol, int maxIter, double xi[],
+             double eta[], double residual[], int iterations[]);
+
 void Tdf___App2mount(int cen, TdfXyType *xypars, double ra, double dec,
                     double *mha, double *mdec, StatusType *status);
 
@@ -113,6 +206,15 @@ void TdfXy2pos(TdfLinType *linpars, double x, double y, double *xp, double *yp);
 
 void TdfPos2xy(TdfLinType *linpars, double xp, double yp, double *x, double *y);
 
+void TdfLinInit(const TdfLinType *linpars, TdfLinQkType *linqk,
+                StatusType *status);
+
+void TdfXy2posQk(const TdfLinQkType *linqk, double x, double y,
+                double *xp, double *yp);
+
+void TdfPos2xyQk(const TdfLinQkType *linqk, double xp, double yp,
+                double *x, double *y);
+
 void TdfGetDist(char *path, TdfDistType *dist, StatusType *status);
 
 void TdfGetDist2(char *path0, char* path1, 
@@ -192,6 +294,25 @@ void TdfRd2tan(
     double *cmdec,
     StatusType *status);
 
+void TdfFieldInit(
+    TdfXyType *xypars, double cra, double cdec, double mjd,
+    TdfFieldType *field,
+    StatusType *status);
+
+void TdfRd2tanQk(
+    TdfXyType *xypars, const TdfFieldType *field, double ra,
+    double dec, double *xi, double *eta,
+    StatusType *status);
+
+void TdfRd2xyQk(TdfXyType *xypars, const TdfFieldType *field, double ra,
+                double dec, double *x, double *y, StatusType *status);
+
+void TdfXy2rdQk(TdfXyType *xypars, const TdfFieldType *field, double x,
+                double y, double *ra, double *dec, StatusType *status);
+
+void TdfTan2rdQk(TdfXyType *xypars, const TdfFieldType *field, double xi,
+                double eta, double *ra, double *dec, StatusType *status);
+
 
 /*
  * Test are only for use by test program.
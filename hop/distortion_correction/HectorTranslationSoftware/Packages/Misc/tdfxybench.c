@@ -0,0 +1,248 @@
+/*
+ *                        t d f x y b e n c h . c
+ *
+ *  Function:
+ *     Micro-benchmark for the tdfxy batch distortion routines.
+ *
+ *  Description:
+ *     Times TdfDistXyBatch() and TdfDistXyInvBatch() over a large set of
+ *     positions covering the Hector field, first using only scalar code and
+ *     then using each of the vector instruction sets the processor supports,
+ *     and reports the throughput of each and the largest difference between
+ *     the results and those from TdfDistXyQk() and TdfDistXyInvNewton()
+ *     called one position at a time. It also checks that TdfDistXyInvQk()
+ *     takes each position back to within MAX_ROUND_TRIP of where it started.
+ *     It returns a non-zero exit status if either check fails.
+ *
+ *  Invocation:
+ *     tdfxybench [distortion_file] [npositions] [repeats]
+ *
+ *     If the distortion file is omitted, the environment variable
+ *     TDF_DISTORTION is used, and if that is not set the Hector distortion
+ *     file in the DataFiles directory is used.
+ *
+ *  Building:
+ *     make -f Makefile.standalone tdfxybench
+ *
+ *     This needs the sds, ers and slalib libraries to have been built,
+ *     which they will have been if HectorConfigUtil has been built.
+ *
+ *  Author(s): Hector Observations Pipeline team, (HOP)
+ *
+ *  History:
+ *     16th Oct 2026.  Original version. HOP.
+ *     17th Oct 2026.  TdfDistXyInvBatch() now uses Newton's method, and is
+ *                     checked against TdfDistXyInvNewton(). Any difference
+ *                     from the scalar results is now treated as a failure.
+ *                     Added the round trip check of TdfDistXyInvQk(). HOP.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "status.h"
+#include "sds.h"
+#include "tdfxy.h"
+
+/*  Field used for the benchmark - any observable field will do. */
+
+#define CEN_RA 5.87886
+#define CEN_DEC -0.540933
+#define MJD 59711.875
+
+/*  Radius of the Hector field, in radians - just over a degree. */
+
+#define FIELD_RADIUS 0.0185
+
+/*  Largest acceptable round trip error through TdfDistXyQk() and
+    TdfDistXyInvQk(), in radians - 0.2 milli-arcseconds. */
+
+#define MAX_ROUND_TRIP (0.2e-3 / 206264.806)
+
+static double Seconds(clock_t start)
+{
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static const char *LevelName(int level)
+{
+    if (level == TDFXY_SIMD_AVX512) return "AVX-512";
+    if (level == TDFXY_SIMD_AVX) return "AVX";
+    return "scalar";
+}
+
+int main(int argc, char *argv[])
+{
+    StatusType status = STATUS__OK;
+    const char *distFile = "../../DataFiles/HectorDistortion.sds";
+    int npos = 100000;
+    int repeats = 50;
+    int best, level, i, r;
+    double maxRoundTrip = 0.0;
+    int mismatch = 0;
+    double *xi, *eta, *x, *y, *xRef, *yRef;
+    double *xiInv, *etaInv, *res, *xiRef, *etaRef, *resRef;
+    int *iters, *itersRef;
+    TdfDistType dist;
+    TdfXyType xypars;
+    TdfFieldType field;
+    double scalarFwd = 0.0;
+    double scalarInv = 0.0;
+
+    if (getenv("TDF_DISTORTION")) distFile = getenv("TDF_DISTORTION");
+    if (argc > 1) distFile = argv[1];
+    if (argc > 2) npos = atoi(argv[2]);
+    if (argc > 3) repeats = atoi(argv[3]);
+    if (npos <= 0 || repeats <= 0)
+    {
+        fprintf(stderr,"Usage: tdfxybench [distortion_file] [npos] [repeats]\n");
+        return 1;
+    }
+
+    TdfGetDist((char *)distFile, &dist, &status);
+    TdfXyInit(MJD, 0.0, 285.15, 900.0, 0.5, 0.6, 0.6,
+              0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
+              dist, &xypars, &status);
+    TdfFieldInit(&xypars, CEN_RA, CEN_DEC, MJD, &field, &status);
+    if (status != STATUS__OK)
+    {
+        fprintf(stderr,"Unable to set up conversion using %s\n", distFile);
+        return 1;
+    }
+
+    xi = malloc(npos * sizeof(double));
+    eta = malloc(npos * sizeof(double));
+    x = malloc(npos * sizeof(double));
+    y = malloc(npos * sizeof(double));
+    xRef = malloc(npos * sizeof(double));
+    yRef = malloc(npos * sizeof(double));
+    xiInv = malloc(npos * sizeof(double));
+    etaInv = malloc(npos * sizeof(double));
+    res = malloc(npos * sizeof(double));
+    xiRef = malloc(npos * sizeof(double));
+    etaRef = malloc(npos * sizeof(double));
+    resRef = malloc(npos * sizeof(double));
+    iters = malloc(npos * sizeof(int));
+    itersRef = malloc(npos * sizeof(int));
+    if (!xi || !eta || !x || !y || !xRef || !yRef || !xiInv || !etaInv ||
+        !res || !xiRef || !etaRef || !resRef || !iters || !itersRef)
+    {
+        fprintf(stderr,"Unable to allocate arrays for %d positions\n", npos);
+        return 1;
+    }
+
+    /*  Positions spread evenly (on a spiral) over the whole field. */
+
+    for (i = 0; i < npos; i++)
+    {
+        double rad = FIELD_RADIUS * sqrt((i + 0.5) / npos);
+        double theta = i * 2.39996322972865332;
+        xi[i] = rad * cos(theta);
+        eta[i] = rad * sin(theta);
+    }
+
+    /*  Reference values, one position at a time. */
+
+    for (i = 0; i < npos; i++)
+    {
+        double xiBack, etaBack, diff;
+        TdfDistXyQk(&field, xi[i], eta[i], &xRef[i], &yRef[i]);
+        TdfDistXyInvNewton(&field, xRef[i], yRef[i], TDFXY_INV_TOL,
+                           TDFXY_INV_MAXITER, &xiRef[i], &etaRef[i],
+                           &resRef[i], &itersRef[i]);
+        TdfDistXyInvQk(&field, xRef[i], yRef[i], &xiBack, &etaBack);
+        diff = sqrt((xiBack - xi[i]) * (xiBack - xi[i]) +
+                    (etaBack - eta[i]) * (etaBack - eta[i]));
+        if (diff > maxRoundTrip) maxRoundTrip = diff;
+    }
+    printf("TdfDistXyInvQk() max round trip error %g mas\n",
+                                           maxRoundTrip * 206264.806e3);
+
+    best = TdfSetBatchSimd(TDFXY_SIMD_AVX512);
+    printf("%d positions, %d repeats, best instruction set %s\n",
+                                             npos, repeats, LevelName(best));
+
+    for (level = TDFXY_SIMD_NONE; level <= best; level++)
+    {
+        clock_t start;
+        double fwd, inv;
+        double maxDiffXy = 0.0;
+        double maxDiffXiEta = 0.0;
+        int iterDiffs = 0;
+
+        TdfSetBatchSimd(level);
+
+        start = clock();
+        for (r = 0; r < repeats; r++)
+            TdfDistXyBatch(&field, npos, xi, eta, x, y);
+        fwd = Seconds(start);
+
+        start = clock();
+        for (r = 0; r < repeats; r++)
+            TdfDistXyInvBatch(&field, npos, xRef, yRef, TDFXY_INV_TOL,
+                              TDFXY_INV_MAXITER, xiInv, etaInv, res, iters);
+        inv = Seconds(start);
+
+        for (i = 0; i < npos; i++)
+        {
+            if (fabs(x[i] - xRef[i]) > maxDiffXy)
+                maxDiffXy = fabs(x[i] - xRef[i]);
+            if (fabs(y[i] - yRef[i]) > maxDiffXy)
+                maxDiffXy = fabs(y[i] - yRef[i]);
+            if (fabs(xiInv[i] - xiRef[i]) > maxDiffXiEta)
+                maxDiffXiEta = fabs(xiInv[i] - xiRef[i]);
+            if (fabs(etaInv[i] - etaRef[i]) > maxDiffXiEta)
+                maxDiffXiEta = fabs(etaInv[i] - etaRef[i]);
+            if (iters[i] != itersRef[i] || res[i] != resRef[i]) iterDiffs++;
+        }
+        if (maxDiffXy != 0.0 || maxDiffXiEta != 0.0 || iterDiffs) mismatch = 1;
+        if (level == TDFXY_SIMD_NONE)
+        {
+            scalarFwd = fwd;
+            scalarInv = inv;
+        }
+
+        printf("%-8s TdfDistXyBatch %8.1f Mpos/s (x%.2f)\n",
+               LevelName(level),
+               fwd > 0.0 ? npos * (double)repeats / fwd / 1.0e6 : 0.0,
+               fwd > 0.0 ? scalarFwd / fwd : 0.0);
+        printf("         max difference from scalar: x,y %g microns\n",
+               maxDiffXy);
+        printf("%-8s TdfDistXyInvBatch %5.1f Mpos/s (x%.2f)\n",
+               LevelName(level),
+               inv > 0.0 ? npos * (double)repeats / inv / 1.0e6 : 0.0,
+               inv > 0.0 ? scalarInv / inv : 0.0);
+        printf("         max difference from scalar: xi,eta %g mas, "
+               "%d residuals or iteration counts differ\n",
+               maxDiffXiEta * 206264.806e3, iterDiffs);
+    }
+
+    free(xi);
+    free(eta);
+    free(x);
+    free(y);
+    free(xRef);
+    free(yRef);
+    free(xiInv);
+    free(etaInv);
+    free(res);
+    free(xiRef);
+    free(etaRef);
+    free(resRef);
+    free(iters);
+    free(itersRef);
+    if (mismatch)
+    {
+        fprintf(stderr,"Batch results differ from the scalar results\n");
+        return 1;
+    }
+    if (maxRoundTrip > MAX_ROUND_TRIP)
+    {
+        fprintf(stderr,"Round trip error exceeds %g mas\n",
+                                           MAX_ROUND_TRIP * 206264.806e3);
+        return 1;
+    }
+    return 0;
+}
@@ -22,6 +22,14 @@ int zuncompress2mem(char *filename,
              size_t *filesize,
              int *status);
 
+/* prototype for multi-threaded gzip uncompression function in zparallel.c */
+int uncompress2mem_parallel(char *filename,
+             FILE *diskfile,
+             char **buffptr,
+             size_t *buffsize,
+             void *(*mem_realloc)(void *p, size_t newsize),
+             size_t *filesize);
+
 #if HAVE_BZIP2
 /* prototype for .bz2 uncompression function (in this file) */
 void bzip2uncompress2mem(char *filename, FILE *diskfile, int hdl,
@@ -703,8 +711,19 @@ int mem_compress_open(char *filename, int rwmode, int *hdl)
         return(status);
     }
 
-    /* uncompress file into memory */
-    status = mem_uncompress2mem(filename, diskfile, *hdl);
+    /* uncompress file into memory; a large gzip file may be uncompressed
+       using several threads (see zlib/zparallel.c), otherwise as usual */
+    if (uncompress2mem_parallel(filename, diskfile,
+		 memTable[*hdl].memaddrptr,   /* pointer to memory address */
+		 memTable[*hdl].memsizeptr,   /* pointer to size of memory */
+		 realloc,                     /* reallocation function */
+		 &finalsize))                 /* returned file size */
+    {
+        memTable[*hdl].currentpos = 0;
+        memTable[*hdl].fitsfilesize = finalsize;
+    }
+    else
+        status = mem_uncompress2mem(filename, diskfile, *hdl);
 
     fclose(diskfile);
 
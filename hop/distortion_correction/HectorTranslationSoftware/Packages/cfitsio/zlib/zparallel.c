@@ -0,0 +1,783 @@
+/*  zparallel.c -- multi-threaded uncompression of large gzip files into memory.
+
+    A gzip file is a single deflate stream (or a few of them, one per gzip
+    'member'), and normally has to be inflated from start to end by one
+    thread, since each part of the stream can refer back to the 32 KB of data
+    before it. But if the state of the inflation - the position in the
+    compressed data, to the bit, and the preceding 32 KB of output - is saved
+    at a number of restart points as the file is inflated, then on later
+    occasions each section between two restart points can be inflated
+    separately, all at once, by a number of threads. This is the technique
+    used by zran.c in the zlib examples. The start of every gzip member is
+    also a natural restart point, needing no saved output, so a multi-member
+    file costs almost nothing to index.
+
+    uncompress2mem_parallel() is called by mem_compress_open() (in drvrmem.c)
+    before it tries the usual single-threaded uncompress2mem(). For a gzip
+    file of at least GZ_MINSIZE bytes, it looks for an index of restart points
+    next to the file, called <file>.gzidx. If there is one, and it matches
+    the file's current size and modification time, and the CRC of samples
+    taken from the start and end of the file, the file is inflated by a
+    number of threads, each reading only the compressed data for the
+    sections it is inflating. If not, the whole file is read and inflated by
+    this thread in the usual way, but the restart points are noted as it
+    goes, and the index is written (if the directory can be written to) for
+    next time. Either way,
+    the result is the same as uncompress2mem() would give - except that all
+    the members of a multi-member file are uncompressed, not just the first.
+    If anything goes wrong, this returns 0, leaving the file rewound, and the
+    file is then handled by uncompress2mem() as if this didn't exist.
+
+    The number of threads used is the number of processors online, unless
+    the environment variable CFITSIO_GZIP_THREADS is set, in which case it is
+    that. If it comes to less than 2, or cfitsio was not built with
+    _REENTRANT defined (configure --enable-reentrant), this does nothing.
+
+    The gzip CRCs can't be used when the file is inflated in sections, so the
+    index holds a CRC for each section, worked out when the index is written
+    (when the gzip CRCs are checked), and each thread checks its sections
+    against these. So an index that doesn't match its file, for whatever
+    reason, is noticed, and the file is then inflated by this thread and the
+    index rewritten. The index is written in the native byte order, and one
+    written on a machine with the other order is also just rewritten.
+
+    Added for the Hector configuration software, 16th Oct 2026. HOP.
+    Each thread now reads the compressed data for its own sections, rather
+    than the whole file being read first, and the index also records a CRC
+    of samples of the file, 17th Oct 2026. HOP.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "zlib.h"
+
+/* prototype for the following function */
+int uncompress2mem_parallel(char *filename,
+             FILE *diskfile,
+             char **buffptr,
+             size_t *buffsize,
+             void *(*mem_realloc)(void *p, size_t newsize),
+             size_t *filesize);
+
+#ifndef _REENTRANT
+
+/*--------------------------------------------------------------------------*/
+int uncompress2mem_parallel(char *filename,  /* name of input file          */
+             FILE *diskfile,     /* I - file pointer                        */
+             char **buffptr,     /* IO - memory pointer                     */
+             size_t *buffsize,   /* IO - size of buffer, in bytes           */
+             void *(*mem_realloc)(void *p, size_t newsize), /* function     */
+             size_t *filesize)   /* O - size of file, in bytes              */
+/*
+  Without threads, there is nothing to be gained here.
+*/
+{
+    return(0);
+}
+
+#else
+
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#define GZ_WINSIZE  32768          /* window of output needed to restart */
+#define GZ_SPAN     (8L << 20)     /* output bytes between restart points */
+#define GZ_MINSIZE  (4L << 20)     /* smaller files are left to uncompress2mem */
+#define GZ_CHUNK    (1U << 30)     /* most bytes passed to inflate() at once */
+#define GZ_MAXTHREADS  64
+#define GZ_MAXPOINTS   (1L << 20)
+#define GZ_ORDER    0x01020304U    /* shows the byte order of the index */
+#define GZ_SAMPLE   65536          /* bytes at each end of file in sample CRC */
+
+static const char GzIndexMagic[8] = "GZIDX02";
+
+typedef struct          /* a restart point, as held in memory */
+{
+    size_t in;          /* offset in the compressed data to restart at */
+    size_t out;         /* offset in the uncompressed data */
+    int bits;           /* if non-zero, bits from byte in-1 to use first */
+    int wsize;          /* bytes of window - 0 at the start of a member */
+    unsigned long crc;  /* CRC of the output up to the next point */
+    unsigned char *window;  /* the output before the restart point */
+} gzpoint;
+
+typedef struct          /* the start of an index file */
+{
+    char magic[8];
+    unsigned int order;
+    unsigned int samplecrc;   /* CRC of the start and end of the file */
+    unsigned long long srcsize;
+    long long srcmtime;
+    unsigned long long totalout;
+    unsigned long long npoints;
+} gzindexhdr;
+
+typedef struct          /* a restart point, as written to an index file */
+{
+    unsigned long long in;
+    unsigned long long out;
+    unsigned int bits;
+    unsigned int wsize;
+    unsigned int crc;
+    unsigned int spare;
+} gzrecord;
+
+typedef struct          /* the work shared by the threads */
+{
+    int fd;             /* the compressed file, read using pread() */
+    size_t insize;
+    unsigned char *out;
+    size_t totalout;
+    gzpoint *points;
+    long npoints;
+    long next;          /* the next restart point to be handled */
+    int failed;
+    pthread_mutex_t lock;
+} gzjob;
+
+/*--------------------------------------------------------------------------*/
+static int gz_threads(void)
+/*
+  Returns the number of threads to use.
+*/
+{
+    long nthreads;
+    char *env = getenv("CFITSIO_GZIP_THREADS");
+
+    if (env)
+        nthreads = atol(env);
+    else
+        nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (nthreads > GZ_MAXTHREADS) nthreads = GZ_MAXTHREADS;
+    return((int) nthreads);
+}
+/*--------------------------------------------------------------------------*/
+static int gz_skip_header(const unsigned char *in, size_t len, size_t *hdrlen)
+/*
+  Checks the gzip member header at the start of the given data, and returns
+  its length. Returns non-zero if it isn't a valid header.
+*/
+{
+    size_t pos = 10;
+    int flags;
+
+    if (len < 10 || in[0] != 0x1f || in[1] != 0x8b || in[2] != 8) return(1);
+    flags = in[3];
+    if (flags & 0xe0) return(1);
+    if (flags & 4) {                  /* FEXTRA */
+        if (len < pos + 2) return(1);
+        pos += 2 + (in[pos] | (in[pos + 1] << 8));
+    }
+    if (flags & 8) {                  /* FNAME */
+        while (pos < len && in[pos]) pos++;
+        pos++;
+    }
+    if (flags & 16) {                 /* FCOMMENT */
+        while (pos < len && in[pos]) pos++;
+        pos++;
+    }
+    if (flags & 2) pos += 2;          /* FHCRC */
+    if (pos > len) return(1);
+    *hdrlen = pos;
+    return(0);
+}
+/*--------------------------------------------------------------------------*/
+static unsigned long gz_crc(const unsigned char *buff, size_t len)
+/*
+  Returns the CRC of a block of memory, which may be larger than inflate()
+  and crc32() can handle at once.
+*/
+{
+    unsigned long crc = crc32(0L, Z_NULL, 0);
+
+    while (len > GZ_CHUNK) {
+        crc = crc32(crc, buff, GZ_CHUNK);
+        buff += GZ_CHUNK;
+        len -= GZ_CHUNK;
+    }
+    return(crc32(crc, buff, (uInt) len));
+}
+/*--------------------------------------------------------------------------*/
+static int gz_read_range(int fd, size_t offset, size_t len,
+             unsigned char *buff)
+/*
+  Reads part of a file into memory. pread() doesn't use or change the file
+  position, so several threads can use this on the same file at once.
+  Returns non-zero if the data can't all be read.
+*/
+{
+    ssize_t nread;
+
+    while (len > 0) {
+        nread = pread(fd, buff, (len > GZ_CHUNK) ? GZ_CHUNK : len,
+                                                         (off_t) offset);
+        if (nread <= 0) return(1);
+        buff += nread;
+        offset += (size_t) nread;
+        len -= (size_t) nread;
+    }
+    return(0);
+}
+/*--------------------------------------------------------------------------*/
+static int gz_sample_crc(int fd, size_t insize, unsigned long *samplecrc)
+/*
+  Works out the CRC of the first and last GZ_SAMPLE bytes of a file. This
+  is recorded in the index, so that a file changed without its size or
+  modification time changing is still noticed. Returns non-zero if the
+  file can't be read.
+*/
+{
+    unsigned char buff[GZ_SAMPLE];
+    size_t len = (insize < GZ_SAMPLE) ? insize : GZ_SAMPLE;
+    unsigned long crc = crc32(0L, Z_NULL, 0);
+
+    if (gz_read_range(fd, 0, len, buff)) return(1);
+    crc = crc32(crc, buff, (uInt) len);
+    if (gz_read_range(fd, insize - len, len, buff)) return(1);
+    *samplecrc = crc32(crc, buff, (uInt) len);
+    return(0);
+}
+/*--------------------------------------------------------------------------*/
+static void gz_free_points(gzpoint *points, long npoints)
+{
+    long i;
+
+    for (i = 0; i < npoints; i++) free(points[i].window);
+    free(points);
+}
+/*--------------------------------------------------------------------------*/
+static int gz_add_point(gzpoint **points, long *npoints, long *maxpoints,
+             size_t in, size_t out, int bits, const unsigned char *window,
+             int wsize)
+/*
+  Adds a restart point to the list, copying the window of output before it.
+  Returns non-zero if it runs out of memory.
+*/
+{
+    gzpoint *point;
+
+    if (*npoints >= GZ_MAXPOINTS) return(1);
+    if (*npoints == *maxpoints) {
+        long newmax = (*maxpoints) ? (*maxpoints) * 2 : 64;
+        gzpoint *newpoints =
+                   (gzpoint *) realloc(*points, newmax * sizeof(gzpoint));
+        if (!newpoints) return(1);
+        *points = newpoints;
+        *maxpoints = newmax;
+    }
+    point = *points + *npoints;
+    point->in = in;
+    point->out = out;
+    point->bits = bits;
+    point->wsize = wsize;
+    point->crc = 0;
+    point->window = NULL;
+    if (wsize) {
+        point->window = (unsigned char *) malloc(wsize);
+        if (!point->window) return(1);
+        memcpy(point->window, window, wsize);
+    }
+    (*npoints)++;
+    return(0);
+}
+/*--------------------------------------------------------------------------*/
+static int gz_build(const unsigned char *in, size_t insize,
+             char **buffptr, size_t *buffsize,
+             void *(*mem_realloc)(void *p, size_t newsize),
+             size_t *filesize, gzpoint **points, long *npoints)
+/*
+  Inflates the whole of the gzip data in memory, in this thread, noting
+  restart points about every GZ_SPAN bytes of output and at the start of
+  each member that is at least that far from the last point, along with the
+  CRC of the output between each point and the next. The output buffer is
+  enlarged as necessary using mem_realloc. The CRC and length at the end of
+  each member are checked. Returns non-zero if anything goes wrong, which
+  includes the data not being a valid gzip file.
+*/
+{
+    z_stream strm;
+    size_t pos = 0, out = 0, last = 0, memberout, hdrlen, usedin, usedout;
+    long maxpoints = 0;
+    unsigned long crc, sectioncrc = crc32(0L, Z_NULL, 0);
+    unsigned char *trailer;
+    int ret, failed = 0;
+
+    *points = NULL;
+    *npoints = 0;
+    memset(&strm, 0, sizeof(strm));
+    if (inflateInit2(&strm, -15) != Z_OK) return(1);
+
+    while (pos < insize && !failed) {
+
+        /* Anything after the last member that isn't another member is
+           ignored, as gzip does. */
+        if (gz_skip_header(in + pos, insize - pos, &hdrlen)) {
+            if (*npoints == 0) failed = 1;
+            break;
+        }
+        pos += hdrlen;
+        inflateReset(&strm);
+        memberout = out;
+        if (*npoints == 0 || out - last >= GZ_SPAN) {
+            if (*npoints) (*points)[*npoints - 1].crc = sectioncrc;
+            sectioncrc = crc32(0L, Z_NULL, 0);
+            if (gz_add_point(points, npoints, &maxpoints, pos, out, 0,
+                                                           NULL, 0)) {
+                failed = 1;
+                break;
+            }
+            last = out;
+        }
+        crc = crc32(0L, Z_NULL, 0);
+
+        for (;;) {
+            if (out == *buffsize) {
+                size_t newsize = *buffsize + (*buffsize / 2) + GZ_WINSIZE;
+                char *newbuff = (char *) mem_realloc(*buffptr, newsize);
+                if (!newbuff) {
+                    failed = 1;
+                    break;
+                }
+                *buffptr = newbuff;
+                *buffsize = newsize;
+            }
+            strm.next_in = (unsigned char *) in + pos;
+            strm.avail_in = (insize - pos > GZ_CHUNK) ?
+                                       GZ_CHUNK : (uInt) (insize - pos);
+            strm.next_out = (unsigned char *) *buffptr + out;
+            strm.avail_out = (*buffsize - out > GZ_CHUNK) ?
+                                       GZ_CHUNK : (uInt) (*buffsize - out);
+
+            /* Z_BLOCK returns at the end of each deflate block, which is
+               where a restart point can go. */
+            ret = inflate(&strm, Z_BLOCK);
+            usedin = strm.next_in - (in + pos);
+            usedout = strm.next_out - ((unsigned char *) *buffptr + out);
+            crc = crc32(crc, (unsigned char *) *buffptr + out, usedout);
+            sectioncrc = crc32(sectioncrc,
+                                (unsigned char *) *buffptr + out, usedout);
+            pos += usedin;
+            out += usedout;
+            if (ret == Z_STREAM_END) break;
+            if (ret == Z_BUF_ERROR && out == *buffsize) {
+                continue;   /* just needs more room for output */
+            }
+            if (ret != Z_OK) {
+                failed = 1;
+                break;
+            }
+            if ((strm.data_type & 128) && !(strm.data_type & 64) &&
+                                                  out - last >= GZ_SPAN) {
+                int wsize = (out - memberout > GZ_WINSIZE) ?
+                                     GZ_WINSIZE : (int) (out - memberout);
+                (*points)[*npoints - 1].crc = sectioncrc;
+                sectioncrc = crc32(0L, Z_NULL, 0);
+                if (gz_add_point(points, npoints, &maxpoints, pos, out,
+                      strm.data_type & 7,
+                      (unsigned char *) *buffptr + out - wsize, wsize)) {
+                    failed = 1;
+                    break;
+                }
+                last = out;
+            }
+        }
+        if (failed) break;
+
+        /* check the CRC and (modulo 2^32) length in the member trailer */
+        if (insize - pos < 8) {
+            failed = 1;
+            break;
+        }
+        trailer = (unsigned char *) in + pos;
+        if (crc != (trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) |
+                                         ((unsigned long) trailer[3] << 24)) ||
+            ((out - memberout) & 0xffffffffUL) != (trailer[4] |
+                    (trailer[5] << 8) | (trailer[6] << 16) |
+                                       ((unsigned long) trailer[7] << 24))) {
+            failed = 1;
+            break;
+        }
+        pos += 8;
+    }
+    inflateEnd(&strm);
+
+    if (failed) {
+        gz_free_points(*points, *npoints);
+        *points = NULL;
+        *npoints = 0;
+        return(1);
+    }
+    (*points)[*npoints - 1].crc = sectioncrc;
+    *filesize = out;
+    return(0);
+}
+/*--------------------------------------------------------------------------*/
+static int gz_section(gzjob *job, long ipoint, z_stream *strm,
+             unsigned char **inbuff, size_t *inbuffsize)
+/*
+  Inflates the section of the data from one restart point to the next.
+  The compressed data for the section - from the restart point to the next
+  one, plus the byte before it if the section starts part way through it -
+  is read into *inbuff, which is enlarged (and *inbuffsize updated) if
+  necessary. Returns non-zero if that doesn't give exactly the expected
+  output, as shown by its length and CRC.
+*/
+{
+    gzpoint *point = job->points + ipoint;
+    size_t pos = point->in, out = point->out, hdrlen;
+    size_t end = (ipoint + 1 < job->npoints) ?
+                                  job->points[ipoint + 1].out : job->totalout;
+    size_t first = (point->bits) ? point->in - 1 : point->in;
+    size_t last = (ipoint + 1 < job->npoints) ?
+                                  job->points[ipoint + 1].in : job->insize;
+    unsigned char *in;
+    int ret;
+
+    if (point->bits && point->in == 0) return(1);
+    if (last < first || last > job->insize) return(1);
+    if (last - first > *inbuffsize) {
+        unsigned char *newbuff = (unsigned char *) realloc(*inbuff,
+                                                              last - first);
+        if (!newbuff) return(1);
+        *inbuff = newbuff;
+        *inbuffsize = last - first;
+    }
+    if (gz_read_range(job->fd, first, last - first, *inbuff)) return(1);
+
+    /* in is where the whole of the compressed data would start, so that
+       in + pos addresses the data just read. It is only ever used with
+       positions between first and last. */
+    in = *inbuff - first;
+
+    inflateReset(strm);
+    if (point->bits) {
+        inflatePrime(strm, point->bits, in[pos - 1] >> (8 - point->bits));
+    }
+    if (point->wsize) {
+        if (inflateSetDictionary(strm, point->window, point->wsize) != Z_OK)
+            return(1);
+    }
+    while (out < end) {
+        strm->next_in = in + pos;
+        strm->avail_in = (last - pos > GZ_CHUNK) ?
+                                      GZ_CHUNK : (uInt) (last - pos);
+        strm->next_out = job->out + out;
+        strm->avail_out = (end - out > GZ_CHUNK) ?
+                                      GZ_CHUNK : (uInt) (end - out);
+        ret = inflate(strm, Z_NO_FLUSH);
+        pos = strm->next_in - in;
+        out = strm->next_out - job->out;
+        if (ret == Z_STREAM_END) {
+            if (out == end) break;
+
+            /* a new member starts within this section */
+            pos += 8;
+            if (pos > last ||
+                   gz_skip_header(in + pos, last - pos, &hdrlen))
+                return(1);
+            pos += hdrlen;
+            inflateReset(strm);
+        } else if (ret != Z_OK) {
+            return(1);
+        }
+    }
+    if (out != end) return(1);
+    return(gz_crc(job->out + point->out, end - point->out) != point->crc);
+}
+/*--------------------------------------------------------------------------*/
+static void *gz_worker(void *arg)
+/*
+  Each thread - including the calling thread - takes the next section that
+  hasn't yet been taken, until there are none left, or one has failed. Each
+  has its own buffer for the compressed data, reused for each section.
+*/
+{
+    gzjob *job = (gzjob *) arg;
+    z_stream strm;
+    unsigned char *inbuff = NULL;
+    size_t inbuffsize = 0;
+    long ipoint;
+    int failed;
+
+    memset(&strm, 0, sizeof(strm));
+    if (inflateInit2(&strm, -15) != Z_OK) {
+        pthread_mutex_lock(&job->lock);
+        job->failed = 1;
+        pthread_mutex_unlock(&job->lock);
+        return(NULL);
+    }
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        ipoint = job->next++;
+        failed = job->failed;
+        pthread_mutex_unlock(&job->lock);
+        if (failed || ipoint >= job->npoints) break;
+        if (gz_section(job, ipoint, &strm, &inbuff, &inbuffsize)) {
+            pthread_mutex_lock(&job->lock);
+            job->failed = 1;
+            pthread_mutex_unlock(&job->lock);
+        }
+    }
+    inflateEnd(&strm);
+    free(inbuff);
+    return(NULL);
+}
+/*--------------------------------------------------------------------------*/
+static int gz_parallel(int fd, size_t insize,
+             unsigned char *out, size_t totalout, gzpoint *points,
+             long npoints, int nthreads)
+/*
+  Inflates the data in the file into the output buffer, which must be big
+  enough, using the given number of threads and the restart points. Returns
+  non-zero if anything goes wrong.
+*/
+{
+    gzjob job;
+    pthread_t threads[GZ_MAXTHREADS];
+    int ithread, nstarted = 0;
+
+    job.fd = fd;
+    job.insize = insize;
+    job.out = out;
+    job.totalout = totalout;
+    job.points = points;
+    job.npoints = npoints;
+    job.next = 0;
+    job.failed = 0;
+    if (pthread_mutex_init(&job.lock, NULL)) return(1);
+
+    if (nthreads > npoints) nthreads = (int) npoints;
+    for (ithread = 1; ithread < nthreads; ithread++) {
+        if (pthread_create(&threads[nstarted], NULL, gz_worker, &job)) break;
+        nstarted++;
+    }
+    gz_worker(&job);
+    for (ithread = 0; ithread < nstarted; ithread++)
+        pthread_join(threads[ithread], NULL);
+
+    pthread_mutex_destroy(&job.lock);
+    return(job.failed);
+}
+/*--------------------------------------------------------------------------*/
+static int gz_read_index(char *indexname, size_t srcsize, long long srcmtime,
+             unsigned long samplecrc, size_t *totalout, gzpoint **points,
+             long *npoints)
+/*
+  Reads the index for a file, if there is one and it matches the file's
+  size, modification time and sample CRC. Returns non-zero if there isn't
+  a usable one.
+*/
+{
+    FILE *indexfile;
+    gzindexhdr header;
+    gzrecord record;
+    long ipoint;
+    int failed = 0;
+
+    *points = NULL;
+    *npoints = 0;
+    indexfile = fopen(indexname, "rb");
+    if (!indexfile) return(1);
+
+    if (fread(&header, sizeof(header), 1, indexfile) != 1 ||
+            memcmp(header.magic, GzIndexMagic, sizeof(header.magic)) ||
+            header.order != GZ_ORDER || header.srcsize != srcsize ||
+            header.srcmtime != srcmtime ||
+            header.samplecrc != (unsigned int) samplecrc || header.npoints < 1 ||
+            header.npoints > GZ_MAXPOINTS ||
+            header.totalout != (size_t) header.totalout) {
+        fclose(indexfile);
+        return(1);
+    }
+
+    /* the records are followed by the windows, in the same order */
+    *points = (gzpoint *) calloc(header.npoints, sizeof(gzpoint));
+    if (!*points) failed = 1;
+    for (ipoint = 0; ipoint < (long) header.npoints && !failed; ipoint++) {
+        if (fread(&record, sizeof(record), 1, indexfile) != 1 ||
+               record.in > srcsize || record.out > header.totalout ||
+               record.bits > 7 || record.wsize > GZ_WINSIZE ||
+               (ipoint == 0 && record.out != 0) ||
+               (ipoint > 0 && record.out <= (*points)[ipoint - 1].out)) {
+            failed = 1;
+            break;
+        }
+        (*points)[ipoint].in = (size_t) record.in;
+        (*points)[ipoint].out = (size_t) record.out;
+        (*points)[ipoint].bits = record.bits;
+        (*points)[ipoint].wsize = record.wsize;
+        (*points)[ipoint].crc = record.crc;
+        *npoints = ipoint + 1;
+    }
+    for (ipoint = 0; ipoint < *npoints && !failed; ipoint++) {
+        gzpoint *point = *points + ipoint;
+        if (point->wsize) {
+            point->window = (unsigned char *) malloc(point->wsize);
+            if (!point->window ||
+                   fread(point->window, point->wsize, 1, indexfile) != 1)
+                failed = 1;
+        }
+    }
+    fclose(indexfile);
+
+    if (failed) {
+        gz_free_points(*points, *npoints);
+        *points = NULL;
+        *npoints = 0;
+        return(1);
+    }
+    *totalout = (size_t) header.totalout;
+    return(0);
+}
+/*--------------------------------------------------------------------------*/
+static void gz_write_index(char *indexname, size_t srcsize,
+             long long srcmtime, unsigned long samplecrc, size_t totalout,
+             gzpoint *points, long npoints)
+/*
+  Writes the index for a file. It is written to a temporary file that is
+  then renamed, so that anything reading it at the same time never sees a
+  partial index. Any failure is ignored - the index is only ever a help.
+*/
+{
+    FILE *indexfile;
+    char *tempname;
+    gzindexhdr header;
+    gzrecord record;
+    long ipoint;
+    int failed = 0;
+
+    tempname = (char *) malloc(strlen(indexname) + 32);
+    if (!tempname) return;
+    sprintf(tempname, "%s.%ld", indexname, (long) getpid());
+    indexfile = fopen(tempname, "wb");
+    if (!indexfile) {
+        free(tempname);
+        return;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, GzIndexMagic, sizeof(header.magic));
+    header.order = GZ_ORDER;
+    header.srcsize = srcsize;
+    header.srcmtime = srcmtime;
+    header.samplecrc = (unsigned int) samplecrc;
+    header.totalout = totalout;
+    header.npoints = npoints;
+    if (fwrite(&header, sizeof(header), 1, indexfile) != 1) failed = 1;
+    for (ipoint = 0; ipoint < npoints && !failed; ipoint++) {
+        memset(&record, 0, sizeof(record));
+        record.in = points[ipoint].in;
+        record.out = points[ipoint].out;
+        record.bits = points[ipoint].bits;
+        record.wsize = points[ipoint].wsize;
+        record.crc = (unsigned int) points[ipoint].crc;
+        if (fwrite(&record, sizeof(record), 1, indexfile) != 1) failed = 1;
+    }
+    for (ipoint = 0; ipoint < npoints && !failed; ipoint++) {
+        if (points[ipoint].wsize && fwrite(points[ipoint].window,
+                          points[ipoint].wsize, 1, indexfile) != 1)
+            failed = 1;
+    }
+    if (fclose(indexfile)) failed = 1;
+
+    if (failed || rename(tempname, indexname)) remove(tempname);
+    free(tempname);
+}
+/*--------------------------------------------------------------------------*/
+int uncompress2mem_parallel(char *filename,  /* name of input file          */
+             FILE *diskfile,     /* I - file pointer                        */
+             char **buffptr,     /* IO - memory pointer                     */
+             size_t *buffsize,   /* IO - size of buffer, in bytes           */
+             void *(*mem_realloc)(void *p, size_t newsize), /* function     */
+             size_t *filesize)   /* O - size of file, in bytes              */
+/*
+  Uncompress a large gzip disk file into memory, using several threads if
+  there is an index of restart points for it, and writing one if there
+  isn't. Fill whatever amount of memory has already been allocated, and
+  realloc more memory, using the supplied function, if necessary. Returns
+  1 if the file was uncompressed, or 0 (with the file rewound) if it should
+  be uncompressed by uncompress2mem() instead.
+*/
+{
+    struct stat statbuf;
+    unsigned char magic[2];
+    unsigned char *inbuff = NULL;
+    char *indexname = NULL;
+    gzpoint *points = NULL;
+    long npoints = 0;
+    size_t insize, totalout = 0;
+    unsigned long samplecrc;
+    long long mtime;
+    int nthreads, sampled, done = 0;
+
+    nthreads = gz_threads();
+    if (nthreads < 2) return(0);
+
+    if (fstat(fileno(diskfile), &statbuf) || !S_ISREG(statbuf.st_mode) ||
+                                          statbuf.st_size < GZ_MINSIZE ||
+                   (unsigned long long) statbuf.st_size > (size_t) -1) {
+        return(0);
+    }
+    insize = (size_t) statbuf.st_size;
+    mtime = (long long) statbuf.st_mtime;
+
+    if (fseek(diskfile, 0, 0) || fread(magic, 1, 2, diskfile) != 2 ||
+                                        magic[0] != 0x1f || magic[1] != 0x8b) {
+        fseek(diskfile, 0, 0);
+        return(0);
+    }
+
+    indexname = (char *) malloc(strlen(filename) + 8);
+    if (indexname) {
+        strcpy(indexname, filename);
+        strcat(indexname, ".gzidx");
+        sampled = !gz_sample_crc(fileno(diskfile), insize, &samplecrc);
+
+        /* With a usable index, the threads read the compressed data they
+           need for themselves. */
+        if (sampled && !gz_read_index(indexname, insize, mtime, samplecrc,
+                                         &totalout, &points, &npoints)) {
+            if (*buffsize < totalout) {
+                char *newbuff = (char *) mem_realloc(*buffptr, totalout);
+                if (newbuff) {
+                    *buffptr = newbuff;
+                    *buffsize = totalout;
+                }
+            }
+            if (*buffsize >= totalout && !gz_parallel(fileno(diskfile),
+                   insize, (unsigned char *) *buffptr, totalout, points,
+                                                     npoints, nthreads)) {
+                *filesize = totalout;
+                done = 1;
+            }
+            gz_free_points(points, npoints);
+            points = NULL;
+            npoints = 0;
+        }
+
+        /* If there was no usable index, read all the compressed data into
+           memory and inflate it here and now, writing the index as we go. */
+        if (!done) inbuff = (unsigned char *) malloc(insize);
+        if (!done && inbuff && !fseek(diskfile, 0, 0) &&
+                   fread(inbuff, 1, insize, diskfile) == insize &&
+                   !gz_build(inbuff, insize, buffptr, buffsize,
+                                  mem_realloc, filesize, &points, &npoints)) {
+            if (npoints > 1 && sampled)
+                gz_write_index(indexname, insize, mtime, samplecrc,
+                                             *filesize, points, npoints);
+            gz_free_points(points, npoints);
+            done = 1;
+        }
+    }
+    free(inbuff);
+    free(indexname);
+
+    if (!done) fseek(diskfile, 0, 0);
+    return(done);
+}
+
+#endif
@@ -0,0 +1,92 @@
+import gzip
+import math
+import struct
+
+# Input files for the tests of the hectorconfig module and HectorConfigUtil.
+
+
+def fits_header(cards):
+    header = "".join(("%-8s= %20s" % card).ljust(80) for card in cards) + "END".ljust(80)
+    return (header + " " * (-len(header) % 2880)).encode()
+
+
+def fits_padded(data):
+    return bytes(data) + bytes(-len(data) % 2880)
+
+
+def write_mask(directory, centre_ra, centre_dec, n, step, *contaminated, compression=None, tile=64,
+               level=9):
+    """Writes an n by n pixel Profit mask file, with square pixels of the given
+    size (deg) centred on the given Ra,Dec, with the pixels in each of the given
+    (xmin, xmax, ymin, ymax) ranges flagged as contaminated. The file is a plain
+    FITS file, or if compression is "gz" one gzipped at the given level, or if
+    it is "tiled" a tile-compressed one (GZIP_1, with tiles of the given size).
+    Returns its path."""
+    width = n * step
+    path = directory / ("m_%.1f_%.1f_%.2f_%.2f.fits" % (centre_ra, centre_dec, width, width))
+    wcs = [("CTYPE1", "'RA---TAN'"), ("CTYPE2", "'DEC--TAN'"),
+           ("CRPIX1", repr(n / 2 + 0.5)), ("CRPIX2", repr(n / 2 + 0.5)),
+           ("CRVAL1", repr(centre_ra)), ("CRVAL2", repr(centre_dec)),
+           ("CDELT1", repr(-step)), ("CDELT2", repr(step))]
+    data = bytearray(n * n * 4)
+    for xmin, xmax, ymin, ymax in contaminated:
+        for y in range(ymin, ymax):
+            for x in range(xmin, xmax):
+                struct.pack_into(">i", data, (y * n + x) * 4, 1)
+    if compression == "tiled":
+        path = path.with_name(path.name + ".fz")
+        path.write_bytes(tile_compressed(data, n, tile, wcs))
+        return path
+    contents = fits_header([("SIMPLE", "T"), ("BITPIX", "32"), ("NAXIS", "2"), ("NAXIS1", str(n)),
+                            ("NAXIS2", str(n))] + wcs) + fits_padded(data)
+    if compression == "gz":
+        path = path.with_name(path.name + ".gz")
+        contents = gzip.compress(contents, compresslevel=level, mtime=0)
+    path.write_bytes(contents)
+    return path
+
+
+def tile_compressed(data, n, tile, wcs):
+    """The contents of a tile-compressed FITS file holding an n by n image of
+    32 bit pixels, given as big-endian bytes, each tile compressed using
+    GZIP_1 - which works on the big-endian bytes - as cfitsio does."""
+    tiles = []
+    for y0 in range(0, n, tile):
+        for x0 in range(0, n, tile):
+            rows = [data[(y * n + x0) * 4:(y * n + min(x0 + tile, n)) * 4]
+                    for y in range(y0, min(y0 + tile, n))]
+            tiles.append(gzip.compress(b"".join(rows), mtime=0))
+    table = b"".join(struct.pack(">ii", len(compressed), sum(len(t) for t in tiles[:i]))
+                     for i, compressed in enumerate(tiles))
+    heap = b"".join(tiles)
+    primary = fits_header([("SIMPLE", "T"), ("BITPIX", "8"), ("NAXIS", "0"), ("EXTEND", "T")])
+    extension = fits_header([("XTENSION", "'BINTABLE'"), ("BITPIX", "8"), ("NAXIS", "2"),
+                             ("NAXIS1", "8"), ("NAXIS2", str(len(tiles))), ("PCOUNT", str(len(heap))),
+                             ("GCOUNT", "1"), ("TFIELDS", "1"), ("TTYPE1", "'COMPRESSED_DATA'"),
+                             ("TFORM1", "'1PB(%d)'" % max(len(t) for t in tiles)),
+                             ("ZIMAGE", "T"), ("ZBITPIX", "32"), ("ZNAXIS", "2"),
+                             ("ZNAXIS1", str(n)), ("ZNAXIS2", str(n)), ("ZTILE1", str(tile)),
+                             ("ZTILE2", str(tile)), ("ZCMPTYPE", "'GZIP_1'")] + wcs)
+    return primary + extension + fits_padded(table + heap)
+
+
+def mask_pixel_radec(centre_ra, centre_dec, n, step, x, y):
+    """The Ra,Dec (deg) of the centre of pixel [x,y] (from zero) of a mask file
+    written by write_mask(), using the gnomonic (TAN) projection."""
+    xi = math.radians(-step * (x + 1 - (n / 2 + 0.5)))
+    eta = math.radians(step * (y + 1 - (n / 2 + 0.5)))
+    dec0 = math.radians(centre_dec)
+    denom = math.cos(dec0) - eta * math.sin(dec0)
+    ra = centre_ra + math.degrees(math.atan2(xi, denom))
+    dec = math.degrees(math.atan2(math.sin(dec0) + eta * math.cos(dec0), math.hypot(xi, denom)))
+    return ra, dec
+
+
+def write_targets(path, centre_ra, centre_dec, positions):
+    """Writes a target (galaxy or guide star) file for HectorConfigUtil, for a
+    field with the given centre, listing the given (ra, dec) positions."""
+    lines = ["# Hector target file", "# %.6f %.6f" % (centre_ra, centre_dec), "# test",
+             "ID,RA,DEC,pmRA,pmDEC,mag"]
+    for number, (ra, dec) in enumerate(positions, 1):
+        lines.append("%d,%.6f,%.6f,0.0,0.0,15.00" % (number, ra, dec))
+    path.write_text("\n".join(lines) + "\n")
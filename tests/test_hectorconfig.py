@@ -0,0 +1,144 @@
+import sys
+import math
+import array
+import warnings
+from pathlib import Path
+
+import pytest
+
+from tests.hector_files import write_mask
+
+# The hectorconfig extension module is built in the HectorConfigUtility directory
+# by 'make python'. These tests are skipped if it hasn't been built.
+
+HTS_DIR = Path(__file__).resolve().parent.parent / "hop" / "distortion_correction" / "HectorTranslationSoftware"
+sys.path.insert(0, str(HTS_DIR / "HectorConfigUtility"))
+hectorconfig = pytest.importorskip("hectorconfig")
+
+DATA_DIR = HTS_DIR / "DataFiles"
+
+# Largest acceptable round trip error, in milli-arcseconds.
+MAX_ROUND_TRIP_MAS = 0.2
+
+
+def doubles(values):
+    return array.array('d', values)
+
+
+def make_session(**kwargs):
+    with warnings.catch_warnings():
+        warnings.simplefilter("ignore")
+        return hectorconfig.Session(distortion=str(DATA_DIR / "HectorDistortion.sds"),
+                                    linearity=str(DATA_DIR / "HectorLinear.sds"), **kwargs)
+
+
+def set_field(session, ra, dec, time="2022 02 28 14 00 00"):
+    with warnings.catch_warnings():
+        warnings.simplefilter("ignore")
+        return session.set_field(ra, dec, time, 10, 12)
+
+
+def field_grid(centre_ra, centre_dec, radius=1.1, n=41):
+    """Ra,Dec positions on a grid covering a circle of the given radius (deg)."""
+    ra = []
+    dec = []
+    for i in range(n):
+        for j in range(n):
+            dx = -radius + 2.0 * radius * i / (n - 1)
+            dy = -radius + 2.0 * radius * j / (n - 1)
+            if dx * dx + dy * dy <= radius * radius:
+                dec.append(centre_dec + dy)
+                ra.append(centre_ra + dx / math.cos(math.radians(centre_dec + dy)))
+    return doubles(ra), doubles(dec)
+
+
+# The mechanical offsets are applied to target positions but aren't removed by
+# xy_to_radec(), so they're turned off to test the round trip.
+
+@pytest.mark.parametrize("tele", [True, False])
+def test_round_trip_accuracy(tele):
+
+    session = make_session(mech=False, tele=tele)
+    set_field(session, 180.0, -30.0)
+
+    ra, dec = field_grid(180.0, -30.0)
+    n = len(ra)
+    x, y = doubles([0.0] * n), doubles([0.0] * n)
+    ra_back, dec_back = doubles([0.0] * n), doubles([0.0] * n)
+    with warnings.catch_warnings():
+        warnings.simplefilter("ignore")
+        session.radec_to_xy(ra, dec, x, y)
+        session.xy_to_radec(x, y, ra_back, dec_back)
+
+    worst = 0.0
+    converted = 0
+    for i in range(n):
+        if math.isnan(ra_back[i]):
+            continue
+        converted += 1
+        dra = (ra_back[i] - ra[i]) * math.cos(math.radians(dec[i]))
+        ddec = dec_back[i] - dec[i]
+        worst = max(worst, math.hypot(dra, ddec) * 3.6e6)
+    assert converted > 0.99 * n
+    assert worst < MAX_ROUND_TRIP_MAS
+
+
+def test_no_field():
+    session = make_session()
+    with pytest.raises(RuntimeError, match="No field"):
+        session.radec_to_xy(doubles([180.0]), doubles([-30.0]), doubles([0.0]), doubles([0.0]))
+
+
+def test_meridian_time_is_a_warning(capfd):
+    session = make_session()
+    with pytest.warns(UserWarning, match="UT set to .* to put field on meridian"):
+        session.set_field(180.0, -30.0)
+    assert "UT set to" not in capfd.readouterr().out
+
+
+def test_size_errors():
+    session = make_session()
+    set_field(session, 180.0, -30.0)
+    three = doubles([0.0] * 3)
+    with pytest.raises(ValueError, match="'dec' has 1 values, should have 3"):
+        session.radec_to_xy(doubles([180.0] * 3), doubles([-30.0]), three, doubles([0.0] * 3))
+    with pytest.raises(ValueError, match="'pmra' has 2 values, should have 3"):
+        session.radec_to_xy(doubles([180.0] * 3), doubles([-30.0] * 3), three,
+                            doubles([0.0] * 3), pmra=doubles([0.0] * 2))
+    with pytest.raises(ValueError, match="'ra' has 3 values, should have 2"):
+        session.xy_to_radec(doubles([0.0] * 2), doubles([0.0] * 2), three, doubles([0.0] * 2))
+
+
+def test_format_errors():
+    session = make_session()
+    set_field(session, 180.0, -30.0)
+    with pytest.raises(TypeError, match="'ra' should be an array of doubles"):
+        session.radec_to_xy(array.array('f', [180.0]), doubles([-30.0]), doubles([0.0]), doubles([0.0]))
+    with pytest.raises(TypeError, match="'x' should be a contiguous, writable array"):
+        session.radec_to_xy(doubles([180.0]), doubles([-30.0]), bytes(8), doubles([0.0]))
+    with pytest.raises(ValueError, match="'clearance' can't be negative"):
+        session.check_sky(doubles([180.0]), doubles([-30.0]), doubles([0.0]), clearance=-1.0)
+
+
+def test_check_sky_nan(tmp_path):
+
+    # A mask 0.2 deg across, with its eastern half - the side with the larger Ra,
+    # since Ra increases to the left - contaminated.
+
+    write_mask(tmp_path, 180.0, 10.0, 360, 1.0 / 1800.0, (0, 180, 0, 360))
+    session = make_session(profitdir=str(tmp_path))
+    set_field(session, 180.0, 10.0)
+
+    ra = doubles([180.05, 179.95, 185.0, math.nan, 180.0])
+    dec = doubles([10.0, 10.0, 10.0, 10.0, math.inf])
+    clear = doubles([-1.0] * len(ra))
+    with pytest.warns(UserWarning) as record:
+        checked = session.check_sky(ra, dec, clear)
+    assert checked == 2
+    assert clear[0] == 0.0
+    assert clear[1] == 1.0
+    assert all(math.isnan(value) for value in clear[2:])
+    messages = [str(warning.message) for warning in record]
+    assert any("Position 2 not checked: No mask found" in message for message in messages)
+    assert any("Position 3 not checked: Ra,Dec is not a number" in message for message in messages)
+    assert any("Position 4 not checked: Ra,Dec is not a number" in message for message in messages)
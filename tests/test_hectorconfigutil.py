@@ -0,0 +1,285 @@
+import os
+import json
+import math
+import subprocess
+from pathlib import Path
+
+import pytest
+
+from tests.hector_files import write_mask, write_targets
+
+# These run the HectorConfigUtil program built in the HectorConfigUtility
+# directory by 'make HectorConfigUtil', or the one named by $HECTORCONFIGUTIL,
+# and are skipped if it can't be run here.
+
+HTS_DIR = Path(__file__).resolve().parent.parent / "hop" / "distortion_correction" / "HectorTranslationSoftware"
+PROGRAM = Path(os.environ.get("HECTORCONFIGUTIL", HTS_DIR / "HectorConfigUtility" / "HectorConfigUtil"))
+DATA_DIR = HTS_DIR / "DataFiles"
+
+
+def runnable(program):
+    try:
+        subprocess.run([str(program)], capture_output=True, timeout=60)
+    except OSError:
+        return False
+    return True
+
+
+pytestmark = pytest.mark.skipif(not runnable(PROGRAM), reason="HectorConfigUtil can't be run here")
+
+CENTRE_RA = 180.3
+CENTRE_DEC = 10.2
+TIME = "2022 02 28 14 00 00"
+
+
+def ring(centre_ra, centre_dec, radius, n, phase=0.0):
+    """n positions evenly spaced round a circle of the given radius (deg)."""
+    positions = []
+    for i in range(n):
+        angle = phase + 2.0 * math.pi * i / n
+        dec = centre_dec + radius * math.sin(angle)
+        positions.append((centre_ra + radius * math.cos(angle) / math.cos(math.radians(dec)), dec))
+    return positions
+
+
+@pytest.fixture
+def field(tmp_path):
+    """A field with its galaxy and guide files and an uncontaminated mask that
+    covers it, returned as the arguments for HectorConfigUtil that follow the
+    output file name, with the date and time and temperatures left out."""
+    masks = tmp_path / "masks"
+    masks.mkdir()
+    write_mask(masks, CENTRE_RA, CENTRE_DEC, 500, 0.005, (0, 0, 0, 0))
+    galaxies = tmp_path / "gal.csv"
+    guides = tmp_path / "guide.csv"
+    write_targets(galaxies, CENTRE_RA, CENTRE_DEC,
+                  ring(CENTRE_RA, CENTRE_DEC, 0.3, 7) + ring(CENTRE_RA, CENTRE_DEC, 0.8, 11, 0.2))
+    write_targets(guides, CENTRE_RA, CENTRE_DEC, ring(CENTRE_RA, CENTRE_DEC, 0.6, 5, 0.1))
+    return {"galaxies": galaxies, "guides": guides,
+            "settings": ["2dFDistortion=" + str(DATA_DIR / "HectorDistortion.sds"),
+                         "2dFLinearity=" + str(DATA_DIR / "HectorLinear.sds"),
+                         "SkyFibres=" + str(DATA_DIR / "SkyFibres.csv"),
+                         "ProfitDir=" + str(masks)]}
+
+
+def run(field, output, time=TIME, robot_temp=10, obs_temp=12, options=(), label="lab1"):
+    return subprocess.run([str(PROGRAM), str(field["galaxies"]), str(field["guides"]), str(output),
+                           label, "P1", time, str(robot_temp), str(obs_temp)]
+                          + field["settings"] + list(options),
+                          capture_output=True, text=True, timeout=300)
+
+
+def magnet_positions(path):
+    """The MagnetX,MagnetY values for the targets in a HectorConfigUtil output
+    file, in order. These are the last two values for both the galaxies and the
+    guide stars, and the sky fibre lines that follow them are ignored."""
+    positions = []
+    lines = [line for line in path.read_text().splitlines() if not line.startswith("#")]
+    for line in lines[1:]:
+        items = line.split(",")
+        if items[0].startswith("Sky"):
+            break
+        positions.append((float(items[-2]), float(items[-1])))
+    return positions
+
+
+def sweep_positions(path):
+    """The MagnetX,MagnetY values in a sweep output file, keyed by epoch number,
+    with the date and time and temperatures listed for each epoch."""
+    epochs = {}
+    columns = None
+    for line in path.read_text().splitlines():
+        if line.startswith("#"):
+            continue
+        items = line.split(",")
+        if columns is None:
+            columns = items
+            continue
+        epoch = int(items[columns.index("Epoch")])
+        details = (items[columns.index("UTDATE")] + " " + items[columns.index("UTTIME")],
+                   float(items[columns.index("ROBOT_TEMP")]), float(items[columns.index("OBS_TEMP")]))
+        entry = epochs.setdefault(epoch, (details, []))
+        assert int(items[columns.index("Target")]) == len(entry[1]) + 1
+        entry[1].append((float(items[columns.index("MagnetX")]), float(items[columns.index("MagnetY")])))
+    return epochs
+
+
+def test_sweep_matches_single_runs(field, tmp_path):
+
+    # A range of three epochs at the command line temperatures, and a single
+    # epoch at other temperatures. Each should give the positions a separate
+    # run at that time and those temperatures would give.
+
+    spec = "2022 02 28 13 00 00 to 2022 02 28 14 00 00 step 30; 2022 02 28 15 30 00 at 5 7"
+    result = run(field, tmp_path / "sweep.csv", options=["-sweep", spec])
+    assert result.returncode == 0, result.stderr
+    epochs = sweep_positions(tmp_path / "sweep.csv")
+    expected = [("2022 02 28 13 00 00", 10, 12), ("2022 02 28 13 30 00", 10, 12),
+                ("2022 02 28 14 00 00", 10, 12), ("2022 02 28 15 30 00", 5, 7)]
+    assert sorted(epochs) == list(range(1, len(expected) + 1))
+    for epoch, (time, robot_temp, obs_temp) in enumerate(expected, 1):
+        (when, sweep_robot_temp, sweep_obs_temp), positions = epochs[epoch]
+        assert when.split()[:3] == time.split()[:3]
+        assert sweep_robot_temp == pytest.approx(robot_temp + 273.15, abs=1e-4)
+        assert sweep_obs_temp == pytest.approx(obs_temp + 273.15, abs=1e-4)
+        single = tmp_path / ("single_%d.csv" % epoch)
+        result = run(field, single, time=time, robot_temp=robot_temp, obs_temp=obs_temp)
+        assert result.returncode == 0, result.stderr
+        assert len(positions) == 23
+        assert positions == magnet_positions(single)
+
+
+@pytest.mark.parametrize("spec, message", [
+    ("2022 02 28 14 00 00 at", "Need robot and observing temperatures after 'at'"),
+    ("2022 02 28 14 00 00 at 5", "Need robot and observing temperatures"),
+    ("2022 02 28 14 00 00 at 5 x", ""),
+    ("2022 02 28 14 00 00 at 5 7 at 6 8", "'at' given twice"),
+    ("2022 02 28 14 00 00; at 5 7", "No start time given"),
+    ("2022 02 28 14 00 00 to", "Need an end time after 'to'"),
+    ("2022 02 28 14 00 00 to 2022 02 28 15 00 00 step", "Need a step in minutes after 'step'"),
+])
+def test_sweep_errors(field, tmp_path, spec, message):
+
+    # None of these should quietly use the command line temperatures or drop
+    # an epoch - the whole sweep should fail.
+
+    output = tmp_path / "sweep.csv"
+    result = run(field, output, options=["-sweep", spec])
+    assert result.returncode != 0
+    assert "Sweep epochs: " + message in result.stderr
+    assert not output.exists()
+
+
+def test_manifest_matches_single_runs(field, tmp_path):
+
+    # Two tiles for the field at different times and temperatures, with a
+    # third between them that fails because its galaxy file doesn't exist,
+    # processed two at a time. The failure shouldn't stop the others, whose
+    # output files should be just as separate runs would write them. Each is
+    # reported in the order of the manifest, with its output file name (other
+    # lines are messages about the mask). The temporary mask cache should be
+    # gone at the end.
+
+    tiles = [("2022 02 28 13 00 00", 10, 12), None, ("2022 02 28 15 30 00", 5, 7)]
+    lines = ["# Test manifest", ""]
+    for number, tile in enumerate(tiles, 1):
+        galaxies = field["galaxies"] if tile else tmp_path / "missing.csv"
+        time, robot_temp, obs_temp = tile or (TIME, 10, 12)
+        output = tmp_path / ("tile_%d.csv" % number)
+        lines.append('%s,%s,"%s",lab%d,P1,%s,%d,%d' % (galaxies, field["guides"], output, number,
+                                                       time, robot_temp, obs_temp))
+    manifest = tmp_path / "manifest.txt"
+    manifest.write_text("\n".join(lines) + "\n")
+    temp = tmp_path / "tmp"
+    temp.mkdir()
+    result = subprocess.run([str(PROGRAM), "-manifest", str(manifest), "-workers", "2", "-tempcache"]
+                            + field["settings"], capture_output=True, text=True, timeout=300,
+                            env=dict(os.environ, TMPDIR=str(temp)))
+    assert result.returncode != 0
+    reports = [line for line in result.stdout.splitlines() if line.startswith(("Tile ", "All OK"))]
+    assert reports == ["Tile 1 (line 3): %s" % (tmp_path / "tile_1.csv"), "All OK",
+                                          "Tile 2 (line 4): %s" % (tmp_path / "tile_2.csv"),
+                                          "Tile 3 (line 5): %s" % (tmp_path / "tile_3.csv"), "All OK"]
+    assert "** Error **" in result.stderr and "missing.csv" in result.stderr
+    assert not (tmp_path / "tile_2.csv").exists()
+    assert not any(temp.iterdir())
+    for number, tile in enumerate(tiles, 1):
+        if tile:
+            time, robot_temp, obs_temp = tile
+            single = tmp_path / ("single_%d.csv" % number)
+            result = run(field, single, time=time, robot_temp=robot_temp, obs_temp=obs_temp,
+                         label="lab%d" % number)
+            assert result.returncode == 0, result.stderr
+            assert (tmp_path / ("tile_%d.csv" % number)).read_text() == single.read_text()
+
+
+def test_service_transcript(field):
+
+    # Requests read from standard input, one JSON object per line, with the
+    # responses written one per line to standard output. The mechanical offsets
+    # aren't removed by xy2radec, so they're turned off to test the round trip.
+    # A position too far from the zenith can't be converted, and is given as
+    # null, with a warning. A line that isn't valid JSON, or a request with
+    # the wrong number of values, gets an error response, and the service
+    # carries on.
+
+    ra = [CENTRE_RA + 0.05, CENTRE_RA - 0.2, CENTRE_RA + 0.6, CENTRE_RA]
+    dec = [CENTRE_DEC + 0.05, CENTRE_DEC - 0.4, CENTRE_DEC + 0.2, 60.0]
+    requests = [{"id": 1, "cmd": "open", "session": "A", "centre": [CENTRE_RA, CENTRE_DEC],
+                 "time": "2022 02 28 15 30 00"},
+                {"id": 2, "cmd": "radec2xy", "session": "A", "ra": ra, "dec": dec}]
+    service = subprocess.Popen([str(PROGRAM), "-serve", "-", "-nomech"] + field["settings"],
+                               stdin=subprocess.PIPE, stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                               text=True)
+
+    def request(line):
+        service.stdin.write(line + "\n")
+        service.stdin.flush()
+        return json.loads(service.stdout.readline())
+
+    try:
+        responses = [request(json.dumps(item)) for item in requests]
+        assert [response["id"] for response in responses] == [1, 2]
+        assert responses[0]["ok"] and not responses[0]["reused"]
+        converted = responses[1]
+        assert converted["ok"]
+        assert converted["x"][3] is None and converted["y"][3] is None
+        assert any("ZD greater than 70 degrees" in warning for warning in converted["warnings"])
+        back = request(json.dumps({"id": 3, "cmd": "xy2radec", "session": "A",
+                                   "x": converted["x"][:3], "y": converted["y"][:3]}))
+        assert back["ok"] and "warnings" not in back
+        assert back["ra"] == pytest.approx(ra[:3], abs=1e-9)
+        assert back["dec"] == pytest.approx(dec[:3], abs=1e-9)
+        single = request(json.dumps({"id": 4, "cmd": "radec2xy", "session": "A", "ra": ra[0], "dec": dec[0]}))
+        assert (single["x"], single["y"]) == (converted["x"][0], converted["y"][0])
+
+        malformed = request('{"id":5,"cmd":')
+        assert not malformed["ok"] and malformed["error"]
+        mismatch = request(json.dumps({"id": 6, "cmd": "radec2xy", "session": "A", "ra": ra, "dec": dec[:2]}))
+        assert mismatch["id"] == 6 and not mismatch["ok"]
+        assert "should all have the same number of values" in mismatch["error"]
+        mismatch = request(json.dumps({"id": 7, "cmd": "xy2radec", "session": "A", "x": [0.0], "y": []}))
+        assert not mismatch["ok"] and "should have the same number of values" in mismatch["error"]
+
+        assert request(json.dumps({"id": 8, "cmd": "close", "session": "A"}))["ok"]
+        closed = request(json.dumps({"id": 9, "cmd": "radec2xy", "session": "A", "ra": ra[0], "dec": dec[0]}))
+        assert not closed["ok"]
+        assert request(json.dumps({"id": 10, "cmd": "quit"}))["ok"]
+        service.stdin.close()
+        assert service.wait(timeout=60) == 0
+    finally:
+        if service.poll() is None:
+            service.kill()
+        service.wait()
+        service.stdout.close()
+        service.stderr.close()
+
+
+def test_meridian_time(field, tmp_path):
+
+    # With no observing time, the program picks one that puts the field on the
+    # meridian, and says so on standard output. That isn't a warning, so the
+    # run is still "All OK". The service reports it as a warning instead. (The
+    # time picked isn't exactly when the field is on the meridian, so this uses
+    # a field further south, and doesn't check the sky.)
+
+    south = dict(field, galaxies=tmp_path / "south_gal.csv", guides=tmp_path / "south_guide.csv")
+    write_targets(south["galaxies"], CENTRE_RA, -30.0, ring(CENTRE_RA, -30.0, 0.3, 7))
+    write_targets(south["guides"], CENTRE_RA, -30.0, ring(CENTRE_RA, -30.0, 0.6, 5, 0.1))
+    result = run(south, tmp_path / "out.csv", time="", options=["-nosky"])
+    assert result.returncode == 0
+    assert "* Warning *" not in result.stderr and "UT set to" not in result.stderr
+    lines = result.stdout.splitlines()
+    assert any(line.startswith("UT set to") and line.endswith("to put field on meridian") for line in lines)
+    assert lines[-1] == "All OK"
+
+    requests = [{"id": 1, "cmd": "open", "session": "A", "centre": [CENTRE_RA, -30.0]},
+                {"id": 2, "cmd": "quit"}]
+    result = subprocess.run([str(PROGRAM), "-serve", "-"] + field["settings"],
+                            input="".join(json.dumps(item) + "\n" for item in requests),
+                            capture_output=True, text=True, timeout=300)
+    assert result.returncode == 0
+    opened = json.loads(result.stdout.splitlines()[0])
+    assert opened["ok"]
+    assert any("to put field on meridian" in warning for warning in opened["warnings"])
+    assert "UT set to" not in result.stderr
@@ -0,0 +1,310 @@
+import os
+import sys
+import math
+import array
+import warnings
+from pathlib import Path
+
+import pytest
+
+from tests.hector_files import write_mask, mask_pixel_radec
+
+# Tests of the Profit mask sky checks (ProfitSkyCheck), made through the
+# hectorconfig extension module built in the HectorConfigUtility directory by
+# 'make python'. These are skipped if it hasn't been built. The different ways
+# of reading the masks and checking positions should all give the same results
+# as the simplest ones.
+
+HTS_DIR = Path(__file__).resolve().parent.parent / "hop" / "distortion_correction" / "HectorTranslationSoftware"
+sys.path.insert(0, str(HTS_DIR / "HectorConfigUtility"))
+hectorconfig = pytest.importorskip("hectorconfig")
+
+DATA_DIR = HTS_DIR / "DataFiles"
+
+# The mask used by most of the tests: 360 pixels of 2 arcsec square, so 0.2 deg
+# across, with several contaminated areas of different sizes - including single
+# pixels and one at the edge of the mask.
+
+CENTRE_RA = 180.0
+CENTRE_DEC = 10.0
+N = 360
+STEP = 1.0 / 1800.0
+CONTAMINATED = [(40, 60, 50, 80), (200, 203, 100, 103), (300, 301, 300, 301),
+                (100, 180, 250, 260), (150, 151, 40, 41), (0, 3, 170, 190)]
+
+
+def doubles(values):
+    return array.array('d', values)
+
+
+def make_session(profitdir, **kwargs):
+    with warnings.catch_warnings():
+        warnings.simplefilter("ignore")
+        session = hectorconfig.Session(distortion=str(DATA_DIR / "HectorDistortion.sds"),
+                                       linearity=str(DATA_DIR / "HectorLinear.sds"),
+                                       profitdir=str(profitdir), **kwargs)
+        session.set_field(CENTRE_RA, CENTRE_DEC, "2022 02 28 14 00 00", 10, 12)
+    return session
+
+
+def sample_positions():
+    """Positions spread over the mask, including some close to each of the
+    contaminated areas, and a few off the edges of the mask, not covered by it."""
+    ra = []
+    dec = []
+    for y in range(-6, N + 6, 9):
+        for x in range(-6, N + 6, 11):
+            position = mask_pixel_radec(CENTRE_RA, CENTRE_DEC, N, STEP, x + 0.3, y - 0.2)
+            ra.append(position[0])
+            dec.append(position[1])
+    for xmin, xmax, ymin, ymax in CONTAMINATED:
+        for dx, dy in [(-3, 0), (0, -4), (2, 1), (6, 0), (0, 9)]:
+            position = mask_pixel_radec(CENTRE_RA, CENTRE_DEC, N, STEP,
+                                        (xmax if dx > 0 else xmin) + dx, (ymax if dy > 0 else ymin) + dy)
+            ra.append(position[0])
+            dec.append(position[1])
+    return doubles(ra), doubles(dec)
+
+
+def check_sky(session, ra, dec, clearance):
+    """Checks the positions, returning the results and the warnings about
+    positions that couldn't be checked."""
+    clear = doubles([-1.0] * len(ra))
+    with warnings.catch_warnings(record=True) as record:
+        warnings.simplefilter("always")
+        session.check_sky(ra, dec, clear, clearance=clearance)
+    messages = sorted(str(warning.message) for warning in record)
+    return [("nan" if math.isnan(value) else value) for value in clear], messages
+
+
+@pytest.fixture(scope="module")
+def masks(tmp_path_factory):
+    """Directories holding the test mask as a plain, a gzipped and a tile-compressed
+    file, keyed by the compression."""
+    directories = {}
+    for compression in [None, "gz", "tiled"]:
+        directory = tmp_path_factory.mktemp(str(compression))
+        write_mask(directory, CENTRE_RA, CENTRE_DEC, N, STEP, *CONTAMINATED, compression=compression)
+        directories[compression] = directory
+    return directories
+
+
+@pytest.mark.parametrize("compression", ["gz", "tiled"])
+@pytest.mark.parametrize("clearance", [1.0, 6.0, 15.0])
+def test_compressed_masks(masks, compression, clearance):
+    ra, dec = sample_positions()
+    expected = check_sky(make_session(masks[None]), ra, dec, clearance)
+    assert check_sky(make_session(masks[compression]), ra, dec, clearance) == expected
+
+
+@pytest.mark.parametrize("compression", [None, "gz", "tiled"])
+def test_mask_cache(masks, compression, tmp_path):
+
+    # The first session writes the cache file for the mask, and the second
+    # uses it, memory mapped, rather than the mask file.
+
+    ra, dec = sample_positions()
+    expected = check_sky(make_session(masks[None]), ra, dec, 6.0)
+    assert check_sky(make_session(masks[compression], profitcache=str(tmp_path)), ra, dec, 6.0) == expected
+    assert any(tmp_path.iterdir())
+    assert check_sky(make_session(masks[compression], profitcache=str(tmp_path)), ra, dec, 6.0) == expected
+
+
+@pytest.mark.parametrize("clearance", [1.0, 6.0, 15.0, 40.0])
+def test_count_tables_match_brute_force(masks, clearance):
+
+    # With the SkyCheckDist debug level, each pixel round each position is
+    # looked at in turn. The debug output itself isn't needed.
+
+    ra, dec = sample_positions()
+    brute_force = check_sky(make_session(masks[None], debug="SkyCheckDist", threads=1), ra, dec, clearance)
+    results = check_sky(make_session(masks[None], counttable=True), ra, dec, clearance)
+    assert results == brute_force
+    assert 0.0 in results[0] and 1.0 in results[0]
+
+
+@pytest.mark.parametrize("compression", [None, "tiled"])
+@pytest.mark.parametrize("clearance", [1.0, 6.0, 15.0])
+def test_batch_matches_single_checks(masks, compression, clearance):
+
+    # With the SkyCheck debug level, check_sky() checks each position in turn
+    # using CheckUseForSky(), rather than all at once. The positions not covered
+    # by the mask should be reported in the same way.
+
+    ra, dec = sample_positions()
+    single = check_sky(make_session(masks[compression], debug="SkyCheck", threads=1), ra, dec, clearance)
+    batch = check_sky(make_session(masks[compression], threads=4), ra, dec, clearance)
+    assert batch == single
+    assert "nan" in batch[0]
+    assert any("No mask found that covers the coordinates" in message for message in batch[1])
+
+
+def test_overlapping_masks(tmp_path):
+
+    # Two overlapping masks, one showing contamination the other doesn't. Any
+    # mask showing a position clear is enough for it to be clear.
+
+    write_mask(tmp_path, CENTRE_RA, CENTRE_DEC, N, STEP, *CONTAMINATED)
+    write_mask(tmp_path, CENTRE_RA + 0.1, CENTRE_DEC, N, STEP, (0, 60, 0, N))
+    ra, dec = sample_positions()
+    single = check_sky(make_session(tmp_path, debug="SkyCheck", threads=1), ra, dec, 6.0)
+    assert check_sky(make_session(tmp_path, threads=4), ra, dec, 6.0) == single
+    assert check_sky(make_session(tmp_path, counttable=True), ra, dec, 6.0) == single
+
+
+def test_clear_maps_match_brute_force(masks):
+
+    # The clear radius is the distance from the centre of the pixel containing
+    # the position to the centre of the nearest contaminated pixel, rounded down
+    # to 0.1 arcsec, and no more than 25.5 arcsec. The size of a pixel in Ra is
+    # worked out for the row the position is in, from the change in Ra from one
+    # pixel to the next at the centre of the mask. Allow for rounding the other
+    # way.
+
+    session = make_session(masks[None], clearmap=True)
+    positions = [(x, y) for y in range(0, N, 7) for x in range(0, N, 5)]
+    ra = doubles([])
+    dec = doubles([])
+    for x, y in positions:
+        position = mask_pixel_radec(CENTRE_RA, CENTRE_DEC, N, STEP, x, y)
+        ra.append(position[0])
+        dec.append(position[1])
+    radius = doubles([-1.0] * len(ra))
+    assert session.clear_radius(ra, dec, radius) == len(ra)
+    scale_y = STEP * 3600.0
+    for (x, y), found in zip(positions, radius):
+        row_dec = CENTRE_DEC + (y + 1 - (N + 1) * 0.5) * STEP
+        scale_x = scale_y * math.cos(math.radians(row_dec)) / math.cos(math.radians(CENTRE_DEC))
+        distance = min(math.hypot(max(xmin - x, 0, x - (xmax - 1)) * scale_x,
+                                  max(ymin - y, 0, y - (ymax - 1)) * scale_y)
+                       for xmin, xmax, ymin, ymax in CONTAMINATED)
+        expected = min(int(distance / 0.1), 255) * 0.1
+        assert abs(found - expected) <= 0.1 + 1e-9, (x, y)
+
+
+def test_clear_maps_agree_with_checks(masks):
+
+    # A position whose clear radius is comfortably more than the clearance
+    # should be clear, and one with comfortably less shouldn't. (Close to the
+    # clearance, the two can differ, since the checks measure to the edges of
+    # the pixels.)
+
+    ra, dec = sample_positions()
+    clearance = 8.0
+    clear, messages = check_sky(make_session(masks[None]), ra, dec, clearance)
+    radius = doubles([-1.0] * len(ra))
+    with warnings.catch_warnings(record=True) as record:
+        warnings.simplefilter("always")
+        make_session(masks[None], clearmap=True).clear_radius(ra, dec, radius)
+    assert any("No clearance map covers the coordinates" in str(warning.message) for warning in record)
+    for result, found in zip(clear, radius):
+        assert (result == "nan") == math.isnan(found)
+        if result != "nan" and abs(found - clearance) > 3.0:
+            assert result == (1.0 if found > clearance else 0.0)
+
+
+def test_clear_radius_needs_clear_maps(masks):
+    session = make_session(masks[None])
+    with pytest.raises(RuntimeError, match="Clearance maps have not been enabled"):
+        session.clear_radius(doubles([CENTRE_RA]), doubles([CENTRE_DEC]), doubles([0.0]))
+
+
+# Large gzipped masks are read using several threads (zparallel.c in cfitsio),
+# with an index of restart points written next to the file the first time it
+# is read and used after that, unless it no longer matches the file. That's
+# only done for files of at least 4 MB, so these tests use a mask of 2048 by
+# 2048 pixels gzipped without compression, which gives a restart point every
+# 8 MB of the 16 MB of data.
+
+BIG_N = 2048
+BIG_CONTAMINATED = [(40, 60, 50, 80), (1000, 1010, 1020, 1030), (2000, 2048, 1900, 1910)]
+
+
+def big_positions():
+    ra = doubles([])
+    dec = doubles([])
+    for y in range(3, BIG_N, 41):
+        for x in range(5, BIG_N, 37):
+            position = mask_pixel_radec(CENTRE_RA, CENTRE_DEC, BIG_N, STEP, x, y)
+            ra.append(position[0])
+            dec.append(position[1])
+    return ra, dec
+
+
+@pytest.fixture
+def big_masks(tmp_path, monkeypatch):
+    """The large mask as a plain file and gzipped, in separate directories, and
+    the path of the index that will be written for the gzipped one."""
+    monkeypatch.setenv("CFITSIO_GZIP_THREADS", "4")
+    plain = tmp_path / "plain"
+    zipped = tmp_path / "gz"
+    plain.mkdir()
+    zipped.mkdir()
+    write_mask(plain, CENTRE_RA, CENTRE_DEC, BIG_N, STEP, *BIG_CONTAMINATED)
+    path = write_mask(zipped, CENTRE_RA, CENTRE_DEC, BIG_N, STEP, *BIG_CONTAMINATED,
+                      compression="gz", level=0)
+    return plain, zipped, path.with_name(path.name + ".gzidx")
+
+
+def test_gzip_index(big_masks):
+    plain, zipped, index = big_masks
+    ra, dec = big_positions()
+    expected = check_sky(make_session(plain), ra, dec, 6.0)
+    assert check_sky(make_session(zipped), ra, dec, 6.0) == expected
+    assert index.read_bytes()[:7] == b"GZIDX02"
+    written = index.stat()
+
+    # The second reading uses the index, so it isn't written again (which
+    # would replace the file).
+
+    assert check_sky(make_session(zipped), ra, dec, 6.0) == expected
+    assert index.stat().st_ino == written.st_ino
+    assert index.stat().st_mtime_ns == written.st_mtime_ns
+
+
+def test_stale_gzip_index(big_masks):
+
+    # The mask is replaced by one of the same size and modification time
+    # showing different contamination. The index no longer matches it, and
+    # must not be used.
+
+    plain, zipped, index = big_masks
+    ra, dec = big_positions()
+    check_sky(make_session(zipped), ra, dec, 6.0)
+    stale = index.read_bytes()
+    path = next(zipped.glob("*.gz"))
+    times = path.stat()
+    changed = [(x0 + 100, x1 + 100, y0, y1) for x0, x1, y0, y1 in BIG_CONTAMINATED[:-1]]
+    write_mask(plain, CENTRE_RA, CENTRE_DEC, BIG_N, STEP, *changed)
+    write_mask(zipped, CENTRE_RA, CENTRE_DEC, BIG_N, STEP, *changed, compression="gz", level=0)
+    os.utime(path, ns=(times.st_atime_ns, times.st_mtime_ns))
+    expected = check_sky(make_session(plain), ra, dec, 6.0)
+    assert check_sky(make_session(zipped), ra, dec, 6.0) == expected
+    assert index.read_bytes() != stale
+
+
+@pytest.mark.parametrize("damage", ["garbage", "truncated", "restart point"])
+def test_corrupt_gzip_index(big_masks, damage):
+
+    # However the index is damaged, the mask is still read correctly, and the
+    # index is written again.
+
+    plain, zipped, index = big_masks
+    ra, dec = big_positions()
+    expected = check_sky(make_session(plain), ra, dec, 6.0)
+    check_sky(make_session(zipped), ra, dec, 6.0)
+    written = index.read_bytes()
+    if damage == "garbage":
+        index.write_bytes(bytes((i * 37) & 0xff for i in range(len(written))))
+    elif damage == "truncated":
+        index.write_bytes(written[:len(written) // 2])
+    else:
+
+        # Moves the second restart point's offset in the compressed data,
+        # which follows the 48 byte header and the 32 byte record of the first.
+
+        damaged = bytearray(written)
+        damaged[80] ^= 0x55
+        index.write_bytes(bytes(damaged))
+    assert check_sky(make_session(zipped), ra, dec, 6.0) == expected
+    assert index.read_bytes() == written